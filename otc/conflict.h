@@ -4,6 +4,10 @@
 #include "otc/induced_tree.h"
 #include "otc/tree_operations.h"
 #include "otc/supertree_util.h" // for count_leaves( )
+#include "otc/work_stealing_pool.h"
+#include <algorithm>
+#include <optional>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -44,35 +48,20 @@ void compute_tips(Tree_t& tree) {
     }
 }
 
-template <typename N>
-std::vector<N*> leaf_nodes_below(N* node) {
-    std::vector<N*> nodes;
-    for(auto nd: iter_leaf_n_const(*node)) {
-        nodes.push_back(nd);
-    }
-    return nodes;
-}
-
-template <typename N>
-auto map_to_summary(const std::vector<const N*>& nodes)
-{
-    std::vector<N*> nodes2(nodes.size(),nullptr);
-    for(int i=0;i<(int)nodes2.size();i++)
-        nodes2[i] = summary_node(nodes[i]);
-    return nodes2;
-}
-
 struct ConflictNode
 {
     int depth = 0; // depth = number of nodes to the root of the tree including the  endpoints (so depth of root = 1)
     int n_tips = 0;
     int n_include_tips = 0;
+    int preorder = 0; // the index of this node in a preorder traversal of its tree, set by perform_conflict_analysis( )
     otc::RootedTreeNode<ConflictNode>* summary_node;
 };
 
-using ConflictTree = otc::RootedTree<ConflictNode, otc::RTreeNoData>;
+template<>
+struct uses_node_arena<ConflictNode, otc::RTreeNoData> : std::true_type {
+};
 
-using node_logger_t = std::function<void(const ConflictTree::node_type* node2, const ConflictTree::node_type* node1)>;
+using ConflictTree = otc::RootedTree<ConflictNode, otc::RTreeNoData>;
 
 inline ConflictTree::node_type* summary_node(const ConflictTree::node_type* node)
 {
@@ -120,22 +109,25 @@ auto all_nodes_postorder(T& tree)
 // * Each non-monotypic node of T1 will equal (supported_by/partial_path_of), conflict with, or be a terminal of nodes in T2.
 // * A node of T1 can equal one node of T2 (supported_by) or several nodes of T2 (partial_path_of).
 // * A node of T1 can conflict with several nodes of T2.
-
-inline void perform_conflict_analysis(ConflictTree& induced_tree1,
-                                      ConflictTree& induced_tree2,
-                                      node_logger_t log_supported_by,
-                                      node_logger_t log_partial_path_of,
-                                      node_logger_t log_conflicts_with,
-                                      node_logger_t log_resolved_by,
-                                      node_logger_t log_terminal) {
+//
+// The log_* functions can be any callables that take (const node_type* node2, const node_type* node1).
+//
+// The nodes of induced_tree2 are numbered in preorder, and the marks made while mapping a node of
+//   induced_tree1 are kept in arrays indexed by that number, so that mapping a node does not allocate.
+template <typename LogSupportedBy, typename LogPartialPathOf, typename LogConflictsWith, typename LogResolvedBy, typename LogTerminal>
+void perform_conflict_analysis(ConflictTree& induced_tree1,
+                               ConflictTree& induced_tree2,
+                               LogSupportedBy log_supported_by,
+                               LogPartialPathOf log_partial_path_of,
+                               LogConflictsWith log_conflicts_with,
+                               LogResolvedBy log_resolved_by,
+                               LogTerminal log_terminal) {
     typedef ConflictTree::node_type node_type;
 
     // 1. Record depth of nodes, in order to compute MRCAs.
     compute_depth(induced_tree1);
     compute_depth(induced_tree2);
 
-    std::function<node_type*(node_type*,node_type*)> mrca_of_pair = [](node_type* n1, node_type* n2) {return mrca_from_depth(n1,n2);};
-
     // 2. Record the number of tips <= each node, to determine when MRCAs contain more descendants than expected.
     compute_tips(induced_tree1);
     compute_tips(induced_tree2);
@@ -150,25 +142,38 @@ inline void perform_conflict_analysis(ConflictTree& induced_tree1,
         auto leaf2 = map2.at(leaf->get_ott_id());
         summary_node(leaf) = leaf2;
     }
-        
-    // 4. Walk the nodes of induced_tree1 postorder, mapping them onto induced_tree2
-    std::vector<ConflictTree::node_type*> conflicts;
 
+    // 4. Number the nodes of induced_tree2, and allocate the marks and buffers used for each node of induced_tree1.
+    int n2 = 0;
+    for(auto nd: iter_pre(induced_tree2)) {
+        nd->get_data().preorder = n2++;
+    }
+    auto preorder = [](const node_type* nd) {return nd->get_data().preorder;};
+    std::vector<char> is_induced(n2, 0);          // is the node on the path from a leaf to the MRCA?
+    std::vector<int> n_induced_children(n2, 0);   // how many of its children are, and have not yet been counted?
+
+    std::vector<node_type*> leaves2;   // the nodes of induced_tree2 that the leaves below nd1 map to
+    std::vector<node_type*> nodes;     // the nodes on the paths from leaves2 to their MRCA
+    std::vector<node_type*> ready;     // the nodes whose n_include_tips is complete, children first
+    std::vector<node_type*> conflicts;
+    std::vector<node_type*> destroyed;
+
+    // 5. Walk the nodes of induced_tree1 postorder, mapping them onto induced_tree2
     for(auto nd1: all_nodes_postorder(induced_tree1))
     {
-        // 4.1 Quit when we get to a parent of all leaves.
+        // 5.1 Quit when we get to a parent of all leaves.
         //     (This could be the root, or a child of a monotypic root.)
         if (nd1->get_data().n_tips == (int)L) break;
 
         // If we've gotten here, this should not be the root.
         assert(nd1->get_parent());
 
-        // 4.2 Ignore knuckles in input trees.
+        // 5.2 Ignore knuckles in input trees.
         //     (Note that in general, if we've pruned this tree down to match the shared taxon set
         //      then this could produce knuckles that were not originally there.)
         if (nd1->is_outdegree_one_node()) continue;
 
-        // 4.3 If this node is a tip, the mark the corresponding nodes
+        // 5.3 If this node is a tip, the mark the corresponding nodes
         if (nd1->is_tip()) {
             auto nd2 = summary_node(nd1);
             log_terminal(nd2, nd1);
@@ -179,48 +184,63 @@ inline void perform_conflict_analysis(ConflictTree& induced_tree1,
             continue;
         }
 
-        // Find the list of nodes in the input tree that are below nd.
-        std::vector<const node_type*> leaves1 = leaf_nodes_below(const_cast<const node_type*>(nd1));
+        // Find the nodes in the summary tree that correspond to the leaves below nd1.
+        leaves2.clear();
+        for(auto leaf: iter_leaf_n_const(*const_cast<const node_type*>(nd1))) {
+            leaves2.push_back(summary_node(leaf));
+        }
 
         // Since nd is not a tip, and not monotypic, it should have at least 2 leaves below it.
-        assert(leaves1.size() >= 2);
-
-        int L2 = 0;
-        for(auto nd: leaves1) {
-            L2 += n_tips(nd);
+        assert(leaves2.size() >= 2);
+
+        // Each leaf below nd1 stands for n_tips of the original leaves, so this is their total.
+        const int L2 = n_tips(nd1);
+
+        // The MRCA of a set of nodes is the MRCA of the first and last of them in preorder.
+        auto [first2, last2] = std::minmax_element(leaves2.begin(), leaves2.end(), [&](auto x, auto y) {return preorder(x) < preorder(y);});
+        node_type* MRCA = mrca_from_depth(*first2, *last2);
+
+        // Find the nodes in the induced tree of those nodes, counting the induced children of each.
+        nodes.clear();
+        is_induced[preorder(MRCA)] = 1;
+        nodes.push_back(MRCA);
+        for(auto leaf: leaves2) {
+            if (is_induced[preorder(leaf)]) continue;
+            is_induced[preorder(leaf)] = 1;
+            nodes.push_back(leaf);
+            for(auto nd = leaf; ; nd = nd->get_parent()) {
+                auto p = nd->get_parent();
+                assert(p);
+                n_induced_children[preorder(p)]++;
+                if (is_induced[preorder(p)]) break;
+                is_induced[preorder(p)] = 1;
+                nodes.push_back(p);
+            }
         }
 
-        // Find the corresponding list of nodes in the summary tree
-        std::vector<node_type*> leaves2 = map_to_summary(leaves1);
-
-        // The MRCA should be the last node in the vector.
-        node_type* MRCA = MRCA_of_group(leaves2, mrca_of_pair);
-
-        // Find the nodes in the induced tree of those nodes
-        std::set<node_type*> node_set = find_induced_nodes(leaves2, MRCA);
-        std::vector<node_type*> nodes;
-        for(auto n: node_set) {
-            nodes.push_back(n);
+        // The n_include_tips for a parent node should count the n_include_tips for this node.
+        // A node is ready once all its induced children have been counted, so children come before their parents.
+        ready.clear();
+        for(auto nd: nodes) {
+            if (nd != MRCA and n_induced_children[preorder(nd)] == 0) {
+                ready.push_back(nd);
+            }
         }
-
-        // Sort the nodes by depth to ensure all children occur before their parents -- unfortunately n*log(n) !
-        std::sort(nodes.begin(), nodes.end(), [](auto x, auto y){return depth(x) > depth(y);});
-
-        // The n_include_tips for a parent node should count the n_include_tips for this node
-        if (nodes.size() > 1) {
-            // Loop over all the nodes except the MRCA.
-            for(std::size_t i=0;i<nodes.size()-1;i++) {
-                auto nd = nodes[i];
-                if (nd->is_tip()) {
-                    n_include_tips(nd) = n_tips(nd);
-                }
-                auto p = nd->get_parent();
-                assert(p);
-                assert(nd != MRCA);
-                n_include_tips(p) += n_include_tips(nd);
-                assert(n_include_tips(nd) <= n_tips(nd));
-           }
+        for(std::size_t i=0;i<ready.size();i++) {
+            auto nd = ready[i];
+            if (nd->is_tip()) {
+                n_include_tips(nd) = n_tips(nd);
+            }
+            auto p = nd->get_parent();
+            assert(p);
+            assert(nd != MRCA);
+            n_include_tips(p) += n_include_tips(nd);
+            assert(n_include_tips(nd) <= n_tips(nd));
+            if (--n_induced_children[preorder(p)] == 0 and p != MRCA) {
+                ready.push_back(p);
+            }
         }
+        assert(ready.size() + 1 == nodes.size());
             
         // If MRCA includes all and only the tips under nd, then MRCA is supporting or partial_path_of
         bool conflicts_or_resolved_by = n_include_tips(MRCA) < n_tips(MRCA);
@@ -240,17 +260,23 @@ inline void perform_conflict_analysis(ConflictTree& induced_tree1,
             }
         }
 
+        // Children are reported before their parents.
         conflicts.clear();
-        for(auto nd: nodes) {
+        for(auto nd: ready) {
             // If we have (a) some, but not all of the include group
             //            (b) any of the exclude group
             if (n_include_tips(nd) < n_tips(nd) and n_include_tips(nd) < L2) {
                 conflicts.push_back(nd);
             }
         }
+        if (n_include_tips(MRCA) < n_tips(MRCA) and n_include_tips(MRCA) < L2) {
+            conflicts.push_back(MRCA);
+        }
         for(auto nd: nodes) {
             n_include_tips(nd) = 0;
+            is_induced[preorder(nd)] = 0;
         }
+        n_induced_children[preorder(MRCA)] = 0;
             
         for(auto conflicting_node: conflicts) {
             log_conflicts_with(conflicting_node, nd1);
@@ -263,30 +289,32 @@ inline void perform_conflict_analysis(ConflictTree& induced_tree1,
 #ifdef CHECK_MARKS
         for(const auto nd2: iter_post_const(induced_tree2)){
             assert(n_include_tips(nd2) == 0);
+            assert(not is_induced[preorder(nd2)] and n_induced_children[preorder(nd2)] == 0);
         }
 #endif
 
         // nd -> MRCA
         if (not conflicts_or_resolved_by) {
             summary_node(nd1) = MRCA;
-            destroy_children(nd1);
-            destroy_children(MRCA);
+            destroy_children(induced_tree1, nd1, destroyed);
+            destroy_children(induced_tree2, MRCA, destroyed);
         }
     }
 }
 
-template <typename Tree1_t, typename Tree2_t>
+template <typename Tree1_t, typename Tree2_t,
+          typename LogSupportedBy, typename LogPartialPathOf, typename LogConflictsWith, typename LogResolvedBy, typename LogTerminal>
 void perform_conflict_analysis(Tree1_t& tree1,
                                const std::unordered_map<OttId, node_type<Tree1_t>*>& ottid_to_node1,
                                std::function<node_type<Tree1_t>*(node_type<Tree1_t>*,node_type<Tree1_t>*)> MRCA_of_pair1,
                                Tree2_t& tree2,
                                const std::unordered_map<OttId, node_type<Tree2_t>*>& ottid_to_node2,
                                std::function<node_type<Tree2_t>*(node_type<Tree2_t>*,node_type<Tree2_t>*)> MRCA_of_pair2,
-                               node_logger_t log_supported_by,
-                               node_logger_t log_partial_path_of,
-                               node_logger_t log_conflicts_with,
-                               node_logger_t log_resolved_by,
-                               node_logger_t log_terminal) {
+                               LogSupportedBy log_supported_by,
+                               LogPartialPathOf log_partial_path_of,
+                               LogConflictsWith log_conflicts_with,
+                               LogResolvedBy log_resolved_by,
+                               LogTerminal log_terminal) {
     auto induced_tree1 = get_induced_tree<ConflictTree>(tree1,
                                                         ottid_to_node1,
                                                         MRCA_of_pair1,
@@ -301,5 +329,31 @@ void perform_conflict_analysis(Tree1_t& tree1,
     return perform_conflict_analysis(*induced_tree1, *induced_tree2, log_supported_by, log_partial_path_of, log_conflicts_with, log_resolved_by, log_terminal);
 }
 
+// Runs analyze(i) for each of n input trees on the threads of pool, and then calls
+//   merge(i, result) for each of them on the calling thread, in input order.
+//
+// analyze( ) should load input tree i and compare it with the (shared) summary tree, which
+//   perform_conflict_analysis( ) only reads; everything that it writes -- the input tree,
+//   the induced trees and their n_include_tips marks -- belongs to that one call. Merging
+//   in input order makes the output independent of the number of threads. Inputs are taken
+//   in batches, so that only the results of one batch are held at a time.
+template <typename Analyze, typename Merge>
+void analyze_in_parallel(WorkStealingPool & pool, std::size_t n, Analyze analyze, Merge merge) {
+    using result_t = std::invoke_result_t<Analyze &, std::size_t>;
+    const std::size_t batch_size = 16 * (pool.num_threads() + 1);
+    std::vector<std::optional<result_t>> results;
+    for (std::size_t first = 0; first < n; first += batch_size) {
+        const std::size_t num = std::min(batch_size, n - first);
+        results.clear();
+        results.resize(num);
+        pool.parallel_for(num, [&](std::size_t i) {
+            results[i].emplace(analyze(first + i));
+        });
+        for (std::size_t i = 0; i < num; ++i) {
+            merge(first + i, std::move(*results[i]));
+        }
+    }
+}
+
 } // namespace otc
 #endif
@@ -3,6 +3,11 @@
 #include "otc/tnrs/context.h"
 #include "otc/taxonomy/taxonomy.h"
 #include "otc/taxonomy/flags.h"
+#include "otc/snapshot.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 using std::set;
 using std::string;
@@ -22,8 +27,11 @@ ContextAwareCTrieBasedDB::ContextAwareCTrieBasedDB(const Context &context_arg,
     const auto & rt_data = rich_tax_tree.get_data();
     std::set<std::string> all_names;
     auto insert_hint = all_names.begin();
-    for (auto& [name, node] : rt_data.name_to_node)
+    // The indexes are walked in name order, so that the taxa that share a normalized
+    //    name are listed in the same order from run to run.
+    for (auto name : sorted_names(rt_data.name_to_node))
     {
+        const auto node = rt_data.name_to_node.at(name);
         // node could be nullptr here if this is a homonym, see note in taxonomy.h
         if (node)
         {
@@ -33,7 +41,8 @@ ContextAwareCTrieBasedDB::ContextAwareCTrieBasedDB(const Context &context_arg,
         }
     }
     insert_hint = all_names.begin();
-    for (auto& [name, nodes] : rt_data.homonym_to_nodes) {
+    for (auto name : sorted_names(rt_data.homonym_to_nodes)) {
+        const auto & nodes = rt_data.homonym_to_nodes.at(name);
         auto nn = normalize_query(name);
         for (auto hnp : nodes) {
             assert(hnp);
@@ -43,14 +52,16 @@ ContextAwareCTrieBasedDB::ContextAwareCTrieBasedDB(const Context &context_arg,
     }
     // filtered
     insert_hint = all_names.begin();
-    for (auto& [name, record] : rt_data.name_to_record) {
+    for (auto name : sorted_names(rt_data.name_to_record)) {
+        const auto record = rt_data.name_to_record.at(name);
         auto nn = normalize_query(name);
         assert(record);
         match_name_to_taxon[nn].push_back(const_rich_taxon_and_syn_ptr{nullptr, (const void *)record});
         insert_hint = all_names.insert(insert_hint, nn);
     }
     insert_hint = all_names.begin();
-    for (auto& [name, records] : rt_data.homonym_to_record) {
+    for (auto name : sorted_names(rt_data.homonym_to_record)) {
+        const auto & records = rt_data.homonym_to_record.at(name);
         auto nn = normalize_query(name);
         for (auto hrp : records) {
             assert(hrp);
@@ -66,6 +77,7 @@ ContextAwareCTrieBasedDB::ContextAwareCTrieBasedDB(const Context &context_arg,
     
     trie.initialize(all_names);
     context_arg.name_matcher = &trie;
+    init_context_tries(taxonomy);
 }
 
 
@@ -78,6 +90,184 @@ ContextAwareCTrieBasedDB::ContextAwareCTrieBasedDB(const Context &context_arg,
 }
 
 
+enum class NameMatchKind : std::uint32_t {
+    TAXON = 0,
+    FILTERED_RECORD = 1,
+    SYNONYM = 2
+};
+
+struct NameMatchSnapshotRecord {
+    SnapshotStr name;
+    std::uint64_t first_ref;
+    std::uint64_t num_refs;
+};
+
+// node_index is the snapshot (preorder) index of the taxon. aux is the OTT Id of
+//    a filtered record or the index of a synonym in the synonyms list.
+struct TaxonRefSnapshotRecord {
+    std::uint32_t kind;
+    std::uint32_t node_index;
+    std::int64_t aux;
+};
+
+void ContextAwareCTrieBasedDB::write_snapshot(SnapshotWriter & snapshot, const RichTaxonomy & taxonomy) const {
+    const auto nodes = taxonomy_nodes_in_snapshot_order(taxonomy.get_tax_tree());
+    std::unordered_map<const RTRichTaxNode *, std::uint32_t> node_index;
+    node_index.reserve(nodes.size());
+    for (std::uint32_t i = 0; i < nodes.size(); ++i) {
+        node_index[nodes[i]] = i;
+    }
+    std::unordered_map<const void *, std::int64_t> syn_index;
+    std::int64_t si = 0;
+    for (const auto & tjs : taxonomy.get_synonyms_list()) {
+        syn_index[(const void *)(&tjs)] = si++;
+    }
+    SnapshotStringPool pool;
+    vector<NameMatchSnapshotRecord> names;
+    vector<TaxonRefSnapshotRecord> refs;
+    names.reserve(match_name_to_taxon.size());
+    for (const auto & [name, taxon_and_syn_ptrs] : match_name_to_taxon) {
+        names.push_back(NameMatchSnapshotRecord{pool.add(name), refs.size(), taxon_and_syn_ptrs.size()});
+        for (const auto & [tax_ptr, rec_or_syn_ptr] : taxon_and_syn_ptrs) {
+            TaxonRefSnapshotRecord ref{0, 0, 0};
+            if (tax_ptr == nullptr) {
+                ref.kind = static_cast<std::uint32_t>(NameMatchKind::FILTERED_RECORD);
+                ref.aux = ((const TaxonomyRecord *) rec_or_syn_ptr)->id;
+            } else {
+                ref.node_index = node_index.at(tax_ptr);
+                if (rec_or_syn_ptr == nullptr) {
+                    ref.kind = static_cast<std::uint32_t>(NameMatchKind::TAXON);
+                } else {
+                    ref.kind = static_cast<std::uint32_t>(NameMatchKind::SYNONYM);
+                    ref.aux = syn_index.at(rec_or_syn_ptr);
+                }
+            }
+            refs.push_back(ref);
+        }
+    }
+    snapshot.write_string(pool.contents());
+    snapshot.write_vector(names);
+    snapshot.write_vector(refs);
+    trie.write_snapshot(snapshot);
+}
+
+ContextAwareCTrieBasedDB::ContextAwareCTrieBasedDB(const Context &context_arg,
+                                                   const RichTaxonomy &taxonomy,
+                                                   SnapshotReader & snapshot)
+    :context(context_arg) {
+    Context::init_nom_codes_boundaries(taxonomy);
+    if (context_arg.name_matcher != nullptr) {
+        return; // already initialized
+    }
+    const auto nodes = taxonomy_nodes_in_snapshot_order(taxonomy.get_tax_tree());
+    vector<const void *> synonyms;
+    for (const auto & tjs : taxonomy.get_synonyms_list()) {
+        synonyms.push_back((const void *)(&tjs));
+    }
+    const auto & id_to_record = taxonomy.get_tax_tree().get_data().id_to_record;
+    const std::string_view pool = snapshot.read_string();
+    auto [names, num_names] = snapshot.read_array<NameMatchSnapshotRecord>();
+    auto [refs, num_refs] = snapshot.read_array<TaxonRefSnapshotRecord>();
+    match_name_to_taxon.reserve(num_names);
+    for (std::size_t i = 0; i < num_names; ++i) {
+        const auto & nr = names[i];
+        if (nr.first_ref + nr.num_refs > num_refs) {
+            throw OTCError() << "Name match reference out of range in snapshot \"" << snapshot.get_path() << "\"";
+        }
+        vec_taxon_and_syn_ptrs taxon_and_syn_ptrs;
+        taxon_and_syn_ptrs.reserve(nr.num_refs);
+        for (auto j = nr.first_ref; j < nr.first_ref + nr.num_refs; ++j) {
+            const auto & ref = refs[j];
+            switch (static_cast<NameMatchKind>(ref.kind)) {
+                case NameMatchKind::TAXON:
+                    taxon_and_syn_ptrs.push_back(const_rich_taxon_and_syn_ptr{nodes.at(ref.node_index), nullptr});
+                    break;
+                case NameMatchKind::FILTERED_RECORD:
+                    taxon_and_syn_ptrs.push_back(const_rich_taxon_and_syn_ptr{nullptr, (const void *)id_to_record.at(ref.aux)});
+                    break;
+                case NameMatchKind::SYNONYM:
+                    taxon_and_syn_ptrs.push_back(const_rich_taxon_and_syn_ptr{nodes.at(ref.node_index), synonyms.at(ref.aux)});
+                    break;
+                default:
+                    throw OTCError() << "Unknown name match kind in snapshot \"" << snapshot.get_path() << "\"";
+            }
+        }
+        match_name_to_taxon.emplace(string(snapshot_str_to_view(pool, nr.name)),
+                                    std::move(taxon_and_syn_ptrs));
+    }
+    trie.read_snapshot(snapshot);
+    context_arg.name_matcher = &trie;
+    init_context_tries(taxonomy);
+}
+
+// A context gets a trie of its own only if it has at most this fraction of the names.
+//  Searching the trie of all names is not much slower for the larger ones, and their
+//  tries would add a lot of memory.
+constexpr double MAX_CONTEXT_TRIE_FRACTION = 1.0/3.0;
+
+void ContextAwareCTrieBasedDB::init_context_tries(const RichTaxonomy & taxonomy) {
+    const auto tree_root = taxonomy.get_tax_tree().get_root();
+    for (const auto & ctx : all_contexts) {
+        const auto root = taxonomy.included_taxon_from_id(ctx.ott_id);
+        if (root == nullptr or root == tree_root) {
+            continue;
+        }
+        bool seen = std::any_of(context_tries.begin(), context_tries.end(),
+                                [root](const auto & ct) { return ct->root == root; });
+        if (not seen) {
+            auto ct = std::make_unique<ContextTrie>();
+            ct->context = &ctx;
+            ct->root = root;
+            context_tries.push_back(std::move(ct));
+        }
+    }
+}
+
+void ContextAwareCTrieBasedDB::build_context_trie(ContextTrie & ct) const {
+    const auto & root_data = ct.root->get_data();
+    std::set<std::string> keys;
+    for (const auto & [name, taxon_and_syn_ptrs] : match_name_to_taxon) {
+        for (const auto & cand : taxon_and_syn_ptrs) {
+            if (cand.first == nullptr) {
+                continue;
+            }
+            const auto e = cand.first->get_data().trav_enter;
+            if (root_data.trav_enter <= e and e <= root_data.trav_exit) {
+                keys.insert(name);
+                break;
+            }
+        }
+    }
+    if (keys.size() > MAX_CONTEXT_TRIE_FRACTION * match_name_to_taxon.size()) {
+        LOG(INFO) << "Context \"" << ct.context->name << "\" has " << keys.size() << " of the "
+                  << match_name_to_taxon.size() << " names, so its fuzzy queries search all names.";
+    } else {
+        LOG(INFO) << "Building the trie of the " << keys.size() << " names in context \"" << ct.context->name << "\".";
+        ct.trie = std::make_unique<CompressedTrieBasedDB>();
+        ct.trie->initialize(keys);
+    }
+    ct.built = true;
+}
+
+const CompressedTrieBasedDB * ContextAwareCTrieBasedDB::context_trie_for(const RTRichTaxNode * context_root) const {
+    const auto & data = context_root->get_data();
+    ContextTrie * smallest = nullptr;
+    for (const auto & ct : context_tries) {
+        const auto & root_data = ct->root->get_data();
+        if (root_data.trav_enter <= data.trav_enter and data.trav_exit <= root_data.trav_exit) {
+            if (smallest == nullptr
+                or root_data.trav_exit - root_data.trav_enter < smallest->root->get_data().trav_exit - smallest->root->get_data().trav_enter) {
+                smallest = ct.get();
+            }
+        }
+    }
+    if (smallest == nullptr) {
+        return nullptr;
+    }
+    std::call_once(smallest->build_once, [this, smallest] { build_context_trie(*smallest); });
+    return smallest->trie.get();
+}
+
 std::set<FuzzyQueryResult, SortQueryResByNearness> ContextAwareCTrieBasedDB::fuzzy_query(const std::string & query_str) const {
     std::set<FuzzyQueryResult, SortQueryResByNearness> sorted;
     if (context.name_matcher != nullptr) {
@@ -105,13 +295,38 @@ vector<string> ContextAwareCTrieBasedDB::prefix_query(const std::string & query_
 }
 
 using vec_fqr_w_t = std::vector<FuzzyQueryResultWithTaxon>;
+
+vec_taxon_and_syn_ptrs ContextAwareCTrieBasedDB::filter_to_context(const vec_taxon_and_syn_ptrs & candidates,
+                                                                   const RTRichTaxNode * context_root,
+                                                                   bool include_suppressed) {
+    // The context's interval is loaded once, so each candidate costs two comparisons.
+    const auto & ctx_data = context_root->get_data();
+    const auto ctx_enter = ctx_data.trav_enter;
+    const auto ctx_exit = ctx_data.trav_exit;
+    vec_taxon_and_syn_ptrs filtered;
+    filtered.reserve(candidates.size());
+    for (const auto & cand : candidates) {
+        const RTRichTaxNode * tax_ptr = cand.first;
+        if (tax_ptr == nullptr) {
+            if (include_suppressed) {
+                filtered.push_back(cand);
+            }
+        } else {
+            const auto e = tax_ptr->get_data().trav_enter;
+            if (ctx_enter <= e and e <= ctx_exit) {
+                filtered.push_back(cand);
+            }
+        }
+    }
+    return filtered;
+}
+
 vec_fqr_w_t ContextAwareCTrieBasedDB::to_taxa(const set<FuzzyQueryResult, SortQueryResByNearness>& sorted,
                                               const RTRichTaxNode * context_root,
                                               const RichTaxonomy & /*taxonomy*/, 
                                               bool include_suppressed) const {
     LOG(DEBUG) << "to_taxa(context_id = " << context_root->get_ott_id() << ", ... , included_suppressed ="  << include_suppressed << ")";
     vec_fqr_w_t results;
-    const auto & tax_data = context_root->get_data();
 
     if (sorted.empty()) {
         LOG(DEBUG) << "no matches";
@@ -119,27 +334,20 @@ vec_fqr_w_t ContextAwareCTrieBasedDB::to_taxa(const set<FuzzyQueryResult, SortQu
     for (auto fqr : sorted) {
         const auto & vec_taxon_and_syn_ptrs = match_name_to_taxon.at(fqr.match());
 //        LOG(DEBUG) << "FuzzyQueryResult(match=\"" << fqr.match() << "\", score = " << fqr.score << ") -> vec size = " << vec_taxon_and_syn_ptrs.size();
-        for (auto & [tax_ptr, tax_thing] : vec_taxon_and_syn_ptrs)
+        for (auto & [tax_ptr, tax_thing] : filter_to_context(vec_taxon_and_syn_ptrs, context_root, include_suppressed))
         {
             if (tax_ptr == nullptr) {
                 LOG(DEBUG) << "matched suppressed and include_suppressed = " << include_suppressed;
-                if (include_suppressed) {
-                    const TaxonomyRecord * tr = (const TaxonomyRecord *)(tax_thing);
-                    results.push_back(FuzzyQueryResultWithTaxon(fqr, tr));
-                }
+                const TaxonomyRecord * tr = (const TaxonomyRecord *)(tax_thing);
+                results.push_back(FuzzyQueryResultWithTaxon(fqr, tr));
             } else {
-                const auto & res_tax_data = tax_ptr->get_data();
-
-                if (is_ancestor_of_using_depth(context_root, tax_ptr))
-                {
-                    const TaxonomicJuniorSynonym * syn_ptr = (const TaxonomicJuniorSynonym *)(tax_thing);
-                    if (syn_ptr == nullptr) {
-                        LOG(DEBUG) << "pushing non-syn";
-                        results.push_back(FuzzyQueryResultWithTaxon(fqr, tax_ptr));
-                    } else {
-                        LOG(DEBUG) << "pushing synonym";
-                        results.push_back(FuzzyQueryResultWithTaxon(fqr, tax_ptr,  syn_ptr));
-                    }
+                const TaxonomicJuniorSynonym * syn_ptr = (const TaxonomicJuniorSynonym *)(tax_thing);
+                if (syn_ptr == nullptr) {
+                    LOG(DEBUG) << "pushing non-syn";
+                    results.push_back(FuzzyQueryResultWithTaxon(fqr, tax_ptr));
+                } else {
+                    LOG(DEBUG) << "pushing synonym";
+                    results.push_back(FuzzyQueryResultWithTaxon(fqr, tax_ptr,  syn_ptr));
                 }
             }
         }
@@ -147,6 +355,32 @@ vec_fqr_w_t ContextAwareCTrieBasedDB::to_taxa(const set<FuzzyQueryResult, SortQu
     return results;
 }
 
+// Appends the TaxonResult for each of the (already filtered) matches of a name.
+static void append_taxon_results(vector<TaxonResult> & results, const vec_taxon_and_syn_ptrs & matches) {
+    for (auto & [tax_ptr, rec_or_syn_ptr] : matches)
+    {
+        if (tax_ptr == nullptr)
+        {
+            const TaxonomyRecord * tr = (const TaxonomyRecord *) rec_or_syn_ptr;
+            results.push_back(TaxonResult(tr));
+        }
+        else
+        {
+            const TaxonomicJuniorSynonym * syn_ptr = (const TaxonomicJuniorSynonym *) rec_or_syn_ptr;
+            if (syn_ptr == nullptr)
+            {
+                LOG(DEBUG) << "pushing non-syn";
+                results.push_back(TaxonResult(tax_ptr));
+            }
+            else
+            {
+                LOG(DEBUG) << "pushing synonym";
+                results.push_back(TaxonResult(tax_ptr,  syn_ptr));
+            }
+        }
+    }
+}
+
 vector<TaxonResult>
 ContextAwareCTrieBasedDB::to_taxa(const optional<string>& n_query,
                                   const RTRichTaxNode * context_root,
@@ -160,40 +394,9 @@ ContextAwareCTrieBasedDB::to_taxa(const optional<string>& n_query,
     }
 
     vector<TaxonResult> results;
-    const auto & tax_data = context_root->get_data();
-
     const auto & vec_taxon_and_syn_ptrs = match_name_to_taxon.at(*n_query);
     LOG(DEBUG) << "exact_query(match=\"" << *n_query << ") -> vec size = " << vec_taxon_and_syn_ptrs.size();
-    for (auto & [tax_ptr, rec_or_syn_ptr] : vec_taxon_and_syn_ptrs)
-    {
-        if (tax_ptr == nullptr)
-        {
-            LOG(DEBUG) << "matched suppressed and include_suppressed = " << include_suppressed;
-            if (include_suppressed)
-            {
-                const TaxonomyRecord * tr = (const TaxonomyRecord *) rec_or_syn_ptr;
-                results.push_back(TaxonResult(tr));
-            }
-        }
-        else
-        {
-            const auto & res_tax_data = tax_ptr->get_data();
-            if (is_ancestor_of_using_depth(context_root, tax_ptr))
-            {
-                const TaxonomicJuniorSynonym * syn_ptr = (const TaxonomicJuniorSynonym *) rec_or_syn_ptr;
-                if (syn_ptr == nullptr)
-                {
-                    LOG(DEBUG) << "pushing non-syn";
-                    results.push_back(TaxonResult(tax_ptr));
-                }
-                else
-                {
-                    LOG(DEBUG) << "pushing synonym";
-                    results.push_back(TaxonResult(tax_ptr,  syn_ptr));
-                }
-            }
-        }
-    }
+    append_taxon_results(results, filter_to_context(vec_taxon_and_syn_ptrs, context_root, include_suppressed));
     return results;
 }
 
@@ -210,53 +413,87 @@ ContextAwareCTrieBasedDB::to_taxa(const vector<string>& n_queries,
     }
 
     vector<TaxonResult> results;
-
-    const auto & tax_data = context_root->get_data();
-
     for(auto& n_query: n_queries)
     {
         const auto & vec_taxon_and_syn_ptrs = match_name_to_taxon.at(n_query);
         LOG(DEBUG) << "prefix_query(match=\"" << n_query << ") -> vec size = " << vec_taxon_and_syn_ptrs.size();
-        for (auto & [tax_ptr, rec_or_syn_ptr] : vec_taxon_and_syn_ptrs)
-        {
-            if (tax_ptr == nullptr)
-            {
-                LOG(DEBUG) << "matched suppressed and include_suppressed = " << include_suppressed;
-                if (include_suppressed)
-                {
-                    const TaxonomyRecord * tr = (const TaxonomyRecord *) rec_or_syn_ptr;
-                    results.push_back(TaxonResult(tr));
-                }
-            }
-            else
-            {
-                const auto & res_tax_data = tax_ptr->get_data();
-                if (is_ancestor_of_using_depth(context_root, tax_ptr))
-                {
-                    const TaxonomicJuniorSynonym * syn_ptr = (const TaxonomicJuniorSynonym *) rec_or_syn_ptr;
-                    if (syn_ptr == nullptr)
-                    {
-                        LOG(DEBUG) << "pushing non-syn";
-                        results.push_back(TaxonResult(tax_ptr));
-                    }
-                    else
-                    {
-                        LOG(DEBUG) << "pushing synonym";
-                        results.push_back(TaxonResult(tax_ptr,  syn_ptr));
-                    }
-                }
-            }
-        }
+        append_taxon_results(results, filter_to_context(vec_taxon_and_syn_ptrs, context_root, include_suppressed));
     }
     return results;
 }
 
+const CompressedTrieBasedDB * ContextAwareCTrieBasedDB::matcher_for(const RTRichTaxNode * context_root,
+                                                                     bool include_suppressed) const {
+    // Filtered records are not in any context, so the context tries don't have their names.
+    const CompressedTrieBasedDB * context_trie = include_suppressed ? nullptr : context_trie_for(context_root);
+    return context_trie != nullptr ? context_trie : context.name_matcher;
+}
+
 vec_fqr_w_t ContextAwareCTrieBasedDB::fuzzy_query_to_taxa(const std::string & query_str,
                                                           const RTRichTaxNode * context_root,
                                                           const RichTaxonomy & taxonomy,
                                                           bool include_suppressed) const {
     LOG(DEBUG) << "fuzzy_query_to_taxa(" << query_str << ", context_id = " << context_root->get_ott_id() << ", ... , included_suppressed ="  << include_suppressed << ")";
-    return to_taxa(fuzzy_query(query_str),  context_root, taxonomy, include_suppressed);
+    auto matcher = matcher_for(context_root, include_suppressed);
+    if (matcher == nullptr) {
+        return {};
+    }
+    return to_taxa(matcher->fuzzy_query(query_str), context_root, taxonomy, include_suppressed);
+}
+
+// One search that starts out allowing the usual number of edits, and allows fewer as
+//  matches come in. A name with e edits has at most |query| + e letters, so it scores at
+//  most |query|/(|query| + e). Once k taxa have been matched, names with so many edits
+//  that this is below the k-th best score can't be among the best k, and the search
+//  skips the parts of the trie that only lead to them. When there are fewer than k
+//  matches this is just the full search.
+vec_fqr_w_t ContextAwareCTrieBasedDB::fuzzy_query_top_k(const std::string & query_str,
+                                                        std::size_t k,
+                                                        const RTRichTaxNode * context_root,
+                                                        const RichTaxonomy & taxonomy,
+                                                        bool include_suppressed) const {
+    auto matcher = matcher_for(context_root, include_suppressed);
+    if (matcher == nullptr or k == 0) {
+        return {};
+    }
+    const std::size_t query_length = to_u32string(query_str).length();
+    unsigned int max_dist = CompressedTrieBasedDB::max_fuzzy_distance(query_length);
+    // The scores of the best k taxa matched so far, lowest on top.
+    std::priority_queue<float, vector<float>, std::greater<float> > best_scores;
+    // A name can be reported by more than one trie (e.g. a homonym added by an amendment
+    //  is in both the base trie and the overlay), but its taxa are only counted once.
+    std::unordered_set<string> counted_names;
+    FuzzyMatchBound bound = [&](const FuzzyQueryResult & res) {
+        auto name = res.match();
+        if (not counted_names.insert(name).second) {
+            return max_dist;
+        }
+        const auto & candidates = match_name_to_taxon.at(name);
+        auto num_taxa = filter_to_context(candidates, context_root, include_suppressed).size();
+        for (std::size_t i = 0; i < num_taxa; ++i) {
+            best_scores.push(res.score);
+            if (best_scores.size() > k) {
+                best_scores.pop();
+            }
+        }
+        if (best_scores.size() == k) {
+            // Computed like FuzzyQueryResult::score, so that equal scores compare equal.
+            // A tie is kept, since it is broken by the name.
+            while (max_dist > 0) {
+                const float sl = query_length + max_dist;
+                if ((sl - (float)max_dist)/sl >= best_scores.top()) {
+                    break;
+                }
+                --max_dist;
+            }
+        }
+        return max_dist;
+    };
+    auto results = to_taxa(matcher->fuzzy_query(query_str, max_dist, &bound), context_root, taxonomy, include_suppressed);
+    if (results.size() <= k) {
+        return results;
+    }
+    return vec_fqr_w_t(std::make_move_iterator(results.begin()), std::make_move_iterator(results.begin() + k));
 }
 
 void ContextAwareCTrieBasedDB::add_key(const std::string& s, OttId id, const RichTaxonomy& taxonomy)
@@ -270,6 +507,33 @@ void ContextAwareCTrieBasedDB::add_key(const std::string& s, OttId id, const Ric
     match_name_to_taxon[nn].push_back({node,nullptr});
 
     trie.add_key(nn);
+
+    const auto e = node->get_data().trav_enter;
+    for (auto & ct : context_tries) {
+        const auto & root_data = ct->root->get_data();
+        if (ct->built and ct->trie and root_data.trav_enter <= e and e <= root_data.trav_exit) {
+            ct->trie->add_key(nn);
+        }
+    }
+}
+
+void ContextAwareCTrieBasedDB::taxon_moved(const RTRichTaxNode * nd, const RTRichTaxNode * old_parent) {
+    auto holds = [](const RTRichTaxNode * anc, const RTRichTaxNode * des) {
+        const auto & a = anc->get_data();
+        const auto & d = des->get_data();
+        return a.trav_enter <= d.trav_enter and d.trav_exit <= a.trav_exit;
+    };
+    for (auto & ct : context_tries) {
+        if (holds(nd, ct->root)) {
+            continue; // a context inside the moved subtree keeps the same names
+        }
+        if (holds(ct->root, old_parent) != holds(ct->root, nd->get_parent())) {
+            auto fresh = std::make_unique<ContextTrie>();
+            fresh->context = ct->context;
+            fresh->root = ct->root;
+            ct = std::move(fresh);
+        }
+    }
 }
 
 } // namespace otc
@@ -1,6 +1,9 @@
 #ifndef OTC_CONTEXT_CTRIE_DB_H
 #define OTC_CONTEXT_CTRIE_DB_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <set>
 #include "otc/ctrie/ctrie_db.h"
@@ -15,6 +18,10 @@ class ContextAwareCTrieBasedDB {
     public:
     ContextAwareCTrieBasedDB(const Context &, const RichTaxonomy &);
     ContextAwareCTrieBasedDB(const Context &, const RichTaxonomy &, const std::set<std::string_view> & keys);
+    // Restore the matcher from the sections that follow the taxonomy in a snapshot.
+    ContextAwareCTrieBasedDB(const Context &, const RichTaxonomy &, SnapshotReader & snapshot);
+
+    void write_snapshot(SnapshotWriter & snapshot, const RichTaxonomy &) const;
 
     // What strings (for names or synonyms) match the normalized query string?
     std::set<FuzzyQueryResult, SortQueryResByNearness> fuzzy_query(const std::string & query_str) const;
@@ -25,11 +32,21 @@ class ContextAwareCTrieBasedDB {
     // Does anything match this normalized query string?
     std::vector<std::string> prefix_query(const std::string & query_str) const;
 
+    // Searches the trie of the smallest context that holds context_root, if that context
+    //  has one (see context_trie_for), and otherwise the trie of all names.
     std::vector<FuzzyQueryResultWithTaxon> fuzzy_query_to_taxa(const std::string & query_str,
                                                                const RTRichTaxNode * context_root,
                                                                const RichTaxonomy & taxonomy,
                                                                bool include_suppressed) const;
 
+    // The first k results of fuzzy_query_to_taxa, found without collecting all of them
+    //  when the best ones are close to the query.
+    std::vector<FuzzyQueryResultWithTaxon> fuzzy_query_top_k(const std::string & query_str,
+                                                             std::size_t k,
+                                                             const RTRichTaxNode * context_root,
+                                                             const RichTaxonomy & taxonomy,
+                                                             bool include_suppressed) const;
+
     std::vector<FuzzyQueryResultWithTaxon> to_taxa(const std::set<FuzzyQueryResult, SortQueryResByNearness>& sorted_results,
                                                    const RTRichTaxNode * context_root,
                                                    const RichTaxonomy & taxonomy,
@@ -47,10 +64,37 @@ class ContextAwareCTrieBasedDB {
 
     void add_key(const std::string& s, OttId id, const RichTaxonomy&);
 
+    // Call after the taxon nd has been moved from old_parent, and the traversal intervals
+    //  relabeled. The context tries that gained or lost nd's subtree are dropped, so that
+    //  the next query in those contexts builds them again.
+    void taxon_moved(const RTRichTaxNode * nd, const RTRichTaxNode * old_parent);
+
+    // The candidates that are context_root or its descendants, in order. Candidates
+    //  with a null taxon pointer (suppressed records) are kept only if include_suppressed.
+    static vec_taxon_and_syn_ptrs filter_to_context(const vec_taxon_and_syn_ptrs & candidates,
+                                                    const RTRichTaxNode * context_root,
+                                                    bool include_suppressed);
+
 private:
+    // A trie of just the names of the taxa in one context, so that fuzzy queries in the
+    //  context don't search (and then filter out) the names in the rest of the taxonomy.
+    //  It is built by the first query that needs it.
+    struct ContextTrie {
+        const Context * context;
+        const RTRichTaxNode * root;
+        std::once_flag build_once;
+        std::atomic<bool> built{false};
+        std::unique_ptr<CompressedTrieBasedDB> trie; // null if the context holds too many names
+    };
+    void init_context_tries(const RichTaxonomy &);
+    const CompressedTrieBasedDB * context_trie_for(const RTRichTaxNode * context_root) const;
+    const CompressedTrieBasedDB * matcher_for(const RTRichTaxNode * context_root, bool include_suppressed) const;
+    void build_context_trie(ContextTrie & ct) const;
+
     const Context & context;
     CompressedTrieBasedDB trie;
-    std::map<std::string,  vec_taxon_and_syn_ptrs> match_name_to_taxon;
+    TaxonomyIndex<std::string, vec_taxon_and_syn_ptrs> match_name_to_taxon;
+    std::vector<std::unique_ptr<ContextTrie> > context_tries;
 
 };
 
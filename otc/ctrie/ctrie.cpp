@@ -1,4 +1,5 @@
 #include "otc/ctrie/ctrie.h"
+#include "otc/snapshot.h"
 
 namespace otc {
 
@@ -115,7 +116,7 @@ void CompressedTrie::init(const ctrie_init_set_t & keys, const stored_str_t & le
     stored_str_t curr_pref;
     suff_map_t suffix2index;
     concat_suff.push_back(null_char_index);
-    std::vector<stored_index_t> mt{1, null_char_index};
+    std::vector<stored_index_t> mt{null_char_index};
     suffix2index[mt] = 0;
     CTrieNode & root_node = append_node();
     static const std::string TARGET_THIN_STR{"A"};
@@ -269,6 +270,31 @@ void CompressedTrie::db_write_words(std::ostream & out) const {
     }
 }
 
+void CompressedTrie::write_snapshot(SnapshotWriter & snapshot) const {
+    std::uint32_t nci = (letters.empty() ? 0 : null_char_index);
+    snapshot.write_value(nci);
+    snapshot.write_array(letters.data(), letters.size());
+    snapshot.write_vector(concat_suff);
+    snapshot.write_vector(node_vec);
+}
+
+void CompressedTrie::read_snapshot(SnapshotReader & snapshot) {
+    clear();
+    null_char_index = static_cast<stored_index_t>(snapshot.read_value<std::uint32_t>());
+    auto [let_p, num_let] = snapshot.read_array<stored_char_t>();
+    letters.assign(let_p, num_let);
+    auto [suff_p, num_suff] = snapshot.read_array<stored_index_t>();
+    concat_suff.assign(suff_p, suff_p + num_suff);
+    auto [node_p, num_nodes] = snapshot.read_array<CTrieNode>();
+    node_vec.assign(node_p, node_p + num_nodes);
+    if (not letters.empty()) {
+        // letters holds the null character after the real letters (see init)
+        for (stored_index_t i = 0; i < null_char_index; ++i) {
+            letter_to_ind[letters[i]] = i;
+        }
+    }
+}
+
 } // namespace otc
 
 // search impl in different file just to separate init from search.
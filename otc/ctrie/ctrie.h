@@ -14,6 +14,9 @@
 #include "otc/ctrie/ctrie_node.h"
 
 namespace otc {
+class SnapshotReader;
+class SnapshotWriter;
+
 constexpr bool DB_FUZZY_MATCH = false;
 /* Compressed Trie
   based on, but not identical to structure by Maly 1976
@@ -77,8 +80,11 @@ class CompressedTrie {
         return ret;
     }
     
+    // If bound is given, it is called with each match as soon as it is found, and
+    //  returns the most edits that the matches found after it may have.
     std::vector<FuzzyQueryResult> fuzzy_matches(const stored_str_t & query_str,
-                                                unsigned int max_dist) const;
+                                                unsigned int max_dist,
+                                                const FuzzyMatchBound * bound = nullptr) const;
     
     void db_write(std::ostream & out) const;
     
@@ -86,6 +92,10 @@ class CompressedTrie {
     
     void db_write_node(std::ostream & out, const CTrieNode & nd) const;
 
+    // binary form used by taxonomy snapshots (see otc/snapshot.h)
+    void write_snapshot(SnapshotWriter & snapshot) const;
+    void read_snapshot(SnapshotReader & snapshot);
+
     std::string to_char_from_inds(const stored_index_t * p, std::size_t len) const {
         std::string ret;
         for (std::size_t i = 0; i < len; ++i) {
@@ -174,11 +184,15 @@ class CompressedTrie {
     }
 
     void extend_partial_match(const std::vector<stored_index_t>& query,
-                              const unsigned int max_dist,
                               const CTrieNode* curr_node,
-                              class dp_matrix& score,
+                              class edit_distance_columns& score,
                               std::vector<stored_index_t>& match_coded,
-                              std::vector<FuzzyQueryResult> & results) const;
+                              std::vector<FuzzyQueryResult> & results,
+                              const FuzzyMatchBound * bound) const;
+    void add_match(FuzzyQueryResult && res,
+                   class edit_distance_columns& score,
+                   std::vector<FuzzyQueryResult> & results,
+                   const FuzzyMatchBound * bound) const;
 
     stored_index_t ctrie_get_index_for_letter(const stored_char_t & c) const {
         auto ltiit = letter_to_ind.find(c);
@@ -1,57 +1,78 @@
 #include "otc/ctrie/ctrie_db.h"
+#include "otc/snapshot.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <mutex>
 
 using std::vector;
 using std::string;
 
 namespace otc {
 
-std::set<FuzzyQueryResult, SortQueryResByNearness> CompressedTrieBasedDB::fuzzy_query(const std::string & query_str) const {
-    auto conv_query = to_u32string(query_str);
-    unsigned int max_dist;
+unsigned int CompressedTrieBasedDB::max_fuzzy_distance(std::size_t query_length) {
     // defaults taken from taxomachine...
     const unsigned int SHORT_NAME_LENGTH = 9;
     const unsigned int MEDIUM_NAME_LENGTH = 14;
     const unsigned int LONG_NAME_LENGTH = 19;
-    std::size_t iql = conv_query.length();
-    if (iql < SHORT_NAME_LENGTH) {
-        max_dist = 1;
-    } else if (iql < MEDIUM_NAME_LENGTH) {
-        max_dist = 2;
-    } else {
-        max_dist = (iql < LONG_NAME_LENGTH ? 3 : 4);
+    if (query_length < SHORT_NAME_LENGTH) {
+        return 1;
+    } else if (query_length < MEDIUM_NAME_LENGTH) {
+        return 2;
     }
-    std::set<FuzzyQueryResult, SortQueryResByNearness> sorted;
-    
-    auto from_thin = thin_trie.fuzzy_matches(conv_query, max_dist);
-    sorted.insert(std::begin(from_thin), std::end(from_thin));
-
-    auto from_full = wide_trie.fuzzy_matches(conv_query, max_dist);
-    sorted.insert(std::begin(from_full), std::end(from_full));
-
-    auto from_new = new_trie->fuzzy_matches(conv_query, max_dist);
-    sorted.insert(std::begin(from_new), std::end(from_new));
+    return (query_length < LONG_NAME_LENGTH ? 3 : 4);
+}
 
-    return sorted;
+std::set<FuzzyQueryResult, SortQueryResByNearness> CompressedTrieBasedDB::fuzzy_query(const std::string & query_str) const {
+    return fuzzy_query(query_str, max_fuzzy_distance(to_u32string(query_str).length()));
 }
 
-std::set<FuzzyQueryResult, SortQueryResByNearness> CompressedTrieBasedDB::exact_query(const std::string & query_str) const
-{
+std::set<FuzzyQueryResult, SortQueryResByNearness> CompressedTrieBasedDB::fuzzy_query(const std::string & query_str,
+                                                                                       unsigned int max_dist,
+                                                                                       const FuzzyMatchBound * bound) const {
     auto conv_query = to_u32string(query_str);
-
     std::set<FuzzyQueryResult, SortQueryResByNearness> sorted;
+    // A bound that drops while searching one trie also holds for the tries after it.
+    FuzzyMatchBound lower_max_dist = [&](const FuzzyQueryResult & res) {
+        max_dist = std::min(max_dist, (*bound)(res));
+        return max_dist;
+    };
+    const FuzzyMatchBound * trie_bound = bound ? &lower_max_dist : nullptr;
+    auto add_overlay_matches = [&](const OverlayTrie & overlay) {
+        for (auto & res : overlay.fuzzy_matches(conv_query, max_dist)) {
+            if (bound) {
+                lower_max_dist(res);
+            }
+            sorted.insert(std::move(res));
+        }
+    };
 
-    auto from_thin = thin_trie.fuzzy_matches(conv_query, 0);
+    auto from_thin = thin_trie.fuzzy_matches(conv_query, max_dist, trie_bound);
     sorted.insert(std::begin(from_thin), std::end(from_thin));
 
-    auto from_full = wide_trie.fuzzy_matches(conv_query, 0);
+    auto from_full = wide_trie.fuzzy_matches(conv_query, max_dist, trie_bound);
     sorted.insert(std::begin(from_full), std::end(from_full));
 
-    auto from_new = new_trie->fuzzy_matches(conv_query, 0);
-    sorted.insert(std::begin(from_new), std::end(from_new));
+    {
+        std::shared_lock<std::shared_mutex> lock(added_keys_mutex);
+        if (new_trie) {
+            auto from_new = new_trie->fuzzy_matches(conv_query, max_dist, trie_bound);
+            sorted.insert(std::begin(from_new), std::end(from_new));
+        }
+        if (compacting_keys) {
+            add_overlay_matches(*compacting_keys);
+        }
+        add_overlay_matches(added_keys);
+    }
 
     return sorted;
 }
 
+std::set<FuzzyQueryResult, SortQueryResByNearness> CompressedTrieBasedDB::exact_query(const std::string & query_str) const
+{
+    return fuzzy_query(query_str, 0);
+}
+
 vector<string> CompressedTrieBasedDB::prefix_query(const std::string & query_str) const
 {
     auto conv_query = to_u32string(query_str);
@@ -61,8 +82,19 @@ vector<string> CompressedTrieBasedDB::prefix_query(const std::string & query_str
     auto from_full = wide_trie.prefix_query(conv_query);
     sorted.insert(sorted.end(), std::begin(from_full), std::end(from_full));
 
-    auto from_new = new_trie->prefix_query(conv_query);
-    sorted.insert(sorted.end(), std::begin(from_new), std::end(from_new));
+    {
+        std::shared_lock<std::shared_mutex> lock(added_keys_mutex);
+        if (new_trie) {
+            auto from_new = new_trie->prefix_query(conv_query);
+            sorted.insert(sorted.end(), std::begin(from_new), std::end(from_new));
+        }
+        if (compacting_keys) {
+            auto from_compacting = compacting_keys->prefix_query(conv_query);
+            sorted.insert(sorted.end(), std::begin(from_compacting), std::end(from_compacting));
+        }
+        auto from_added = added_keys.prefix_query(conv_query);
+        sorted.insert(sorted.end(), std::begin(from_added), std::end(from_added));
+    }
 
     // I'm not sure this is a good idea...
     std::sort(sorted.begin(), sorted.end());
@@ -70,75 +102,134 @@ vector<string> CompressedTrieBasedDB::prefix_query(const std::string & query_str
     return sorted;
 }
 
+// Keys are added to an OverlayTrie until it holds this many keys, or half as many as
+//  new_trie, whichever is more. Then they are compacted into a new new_trie. Growing
+//  the threshold with new_trie keeps the total cost of the compactions linear.
+constexpr std::size_t MIN_KEYS_TO_COMPACT = 256;
+
+CompressedTrieBasedDB::~CompressedTrieBasedDB() {
+    wait_for_compaction();
+}
+
 void CompressedTrieBasedDB::add_key(const std::string& s)
 {
-    new_keys.insert(s);
-    rebuild_new_trie();
+    if (s.empty() or not new_keys.insert(s).second) {
+        return;
+    }
+    auto widestr = to_u32string(s);
+    bool compact_now;
+    {
+        std::unique_lock<std::shared_mutex> lock(added_keys_mutex);
+        added_keys.insert(widestr);
+        compact_now = (not compacting_keys
+                       and added_keys.size() - num_left_over_keys >= std::max(MIN_KEYS_TO_COMPACT, num_keys_in_new_trie / 2));
+    }
+    if (compact_now) {
+        start_compaction();
+    }
 }
 
-void CompressedTrieBasedDB::rebuild_new_trie()
+// The CompressedTrie of all keys. Its letters are the 64 most common letters of the keys
+//  (the most that a CTrieNode can hold); keys with other letters are left over.
+CompressedTrieBasedDB::Compaction CompressedTrieBasedDB::compact(const std::set<std::string> & keys)
 {
-    LOG(INFO)<<"Rebuilding ctree for additions";
-    LOG(INFO)<< new_keys.size() << " keys\n";
-
+    std::map<stored_char_t, std::size_t> letter_counts;
+    vector<stored_str_t> wide_keys;
+    wide_keys.reserve(keys.size());
+    for (const auto & key : keys) {
+        wide_keys.push_back(to_u32string(key));
+        for (auto letter : wide_keys.back()) {
+            letter_counts[letter] += 1;
+        }
+    }
+    vector<std::pair<std::size_t, stored_char_t>> by_count;
+    for (auto [letter, count] : letter_counts) {
+        by_count.push_back({count, letter});
+    }
+    std::sort(by_count.begin(), by_count.end(), std::greater<>());
+    std::set<stored_char_t> letter_set;
+    for (std::size_t i = 0; i < by_count.size() and i < 64; ++i) {
+        letter_set.insert(by_count[i].second);
+    }
+    Compaction compaction;
     ctrie_init_set_t for_new;
-    std::map<stored_char_t, unsigned int> letter_counts;
-    std::set<stored_char_t> new_letter_set;
-    // unsigned mem_str = 0;
-    for (auto i : new_keys)
-    {
-        // mem_str += i.length();
-        auto widestr = to_u32string(i);
-
-	for_new.insert(widestr);
-
-	for (auto letter : widestr) {
-	    new_letter_set.insert(letter);
-	}
-        //LOG(INFO) << glob_conv8.to_bytes(widestr) << '\n';
+    for (auto & widestr : wide_keys) {
+        bool fits = std::all_of(widestr.begin(), widestr.end(),
+                                [&](stored_char_t letter) { return letter_set.count(letter) > 0; });
+        if (fits) {
+            for_new.insert(std::move(widestr));
+        } else {
+            compaction.left_over.push_back(std::move(widestr));
+        }
     }
-    LOG(INFO)<<for_new.size()<<" keys for new ctrie\n";
-
-    stored_str_t new_letters;
-    new_letters.insert(std::begin(new_letters), std::begin(new_letter_set), std::end(new_letter_set));
-    std::map<unsigned int, stored_str_t,std::greater<int>> by_count;
-
-    LOG(INFO)<<"new letters: "<<new_letters.size()<<"\n";
-    for (auto letter : new_letters)
-        LOG(INFO)<<"  "<<to_char_str(letter)<<"\n";
-    LOG(INFO)<<"done\n";
+    compaction.num_keys = for_new.size();
+    compaction.trie = std::make_shared<CompressedTrie>();
+    compaction.trie->init(for_new, stored_str_t{letter_set.begin(), letter_set.end()});
+    LOG(INFO) << "Compacted " << for_new.size() << " added keys into a ctrie ("
+              << compaction.left_over.size() << " keys with uncommon letters left over)";
+    return compaction;
+}
 
-    for (auto [letter,count] : letter_counts)
-        by_count[count].push_back(letter);
+void CompressedTrieBasedDB::install(Compaction && compaction)
+{
+    std::unique_lock<std::shared_mutex> lock(added_keys_mutex);
+    new_trie = std::move(compaction.trie);
+    num_keys_in_new_trie = compaction.num_keys;
+    compacting_keys.reset();
+    for (const auto & key : compaction.left_over) {
+        added_keys.insert(key);
+    }
+    num_left_over_keys = compaction.left_over.size();
+}
 
-    int n_dropped_letters = 0;
-    for(auto [count,letters]: by_count)
+// Moves the added keys into compacting_keys, where they are searched until a
+//  background thread has built a CompressedTrie of all of the added keys.
+void CompressedTrieBasedDB::start_compaction()
+{
+    wait_for_compaction();
     {
-        LOG(INFO)<<"  "<<count<<" : \n";
-        for(auto letter : letters)
-        {
-            LOG(INFO)<<"    "<<to_char_str(letter)<<" ("<<(uint32_t)(letter)<<")";
-            if (new_letters.size() < 64)
-                new_letters.push_back(letter);
-            else
-            {
-                n_dropped_letters++;
-                LOG(INFO)<<"  DROPPED!";
-            }
-            LOG(INFO)<<"\n";
+        std::unique_lock<std::shared_mutex> lock(added_keys_mutex);
+        compacting_keys = std::make_unique<OverlayTrie>(std::move(added_keys));
+        added_keys = OverlayTrie();
+        num_left_over_keys = 0;
+    }
+    compaction_thread = std::thread([this, keys = new_keys] {
+        try {
+            install(compact(keys));
+        } catch (std::exception & e) {
+            // The keys are still searched in compacting_keys.
+            LOG(ERROR) << "Could not compact the added keys: " << e.what();
         }
+    });
+}
+
+void CompressedTrieBasedDB::wait_for_compaction()
+{
+    if (compaction_thread.joinable()) {
+        compaction_thread.join();
     }
-    LOG(INFO)<<"done\n";
+}
 
-    if (n_dropped_letters)
+void CompressedTrieBasedDB::rebuild_new_trie()
+{
+    wait_for_compaction();
+    if (new_keys.empty()) {
+        return;
+    }
     {
-        LOG(INFO)<<"dropped "<<n_dropped_letters<<" letters.\n";
+        std::unique_lock<std::shared_mutex> lock(added_keys_mutex);
+        if (compacting_keys) {
+            // A failed compaction: search all added keys in added_keys again.
+            added_keys = OverlayTrie();
+            for (const auto & key : new_keys) {
+                added_keys.insert(to_u32string(key));
+            }
+        }
+        compacting_keys = std::make_unique<OverlayTrie>(std::move(added_keys));
+        added_keys = OverlayTrie();
+        num_left_over_keys = 0;
     }
-
-    //LOG(INFO) << "set size = " << (sizeof(std::string *) + sizeof(char *) + 8)*keys.size() + mem_str << "bytes\n";
-
-    new_trie = std::make_shared<CompressedTrie>();
-    new_trie->init(for_new, new_letters);
+    install(compact(new_keys));
 }
 
 void CompressedTrieBasedDB::initialize(const std::set<std::string> & keys) {
@@ -219,8 +310,7 @@ void CompressedTrieBasedDB::initialize(const std::set<std::string> & keys) {
     wide_trie.init(for_wide, wide_letters);
     thin_trie.init(for_thin, thin_letters);
 
-    new_trie = std::make_shared<CompressedTrie>();
-    new_trie->init({},thin_letters);
+    new_trie.reset();
 
     /*
     wide_trie.db_write_words(std::cerr);
@@ -228,4 +318,24 @@ void CompressedTrieBasedDB::initialize(const std::set<std::string> & keys) {
     */
 }
 
+void CompressedTrieBasedDB::write_snapshot(SnapshotWriter & snapshot) const {
+    if (not new_keys.empty()) {
+        throw OTCError() << "Cannot snapshot a name matcher that has had keys added.";
+    }
+    wide_trie.write_snapshot(snapshot);
+    thin_trie.write_snapshot(snapshot);
+}
+
+void CompressedTrieBasedDB::read_snapshot(SnapshotReader & snapshot) {
+    wait_for_compaction();
+    wide_trie.read_snapshot(snapshot);
+    thin_trie.read_snapshot(snapshot);
+    new_keys.clear();
+    new_trie.reset();
+    num_keys_in_new_trie = 0;
+    compacting_keys.reset();
+    added_keys = OverlayTrie();
+    num_left_over_keys = 0;
+}
+
 }
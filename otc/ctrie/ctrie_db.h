@@ -3,27 +3,70 @@
 
 
 #include "otc/ctrie/ctrie.h"
+#include "otc/ctrie/overlay_trie.h"
 #include <memory>
+#include <shared_mutex>
+#include <thread>
 
 namespace otc {
 
 class CompressedTrieBasedDB {
 public:
+    CompressedTrieBasedDB() = default;
+    ~CompressedTrieBasedDB();
+    CompressedTrieBasedDB(const CompressedTrieBasedDB &) = delete;
+    CompressedTrieBasedDB & operator=(const CompressedTrieBasedDB &) = delete;
+
     void initialize(const std::set<std::string> & keys);
+    // The number of edits that fuzzy_query allows for a query of this many letters.
+    static unsigned int max_fuzzy_distance(std::size_t query_length);
     std::set<FuzzyQueryResult, SortQueryResByNearness>  fuzzy_query(const std::string & query_str) const;
+    // Matches within max_dist edits; bound (see FuzzyMatchBound) may lower max_dist as they are found.
+    std::set<FuzzyQueryResult, SortQueryResByNearness>  fuzzy_query(const std::string & query_str,
+                                                                     unsigned int max_dist,
+                                                                     const FuzzyMatchBound * bound = nullptr) const;
     std::set<FuzzyQueryResult, SortQueryResByNearness>  exact_query(const std::string & query_str) const;
     std::vector<std::string>                            prefix_query(const std::string & query_str) const;
 
+    // Takes O(length) time: the key goes into an OverlayTrie, which is compacted into
+    //  new_trie by a background thread once it has grown enough.
     void add_key(const std::string& s);
 
+    // Compacts all of the added keys into new_trie now.
     void rebuild_new_trie();
 
+    void write_snapshot(SnapshotWriter & snapshot) const;
+    void read_snapshot(SnapshotReader & snapshot);
+
 private:
+    struct Compaction {
+        std::shared_ptr<CompressedTrie> trie;
+        std::size_t num_keys = 0;
+        std::vector<stored_str_t> left_over; // keys with letters that did not fit in the trie
+    };
+    static Compaction compact(const std::set<std::string> & keys);
+    void install(Compaction && compaction);
+    void start_compaction();
+    void wait_for_compaction();
+
     CompressedTrie wide_trie;
     CompressedTrie thin_trie;
 
+    // The keys added after initialize() are searched in new_trie, the overlay that is
+    //  being compacted (if any), and the overlay that takes new keys.
+    // add_key is called with the taxonomy write lock held, so it only needs
+    //  added_keys_mutex to keep out the compaction thread, which takes it just
+    //  to install its result. Queries take it shared.
+    mutable std::shared_mutex added_keys_mutex;
     std::shared_ptr<CompressedTrie> new_trie;
+    std::size_t num_keys_in_new_trie = 0;
+    std::unique_ptr<OverlayTrie> compacting_keys;
+    OverlayTrie added_keys;
+    // Keys that the last compaction left over (see compact()) are put back in added_keys.
+    //  They don't count toward the next compaction, which would leave them over again.
+    std::size_t num_left_over_keys = 0;
     std::set<std::string> new_keys;
+    std::thread compaction_thread;
 };
 
 
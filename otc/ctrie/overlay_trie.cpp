@@ -0,0 +1,148 @@
+#include "otc/ctrie/overlay_trie.h"
+#include <algorithm>
+
+using std::string;
+using std::vector;
+
+namespace otc {
+
+constexpr std::uint32_t NO_CHILD = UINT32_MAX;
+
+std::uint32_t OverlayTrie::find_child(std::uint32_t node, stored_char_t letter) const {
+    const auto & children = nodes[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), letter,
+                               [](const auto & child, stored_char_t c) { return child.first < c; });
+    if (it == children.end() or it->first != letter) {
+        return NO_CHILD;
+    }
+    return it->second;
+}
+
+void OverlayTrie::insert(const stored_str_t & key) {
+    std::uint32_t node = 0;
+    for (auto letter : key) {
+        auto & children = nodes[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), letter,
+                                   [](const auto & child, stored_char_t c) { return child.first < c; });
+        if (it != children.end() and it->first == letter) {
+            node = it->second;
+            continue;
+        }
+        const auto child = std::uint32_t(nodes.size());
+        children.insert(it, {letter, child});
+        nodes.emplace_back(); // invalidates children
+        node = child;
+    }
+    if (not nodes[node].is_key) {
+        nodes[node].is_key = true;
+        ++num_keys;
+    }
+}
+
+bool OverlayTrie::contains(const stored_str_t & key) const {
+    std::uint32_t node = 0;
+    for (auto letter : key) {
+        node = find_child(node, letter);
+        if (node == NO_CHILD) {
+            return false;
+        }
+    }
+    return nodes[node].is_key;
+}
+
+// Walks the trie depth-first, keeping one row of the edit-distance table per depth:
+//  row d holds the distances between the first d letters of the path and each prefix
+//  of the query. A subtree is skipped once every entry of its row exceeds max_dist.
+struct OverlayFuzzySearch {
+    const stored_str_t & query;
+    unsigned int max_dist;
+    vector<unsigned int> rows;
+    stored_str_t path;
+    vector<FuzzyQueryResult> results;
+
+    unsigned int * row(std::size_t depth) {
+        return rows.data() + depth * (query.length() + 1);
+    }
+};
+
+template<typename N>
+void overlay_fuzzy_search(const vector<N> & nodes, std::uint32_t node, OverlayFuzzySearch & search) {
+    const std::size_t m = search.query.length();
+    const std::size_t depth = search.path.length();
+    const unsigned int * prev = search.row(depth);
+    if (nodes[node].is_key and prev[m] <= search.max_dist) {
+        FuzzyQueryResult res{{}, nullptr, 0, prev[m]};
+        res.match_wide_char = search.path;
+        float sl = res.match_wide_char.length();
+        res.score = ((sl - (float)res.distance)/sl);
+        search.results.push_back(std::move(res));
+    }
+    if (nodes[node].children.empty()) {
+        return;
+    }
+    if (search.rows.size() < (depth + 2) * (m + 1)) {
+        search.rows.resize((depth + 2) * (m + 1));
+        prev = search.row(depth);
+    }
+    unsigned int * curr = search.row(depth + 1);
+    for (const auto & [letter, child] : nodes[node].children) {
+        curr[0] = prev[0] + 1;
+        unsigned int lowest = curr[0];
+        for (std::size_t i = 1; i <= m; ++i) {
+            const unsigned int sub = prev[i - 1] + (search.query[i - 1] == letter ? 0 : 1);
+            curr[i] = std::min({prev[i] + 1, curr[i - 1] + 1, sub});
+            lowest = std::min(lowest, curr[i]);
+        }
+        if (lowest > search.max_dist) {
+            continue;
+        }
+        search.path.push_back(letter);
+        overlay_fuzzy_search(nodes, child, search);
+        search.path.pop_back();
+        // the recursion may have grown (and moved) the rows
+        prev = search.row(depth);
+        curr = search.row(depth + 1);
+    }
+}
+
+vector<FuzzyQueryResult> OverlayTrie::fuzzy_matches(const stored_str_t & query_str,
+                                                    unsigned int max_dist) const {
+    if (query_str.empty() or num_keys == 0) {
+        return {};
+    }
+    OverlayFuzzySearch search{query_str, max_dist, {}, {}, {}};
+    const std::size_t m = query_str.length();
+    search.rows.resize((m + max_dist + 1) * (m + 1));
+    for (std::size_t i = 0; i <= m; ++i) {
+        search.row(0)[i] = i;
+    }
+    overlay_fuzzy_search(nodes, 0, search);
+    return std::move(search.results);
+}
+
+void OverlayTrie::all_descendants(std::uint32_t node, stored_str_t & prefix, vector<string> & results) const {
+    if (nodes[node].is_key) {
+        results.push_back(to_char_str(prefix));
+    }
+    for (const auto & [letter, child] : nodes[node].children) {
+        prefix.push_back(letter);
+        all_descendants(child, prefix, results);
+        prefix.pop_back();
+    }
+}
+
+vector<string> OverlayTrie::prefix_query(const stored_str_t & uquery) const {
+    std::uint32_t node = 0;
+    for (auto letter : uquery) {
+        node = find_child(node, letter);
+        if (node == NO_CHILD) {
+            return {};
+        }
+    }
+    vector<string> results;
+    stored_str_t prefix = uquery;
+    all_descendants(node, prefix, results);
+    return results;
+}
+
+} // namespace otc
@@ -0,0 +1,51 @@
+#ifndef OTC_OVERLAY_TRIE_H
+#define OTC_OVERLAY_TRIE_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "otc/ctrie/search_data_models.h"
+
+namespace otc {
+
+// A plain (uncompressed) trie of the keys added to a CompressedTrieBasedDB after it
+//  was built. Unlike a CompressedTrie, which has to be rebuilt from all of its keys,
+//  a key is inserted in O(length) time. It is meant to stay small: the owner compacts
+//  its keys into a CompressedTrie from time to time, and searches both.
+// Queries give the same answers as CompressedTrie's for the same keys.
+class OverlayTrie {
+    public:
+    OverlayTrie() :nodes(1) {
+    }
+
+    void insert(const stored_str_t & key);
+    bool contains(const stored_str_t & key) const;
+
+    std::size_t size() const {
+        return num_keys;
+    }
+    bool empty() const {
+        return num_keys == 0;
+    }
+
+    // The keys within max_dist edits of query_str, with distance and score set.
+    std::vector<FuzzyQueryResult> fuzzy_matches(const stored_str_t & query_str,
+                                                unsigned int max_dist) const;
+    // The keys that start with uquery.
+    std::vector<std::string> prefix_query(const stored_str_t & uquery) const;
+
+    private:
+    struct Node {
+        std::vector<std::pair<stored_char_t, std::uint32_t> > children; // sorted by letter
+        bool is_key = false;
+    };
+    std::uint32_t find_child(std::uint32_t node, stored_char_t letter) const;
+    void all_descendants(std::uint32_t node, stored_str_t & prefix, std::vector<std::string> & results) const;
+
+    std::vector<Node> nodes; // nodes[0] is the root
+    std::size_t num_keys = 0;
+};
+
+} // namespace otc
+#endif
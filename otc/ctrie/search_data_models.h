@@ -4,6 +4,7 @@
 #include <set>
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <optional>
 
 #include "otc/otc_base_includes.h"
@@ -123,10 +124,15 @@ struct SortQueryResByNearness {
         } else if (rhs.score < lhs.score) {
             return true;
         }
-        return rhs.match_wide_char < rhs.match_wide_char;
+        return lhs.match_wide_char < rhs.match_wide_char;
     }
 };
 
+// Called by a fuzzy search with each match (with its score set) as it is found.
+//  Returns the largest number of edits that the rest of the matches may have, so that
+//  a search for the best few matches can give up on the ones that can't make the cut.
+using FuzzyMatchBound = std::function<unsigned int(const FuzzyQueryResult &)>;
+
 class FQuery {
     using ptr_pair = std::pair<const void *, const stored_index_t *>;
     public: 
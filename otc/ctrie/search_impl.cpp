@@ -5,163 +5,278 @@ using std::string;
 
 namespace otc {
 
-// Dynamic programming matrix.
-//   This implementation doesn't separate gap-opening from gap-extension.
-// The underlying algorithm is pretty simple.  However, code is made more complicated by:
-//   * trying to quit early if we know that examining more letters of the target won't help
-//   * trying to compute only letters in a band around the diagonal.
-class dp_matrix
+// Columns of the edit-distance DP between the query and the target strings spelled by a
+//   path through the trie, one column per target letter.
+// Each column is kept as bit-vectors of the vertical differences between adjacent cells
+//   (Myers 1999, in the multi-word form of Hyyro 2003), so computing a column costs one
+//   pass over ceil(|query|/64) words instead of one cell at a time.
+// The columns for every depth of the current trie path are kept, so that the depth-first
+//   search can back up without recomputing. Next to the bit-vectors we store the score of
+//   the whole query, and (Ukkonen's cut-off) the last row above it whose score is still
+//   <= max_dist. That tells us when no longer target can match.
+class edit_distance_columns
 {
-    int* data;
-    int x_width;
-    int y_width;
-    int* xmin;
-    int* xmax;
 public:
-    int& operator()(int x,int y)       {assert(0 <= x and x < x_width); assert(0 <= y and y < y_width) ; return data[y*x_width + x];}
-    int  operator()(int x,int y) const {assert(0 <= x and x < x_width); assert(0 <= y and y < y_width) ; return data[y*x_width + x];}
+    struct column_info
+    {
+        int score;           // distance between the whole query and the target prefix
+        int last_row;        // last row < |query| with a score <= max_dist, or -1
+        int last_row_score;  // the score of last_row
+    };
 
-    int size1() const {return x_width;}
-    int size2() const {return y_width;}
+private:
+    int query_length;
+    int num_words;
+    int max_dist;
+    const uint64_t* peq;     // peq[letter*num_words + w]: bits of the query positions that hold `letter`
+    uint64_t* vp;            // vp[depth*num_words + w]: the cell is one more than the cell above
+    uint64_t* vn;            // vn[depth*num_words + w]: the cell is one less than the cell above
+    column_info* info;
+
+    // Score of row `row` minus the score of the row above it (0 < row <= query_length)
+    static int vertical_delta(const uint64_t* p, const uint64_t* n, int row)
+    {
+        uint64_t bit = uint64_t(1) << ((row-1) % 64);
+        return (p[(row-1)/64] & bit) ? 1 : ((n[(row-1)/64] & bit) ? -1 : 0);
+    }
 
-    // Perform DP for row `y` and return the best possible score for any row > y
-    int calc_row(int y, stored_index_t target_char, const vector<stored_index_t>& query)
+public:
+    // Fill the column for target letter number `depth` (>= 1) from the column at depth-1.
+    // Returns false if no target that extends this one by more letters can match.
+    bool calc_column(int depth, stored_index_t target_char)
     {
-        assert(y<y_width);
-        int next_best = INT_MAX/2;
-        int first_x = xmin[y];
-        int last_x = xmax[y];
-        int edge_x = x_width-1;
-        for(int x=first_x; x<=last_x; x++)
+        const uint64_t* eq_words = peq + std::size_t(target_char)*num_words;
+        const uint64_t* prev_p = vp + (depth-1)*num_words;
+        const uint64_t* prev_n = vn + (depth-1)*num_words;
+        uint64_t* p = vp + depth*num_words;
+        uint64_t* n = vn + depth*num_words;
+
+        // The top row is the number of target letters, so it always grows by one.
+        int h_in = 1;
+        const uint64_t last_row_bit = uint64_t(1) << ((query_length-1) % 64);
+
+        // The change in score along the previous column's last row.
+        const int prev_row = info[depth-1].last_row;
+        const int prev_row_word = (prev_row >= 0) ? prev_row/64 : -1;
+        const uint64_t prev_row_bit = uint64_t(1) << ((prev_row >= 0 ? prev_row : 0) % 64);
+        int prev_row_delta = 0;
+
+        for(int w=0; w<num_words; w++)
+        {
+            uint64_t pv = prev_p[w];
+            uint64_t mv = prev_n[w];
+            uint64_t eq = eq_words[w];
+            uint64_t xv = eq | mv;
+            if (h_in < 0) eq |= 1;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+
+            uint64_t high_bit = (w == num_words-1) ? last_row_bit : uint64_t(1) << 63;
+            int h_out = (ph & high_bit) ? 1 : ((mh & high_bit) ? -1 : 0);
+
+            // After the shift, bit i holds the horizontal change of row i.
+            ph <<= 1;
+            mh <<= 1;
+            if (h_in < 0)
+                mh |= 1;
+            else if (h_in > 0)
+                ph |= 1;
+            if (w == prev_row_word)
+                prev_row_delta = (ph & prev_row_bit) ? 1 : ((mh & prev_row_bit) ? -1 : 0);
+
+            p[w] = mh | ~(xv | ph);
+            n[w] = ph & xv;
+            h_in = h_out;
+        }
+        info[depth].score = info[depth-1].score + h_in;
+
+        // The last row within max_dist can move down by at most one row per column.
+        int row = prev_row;
+        int score = (prev_row >= 0) ? info[depth-1].last_row_score + prev_row_delta : depth - 1;
+        if (row + 1 < query_length)
+        {
+            row++;
+            score += (row == 0) ? 1 : vertical_delta(p, n, row);
+        }
+        // Rows more than max_dist above the diagonal can't be within max_dist.
+        const int lowest_row = std::max(0, depth - max_dist);
+        while (score > max_dist)
         {
-            // We have just matched the x-th char, which is query[x-1]
-            int match_cost       = (target_char == query[x-1]) ? 0 : 1;
-
-            int match_score      = (*this)(x-1,y-1) + match_cost;
-            int del_target_score = (*this)(x-1,y  ) + 1;
-            int del_query_score  = (*this)(x  ,y-1) + 1;
-            int score = std::min(match_score,std::min(del_query_score, del_target_score));
-
-            // Find the best score for any FUTURE row.
-            // If we are at the right edge, future rows will include a +1
-            // penalty for a vertical move (=delete-query-letter).
-            int score2 = score;
-            if (x == edge_x) score2++;
-            next_best = std::min(score2, next_best);
-
-            (*this)(x,y) = score;
+            if (row <= lowest_row)
+            {
+                row = -1;
+                break;
+            }
+            score -= vertical_delta(p, n, row);
+            row--;
         }
-        return next_best;
+        info[depth].last_row = row;
+        info[depth].last_row_score = score;
+
+        // A longer target must either pass through one of the rows above the last one,
+        // or add at least one more edit after matching the whole query.
+        return row >= 0 or info[depth].score < max_dist;
     }
 
-    int score_for_row(int y) const
+    // Could a target of `target_length` letters that continues the target prefix at `depth`
+    // be within max_dist of the query? The path to the final cell crosses this column either
+    // in the last row, or in a row that is at most max_dist, or (costing more than max_dist)
+    // in a row between the two.  From row i, it takes at least |(|query|-i) - remaining|
+    // more edits.
+    bool can_match(int depth, int target_length) const
     {
-        return (*this)(x_width-1, y);
+        if (target_length > query_length + max_dist or target_length + max_dist < query_length)
+            return false;
+        const int remaining = target_length - depth;
+        if (info[depth].score + remaining <= max_dist)
+            return true;
+        const int last_row = info[depth].last_row;
+        return last_row >= 0 and query_length - last_row - remaining <= max_dist;
     }
 
-    dp_matrix(int xw, int yw, int max_dist)
-        :data(new int[xw*yw]),
-         x_width(xw),
-         y_width(yw),
-         xmin(new int[yw]),
-         xmax(new int[yw])
+    int score_for_column(int depth) const
     {
-        // Initialize cells to INT_MAX/2 so that they don't affect the calculation.
-        for(int x=0;x<x_width;x++)
-            for(int y=0;y<y_width;y++)
-                (*this)(x,y) = INT_MAX/2;
-
-        // Initialize the first row and first column.
-        // This avoids handling special cases later.
-        for(int x=0;x<x_width;x++)
-            (*this)(x,0) = x;
-        for(int y=0;y<y_width;y++)
-            (*this)(0,y) = y;
-
-        // The score cannot be higher than the score you would get if all letters matched.
-        // And that score is |x-y| for cell (x,y).
-        // So we can impose the constraint that |x-y| <= max_dist.
-        // This means that x \in (y-max_dist,y+max_dist) \cap (0,x_width-1)
-        // Since we are computed (x=0,y) previously, we set xmin to at least 1
-        for(int y=0;y<y_width;y++)
-        {
-            xmin[y] = std::max(1,y-max_dist);
-            xmax[y] = std::min(x_width-1,y+max_dist);
-        }
-    };
+        return info[depth].score;
+    }
+
+    int max_depth() const
+    {
+        return query_length + max_dist;
+    }
+
+    int get_max_dist() const
+    {
+        return max_dist;
+    }
 
-    ~dp_matrix()
-     {
-         delete[] data;
-         delete[] xmin;
-         delete[] xmax;
-     }
+    // Later columns only need to find targets within the new distance. The last rows
+    // stored for the columns already computed are then too low, which only means that
+    // they rule out fewer targets.
+    void lower_max_dist(int d)
+    {
+        max_dist = std::min(max_dist, d);
+    }
+
+    edit_distance_columns(const vector<stored_index_t>& query, int alphabet_size, int max_dist_,
+                          vector<uint64_t>& scratch_bits, vector<column_info>& scratch_info);
 };
 
+edit_distance_columns::edit_distance_columns(const vector<stored_index_t>& query, int alphabet_size, int max_dist_,
+                                             vector<uint64_t>& scratch_bits, vector<column_info>& scratch_info)
+    :query_length(query.size()),
+     num_words((query.size() + 63)/64),
+     max_dist(max_dist_)
+{
+    assert(query_length > 0);
+    const int num_columns = max_depth() + 1;
+    const std::size_t peq_size = std::size_t(alphabet_size)*num_words;
+    const std::size_t column_bits_size = std::size_t(num_columns)*num_words;
+    // Only grows, so a thread pays for the allocation once.
+    if (scratch_bits.size() < peq_size + 2*column_bits_size)
+        scratch_bits.resize(peq_size + 2*column_bits_size);
+    if (scratch_info.size() < std::size_t(num_columns))
+        scratch_info.resize(num_columns);
+
+    uint64_t* peq_words = scratch_bits.data();
+    std::fill(peq_words, peq_words + peq_size, 0);
+    for(int i=0; i<query_length; i++)
+        if (query[i] < alphabet_size)
+            peq_words[std::size_t(query[i])*num_words + i/64] |= uint64_t(1) << (i%64);
+    peq = peq_words;
+    vp = peq_words + peq_size;
+    vn = vp + column_bits_size;
+    info = scratch_info.data();
+
+    // Column 0 (no target letters): row i has score i.
+    std::fill(vp, vp + num_words, ~uint64_t(0));
+    std::fill(vn, vn + num_words, 0);
+    info[0].score = query_length;
+    info[0].last_row = std::min(max_dist, query_length - 1);
+    info[0].last_row_score = info[0].last_row;
+}
+
+// Reused by every query on this thread.
+thread_local vector<uint64_t> fuzzy_match_scratch_bits;
+thread_local vector<edit_distance_columns::column_info> fuzzy_match_scratch_info;
+
+void CompressedTrie::add_match(FuzzyQueryResult && res,
+                               edit_distance_columns& score,
+                               std::vector<FuzzyQueryResult> & results,
+                               const FuzzyMatchBound * bound) const
+{
+    if (bound)
+    {
+        _finish_query_result(res);
+        score.lower_max_dist((*bound)(res));
+    }
+    results.push_back(std::move(res));
+}
+
 void CompressedTrie::extend_partial_match(const vector<stored_index_t>& query,
-                                          const unsigned int max_dist,
                                           const CTrieNode* curr_node,
-                                          dp_matrix& score,
+                                          edit_distance_columns& score,
                                           vector<stored_index_t>& match_coded,
-                                          std::vector<FuzzyQueryResult> & results) const
+                                          std::vector<FuzzyQueryResult> & results,
+                                          const FuzzyMatchBound * bound) const
 {
     // 1. Handle case where there only one target string with this prefix
     if (curr_node->is_terminal())
     {
+        const unsigned int max_dist = score.get_max_dist();
         auto prev_length = match_coded.size();
         auto suffix_length = get_suffix_length(*curr_node);
         auto total_length = prev_length + suffix_length;
 
-        // If the terminal suffix is too long, we can't match.
-        if (total_length >= score.size2()) return;
-
+        // Since we know the length of the target, we can stop as soon as the letters that
+        // are left can't make up for the difference.
         auto suffix_char_ptr = get_suffix_ptr(*curr_node);
-        int next_best = 0;
         for(int y = prev_length+1; y <= total_length; y++, suffix_char_ptr++)
         {
-            if (next_best > max_dist) return;
-            next_best = score.calc_row(y, *suffix_char_ptr, query);
+            if (not score.can_match(y-1, total_length)) return;
+            score.calc_column(y, *suffix_char_ptr);
         }
 
-        unsigned int dist = score.score_for_row(total_length);
+        unsigned int dist = score.score_for_column(total_length);
 
         // FIXME: maybe stop passing in L just to do a reserve?
         if (dist <= max_dist)
-            results.push_back( {match_coded, get_suffix_ptr(*curr_node), suffix_length, dist} );
+            add_match({match_coded, get_suffix_ptr(*curr_node), suffix_length, dist}, score, results, bound);
 
         return;
     }
 
     // 2. Handle case where there are multiple target strings with this prefix.
+    const int depth = match_coded.size() + 1;
     for (auto [letter, index] : curr_node->children())
     {
-        match_coded.push_back(letter);
-        {
-            // 3a. Compute DP values for `letter`
-            int next_best = score.calc_row(match_coded.size(), letter, query);
+        // The bound may have dropped in the subtree of the previous letter.
+        const unsigned int max_dist = score.get_max_dist();
 
-            const CTrieNode * next_node = &(node_vec[index]);
+        // 3a. Compute DP values for `letter`
+        bool can_extend = score.calc_column(depth, letter);
+        unsigned int dist = score.score_for_column(depth);
 
-            // 3b. Consider matches that are now complete.
-            if (next_node->is_key_terminating())
-            {
-                unsigned int dist = score.score_for_row( match_coded.size() );
+        // Most letters are too far from the query: skip them without loading their nodes.
+        if (not can_extend and dist > max_dist) continue;
 
-                if (dist <= max_dist)
-                    results.push_back( {match_coded, nullptr, 0, dist} );
-            }
+        const CTrieNode * next_node = &(node_vec[index]);
+        match_coded.push_back(letter);
 
-            // 3c. Consider matches that have at least one more letter.
-            if (next_best <= max_dist)
-                extend_partial_match(query, max_dist, next_node, score, match_coded, results);
+        // 3b. Consider matches that are now complete.
+        if (dist <= max_dist and next_node->is_key_terminating())
+            add_match({match_coded, nullptr, 0, dist}, score, results, bound);
+
+        // 3c. Consider matches that have at least one more letter. A terminal node with an
+        //     empty suffix also completes a match here, so visit it even if we can't extend.
+        if (can_extend or (dist <= score.get_max_dist() and next_node->is_terminal()))
+            extend_partial_match(query, next_node, score, match_coded, results, bound);
+
+        // NOTE: We never compute a column deeper than score.max_depth(), because we
+        //       haven't allocated memory for it.  At that depth every row above the last
+        //       one is more than `max_dist` away from the diagonal, and the last one is at
+        //       least `max_dist`, so calc_column returns false.
 
-            // NOTE: We need to avoid rows that are too large, because haven't allocated memory
-            //       for them in either the table itself, or xmin / xmax.
-            //
-            //       However, the last viable row should have only one viable cell, and this cell
-            //       can only have the value `max_dist`.  That means that the next_best will be
-            //       `max_dist+1`, so we will not call extend_partial_match in that case.
-        }
         match_coded.pop_back();
     }
 }
@@ -179,7 +294,9 @@ void CompressedTrie::_finish_query_result(FuzzyQueryResult & res) const {
 }
 
 
-std::vector<FuzzyQueryResult> CompressedTrie::fuzzy_matches(const stored_str_t & query_str, unsigned int max_dist) const
+std::vector<FuzzyQueryResult> CompressedTrie::fuzzy_matches(const stored_str_t & query_str,
+                                                             unsigned int max_dist,
+                                                             const FuzzyMatchBound * bound) const
 {
     if (DB_FUZZY_MATCH) {std::cerr << "fuzzy_matches (within " << max_dist << " edits) of \"" << to_char_str(query_str) << "\"\n";}
     if (query_str.length() == 0) {
@@ -203,22 +320,19 @@ std::vector<FuzzyQueryResult> CompressedTrie::fuzzy_matches(const stored_str_t &
     std::vector<FuzzyQueryResult> results;
     results.reserve(20);
 
-    // 2. Allocate a dynamic programming matrix with size (|query|+1, |target|+1)
-    //    We can ignore target strings longer than query_str().size+max_dist.
-    const int XW = query.size()+1;
-    const int YW = query.size()+1+max_dist;
-
-    //    The cell (x,y) indicates the score after having seen x letters of the query and y letters of the target.
-    dp_matrix score(XW, YW, max_dist);
+    // 2. Set up the DP columns for targets of up to |query|+max_dist letters.
+    //    We can ignore target strings longer than that.
+    //    Row x of column y is the score after having seen x letters of the query and y letters of the target.
+    edit_distance_columns score(query, letters.size(), max_dist, fuzzy_match_scratch_bits, fuzzy_match_scratch_info);
 
     // 4. Keep track of the path through the prefix ctrie as we walk it.
     vector<stored_index_t> match_coded;
-    match_coded.reserve(YW-1);
+    match_coded.reserve(score.max_depth());
 
     auto root_node = &(node_vec.at(0));
 
     // Do a depth-first search using the stack.
-    extend_partial_match(query, max_dist, root_node, score, match_coded, results);
+    extend_partial_match(query, root_node, score, match_coded, results, bound);
 
     for (auto & r : results)
         _finish_query_result(r);
@@ -4,8 +4,8 @@
 
 namespace otc {
 const std::ctype<char> * glob_facet;
-std::wstring_convert<deletable_facet<std::codecvt<char32_t, char, std::mbstate_t> >, char32_t> glob_conv32;
-std::wstring_convert<std::codecvt_utf8_utf16<char32_t>, char32_t> glob_conv8;
+thread_local std::wstring_convert<deletable_facet<std::codecvt<char32_t, char, std::mbstate_t> >, char32_t> glob_conv32;
+thread_local std::wstring_convert<std::codecvt_utf8_utf16<char32_t>, char32_t> glob_conv8;
 std::locale global_locale;
 
 int set_global_conv_facet() {
@@ -30,8 +30,9 @@ struct deletable_facet : Facet {
     ~deletable_facet() {}
 };
 
-extern std::wstring_convert<deletable_facet<std::codecvt<char32_t, char, std::mbstate_t> >, char32_t> glob_conv32;
-extern std::wstring_convert<std::codecvt_utf8_utf16<char32_t>, char32_t> glob_conv8;
+// wstring_convert keeps state between calls, so each thread gets its own converters.
+extern thread_local std::wstring_convert<deletable_facet<std::codecvt<char32_t, char, std::mbstate_t> >, char32_t> glob_conv32;
+extern thread_local std::wstring_convert<std::codecvt_utf8_utf16<char32_t>, char32_t> glob_conv8;
 
 inline std::u32string to_u32string(const std::string_view & undecoded) {
     return glob_conv32.from_bytes(undecoded.data(), undecoded.data() + undecoded.length());
@@ -90,9 +90,9 @@ class EmbeddingCLI
                 internalIDs.insert(nd->get_ott_id());
             }
             auto & d = nd->get_data().des_ids;
-            for (auto o : internalIDs) {
-                d.erase(o);
-            }
+            erase_if(d, [&internalIDs](OttId o) {
+                return contains(internalIDs, o);
+            });
         }
         // Store the tree's filename
         taxonomyAsSource->set_name("TAXONOMY");
@@ -0,0 +1,406 @@
+#ifndef OTCETERA_FROZEN_TREE_H
+#define OTCETERA_FROZEN_TREE_H
+// A read-only, index-based copy of the topology of a RootedTree.
+// Depends on: tree.h tree_iter.h
+//
+// Nodes are numbered in preorder (the root is 0), and the topology is stored
+//  as columns of std::uint32_t (parent, depth, subtree end, ...).
+//  Traversals of a FrozenTree only touch those contiguous arrays, rather than
+//  following pointers between nodes scattered across the heap.
+// Because nodes are numbered in preorder, the subtree rooted at i is the
+//  range [i, subtree_end(i)), so ancestor tests are two comparisons. The first
+//  child of an internal node i is i + 1, and the next sib of i starts where the
+//  subtree of i ends, so neither needs a column.
+// MRCA queries are O(1): for preorder indices a < b, the MRCA is the parent of
+//  the shallowest node in (a, b], which is found with a RangeMinIndex over the
+//  depth column.
+//
+// The node data of the source tree must have a `std::uint32_t frozen_index`
+//  member, which the constructor fills in so that node pointers can be mapped
+//  to indices in O(1). The source tree must not be modified after freezing.
+//
+// Equivalents of the pointer-based traversals (taking a FrozenTree and a node index):
+//     iter_pre, iter_post, iter_child
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <vector>
+#include "otc/otc_base_includes.h"
+#include "otc/error.h"
+#include "otc/tree.h"
+#include "otc/tree_iter.h"
+
+namespace otc {
+
+constexpr std::uint32_t NO_FROZEN_NODE = UINT32_MAX;
+
+// Answers "index of the smallest key in [first, last]" in O(1) time with O(n) extra space.
+//  Keys are split into blocks of 64. Within a block, mask[i] has a bit set for
+//  every position in the block whose key is smaller than all keys after it up
+//  to i, so the minimum of [first, i] is the lowest set bit at or after first.
+//  Queries spanning several blocks use a sparse table over the block minima.
+// Ties may return any of the minimal positions.
+class RangeMinIndex {
+    public:
+        RangeMinIndex() = default;
+        explicit RangeMinIndex(const std::vector<std::uint32_t> & keys) {
+            build(keys);
+        }
+        void build(const std::vector<std::uint32_t> & keys);
+        std::uint32_t argmin(const std::vector<std::uint32_t> & keys,
+                             std::uint32_t first,
+                             std::uint32_t last) const;
+        std::size_t bytes_allocated() const {
+            std::size_t total = in_block_mask.capacity() * sizeof(std::uint64_t);
+            for (const auto & level : block_min) {
+                total += level.capacity() * sizeof(std::uint32_t);
+            }
+            return total;
+        }
+    private:
+        static constexpr std::uint32_t BLOCK_BITS = 6;
+        static constexpr std::uint32_t BLOCK_SIZE = 1U << BLOCK_BITS;
+        std::uint32_t argmin_in_block(std::uint32_t first, std::uint32_t last) const {
+            const std::uint64_t m = in_block_mask[last] & (~std::uint64_t(0) << (first % BLOCK_SIZE));
+            return (last & ~(BLOCK_SIZE - 1)) + std::countr_zero(m);
+        }
+        static std::uint32_t smaller(const std::vector<std::uint32_t> & keys, std::uint32_t a, std::uint32_t b) {
+            return keys[b] < keys[a] ? b : a;
+        }
+        std::vector<std::uint64_t> in_block_mask;
+        // block_min[k][b] is the index of the minimum over blocks [b, b + 2^k)
+        std::vector<std::vector<std::uint32_t> > block_min;
+};
+
+inline void RangeMinIndex::build(const std::vector<std::uint32_t> & keys) {
+    const std::uint32_t n = keys.size();
+    in_block_mask.assign(n, 0);
+    std::uint64_t stack_mask = 0;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const std::uint32_t offset = i % BLOCK_SIZE;
+        if (offset == 0) {
+            stack_mask = 0;
+        }
+        const std::uint32_t block_start = i - offset;
+        while (stack_mask != 0) {
+            const std::uint32_t top = block_start + 63 - std::countl_zero(stack_mask);
+            if (keys[top] < keys[i]) {
+                break;
+            }
+            stack_mask &= ~(std::uint64_t(1) << (top - block_start));
+        }
+        stack_mask |= std::uint64_t(1) << offset;
+        in_block_mask[i] = stack_mask;
+    }
+    const std::uint32_t num_blocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    block_min.clear();
+    if (num_blocks == 0) {
+        return;
+    }
+    block_min.emplace_back(num_blocks);
+    for (std::uint32_t b = 0; b < num_blocks; ++b) {
+        const std::uint32_t last = std::min(n, (b + 1) * BLOCK_SIZE) - 1;
+        block_min[0][b] = argmin_in_block(b * BLOCK_SIZE, last);
+    }
+    for (std::uint32_t k = 1; (1U << k) <= num_blocks; ++k) {
+        const std::uint32_t half = 1U << (k - 1);
+        std::vector<std::uint32_t> level(num_blocks - (1U << k) + 1);
+        const auto & prev = block_min.back();
+        for (std::uint32_t b = 0; b < level.size(); ++b) {
+            level[b] = smaller(keys, prev[b], prev[b + half]);
+        }
+        block_min.push_back(std::move(level));
+    }
+}
+
+inline std::uint32_t RangeMinIndex::argmin(const std::vector<std::uint32_t> & keys,
+                                           std::uint32_t first,
+                                           std::uint32_t last) const {
+    assert(first <= last && last < keys.size());
+    const std::uint32_t first_block = first >> BLOCK_BITS;
+    const std::uint32_t last_block = last >> BLOCK_BITS;
+    if (first_block == last_block) {
+        return argmin_in_block(first, last);
+    }
+    std::uint32_t r = smaller(keys,
+                              argmin_in_block(first, (first_block << BLOCK_BITS) + BLOCK_SIZE - 1),
+                              argmin_in_block(last_block << BLOCK_BITS, last));
+    if (first_block + 1 < last_block) {
+        const std::uint32_t b = first_block + 1;
+        const std::uint32_t num = last_block - b;
+        const std::uint32_t k = std::bit_width(num) - 1;
+        r = smaller(keys, r, smaller(keys, block_min[k][b], block_min[k][last_block - (1U << k)]));
+    }
+    return r;
+}
+
+template<typename T>
+class FrozenTree {
+    public:
+        using node_type = typename T::node_type;
+
+        explicit FrozenTree(T & tree);
+        FrozenTree(const FrozenTree &) = delete;
+        FrozenTree & operator=(const FrozenTree &) = delete;
+
+        std::uint32_t size() const {
+            return static_cast<std::uint32_t>(nodes.size());
+        }
+        std::uint32_t get_root() const {
+            return nodes.empty() ? NO_FROZEN_NODE : 0;
+        }
+        std::uint32_t get_parent(std::uint32_t i) const {
+            return parent[i];
+        }
+        std::uint32_t get_first_child(std::uint32_t i) const {
+            return is_tip(i) ? NO_FROZEN_NODE : i + 1;
+        }
+        std::uint32_t get_next_sib(std::uint32_t i) const {
+            const std::uint32_t p = parent[i];
+            if (p == NO_FROZEN_NODE or end_of_subtree[i] == end_of_subtree[p]) {
+                return NO_FROZEN_NODE;
+            }
+            return end_of_subtree[i];
+        }
+        std::uint32_t get_depth(std::uint32_t i) const {
+            return depth[i];
+        }
+        std::uint32_t get_num_tips(std::uint32_t i) const {
+            return num_tips[i];
+        }
+        // one past the last preorder index in the subtree rooted at i.
+        std::uint32_t subtree_end(std::uint32_t i) const {
+            return end_of_subtree[i];
+        }
+        bool is_tip(std::uint32_t i) const {
+            return end_of_subtree[i] == i + 1;
+        }
+        // true if anc == des or anc is an ancestor of des
+        bool is_ancestor_of(std::uint32_t anc, std::uint32_t des) const {
+            return anc <= des and des < end_of_subtree[anc];
+        }
+        // O(1). NO_FROZEN_NODE acts as an identity, so that an MRCA can be
+        //  accumulated starting from NO_FROZEN_NODE.
+        std::uint32_t mrca(std::uint32_t a, std::uint32_t b) const {
+            if (a == NO_FROZEN_NODE) {
+                return b;
+            }
+            if (b == NO_FROZEN_NODE or a == b) {
+                return a;
+            }
+            if (b < a) {
+                std::swap(a, b);
+            }
+            if (b < end_of_subtree[a]) {
+                return a;
+            }
+            return parent[depth_index.argmin(depth, a + 1, b)];
+        }
+        const node_type * mrca(const node_type * a, const node_type * b) const {
+            return nodes[mrca(index_of(a), index_of(b))];
+        }
+        bool is_ancestor_of(const node_type * anc, const node_type * des) const {
+            return is_ancestor_of(index_of(anc), index_of(des));
+        }
+        const node_type * get_node(std::uint32_t i) const {
+            return nodes[i];
+        }
+        std::uint32_t index_of(const node_type * nd) const {
+            return nd->get_data().frozen_index;
+        }
+        std::size_t bytes_allocated() const {
+            const std::size_t cols = parent.capacity() + depth.capacity() + num_tips.capacity() + end_of_subtree.capacity();
+            return cols * sizeof(std::uint32_t) + nodes.capacity() * sizeof(const node_type *) + depth_index.bytes_allocated();
+        }
+    private:
+        std::vector<std::uint32_t> parent;
+        std::vector<std::uint32_t> depth;
+        std::vector<std::uint32_t> num_tips;
+        std::vector<std::uint32_t> end_of_subtree;
+        std::vector<const node_type *> nodes;
+        RangeMinIndex depth_index;
+};
+
+template<typename T>
+FrozenTree<T>::FrozenTree(T & tree) {
+    std::size_t num_nodes = 0;
+    for (auto nd : iter_pre(tree)) {
+        nd->get_data().frozen_index = static_cast<std::uint32_t>(num_nodes);
+        ++num_nodes;
+    }
+    if (num_nodes >= NO_FROZEN_NODE) {
+        throw OTCError() << "Tree with " << num_nodes << " nodes is too large to freeze.";
+    }
+    parent.assign(num_nodes, NO_FROZEN_NODE);
+    depth.assign(num_nodes, 1);
+    num_tips.assign(num_nodes, 0);
+    end_of_subtree.assign(num_nodes, 0);
+    nodes.reserve(num_nodes);
+    for (auto nd : iter_pre_const(tree)) {
+        const std::uint32_t i = nodes.size();
+        nodes.push_back(nd);
+        auto p = nd->get_parent();
+        if (p != nullptr) {
+            const std::uint32_t pi = index_of(p);
+            parent[i] = pi;
+            depth[i] = depth[pi] + 1;
+        }
+    }
+    // Children have larger indices than their parents, so a reverse sweep
+    //  sees every node after all of its descendants.
+    for (std::uint32_t i = size(); i-- > 0;) {
+        if (end_of_subtree[i] == 0) { // no child has been seen, so i is a tip
+            num_tips[i] = 1;
+            end_of_subtree[i] = i + 1;
+        }
+        const std::uint32_t pi = parent[i];
+        if (pi != NO_FROZEN_NODE) {
+            num_tips[pi] += num_tips[i];
+            if (end_of_subtree[pi] < end_of_subtree[i]) {
+                end_of_subtree[pi] = end_of_subtree[i];
+            }
+        }
+    }
+    depth_index.build(depth);
+}
+
+// Visits the nodes of a FrozenTree in postorder (children before parents,
+//  left to right), without any auxiliary stack.
+template<typename T>
+class FrozenPostorderIter {
+    public:
+        class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::uint32_t;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const std::uint32_t *;
+                using reference = std::uint32_t;
+
+                iterator() = default;
+                iterator(const FrozenTree<T> * t, std::uint32_t start, std::uint32_t c)
+                    :tree(t), subtree_root(start), curr(c) {
+                }
+                std::uint32_t operator*() const {
+                    return curr;
+                }
+                iterator & operator++() {
+                    if (curr == subtree_root) {
+                        curr = NO_FROZEN_NODE;
+                    } else {
+                        auto s = tree->get_next_sib(curr);
+                        curr = (s == NO_FROZEN_NODE ? tree->get_parent(curr) : leftmost_tip(*tree, s));
+                    }
+                    return *this;
+                }
+                iterator operator++(int) {
+                    iterator r = *this;
+                    ++(*this);
+                    return r;
+                }
+                bool operator==(const iterator & other) const {
+                    return curr == other.curr;
+                }
+                bool operator!=(const iterator & other) const {
+                    return curr != other.curr;
+                }
+            private:
+                const FrozenTree<T> * tree = nullptr;
+                std::uint32_t subtree_root = NO_FROZEN_NODE;
+                std::uint32_t curr = NO_FROZEN_NODE;
+        };
+        FrozenPostorderIter(const FrozenTree<T> & t, std::uint32_t start)
+            :tree(t), subtree_root(start) {
+        }
+        iterator begin() const {
+            if (subtree_root == NO_FROZEN_NODE) {
+                return end();
+            }
+            return iterator(&tree, subtree_root, leftmost_tip(tree, subtree_root));
+        }
+        iterator end() const {
+            return iterator(&tree, subtree_root, NO_FROZEN_NODE);
+        }
+        static std::uint32_t leftmost_tip(const FrozenTree<T> & t, std::uint32_t i) {
+            for (auto c = t.get_first_child(i); c != NO_FROZEN_NODE; c = t.get_first_child(i)) {
+                i = c;
+            }
+            return i;
+        }
+    private:
+        const FrozenTree<T> & tree;
+        std::uint32_t subtree_root;
+};
+
+template<typename T>
+class FrozenChildIter {
+    public:
+        class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::uint32_t;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const std::uint32_t *;
+                using reference = std::uint32_t;
+
+                iterator() = default;
+                iterator(const FrozenTree<T> * t, std::uint32_t c)
+                    :tree(t), curr(c) {
+                }
+                std::uint32_t operator*() const {
+                    return curr;
+                }
+                iterator & operator++() {
+                    curr = tree->get_next_sib(curr);
+                    return *this;
+                }
+                iterator operator++(int) {
+                    iterator r = *this;
+                    ++(*this);
+                    return r;
+                }
+                bool operator==(const iterator & other) const {
+                    return curr == other.curr;
+                }
+                bool operator!=(const iterator & other) const {
+                    return curr != other.curr;
+                }
+            private:
+                const FrozenTree<T> * tree = nullptr;
+                std::uint32_t curr = NO_FROZEN_NODE;
+        };
+        FrozenChildIter(const FrozenTree<T> & t, std::uint32_t p)
+            :tree(t), par(p) {
+        }
+        iterator begin() const {
+            return iterator(&tree, tree.get_first_child(par));
+        }
+        iterator end() const {
+            return iterator(&tree, NO_FROZEN_NODE);
+        }
+    private:
+        const FrozenTree<T> & tree;
+        std::uint32_t par;
+};
+
+// preorder indices of the subtree rooted at nd
+template<typename T>
+inline auto iter_pre(const FrozenTree<T> & tree, std::uint32_t nd) {
+    return std::views::iota(nd, tree.subtree_end(nd));
+}
+
+template<typename T>
+inline FrozenPostorderIter<T> iter_post(const FrozenTree<T> & tree, std::uint32_t nd) {
+    return FrozenPostorderIter<T>(tree, nd);
+}
+
+template<typename T>
+inline FrozenChildIter<T> iter_child(const FrozenTree<T> & tree, std::uint32_t nd) {
+    return FrozenChildIter<T>(tree, nd);
+}
+
+} // namespace otc
+#endif
@@ -0,0 +1,184 @@
+#ifndef OTCETERA_LEAF_BITSET_H
+#define OTCETERA_LEAF_BITSET_H
+// Splits (the leaf sets of clades) over a fixed, numbered set of leaves.
+//
+// An OttIdSet is a node-based std::set, so the splits of a tree with n leaves cost
+//  O(n^2) allocations in the worst case, and comparing or intersecting two of them
+//  chases pointers. When every split in a comparison is a subset of one set of leaves
+//  (e.g. the leaves of an input tree), LeafIndex numbers those leaves 0..n-1 and a split
+//  can be stored as:
+//    - a LeafBitset of ceil(n/64) words. Equality, subset and intersection tests are
+//      word-wise, and bitsets hash, so a set of splits can be an unordered_set.
+//    - a LeafSpan: its lowest and highest leaf number and its size. If the leaves are
+//      numbered in the postorder of a tree, the leaf set of each of its nodes is an
+//      interval, so a split is the leaf set of one of its nodes iff it has no gaps and
+//      its interval is in a table of the tree's intervals (Day 1985). That takes O(1)
+//      space per split, so it also works for trees with 100k leaves, where n^2 bits don't.
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "otc/otc_base_includes.h"
+
+namespace otc {
+
+class LeafIndex {
+    public:
+    // Numbers the leaves in the order given.
+    explicit LeafIndex(std::vector<OttId> leaf_ids)
+        :ids(std::move(leaf_ids)) {
+        id_to_index.reserve(ids.size());
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            id_to_index.emplace(ids[i], i);
+        }
+    }
+    std::size_t size() const {
+        return ids.size();
+    }
+    // The index of ott_id, or -1 if it is not one of the leaves.
+    long index_of(OttId ott_id) const {
+        auto it = id_to_index.find(ott_id);
+        return (it == id_to_index.end() ? -1 : static_cast<long>(it->second));
+    }
+    OttId ott_id_at(std::size_t index) const {
+        return ids[index];
+    }
+    private:
+    std::vector<OttId> ids;
+    std::unordered_map<OttId, std::size_t> id_to_index;
+};
+
+struct LeafSpan {
+    std::size_t first = SIZE_MAX;
+    std::size_t last = 0;
+    std::size_t count = 0;
+
+    void add(std::size_t index) {
+        first = std::min(first, index);
+        last = std::max(last, index);
+        count += 1;
+    }
+    // other must not share any leaves with this span
+    void add(const LeafSpan & other) {
+        first = std::min(first, other.first);
+        last = std::max(last, other.last);
+        count += other.count;
+    }
+    bool is_interval() const {
+        return count > 0 and last - first + 1 == count;
+    }
+    std::uint64_t interval_key() const {
+        return (std::uint64_t(first) << 32) | std::uint64_t(last);
+    }
+};
+
+class LeafBitset {
+    public:
+    LeafBitset() = default;
+    explicit LeafBitset(const LeafIndex & index)
+        :words((index.size() + 63) / 64, 0) {
+    }
+    void set(std::size_t i) {
+        words[i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+    bool test(std::size_t i) const {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+    std::size_t count() const {
+        std::size_t c = 0;
+        for (auto w : words) {
+            c += std::popcount(w);
+        }
+        return c;
+    }
+    bool none() const {
+        return std::all_of(words.begin(), words.end(), [](std::uint64_t w) { return w == 0; });
+    }
+    LeafBitset & operator|=(const LeafBitset & other) {
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+    bool is_subset_of(const LeafBitset & other) const {
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            if (words[i] & ~other.words[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool intersects(const LeafBitset & other) const {
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            if (words[i] & other.words[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // Are all (or any) of the leaves first..last in the set?
+    bool all_in_range(std::size_t first, std::size_t last) const {
+        return count_in_range(first, last) == last - first + 1;
+    }
+    bool any_in_range(std::size_t first, std::size_t last) const {
+        for (std::size_t w = first / 64; w <= last / 64; ++w) {
+            if (words[w] & range_mask(w, first, last)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    std::size_t count_in_range(std::size_t first, std::size_t last) const {
+        std::size_t c = 0;
+        for (std::size_t w = first / 64; w <= last / 64; ++w) {
+            c += std::popcount(words[w] & range_mask(w, first, last));
+        }
+        return c;
+    }
+    OttIdSet to_ott_id_set(const LeafIndex & index) const {
+        OttIdSet r;
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            for (auto w = words[i]; w != 0; w &= w - 1) {
+                r.insert(index.ott_id_at(64 * i + std::countr_zero(w)));
+            }
+        }
+        return r;
+    }
+    bool operator==(const LeafBitset & other) const {
+        return words == other.words;
+    }
+    std::size_t hash() const {
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for (auto w : words) {
+            h = (h ^ w) * 0x100000001b3ULL;
+            h ^= h >> 29;
+        }
+        return static_cast<std::size_t>(h);
+    }
+    private:
+    // The bits of word w that are in first..last
+    static std::uint64_t range_mask(std::size_t w, std::size_t first, std::size_t last) {
+        std::uint64_t m = ~std::uint64_t(0);
+        if (w == first / 64) {
+            m &= ~std::uint64_t(0) << (first % 64);
+        }
+        if (w == last / 64) {
+            m &= ~std::uint64_t(0) >> (63 - last % 64);
+        }
+        return m;
+    }
+    std::vector<std::uint64_t> words;
+};
+
+struct LeafBitsetHash {
+    std::size_t operator()(const LeafBitset & b) const {
+        return b.hash();
+    }
+};
+
+using LeafBitsetSet = std::unordered_set<LeafBitset, LeafBitsetHash>;
+
+} // namespace otc
+#endif
@@ -7,6 +7,7 @@
 #include "otc/error.h"
 #include "otc/util.h"
 #include "otc/debug.h"
+#include "otc/robin_hood.h"
 #include <vector>
 #include <unordered_map>
 #include <set>
@@ -100,6 +101,32 @@ inline std::size_t calc_memory_used_by_map_simple(const std::unordered_map<K, V>
     }
     return total;
 }
+// robin_hood maps allocate all of their slots (mask() + 1 of them) up front.
+template<bool IsFlat, std::size_t MaxLoadFactor100, typename K, typename V, typename H, typename E>
+inline std::size_t calc_memory_used_by_map_eqsize(const robin_hood::detail::Table<IsFlat, MaxLoadFactor100, K, V, H, E> & v,
+                                                  std::size_t el_size,
+                                                  MemoryBookkeeper &) {
+    std::size_t total = 0;
+    const std::size_t num_slots = (v.size() == 0 ? 0 : v.mask() + 1);
+    if (num_slots > v.size()) {
+        total += (num_slots - v.size()) * (IsFlat ? sizeof(K) + sizeof(V) : sizeof(char *));
+    }
+    total += num_slots; // one info byte per slot
+    total += v.size() * el_size;
+    return total;
+}
+
+template<bool IsFlat, std::size_t MaxLoadFactor100, typename K, typename V, typename H, typename E>
+inline std::size_t calc_memory_used_by_map_simple(const robin_hood::detail::Table<IsFlat, MaxLoadFactor100, K, V, H, E> & v,
+                                                  MemoryBookkeeper &mb) {
+    std::size_t total = 0;
+    for (const auto & el : v) {
+        total += calc_memory_used(el.first, mb);
+        total += calc_memory_used(el.second, mb);
+    }
+    return total;
+}
+
 template<typename K, typename V>
 inline std::size_t calc_memory_used_by_map_simple(const std::map<K, V> & v, MemoryBookkeeper &mb) {
     std::size_t total = 0;
@@ -294,9 +294,7 @@ bool PathPairing<T, U>::update_ott_id_set_no_traversal(const OttIdSet & oldEls,
         return false;
     }
     if (!i.empty()) {
-        for (auto o : i) {
-            curr_child_ott_id_set.erase(o);
-        }
+        curr_child_ott_id_set = set_difference_as_set(curr_child_ott_id_set, i);
     }
     curr_child_ott_id_set.insert(begin(newEls), end(newEls));
     if (false && debugging_output_enabled) {
@@ -132,7 +132,7 @@ void name_unnamed_nodes(T & tree) {
         child->detach_this_node();
         nd->add_sib_on_right(child);
         nd->detach_this_node();
-        delete nd;
+        tree.delete_node(nd);
     }
     
     OttId id = 1;
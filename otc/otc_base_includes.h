@@ -3,6 +3,7 @@
 
 #include "assert.hh"
 #include <set>
+#include "otc/sorted_vector_set.h"
 #include <functional>
 #ifdef __clang__
 #pragma clang diagnostic ignored "-Wpadded"
@@ -52,7 +53,13 @@ inline OttId check_ott_id_size(long raw_ott_id) {
     return *id;
 }
 
+// The id set used for des_ids and most set algebra on ids. Build with
+//  -DOTC_STD_OTT_ID_SET (meson -Dott_id_set=std) to go back to std::set.
+#if defined(OTC_STD_OTT_ID_SET)
 using OttIdSet = std::set<OttId>;
+#else
+using OttIdSet = SortedVectorSet<OttId>;
+#endif
 
 // forward decl
 class RTSplits;
@@ -0,0 +1,142 @@
+#include "otc/snapshot.h"
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+
+namespace otc {
+
+FileStamp stamp_file(const string & filepath) {
+    FileStamp stamp;
+    struct stat st;
+    if (::stat(filepath.c_str(), &st) == 0) {
+        stamp.size = static_cast<std::uint64_t>(st.st_size);
+        stamp.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    return stamp;
+}
+
+MappedFile::MappedFile(const string & filepath) {
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw OTCError() << "Could not open \"" << filepath << "\": " << std::strerror(errno);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw OTCError() << "Could not stat \"" << filepath << "\": " << std::strerror(errno);
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    if (length > 0) {
+        void * p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            throw OTCError() << "Could not mmap \"" << filepath << "\": " << std::strerror(errno);
+        }
+        start = static_cast<const char *>(p);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (start != nullptr) {
+        ::munmap(const_cast<char *>(start), length);
+    }
+}
+
+SnapshotWriter::SnapshotWriter(const string & filepath, SnapshotKind kind, std::uint32_t format_version)
+    :final_path(filepath),
+    tmp_path(filepath + ".tmp"),
+    out(tmp_path, std::ios::binary | std::ios::trunc) {
+    if (not out) {
+        throw OTCError() << "Could not open \"" << tmp_path << "\" for writing.";
+    }
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.kind = static_cast<std::uint32_t>(kind);
+    header.format_version = format_version;
+    header.byte_order_mark = SNAPSHOT_BYTE_ORDER_MARK;
+    header.sizeof_ott_id = sizeof(OttId);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    pos = sizeof(header);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (not committed) {
+        out.close();
+        std::remove(tmp_path.c_str());
+    }
+}
+
+void SnapshotWriter::write_section(const char * p, std::size_t num_bytes) {
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    std::uint64_t n = num_bytes;
+    out.write(reinterpret_cast<const char *>(&n), sizeof(n));
+    if (num_bytes > 0) {
+        out.write(p, num_bytes);
+    }
+    pos += sizeof(n) + num_bytes;
+    auto padding = (8 - (pos % 8)) % 8;
+    out.write(zeros, padding);
+    pos += padding;
+    if (not out) {
+        throw OTCError() << "Error writing to \"" << tmp_path << "\".";
+    }
+}
+
+void SnapshotWriter::commit() {
+    out.close();
+    if (not out) {
+        throw OTCError() << "Error closing \"" << tmp_path << "\".";
+    }
+    std::filesystem::rename(tmp_path, final_path);
+    committed = true;
+}
+
+SnapshotReader::SnapshotReader(const string & filepath, SnapshotKind kind, std::uint32_t format_version)
+    :path(filepath),
+    mapped(filepath) {
+    static_assert(sizeof(SnapshotHeader) % 8 == 0);
+    if (mapped.size() < sizeof(SnapshotHeader)) {
+        throw OTCError() << "\"" << path << "\" is too short to be a snapshot.";
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        throw OTCError() << "\"" << path << "\" is not an otcetera snapshot.";
+    }
+    if (header.byte_order_mark != SNAPSHOT_BYTE_ORDER_MARK or header.sizeof_ott_id != sizeof(OttId)) {
+        throw OTCError() << "\"" << path << "\" was written by an incompatible build.";
+    }
+    if (header.kind != static_cast<std::uint32_t>(kind)) {
+        throw OTCError() << "\"" << path << "\" is the wrong kind of snapshot.";
+    }
+    if (header.format_version != format_version) {
+        throw OTCError() << "\"" << path << "\" has snapshot format version " << header.format_version
+                         << ", but version " << format_version << " is required.";
+    }
+    pos = sizeof(header);
+}
+
+std::pair<const char *, std::size_t> SnapshotReader::read_section() {
+    std::uint64_t n;
+    if (pos + sizeof(n) > mapped.size()) {
+        throw OTCError() << "Unexpected end of snapshot \"" << path << "\"";
+    }
+    std::memcpy(&n, mapped.data() + pos, sizeof(n));
+    pos += sizeof(n);
+    if (n > mapped.size() - pos) {
+        throw OTCError() << "Truncated section in snapshot \"" << path << "\"";
+    }
+    const char * p = mapped.data() + pos;
+    pos += n;
+    pos += (8 - (pos % 8)) % 8;
+    return {p, static_cast<std::size_t>(n)};
+}
+
+} // namespace otc
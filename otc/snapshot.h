@@ -0,0 +1,183 @@
+#ifndef OTC_SNAPSHOT_H
+#define OTC_SNAPSHOT_H
+// Binary snapshots let otc-tol-ws skip re-parsing the taxonomy .tsv files and
+//  the synthetic tree newick at boot.
+//
+// A snapshot file is a fixed SnapshotHeader followed by a sequence of sections.
+//  Each section is a uint64_t byte count followed by the raw bytes of an array
+//  of trivially copyable records, padded so that every section starts on an
+//  8-byte boundary. Snapshots are memory mapped for reading, so the arrays are
+//  read in place rather than copied.
+// Snapshots are a cache: they are only valid for the machine/build that wrote
+//  them, and the header records enough to detect a mismatch.
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "otc/otc_base_includes.h"
+#include "otc/error.h"
+
+namespace otc {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'O', 'T', 'C', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+
+enum class SnapshotKind : std::uint32_t {
+    TAXONOMY = 1,
+    SUMMARY_TREE = 2
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t kind;
+    std::uint32_t format_version;
+    std::uint32_t byte_order_mark;
+    std::uint32_t sizeof_ott_id;
+};
+
+// Size and modification time of a file, used to decide if a snapshot is stale.
+struct FileStamp {
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    bool operator==(const FileStamp &) const = default;
+};
+
+// Returns an all-zero stamp if the file does not exist.
+FileStamp stamp_file(const std::string & filepath);
+
+// (offset, length) of a string stored in the string pool section of a snapshot.
+struct SnapshotStr {
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+};
+
+class SnapshotStringPool {
+    public:
+    SnapshotStr add(std::string_view s) {
+        SnapshotStr r{pool.size(), s.length()};
+        pool.append(s);
+        return r;
+    }
+    const std::string & contents() const {
+        return pool;
+    }
+    private:
+    std::string pool;
+};
+
+// Read-only memory map of an entire file.
+class MappedFile {
+    public:
+    explicit MappedFile(const std::string & filepath);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+    const char * data() const {
+        return start;
+    }
+    std::size_t size() const {
+        return length;
+    }
+    private:
+    const char * start = nullptr;
+    std::size_t length = 0;
+};
+
+// Writes to `filepath`.tmp and renames the file into place in commit(),
+//  so that a crash while writing never leaves a truncated snapshot behind.
+class SnapshotWriter {
+    public:
+    SnapshotWriter(const std::string & filepath, SnapshotKind kind, std::uint32_t format_version);
+    ~SnapshotWriter();
+
+    template<typename T>
+    void write_array(const T * p, std::size_t n) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        static_assert(alignof(T) <= 8);
+        // Padding bytes would be written uninitialized, so records must not have any.
+        static_assert(std::has_unique_object_representations_v<T>);
+        write_section(reinterpret_cast<const char *>(p), n * sizeof(T));
+    }
+
+    template<typename T>
+    void write_vector(const std::vector<T> & v) {
+        write_array(v.data(), v.size());
+    }
+
+    template<typename T>
+    void write_value(const T & v) {
+        write_array(&v, 1);
+    }
+
+    void write_string(std::string_view s) {
+        write_section(s.data(), s.length());
+    }
+
+    void commit();
+
+    private:
+    void write_section(const char * p, std::size_t num_bytes);
+    std::string final_path;
+    std::string tmp_path;
+    std::ofstream out;
+    std::uint64_t pos = 0;
+    bool committed = false;
+};
+
+// Walks the sections of a mapped snapshot in the order that they were written.
+//  Throws OTCError if the file is not a snapshot of the expected kind and
+//  format version, or if a section is truncated.
+class SnapshotReader {
+    public:
+    SnapshotReader(const std::string & filepath, SnapshotKind kind, std::uint32_t format_version);
+
+    template<typename T>
+    std::pair<const T *, std::size_t> read_array() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        static_assert(alignof(T) <= 8);
+        auto [p, num_bytes] = read_section();
+        if (num_bytes % sizeof(T) != 0) {
+            throw OTCError() << "Snapshot section of " << num_bytes << " bytes is not a whole number of records in \"" << path << "\"";
+        }
+        return {reinterpret_cast<const T *>(p), num_bytes / sizeof(T)};
+    }
+
+    template<typename T>
+    T read_value() {
+        auto [p, n] = read_array<T>();
+        if (n != 1) {
+            throw OTCError() << "Expected a single record in snapshot section of \"" << path << "\"";
+        }
+        return *p;
+    }
+
+    std::string_view read_string() {
+        auto [p, num_bytes] = read_section();
+        return std::string_view(p, num_bytes);
+    }
+
+    const std::string & get_path() const {
+        return path;
+    }
+
+    private:
+    std::pair<const char *, std::size_t> read_section();
+    std::string path;
+    MappedFile mapped;
+    std::size_t pos = 0;
+};
+
+inline std::string_view snapshot_str_to_view(std::string_view pool, const SnapshotStr & s) {
+    if (s.offset + s.length > pool.length()) {
+        throw OTCError() << "Snapshot string reference out of range of the string pool";
+    }
+    return pool.substr(s.offset, s.length);
+}
+
+} // namespace otc
+#endif
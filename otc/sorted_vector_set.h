@@ -0,0 +1,219 @@
+#ifndef OTCETERA_SORTED_VECTOR_SET_H
+#define OTCETERA_SORTED_VECTOR_SET_H
+// A set of ids stored as a sorted, duplicate-free std::vector.
+//
+// std::set allocates a node of ~40 bytes per element, so the des_ids of every node
+//  of a tree cost far more than the ids themselves, and walking or merging them chases
+//  pointers. SortedVectorSet stores each id once, contiguously, and has the part of
+//  the std::set interface that otcetera uses (it is the default OttIdSet, see
+//  otc_base_includes.h), so code written against std::set<OttId> keeps working.
+//
+// The differences that matter:
+//    - inserting or erasing one element is O(n), except at the end. Inserting a range
+//      (e.g. the des_ids of a child) is a single O(n + m) merge, and std::inserter
+//      with the end() hint appends, so the set algebra of util.h is linear. To insert
+//      many ranges, use insert_union (util.h), and to erase many elements, erase_if or
+//      set_difference_as_set: a merge or erase per range or element is quadratic.
+//    - as with std::vector, inserting and erasing invalidate iterators.
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace otc {
+
+template<typename T>
+class SortedVectorSet {
+    public:
+    using key_type = T;
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T &;
+    using const_reference = const T &;
+    using iterator = typename std::vector<T>::const_iterator;
+    using const_iterator = iterator;
+    using reverse_iterator = typename std::vector<T>::const_reverse_iterator;
+    using const_reverse_iterator = reverse_iterator;
+
+    SortedVectorSet() = default;
+    SortedVectorSet(std::initializer_list<T> values)
+        :SortedVectorSet(values.begin(), values.end()) {
+    }
+    template<typename It>
+    SortedVectorSet(It first, It last)
+        :elements(first, last) {
+        sort_and_unique(elements.begin());
+    }
+    // Takes over v, which must be sorted and have no duplicates.
+    static SortedVectorSet from_sorted(std::vector<T> v) {
+        SortedVectorSet s;
+        s.elements = std::move(v);
+        return s;
+    }
+
+    iterator begin() const {
+        return elements.cbegin();
+    }
+    iterator end() const {
+        return elements.cend();
+    }
+    iterator cbegin() const {
+        return elements.cbegin();
+    }
+    iterator cend() const {
+        return elements.cend();
+    }
+    reverse_iterator rbegin() const {
+        return elements.crbegin();
+    }
+    reverse_iterator rend() const {
+        return elements.crend();
+    }
+    size_type size() const {
+        return elements.size();
+    }
+    bool empty() const {
+        return elements.empty();
+    }
+    size_type capacity() const {
+        return elements.capacity();
+    }
+    void clear() {
+        elements.clear();
+    }
+    void reserve(size_type n) {
+        elements.reserve(n);
+    }
+    void shrink_to_fit() {
+        elements.shrink_to_fit();
+    }
+    void swap(SortedVectorSet & other) {
+        elements.swap(other.elements);
+    }
+    const std::vector<T> & as_vector() const {
+        return elements;
+    }
+
+    iterator lower_bound(const T & value) const {
+        return std::lower_bound(elements.begin(), elements.end(), value);
+    }
+    iterator upper_bound(const T & value) const {
+        return std::upper_bound(elements.begin(), elements.end(), value);
+    }
+    iterator find(const T & value) const {
+        auto it = lower_bound(value);
+        return (it != end() and *it == value ? it : end());
+    }
+    size_type count(const T & value) const {
+        return (find(value) == end() ? 0 : 1);
+    }
+    bool contains(const T & value) const {
+        return find(value) != end();
+    }
+
+    std::pair<iterator, bool> insert(const T & value) {
+        if (elements.empty() or elements.back() < value) {
+            elements.push_back(value);
+            return {std::prev(elements.cend()), true};
+        }
+        auto it = lower_bound(value);
+        if (*it == value) {
+            return {it, false};
+        }
+        return {elements.insert(it, value), true};
+    }
+    // For std::inserter: O(1) if value belongs just before hint.
+    iterator insert(iterator hint, const T & value) {
+        if ((hint == end() or value < *hint) and (hint == begin() or *std::prev(hint) < value)) {
+            return elements.insert(hint, value);
+        }
+        return insert(value).first;
+    }
+    template<typename It>
+    void insert(It first, It last) {
+        const auto old_size = elements.size();
+        elements.insert(elements.end(), first, last);
+        sort_and_unique(elements.begin() + old_size);
+    }
+    void insert(std::initializer_list<T> values) {
+        insert(values.begin(), values.end());
+    }
+    std::pair<iterator, bool> emplace(const T & value) {
+        return insert(value);
+    }
+
+    size_type erase(const T & value) {
+        auto it = find(value);
+        if (it == end()) {
+            return 0;
+        }
+        elements.erase(it);
+        return 1;
+    }
+    iterator erase(iterator pos) {
+        return elements.erase(pos);
+    }
+    iterator erase(iterator first, iterator last) {
+        return elements.erase(first, last);
+    }
+    // Erases the elements for which pred is true, in one pass.
+    template<typename Pred>
+    size_type erase_if(Pred pred) {
+        const auto old_size = elements.size();
+        elements.erase(std::remove_if(elements.begin(), elements.end(), pred), elements.end());
+        return old_size - elements.size();
+    }
+
+    friend bool operator==(const SortedVectorSet & a, const SortedVectorSet & b) {
+        return a.elements == b.elements;
+    }
+    friend bool operator!=(const SortedVectorSet & a, const SortedVectorSet & b) {
+        return a.elements != b.elements;
+    }
+    friend bool operator<(const SortedVectorSet & a, const SortedVectorSet & b) {
+        return a.elements < b.elements;
+    }
+
+    private:
+    // Sorts the elements from `from` on, and merges them into the (sorted) ones before.
+    void sort_and_unique(typename std::vector<T>::iterator from) {
+        if (not std::is_sorted(from, elements.end())) {
+            std::sort(from, elements.end());
+        }
+        if (from != elements.begin() and from != elements.end() and not (*std::prev(from) < *from)) {
+            std::inplace_merge(elements.begin(), from, elements.end());
+            from = elements.begin();
+        }
+        elements.erase(std::unique(from == elements.begin() ? from : std::prev(from), elements.end()),
+                       elements.end());
+    }
+
+    std::vector<T> elements;
+};
+
+template<typename T>
+inline void swap(SortedVectorSet<T> & a, SortedVectorSet<T> & b) {
+    a.swap(b);
+}
+
+// Found by argument-dependent lookup, as std::erase_if is for std::set.
+template<typename T, typename Pred>
+inline typename SortedVectorSet<T>::size_type erase_if(SortedVectorSet<T> & s, Pred pred) {
+    return s.erase_if(pred);
+}
+
+// Found by argument-dependent lookup, as std::begin and std::end are for std::set.
+template<typename T>
+inline typename SortedVectorSet<T>::iterator begin(const SortedVectorSet<T> & s) {
+    return s.begin();
+}
+
+template<typename T>
+inline typename SortedVectorSet<T>::iterator end(const SortedVectorSet<T> & s) {
+    return s.end();
+}
+
+} // namespace otc
+#endif
@@ -0,0 +1,74 @@
+#ifndef OTC_STRING_ARENA_H
+#define OTC_STRING_ARENA_H
+// Append-only storage for many short, immutable strings.
+//
+// Strings are copied into large heap blocks and handed back as string_views.
+//  The views stay valid until the arena is destroyed (moving the arena does
+//  not move the blocks), so they can be used as map keys and stored in
+//  node data without paying for a std::string header and heap allocation
+//  per string.
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace otc {
+
+class StringArena {
+    public:
+    explicit StringArena(std::size_t block_size = 1 << 16)
+        :block_size(block_size) {
+    }
+    StringArena(StringArena &&) = default;
+    StringArena & operator=(StringArena &&) = default;
+    StringArena(const StringArena &) = delete;
+    StringArena & operator=(const StringArena &) = delete;
+
+    // Copies s into the arena. Empty strings are not stored.
+    std::string_view add(std::string_view s) {
+        if (s.empty()) {
+            return std::string_view();
+        }
+        char * dest = nullptr;
+        if (s.length() > block_size / 4) {
+            // Large strings get their own block, so that the current block is not abandoned.
+            dest = allocate_block(s.length());
+        } else {
+            if (s.length() > remaining) {
+                next = allocate_block(block_size);
+                remaining = block_size;
+            }
+            dest = next;
+            next += s.length();
+            remaining -= s.length();
+        }
+        std::memcpy(dest, s.data(), s.length());
+        num_bytes_stored += s.length();
+        return std::string_view(dest, s.length());
+    }
+    // Total length of the strings that have been added.
+    std::size_t bytes_stored() const {
+        return num_bytes_stored;
+    }
+    // Total size of the blocks that have been allocated.
+    std::size_t bytes_allocated() const {
+        return num_bytes_allocated;
+    }
+    private:
+    char * allocate_block(std::size_t n) {
+        blocks.push_back(std::unique_ptr<char[]>(new char[n]));
+        num_bytes_allocated += n;
+        return blocks.back().get();
+    }
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t block_size;
+    char * next = nullptr;
+    std::size_t remaining = 0;
+    std::size_t num_bytes_stored = 0;
+    std::size_t num_bytes_allocated = 0;
+};
+
+} // namespace otc
+#endif
@@ -8,6 +8,7 @@
 #include "otc/util.h"
 #include "otc/tree_iter.h"
 #include "otc/tree_data.h"
+#include "otc/leaf_bitset.h"
 #include <optional>
 
 namespace otc {
@@ -178,6 +179,26 @@ inline bool can_be_resolved_to_display_inc_exc_group(const T *nd, const OttIdSet
     return true;
 }
 
+// As above, for leaf sets restricted to one numbered set of leaves, in which the leaves
+//  of each child are an interval (see induced_leaf_spans). The excGroup is the rest of
+//  those leaves. Children that are not in `induced` have none of them.
+template<typename T>
+inline bool can_be_resolved_to_display_inc_exc_group(const T *nd,
+                                                     const LeafBitset & incGroup,
+                                                     const std::map<const T *, LeafSpan> & induced) {
+    for (auto c : iter_child_const(*nd)) {
+        auto it = induced.find(c);
+        if (it == induced.end()) {
+            continue;
+        }
+        const auto & span = it->second;
+        if (incGroup.any_in_range(span.first, span.last) && !incGroup.all_in_range(span.first, span.last)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // returns true if all of the children of nd which intersect with incGroup do NOT intersect w/ excGroup.
 // NOTE: `nd` is assumed to be a common anc of all IDs in incGroup!
 template<typename T>
@@ -43,7 +43,8 @@ TaxonomyDiffMaker::TaxonomyDiffMaker(const std::string& dir,
     const auto & rt_data = rich_tax_tree.get_data();
     std::vector<const RTRichTaxNode *> nd_vec;
     nd_vec.reserve(10);
-    for (auto& [name, node] : rt_data.name_to_node) {
+    for (auto name : sorted_names(rt_data.name_to_node)) {
+        const auto node = rt_data.name_to_node.at(name);
         nd_vec.clear();
         if (node == nullptr) {
             nd_vec = rt_data.homonym_to_nodes.at(name);
@@ -53,7 +54,7 @@ TaxonomyDiffMaker::TaxonomyDiffMaker(const std::string& dir,
         for (auto nd : nd_vec ) {
             const auto & nd_data = nd->get_data();
             for (auto syn_ptr : nd_data.junior_synonyms) {
-                synonym2node[syn_ptr->name].push_back(nd);
+                synonym2node[std::string(syn_ptr->name)].push_back(nd);
                 //std::cerr << "registered " << syn_ptr->name << " syn for "<< nd_data.get_nonuniqname() << '\n';
             }
         }
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <exception>
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 #include <unordered_map>
 #include <boost/program_options.hpp>
@@ -101,10 +102,8 @@ tax_flags flags_from_string(const char* start, const char* end) {
     bitset<32> flags;
     while (start < end) {
         assert(start <= end);
-        const char* sep = std::strchr(start, ',');
-        if (not sep) {
-            sep = end;
-        }
+        // bounded by end, because the field need not be followed by a '\0' (e.g. in a mapped file).
+        const char* sep = std::find(start, end, ',');
         int flag = flag_from_string(start, sep);
         flags |= (1 << flag);
         start = sep + 1;
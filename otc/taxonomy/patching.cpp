@@ -34,16 +34,36 @@ PatchableTaxonomy load_patchable_taxonomy(const boost::program_options::variable
     return {taxonomy_dir, cleaning_flags, keep_root};
 }
 
+PatchableTaxonomy load_patchable_taxonomy(const boost::program_options::variables_map& args,
+                                          SnapshotReader & snapshot) {
+    string taxonomy_dir = get_taxonomy_dir(args);
+    OttId keep_root = -1;
+    bitset<32> cleaning_flags = 0;
+    return {taxonomy_dir, cleaning_flags, keep_root, snapshot};
+}
+
 PatchableTaxonomy::PatchableTaxonomy(const std::string& dir,
                                      std::bitset<32> cf,
                                      OttId kr)
     :RichTaxonomy(dir, cf, kr) {
+    _index_synonyms();
+}
+
+PatchableTaxonomy::PatchableTaxonomy(const std::string& dir,
+                                     std::bitset<32> cf,
+                                     OttId kr,
+                                     SnapshotReader & snapshot)
+    :RichTaxonomy(dir, cf, kr, snapshot) {
+    _index_synonyms();
+}
+
+void PatchableTaxonomy::_index_synonyms() {
     const auto & rich_tax_tree = this->get_tax_tree();
     for (auto node : iter_post_const(rich_tax_tree)) {
         assert(node != nullptr);
         const auto & nd_data = node->get_data();
         for (auto syn_ptr : nd_data.junior_synonyms) {
-            synonym2node[syn_ptr->name].push_back(node);
+            synonym2node[std::string(syn_ptr->name)].push_back(node);
             //std::cerr << "registered " << syn_ptr->name << " syn for "<< nd_data.get_nonuniqname() << '\n';
         }
         //     if (name != node->get_data().get_nonuniqname()) {
@@ -75,8 +95,7 @@ bool_str_t PatchableTaxonomy::add_synonym(const std::string & name,
         rec_to_new_syn[tr].push_back(ls);
         return bool_str_t{false, ""};
     }
-    synonyms.emplace_back(name, target_nd, sourceinfo);
-    const TaxonomicJuniorSynonym * syn_ptr = &(*synonyms.rbegin());
+    const TaxonomicJuniorSynonym * syn_ptr = &_emplace_synonym(name, target_nd, sourceinfo);
     RTRichTaxNodeData & nd_data = const_cast<RTRichTaxNodeData &>(target_nd->get_data());
     nd_data.junior_synonyms.push_back(syn_ptr);
     add_name_to_node_maps(name, target_nd);
@@ -250,6 +269,16 @@ bool_str_t PatchableTaxonomy::edit_taxon(OttId oid,
         if (new_par != old_par) {
             old_par->remove_child(nd_ptr);
             new_par->add_child(nd_ptr);
+            // Only the moved subtree changes depth and needs new labels.
+            for (auto d : iter_pre_n(nd_ptr)) {
+                d->get_data().depth = d->get_parent()->get_data().depth + 1;
+            }
+            if (not assign_traversal_intervals(nd_ptr)) {
+                compute_traversal_intervals(tree);
+            }
+            if (auto f = get_fuzzy_matcher()) {
+                f->taxon_moved(nd_ptr, old_par);
+            }
         }
     } else if (old_par != nullptr) {
         parent_id = old_par->get_ott_id();
@@ -337,6 +366,9 @@ bool_str_t PatchableTaxonomy::add_new_taxon(OttId oid,
     // 6. Create the new tree node
     auto nnd = tree.create_child(par_ptr);
     reg_or_rereg_nd(nnd, tr, tree);
+    if (not assign_traversal_intervals(nnd)) {
+        compute_traversal_intervals(tree);
+    }
 
     // 7. Update the fuzzy match databases
     if (auto f = get_fuzzy_matcher())
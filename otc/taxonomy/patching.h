@@ -21,6 +21,11 @@ class PatchableTaxonomy: public RichTaxonomy {
     PatchableTaxonomy(const std::string& dir,
                       std::bitset<32> cf = std::bitset<32>(),
                       OttId kr = -1);
+    /// Load the taxonomy from a snapshot (see RichTaxonomy::write_snapshot)
+    PatchableTaxonomy(const std::string& dir,
+                      std::bitset<32> cf,
+                      OttId kr,
+                      SnapshotReader & snapshot);
     PatchableTaxonomy(PatchableTaxonomy &&) = default;
 
     void write(const std::string& newdirname) const;
@@ -76,10 +81,13 @@ class PatchableTaxonomy: public RichTaxonomy {
     void reg_or_rereg_nd(RTRichTaxNode * nnd,
                          const TaxonomyRecord & tr,
                          RichTaxTree & tree);
-    
+
+    void _index_synonyms();
 };
 
 PatchableTaxonomy load_patchable_taxonomy(const boost::program_options::variables_map& args);
+PatchableTaxonomy load_patchable_taxonomy(const boost::program_options::variables_map& args,
+                                          SnapshotReader & snapshot);
 
 
 } // namespace
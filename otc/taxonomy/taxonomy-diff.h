@@ -194,7 +194,7 @@ const RTRichTaxNode * find_specimen_based_root(const RTRichTaxNode *nd,
 }
 
 inline
-std::unordered_map<OttId, const RTRichTaxNode *> find_all_specimen_based_roots(const std::unordered_map<OttId, const RTRichTaxNode *> & id2nd,
+std::unordered_map<OttId, const RTRichTaxNode *> find_all_specimen_based_roots(const TaxonomyIndex<OttId, const RTRichTaxNode *> & id2nd,
                                       const OttIdSet & specimen_based_ids,
                                       OttIdSet & seen) {
     std::unordered_map<OttId, const RTRichTaxNode *> sp_root;
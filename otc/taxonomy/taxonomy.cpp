@@ -1,6 +1,6 @@
-// TODO: mmap via BOOST https://techoverflow.net/blog/2013/03/31/mmap-with-boost-iostreams-a-minimalist-example/
 // TODO: write out a reduced taxonomy
 
+#include <charconv>
 #include <iostream>
 #include <exception>
 #include <vector>
@@ -11,6 +11,7 @@
 #include <set>
 #include <bitset>
 #include <fstream>
+#include <numeric>
 #include <regex>
 #include <filesystem>
 #include <boost/algorithm/string/join.hpp>
@@ -21,7 +22,9 @@ namespace fs = std::filesystem;
 #include "otc/tree_operations.h"
 #include "otc/taxonomy/taxonomy.h"
 #include "otc/taxonomy/flags.h"
+#include "otc/taxonomy/tsv_chunks.h"
 #include "otc/config_file.h"
+#include "otc/snapshot.h"
 #include "otc/util.h"
 #include "otc/otc_base_includes.h"
 #include "otc/ctrie/context_ctrie_db.h"
@@ -189,7 +192,9 @@ const map<TaxonomicRank, string, std::less<>> rank_enum_to_name =
 
 const std::string empty_string;
 const set<string> indexed_source_prefixes = {"ncbi", "gbif", "worms", "if", "irmng"};
-std::set<std::string> rank_strings;
+
+const string ott_taxonomy_header = "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tsourceinfo\t|\tuniqname\t|\tflags\t|\t";
+const string ott_synonyms_header = "name\t|\tuid\t|\ttype\t|\tuniqname\t|\tsourceinfo\t|\t";
 
 bool TaxonomyRecord::is_extinct() const
 {
@@ -197,12 +202,13 @@ bool TaxonomyRecord::is_extinct() const
 }
 
 TaxonomyRecord::TaxonomyRecord(const string& line_)
-    :line(line_) {
+    :owned_line(std::make_unique<string>(line_)) {
+    line = *owned_line;
     // parse the line
     // also see boost::make_split_iterator
     const char* start[8];
     const char* end[8];
-    start[0] = line.c_str();
+    start[0] = owned_line->c_str();
     for(int i=0; i<7; i++) {
         end[i] = std::strstr(start[i],"\t|\t");
         start[i+1] = end[i] + 3;
@@ -218,17 +224,37 @@ TaxonomyRecord::TaxonomyRecord(const string& line_)
     if (not uniqname.size()) {
         uniqname = name;
     }
-    rank_strings.insert(string(rank));
+}
+
+void TaxonomyRecord::parse_ott_line(string_view mapped_line) {
+    line = mapped_line;
+    string_view fields[7];
+    split_tsv_fields(line, fields, 7);
+    unsigned long raw_id = 0;
+    std::from_chars(fields[0].data(), fields[0].data() + fields[0].length(), raw_id);
+    id = raw_id;
+    raw_id = 0;
+    std::from_chars(fields[1].data(), fields[1].data() + fields[1].length(), raw_id);
+    parent_id = raw_id;
+    name = fields[2];
+    rank = fields[3];
+    sourceinfo = fields[4];
+    uniqname = fields[5];
+    flags = flags_from_string(fields[6].data(), fields[6].data() + fields[6].length());
+    if (not uniqname.size()) {
+        uniqname = name;
+    }
 }
 
 // is_input_form will be true when the headers lack sourceinfo and uniqname
 TaxonomyRecord::TaxonomyRecord(const string& line_, bool /* is_input_form */)
-    :line(line_) {
+    :owned_line(std::make_unique<string>(line_)) {
+    line = *owned_line;
     // parse the line
     // also see boost::make_split_iterator
     const char* start[6];
     const char* end[6];
-    start[0] = line.c_str();
+    start[0] = owned_line->c_str();
     for(int i = 0; i < 5; i++) {
         end[i] = std::strstr(start[i],"\t|\t");
         start[i + 1] = end[i] + 3;
@@ -245,7 +271,6 @@ TaxonomyRecord::TaxonomyRecord(const string& line_, bool /* is_input_form */)
     if (not uniqname.size()) {
         uniqname = name;
     }
-    rank_strings.insert(string(rank));
 }
 
 optional<int> Taxonomy::maybe_index_from_id(OttId id) const
@@ -503,28 +528,43 @@ std::variant<OttId,reason_missing> Taxonomy::get_unforwarded_id_or_reason(OttId
 
 Taxonomy::Taxonomy(const string& dir,
                    bitset<32> cf,
-                   OttId kr)
+                   OttId kr,
+                   bool parallel_load)
     :BaseTaxonomy(dir, cf, kr) {
     string filename = path + "/taxonomy.tsv";
-    // 1. Open the file.
-    ifstream taxonomy_stream(filename);
-    if (not taxonomy_stream) {
-        throw OTCError() << "Could not open file '" << filename << "'.";
+    unsigned int count = 0;
+    bool parsed = false;
+    if (parallel_load) {
+        // OTT taxonomies are parsed in place in a memory map of the file.
+        auto mapping = std::make_shared<const MappedFile>(filename);
+        const string_view text(mapping->data(), mapping->size());
+        const auto header_end = text.find('\n');
+        if (text.substr(0, header_end) == ott_taxonomy_header) {
+            taxonomy_tsv_mapping = mapping;
+            count = read_ott_taxonomy_mapped(header_end == string_view::npos ? string_view() : text.substr(header_end + 1));
+            parsed = true;
+        }
     }
-    // 2. Read and check the first line
-    string line;
-    std::getline(taxonomy_stream,line);
-    unsigned int count;
-    if (line == "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tflags\t|\t") {
-        count = read_input_taxonomy_stream(taxonomy_stream);
-    } else if (line != "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tsourceinfo\t|\tuniqname\t|\tflags\t|\t") {
-        throw OTCError() << "First line of file '" << filename << "' is not a taxonomy header.";
-    } else {
-        count = read_ott_taxonomy_stream(taxonomy_stream);
+    if (not parsed) {
+        // 1. Open the file.
+        ifstream taxonomy_stream(filename);
+        if (not taxonomy_stream) {
+            throw OTCError() << "Could not open file '" << filename << "'.";
+        }
+        // 2. Read and check the first line
+        string line;
+        std::getline(taxonomy_stream,line);
+        if (line == "uid\t|\tparent_uid\t|\tname\t|\trank\t|\tflags\t|\t") {
+            count = read_input_taxonomy_stream(taxonomy_stream);
+        } else if (line != ott_taxonomy_header) {
+            throw OTCError() << "First line of file '" << filename << "' is not a taxonomy header.";
+        } else {
+            count = read_ott_taxonomy_stream(taxonomy_stream);
+        }
+        taxonomy_stream.close();
     }
     LOG(TRACE) << "records read = " << count;
     LOG(TRACE) << "records kept = " << size();
-    taxonomy_stream.close();
     /*
     if (read_deprecated) {
         read_deprecated_file(path + "/deprecated.tsv");
@@ -641,6 +681,77 @@ unsigned int Taxonomy::read_ott_taxonomy_stream(std::istream & taxonomy_stream)
     return count;
 }
 
+// Parses the lines (after the header) of an OTT taxonomy.tsv.
+//  The lines are parsed in parallel into records that point into body, and then
+//  a single sequential pass applies keep_root and the cleaning flags and resolves
+//  parent indices, just as read_ott_taxonomy_stream does.
+unsigned int Taxonomy::read_ott_taxonomy_mapped(string_view body) {
+    const auto chunks = split_at_line_boundaries(body, num_tsv_parse_threads());
+    vector<std::size_t> first_line(chunks.size() + 1, 0);
+    for_each_chunk_in_parallel(chunks, [&](std::size_t i, string_view chunk) {
+        first_line[i + 1] = count_lines(chunk);
+    });
+    std::partial_sum(first_line.begin(), first_line.end(), first_line.begin());
+    resize(first_line.back());
+    for_each_chunk_in_parallel(chunks, [&](std::size_t i, string_view chunk) {
+        auto rec_it = begin() + first_line[i];
+        for_each_line(chunk, [&](string_view line) {
+            (rec_it++)->parse_ott_line(line);
+        });
+    });
+    return keep_records_under_root();
+}
+
+// Compacts the parsed records in place, in the same way that the stream readers filter records.
+unsigned int Taxonomy::keep_records_under_root() {
+    const std::size_t num_read = size();
+    std::size_t i = 0;
+    if (keep_root != -1) {
+        while (i < num_read and (*this)[i].id != keep_root) {
+            ++i;
+        }
+        if (i == num_read) {
+            throw OTCError() << "Root id '" << keep_root << "' not found.";
+        }
+    } else if (num_read == 0) {
+        throw OTCError() << "No taxa found in '" << path << "/taxonomy.tsv'.";
+    }
+    index.reserve(num_read - i);
+    std::size_t num_kept = 0;
+    auto keep = [&](std::size_t j) -> TaxonomyRecord & {
+        if (j != num_kept) {
+            (*this)[num_kept] = std::move((*this)[j]);
+        }
+        auto & kept = (*this)[num_kept];
+        index[kept.id] = num_kept;
+        ++num_kept;
+        return kept;
+    };
+    if (((*this)[i].flags & cleaning_flags).any()) {
+        throw OTCError() << "Root taxon (ID = " << (*this)[i].id << ") removed according to cleaning flags!";
+    }
+    keep(i).depth = 1;
+    for (++i; i < num_read; ++i) {
+        const auto & tr = (*this)[i];
+        // Eliminate records that match the cleaning flags
+        if ((tr.flags & cleaning_flags).any()) {
+            continue;
+        }
+        // Eliminate records whose parents have been eliminated, or are not found.
+        auto loc = index.find(tr.parent_id);
+        if (loc == index.end()) {
+            continue;
+        }
+        const int parent_index = loc->second;
+        auto & kept = keep(i);
+        kept.parent_index = parent_index;
+        kept.depth = (*this)[parent_index].depth + 1;
+        (*this)[parent_index].out_degree++;
+    }
+    erase(begin() + num_kept, end());
+    return num_read;
+}
+
 std::variant<OttId,reason_missing> RichTaxonomy::get_unforwarded_id_or_reason(OttId id) const
 {
     const auto & td = tree->get_data();
@@ -657,11 +768,12 @@ std::variant<OttId,reason_missing> RichTaxonomy::get_unforwarded_id_or_reason(Ot
 RichTaxonomy::RichTaxonomy(const std::string& dir,
                            std::bitset<32> cf,
                            OttId kr,
-                           bool read_syn_type_as_src)
+                           bool read_syn_type_as_src,
+                           bool parallel_load)
     :BaseTaxonomy(dir, cf, kr),
     read_synonym_type_as_src(read_syn_type_as_src) {
     { //braced to reduce scope of light_taxonomy to reduced memory
-        Taxonomy light_taxonomy(dir, cf, kr); 
+        Taxonomy light_taxonomy(dir, cf, kr, parallel_load); 
         auto nodeNamer = [](const auto&){return string();};
         cerr << "light_taxonomy.get_tree<RichTaxTree>(nodeNamer)..." << std::endl;
         tree = light_taxonomy.get_tree<RichTaxTree>(nodeNamer, !read_syn_type_as_src);
@@ -678,22 +790,15 @@ RichTaxonomy::RichTaxonomy(const std::string& dir,
             const auto & tr = *tr_it;
             auto ott_id = tr.id;
             if (tree_data.id_to_node.count(ott_id) == 0) {
-                filtered_records.push_back(TaxonomyRecord(tr.line));
+                _add_filtered_record(tr.line);
             }
         }
-        for (auto tr_it = filtered_records.begin(); tr_it != filtered_records.end(); ++tr_it) {
-            const auto & tr = *tr_it;
-            register_taxon_in_maps(tree_data.name_to_record,
-                                   tree_data.homonym_to_record,
-                                   tr.name,
-                                   tr.uniqname,
-                                   &tr);
-            tree_data.id_to_record[tr.id] = &tr;
-        }
+        _register_filtered_records();
     }
     compute_depth(*tree);
+    compute_traversal_intervals(*tree);
     _fill_ids_to_suppress_set();
-    this->read_synonyms();
+    this->read_synonyms(parallel_load);
     const auto & td = tree->get_data();
     // LOG(INFO) << "# of taxa stored in taxonomy, but filtered from taxonomy tree = " << filtered_records.size();
     // LOG(INFO) << "last # in ncbi_id_map = " << (td.ncbi_id_map.empty() ? 0 : max_numeric_key(td.ncbi_id_map));
@@ -704,6 +809,36 @@ RichTaxonomy::RichTaxonomy(const std::string& dir,
 }
 
 
+// Copies the line into filtered_record_lines, and parses it in place.
+void RichTaxonomy::_add_filtered_record(string_view line) {
+    filtered_records.emplace_back();
+    filtered_records.back().parse_ott_line(filtered_record_lines.add(line));
+}
+
+// Copies the strings into the pools of the tree, so that the synonym can hold views of them.
+TaxonomicJuniorSynonym & RichTaxonomy::_emplace_synonym(string_view name,
+                                                        const RTRichTaxNode * primary,
+                                                        string_view sourceinfo) {
+    auto & tree_data = tree->get_data();
+    synonyms.emplace_back(tree_data.name_pool.add(name),
+                          primary,
+                          tree_data.source_info_pool.add(sourceinfo));
+    return synonyms.back();
+}
+
+void RichTaxonomy::_register_filtered_records() {
+    auto & tree_data = tree->get_data();
+    for (auto tr_it = filtered_records.begin(); tr_it != filtered_records.end(); ++tr_it) {
+        const auto & tr = *tr_it;
+        register_taxon_in_maps(tree_data.name_to_record,
+                               tree_data.homonym_to_record,
+                               tr.name,
+                               tr.uniqname,
+                               &tr);
+        tree_data.id_to_record[tr.id] = &tr;
+    }
+}
+
 void Taxonomy::read_forwards_file(string filepath)
 {
     // 1. Read forwards file and create id -> forwarded_id map
@@ -802,7 +937,7 @@ OttId root_ott_id_from_file(const string& filename) {
     }
 }
 
-Taxonomy load_taxonomy(const variables_map& args) {
+Taxonomy load_taxonomy(const variables_map& args, bool parallel_load) {
     string taxonomy_dir = get_taxonomy_dir(args);
     OttId keep_root = -1;
     if (args.count("root")) {
@@ -819,10 +954,10 @@ Taxonomy load_taxonomy(const variables_map& args) {
     if (args.count("clean")) {
         cleaning_flags = flags_from_string(args["clean"].as<string>());
     }
-    return {taxonomy_dir, cleaning_flags, keep_root};
+    return {taxonomy_dir, cleaning_flags, keep_root, parallel_load};
 }
 
-RichTaxonomy load_rich_taxonomy(const variables_map& args) {
+RichTaxonomy load_rich_taxonomy(const variables_map& args, bool parallel_load) {
     string taxonomy_dir = get_taxonomy_dir(args);
     OttId keep_root = -1;
     if (args.count("root")) {
@@ -837,7 +972,7 @@ RichTaxonomy load_rich_taxonomy(const variables_map& args) {
     if (args.count("clean")) {
         cleaning_flags = flags_from_string(args["clean"].as<string>());
     }
-    return {taxonomy_dir, cleaning_flags, keep_root};
+    return {taxonomy_dir, cleaning_flags, keep_root, false, parallel_load};
 }
 
 bool RTRichTaxNodeData::is_extinct() const {
@@ -845,8 +980,17 @@ bool RTRichTaxNodeData::is_extinct() const {
 }
 
 
-void RichTaxonomy::read_synonyms() {
+void RichTaxonomy::read_synonyms(bool parallel_load) {
     string filename = path + "/synonyms.tsv";
+    if (parallel_load) {
+        MappedFile mapping(filename);
+        const string_view text(mapping.data(), mapping.size());
+        const auto header_end = text.find('\n');
+        if (text.substr(0, header_end) == ott_synonyms_header) {
+            read_ott_synonyms_mapped(header_end == string_view::npos ? string_view() : text.substr(header_end + 1));
+            return;
+        }
+    }
     ifstream synonyms_file(filename);
         if (not synonyms_file) {
         throw OTCError() << "Could not open file '" << filename << "'.";
@@ -856,7 +1000,7 @@ void RichTaxonomy::read_synonyms() {
     std::getline(synonyms_file, line);
     if (line == "uid\t|\tname\t|\ttype\t|\t") {
         read_input_synonyms_stream(synonyms_file);
-    } else  if (line != "name\t|\tuid\t|\ttype\t|\tuniqname\t|\tsourceinfo\t|\t") {
+    } else  if (line != ott_synonyms_header) {
         throw OTCError() << "First line of file '" << filename << "' is not a synonym header.";
     } else {
         read_ott_synonyms_stream(synonyms_file);
@@ -894,8 +1038,7 @@ void RichTaxonomy::read_input_synonyms_stream(std::istream & synonyms_file) {
             sourceinfo = string(start[2], end[2] - start[2]);
         }
         
-        this->synonyms.emplace_back(name, primary, sourceinfo);
-        TaxonomicJuniorSynonym & tjs = *(this->synonyms.rbegin());
+        TaxonomicJuniorSynonym & tjs = _emplace_synonym(name, primary, sourceinfo);
         
         auto vs = comma_separated_as_vec(sourceinfo);
         if (!read_synonym_type_as_src) {
@@ -907,7 +1050,6 @@ void RichTaxonomy::read_input_synonyms_stream(std::istream & synonyms_file) {
 }
 
 void RichTaxonomy::read_ott_synonyms_stream(std::istream & synonyms_file) {
-    RTRichTaxTreeData & tree_data = this->tree->get_data();
     string line;
     int num_syn_skipped = 0;
     while(std::getline(synonyms_file, line)) {
@@ -920,36 +1062,77 @@ void RichTaxonomy::read_ott_synonyms_stream(std::istream & synonyms_file) {
         }
         end[4] = start[0] + line.length() - 3 ; // -3 for the \t|\t
         char *temp;
-        string name = string(start[0], end[0] - start[0]);
+        string_view name = string_view(start[0], end[0] - start[0]);
         unsigned long raw_id = std::strtoul(start[1], &temp, 10);
         OttId ott_id = check_ott_id_size(raw_id);
-        const RTRichTaxNode * primary = nullptr;
-        try {
-            primary = tree_data.id_to_node.at(ott_id);
-        } catch (std::out_of_range &) {
-            if (!Taxonomy::tolerate_synonyms_to_unknown_id) {
-                throw;
-            }
-        }
-        if (primary == nullptr) {
+        if (not add_ott_synonym(name, ott_id, string_view(start[4], end[4] - start[4]))) {
             num_syn_skipped++;
-            continue;
         }
-        string sourceinfo = string(start[4], end[4] - start[4]);
-        
-        this->synonyms.emplace_back(name, primary, sourceinfo);
-        TaxonomicJuniorSynonym & tjs = *(this->synonyms.rbegin());
-        
-        auto vs = comma_separated_as_vec(sourceinfo);
-        process_source_info_vec(vs, tree_data, tjs, primary);
-        RTRichTaxNode * mp = const_cast<RTRichTaxNode *>(primary);
-        mp->get_data().junior_synonyms.push_back(&tjs);
     }
     if (num_syn_skipped > 0) {
         LOG(INFO) << num_syn_skipped << " synonyms skipped because they mapped to unknown IDs.\n";
     }
 }
 
+// Fields of a line of an OTT synonyms.tsv, pointing into the mapped file.
+struct OttSynonymFields {
+    string_view name;
+    OttId ott_id = 0;
+    string_view sourceinfo;
+};
+
+// Splits the lines of synonyms.tsv in parallel, then adds the synonyms in file order.
+void RichTaxonomy::read_ott_synonyms_mapped(string_view body) {
+    const auto chunks = split_at_line_boundaries(body, num_tsv_parse_threads());
+    vector<vector<OttSynonymFields> > parsed(chunks.size());
+    for_each_chunk_in_parallel(chunks, [&](std::size_t i, string_view chunk) {
+        auto & out = parsed[i];
+        out.reserve(count_lines(chunk));
+        for_each_line(chunk, [&](string_view line) {
+            string_view fields[5];
+            split_tsv_fields(line, fields, 5);
+            unsigned long raw_id = 0;
+            std::from_chars(fields[1].data(), fields[1].data() + fields[1].length(), raw_id);
+            out.push_back(OttSynonymFields{fields[0], check_ott_id_size(raw_id), fields[4]});
+        });
+    });
+    int num_syn_skipped = 0;
+    for (const auto & chunk_synonyms : parsed) {
+        for (const auto & syn : chunk_synonyms) {
+            if (not add_ott_synonym(syn.name, syn.ott_id, syn.sourceinfo)) {
+                num_syn_skipped++;
+            }
+        }
+    }
+    if (num_syn_skipped > 0) {
+        LOG(INFO) << num_syn_skipped << " synonyms skipped because they mapped to unknown IDs.\n";
+    }
+}
+
+// Returns false if the synonym was skipped because ott_id is not in the tree
+//  (and Taxonomy::tolerate_synonyms_to_unknown_id is set).
+bool RichTaxonomy::add_ott_synonym(string_view name, OttId ott_id, string_view sourceinfo) {
+    RTRichTaxTreeData & tree_data = this->tree->get_data();
+    const RTRichTaxNode * primary = nullptr;
+    try {
+        primary = tree_data.id_to_node.at(ott_id);
+    } catch (std::out_of_range &) {
+        if (!Taxonomy::tolerate_synonyms_to_unknown_id) {
+            throw;
+        }
+    }
+    if (primary == nullptr) {
+        return false;
+    }
+    TaxonomicJuniorSynonym & tjs = _emplace_synonym(name, primary, sourceinfo);
+    
+    auto vs = comma_separated_as_vec(tjs.source_string);
+    process_source_info_vec(vs, tree_data, tjs, primary);
+    RTRichTaxNode * mp = const_cast<RTRichTaxNode *>(primary);
+    mp->get_data().junior_synonyms.push_back(&tjs);
+    return true;
+}
+
 void RichTaxonomy::_fill_ids_to_suppress_set() {
     for (const auto nd : iter_node_const(*tree)) {
         if (node_is_suppressed_from_tnrs(nd)) {
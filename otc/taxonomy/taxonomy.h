@@ -1,8 +1,8 @@
 #ifndef OTC_TAXONOMY_TAXONOMY_H
 #define OTC_TAXONOMY_TAXONOMY_H
-// TODO: mmap via BOOST https://techoverflow.net/blog/2013/03/31/mmap-with-boost-iostreams-a-minimalist-example/
 // TODO: write out a reduced taxonomy
 
+#include <algorithm>
 #include <iostream>
 #include <exception>
 #include <vector>
@@ -17,18 +17,19 @@
 #include <boost/spirit/include/qi_symbols.hpp>
 #include <string_view>
 #include <bitset>
+#include <memory>
 #include <variant>
 #include "otc/taxonomy/flags.h"
 
 #include "otc/error.h"
+#include "otc/robin_hood.h"
+#include "otc/string_arena.h"
 #include "otc/tree.h"
 #include "otc/tree_operations.h"
 #include "otc/taxonomy/flags.h"
 
 #include "json.hpp"
 
-// 1. Write a parser to read the lines faster
-// 2. Avoid memory allocation -- by mmapping the taxonomy file?
 // 3. Convert the flags into a bitmask
 // 4. Should the Rank be a converted to an integer?
 // 5. Can we assign OTT IDs to internal nodes of a tree while accounting for Incertae Sedis taxa?
@@ -128,7 +129,7 @@ inline TaxonomicRank string_to_rank(const std::string_view& s, bool must_match_i
 }
 
 
-inline std::vector<std::string> comma_separated_as_vec(const std::string & sourceinfo) {
+inline std::vector<std::string> comma_separated_as_vec(std::string_view sourceinfo) {
     std::vector<std::string> mt;
     if (sourceinfo.empty()) {
         return mt;
@@ -147,8 +148,12 @@ inline nlohmann::json sources_vec_as_json(const std::vector<std::string> & vs) {
     return j;
 }
 
+class MappedFile;
+
 struct TaxonomyRecord {
-    std::string line;
+    // The .tsv line. Points into owned_line, or into the mapped taxonomy.tsv of the Taxonomy
+    //  that holds the record.
+    std::string_view line;
     OttId id = 0;
     OttId parent_id = 0;
     int parent_index = 0;
@@ -163,13 +168,19 @@ struct TaxonomyRecord {
     TaxonomyRecord& operator=(const TaxonomyRecord& tr) = delete;
     TaxonomyRecord(TaxonomyRecord&& tr) = default;
     TaxonomyRecord(TaxonomyRecord& tr) = delete;
+    TaxonomyRecord() = default;
     bool is_extinct() const;
+    // These copy the line.
     explicit TaxonomyRecord(const std::string& line);
     explicit TaxonomyRecord(const std::string& line, bool is_short);
+    // Parses a line of an OTT taxonomy.tsv without copying it: mapped_line must outlive the record.
+    void parse_ott_line(std::string_view mapped_line);
     std::vector<std::string> sourceinfoAsVec() const {
-        std::string si = std::string(sourceinfo);
-        return comma_separated_as_vec(si);
+        return comma_separated_as_vec(sourceinfo);
     }
+    private:
+    // heap allocated so that the string_views stay valid when the record is moved.
+    std::unique_ptr<std::string> owned_line;
 };
 
 // returns a vector [0, 1, 2, ... sz-1]
@@ -216,6 +227,8 @@ class Taxonomy: public std::vector<TaxonomyRecord>, public BaseTaxonomy {
 
     std::optional<int> maybe_index_from_id(OttId) const;
     int index_from_id(OttId) const;
+    // taxonomy.tsv, if the records were parsed in place by the parallel loader.
+    std::shared_ptr<const MappedFile> taxonomy_tsv_mapping;
 
 public:
     static bool tolerate_synonyms_to_unknown_id;
@@ -257,11 +270,15 @@ public:
     void copy_relevant_synonyms(std::istream & inp, std::ostream & outp);
 
     /// Load the taxonomy from directory dir, and apply cleaning flags cf, and keep subtree below kr
-    Taxonomy(const std::string& dir, std::bitset<32> cf=std::bitset<32>(), OttId keep_root=-1);
+    //    If parallel_load is false, taxonomy.tsv is read with the sequential std::getline reader
+    //    (only useful for benchmarking the parallel loader).
+    Taxonomy(const std::string& dir, std::bitset<32> cf=std::bitset<32>(), OttId keep_root=-1, bool parallel_load=true);
 
     private:
     unsigned int read_input_taxonomy_stream(std::istream & taxonomy_stream);
     unsigned int read_ott_taxonomy_stream(std::istream & taxonomy_stream);
+    unsigned int read_ott_taxonomy_mapped(std::string_view body);
+    unsigned int keep_records_under_root();
     friend class RichTaxonomy;
 };
 
@@ -274,9 +291,13 @@ class RTRichTaxNodeData {
     std::vector<const TaxonomicJuniorSynonym *> junior_synonyms;
     TaxonomicRank rank = TaxonomicRank::RANK_NO_RANK;
     std::bitset<32> flags;
-    std::string source_info;
+    // source_info and possibly_nonunique_name point into the string pools of the tree.
+    std::string_view source_info;
     std::string_view possibly_nonunique_name;
     uint32_t depth;
+    // preorder interval, see compute_traversal_intervals
+    uint32_t trav_enter = 0;
+    uint32_t trav_exit = 0;
     std::string_view get_nonuniqname() const {
         return possibly_nonunique_name;
     }
@@ -290,7 +311,7 @@ class RTRichTaxNodeData {
         return comma_separated_as_vec(source_info);
     }
     std::string get_sources_as_fmt_str() const {
-        return source_info;
+        return std::string(source_info);
     }
     nlohmann::json get_sources_json() const {
         auto vs = this->sourceinfoAsVec();
@@ -301,19 +322,21 @@ class RTRichTaxNodeData {
 
 typedef RootedTreeNode<RTRichTaxNodeData> RTRichTaxNode;
 
+// name and source_string are not owned: they point into the string pools of the
+//    taxonomy tree (see RichTaxonomy::_emplace_synonym).
 class TaxonomicJuniorSynonym {
     public:
-    TaxonomicJuniorSynonym(const std::string & namestring,
+    TaxonomicJuniorSynonym(std::string_view namestring,
                            const RTRichTaxNode *senior_synonym,
-                           const std::string & sources)
+                           std::string_view sources)
         :name(namestring),
         source_string(sources),
         primary(senior_synonym) {
     }
-    const std::string name;
-    const std::string source_string;
+    const std::string_view name;
+    const std::string_view source_string;
     const RTRichTaxNode * primary;
-    const std::string & get_name() const {
+    std::string_view get_name() const {
         return name;
     }
     // deleting copy ctor because we are using string_views, so it is important
@@ -323,49 +346,94 @@ class TaxonomicJuniorSynonym {
 
 constexpr const char* sup_flag_comma = "not_otu,environmental,environmental_inherited,viral,hidden,hidden_inherited,was_container";
 
+// The name and id indexes of the taxonomy are open-addressing hash maps, which store
+//    their entries inline rather than allocating a node per entry. Unlike std::map,
+//    iteration order is arbitrary and inserting invalidates references to entries.
+template<typename K, typename V>
+using TaxonomyIndex = robin_hood::unordered_map<K, V>;
+
+// The names in a name index in lexicographic order, for callers whose output should
+//    not depend on the iteration order of the index.
+template<typename V>
+std::vector<std::string_view> sorted_names(const TaxonomyIndex<std::string_view, V> & index) {
+    std::vector<std::string_view> names;
+    names.reserve(index.size());
+    for (const auto & el : index) {
+        names.push_back(el.first);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
 #define MAP_FOREIGN_TO_POINTER
 class RTRichTaxTreeData {
     public:
 #if defined(MAP_FOREIGN_TO_POINTER)
-    std::unordered_map<OttId, const RTRichTaxNode *> ncbi_id_map;
-    std::unordered_map<OttId, const RTRichTaxNode *> gbif_id_map;
-    std::unordered_map<OttId, const RTRichTaxNode *> worms_id_map;
-    std::unordered_map<OttId, const RTRichTaxNode *> if_id_map;
-    std::unordered_map<OttId, const RTRichTaxNode *> irmng_id_map;
+    TaxonomyIndex<OttId, const RTRichTaxNode *> ncbi_id_map;
+    TaxonomyIndex<OttId, const RTRichTaxNode *> gbif_id_map;
+    TaxonomyIndex<OttId, const RTRichTaxNode *> worms_id_map;
+    TaxonomyIndex<OttId, const RTRichTaxNode *> if_id_map;
+    TaxonomyIndex<OttId, const RTRichTaxNode *> irmng_id_map;
 #else
-    std::unordered_map<OttId, OttId> ncbi_id_map;
-    std::unordered_map<OttId, OttId> gbif_id_map;
-    std::unordered_map<OttId, OttId> worms_id_map;
-    std::unordered_map<OttId, OttId> if_id_map;
-    std::unordered_map<OttId, OttId> irmng_id_map;
+    TaxonomyIndex<OttId, OttId> ncbi_id_map;
+    TaxonomyIndex<OttId, OttId> gbif_id_map;
+    TaxonomyIndex<OttId, OttId> worms_id_map;
+    TaxonomyIndex<OttId, OttId> if_id_map;
+    TaxonomyIndex<OttId, OttId> irmng_id_map;
 #endif
     std::unordered_map<std::bitset<32>, nlohmann::json> flags2json;
-    std::map<std::string_view, const RTRichTaxNode *> name_to_node; // null if homonym, then check homonym2node
-    std::map<std::string_view, const TaxonomyRecord *> name_to_record; // for filtered
-    std::unordered_map<OttId, const RTRichTaxNode *> id_to_node;
-    std::unordered_map<OttId, const TaxonomyRecord *> id_to_record;
-    std::map<std::string_view, std::vector<const RTRichTaxNode *> > homonym_to_nodes;
-    std::map<std::string_view, std::vector<const TaxonomyRecord *> > homonym_to_record;
-    std::map<std::string, OttIdSet> non_unique_taxon_names;
+    TaxonomyIndex<std::string_view, const RTRichTaxNode *> name_to_node; // null if homonym, then check homonym2node
+    TaxonomyIndex<std::string_view, const TaxonomyRecord *> name_to_record; // for filtered
+    TaxonomyIndex<OttId, const RTRichTaxNode *> id_to_node;
+    TaxonomyIndex<OttId, const TaxonomyRecord *> id_to_record;
+    TaxonomyIndex<std::string_view, std::vector<const RTRichTaxNode *> > homonym_to_nodes;
+    TaxonomyIndex<std::string_view, std::vector<const TaxonomyRecord *> > homonym_to_record;
+    std::map<std::string_view, OttIdSet> non_unique_taxon_names;
+    // Backing store for the non-unique names of taxa and synonym names.
+    StringArena name_pool;
+    // Backing store for the sourceinfo strings of taxa and synonyms.
+    StringArena source_info_pool;
 
     std::bitset<32> suppress_flags = flags_from_string(sup_flag_comma);
 };
 
 typedef RootedTree<RTRichTaxNodeData, RTRichTaxTreeData> RichTaxTree;
 
+template<>
+struct uses_node_arena<RTRichTaxNodeData, RTRichTaxTreeData> : std::true_type {
+};
+
 class ContextAwareCTrieBasedDB; // for fuzzy matching
+class SnapshotReader;
+class SnapshotWriter;
+
+// Bump whenever the layout of the taxonomy snapshot sections changes, or the
+//  name-matching tries stored in them would be built differently.
+constexpr std::uint32_t TAXONOMY_SNAPSHOT_FORMAT_VERSION = 3;
+
 class RichTaxonomy: public BaseTaxonomy {
     public:
     const RichTaxTree & get_tax_tree() const {
         return *tree;
     }
     /// Load the taxonomy from directory dir, and apply cleaning flags cf, and keep subtree below kr
+    //    parallel_load is passed on to Taxonomy, and also applies to synonyms.tsv.
     RichTaxonomy(const std::string& dir,
                  std::bitset<32> cf = std::bitset<32>(),
                  OttId kr = -1,
-                 bool read_syn_type_as_src = false);
+                 bool read_syn_type_as_src = false,
+                 bool parallel_load = true);
+    /// Load the taxonomy in directory dir from a snapshot written by write_snapshot.
+    //    The caller should check taxonomy_snapshot_stale_reason first.
+    RichTaxonomy(const std::string& dir,
+                 std::bitset<32> cf,
+                 OttId kr,
+                 SnapshotReader & snapshot);
     RichTaxonomy(RichTaxonomy &&) = default;
 
+    /// Write the tree, synonyms and forwards of the taxonomy as snapshot sections.
+    void write_snapshot(SnapshotWriter & snapshot) const;
+
     std::variant<OttId,reason_missing> get_unforwarded_id_or_reason(OttId id) const;
 
     const RTRichTaxNode * included_taxon_from_id(OttId ott_id) const {
@@ -421,10 +489,17 @@ class RichTaxonomy: public BaseTaxonomy {
     RichTaxTree & get_mutable_tax_tree() const {
         return *tree;
     }
-    void read_synonyms();
+    void read_synonyms(bool parallel_load);
     void _fill_ids_to_suppress_set();
+    void _register_filtered_records();
+    void _add_filtered_record(std::string_view line);
+    TaxonomicJuniorSynonym & _emplace_synonym(std::string_view name,
+                                              const RTRichTaxNode * primary,
+                                              std::string_view sourceinfo);
     
     bool read_synonym_type_as_src; // only relevant for source taxonomies with syntype info
+    // The records point into filtered_record_lines rather than owning a copy of their line.
+    StringArena filtered_record_lines;
     std::vector<TaxonomyRecord> filtered_records;
     std::unique_ptr<RichTaxTree> tree;
     std::list<TaxonomicJuniorSynonym> synonyms;
@@ -440,6 +515,8 @@ class RichTaxonomy: public BaseTaxonomy {
     private:
     void read_input_synonyms_stream(std::istream & synonyms_file);
     void read_ott_synonyms_stream(std::istream & synonyms_file);
+    void read_ott_synonyms_mapped(std::string_view body);
+    bool add_ott_synonym(std::string_view name, OttId ott_id, std::string_view sourceinfo);
 };
 
 
@@ -468,16 +545,13 @@ inline void populate_node_from_taxonomy_record(Node_t & nd,
 }
 
 template<typename T>
-inline void register_taxon_in_maps(std::map<std::string_view, const T *> & n2n,
-                            std::map<std::string_view, std::vector<const T *> > & homonym_map,
+inline void register_taxon_in_maps(TaxonomyIndex<std::string_view, const T *> & n2n,
+                            TaxonomyIndex<std::string_view, std::vector<const T *> > & homonym_map,
                             std::string_view possibly_nonunique_name,
                             std::string_view uname,
                             const T * ti) {
-    auto nit = n2n.lower_bound(possibly_nonunique_name);
-    typedef std::pair<std::string_view, const T *> name_map_pair;
-    if (nit == n2n.end() or nit->first != possibly_nonunique_name) {
-        nit = n2n.insert(nit, name_map_pair(possibly_nonunique_name, ti));
-    } else {
+    auto [nit, inserted] = n2n.emplace(possibly_nonunique_name, ti);
+    if (not inserted) {
         if (nit->second != nullptr) {
             homonym_map[possibly_nonunique_name].push_back(nit->second);
             nit->second = nullptr;
@@ -485,7 +559,7 @@ inline void register_taxon_in_maps(std::map<std::string_view, const T *> & n2n,
        homonym_map[possibly_nonunique_name].push_back(ti);
     }
     if (uname != possibly_nonunique_name) {
-        auto r2 = n2n.insert(name_map_pair(uname, ti));
+        auto r2 = n2n.emplace(uname, ti);
         assert(r2.second); // should be uniq.
     }
 }
@@ -567,46 +641,58 @@ inline void add_f_to_json_if_needed(T & flags2json,
     }
 }
 
-template <>
-inline void populate_node_from_taxonomy_record(RTRichTaxNode & nd,
-                                               const TaxonomyRecord & tr,
-                                               std::function<std::string(const TaxonomyRecord&)> ,
-                                               RichTaxTree & tree,
-                                               bool process_source_maps) {
+// Sets the name, id, rank and flags of a taxonomy tree node, and registers it in
+//    the name and id maps of the tree. Shared by the .tsv and snapshot loaders.
+inline void populate_rich_taxon_node(RTRichTaxNode & nd,
+                                     RichTaxTree & tree,
+                                     OttId id,
+                                     std::string_view name,
+                                     std::string_view uniqname,
+                                     TaxonomicRank rank,
+                                     const std::bitset<32> & flags) {
     using std::string;
-    using std::vector;
     using std::string_view;
     RTRichTaxNode * this_node = &nd;
-    nd.set_ott_id(tr.id);
     auto & data = nd.get_data();
     auto & tree_data = tree.get_data();
-    nd.set_ott_id(tr.id);
-    tree_data.id_to_node[tr.id] = this_node;
-    this_node->set_name(string(tr.uniqname));
+    nd.set_ott_id(id);
+    tree_data.id_to_node[id] = this_node;
+    this_node->set_name(string(uniqname));
     const string & uname = this_node->get_name();
-    if (tr.uniqname != tr.name) {
-        string sn = string(tr.name);
-        tree_data.non_unique_taxon_names[sn].insert(tr.id);
-        auto nit = tree_data.non_unique_taxon_names.find(sn);
-        assert(nit != tree_data.non_unique_taxon_names.end());
-        data.possibly_nonunique_name = string_view(nit->first);
+    if (uniqname != name) {
+        auto & nutn = tree_data.non_unique_taxon_names;
+        auto nit = nutn.lower_bound(name);
+        if (nit == nutn.end() or nit->first != name) {
+            nit = nutn.emplace_hint(nit, tree_data.name_pool.add(name), OttIdSet());
+        }
+        nit->second.insert(id);
+        data.possibly_nonunique_name = nit->first;
     } else {
         data.possibly_nonunique_name = string_view(nd.get_name());
     }
-    data.flags = tr.flags;
-    data.rank = string_to_rank(tr.rank);
+    data.flags = flags;
+    data.rank = rank;
     register_taxon_in_maps(tree_data.name_to_node,
                            tree_data.homonym_to_nodes,
                            data.possibly_nonunique_name,
                            uname,
                            this_node);
-    auto flags = data.get_flags();
     //cout << "flags = " << flags << " name = " << this_node->get_name() << '\n';
-    add_f_to_json_if_needed(tree_data.flags2json, flags);
+    add_f_to_json_if_needed(tree_data.flags2json, data.flags);
+}
+
+template <>
+inline void populate_node_from_taxonomy_record(RTRichTaxNode & nd,
+                                               const TaxonomyRecord & tr,
+                                               std::function<std::string(const TaxonomyRecord&)> ,
+                                               RichTaxTree & tree,
+                                               bool process_source_maps) {
+    populate_rich_taxon_node(nd, tree, tr.id, tr.name, tr.uniqname, string_to_rank(tr.rank), tr.flags);
     if (process_source_maps) {
+        auto & data = nd.get_data();
         auto vs = tr.sourceinfoAsVec();
-        data.source_info = string(tr.sourceinfo);
-        process_source_info_vec(vs, tree_data, data, this_node);
+        data.source_info = tree.get_data().source_info_pool.add(tr.sourceinfo);
+        process_source_info_vec(vs, tree.get_data(), data, &nd);
     }
 }
 
@@ -640,8 +726,18 @@ char format_needs_taxonomy(const std::string& format);
 
 OttId root_ott_id_from_file(const std::string& filename);
 std::string get_taxonomy_dir(const boost::program_options::variables_map& args);
-Taxonomy load_taxonomy(const boost::program_options::variables_map& args);
-RichTaxonomy load_rich_taxonomy(const boost::program_options::variables_map& args);
+Taxonomy load_taxonomy(const boost::program_options::variables_map& args, bool parallel_load = true);
+RichTaxonomy load_rich_taxonomy(const boost::program_options::variables_map& args, bool parallel_load = true);
+
+// Returns an empty string if the snapshot was written from the current contents of
+//    the taxonomy in dir with the same cleaning flags and root, or else the reason
+//    that the .tsv files must be read instead.
+std::string taxonomy_snapshot_stale_reason(SnapshotReader & snapshot,
+                                           const std::string& dir,
+                                           std::bitset<32> cf = std::bitset<32>(),
+                                           OttId kr = -1);
+// The order in which taxonomy snapshots store nodes (preorder).
+std::vector<const RTRichTaxNode *> taxonomy_nodes_in_snapshot_order(const RichTaxTree & tree);
 
 
 const RTRichTaxNode* taxonomy_mrca(const std::vector<const RTRichTaxNode*>& nodes);
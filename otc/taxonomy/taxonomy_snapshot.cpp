@@ -0,0 +1,267 @@
+// Reading and writing of taxonomy snapshots. See otc/snapshot.h for the file layout.
+//  The sections written by RichTaxonomy::write_snapshot are, in order:
+//      stamp, version string, string pool, taxa (preorder), 5 foreign id maps,
+//      synonyms, forwards, filtered record lines.
+#include <unordered_map>
+#include <climits>
+
+#include "otc/taxonomy/taxonomy.h"
+#include "otc/snapshot.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+using std::bitset;
+using std::unordered_map;
+
+namespace otc {
+
+struct TaxonomySnapshotStamp {
+    FileStamp taxonomy_tsv;
+    FileStamp synonyms_tsv;
+    FileStamp forwards_tsv;
+    FileStamp version_txt;
+    std::int64_t keep_root = -1;
+    std::uint32_t cleaning_flags = 0;
+    std::uint32_t read_synonym_type_as_src = 0;
+};
+
+constexpr std::uint32_t NO_SNAPSHOT_PARENT = UINT32_MAX;
+
+// Ids are stored as int64_t, and the records are laid out without padding bytes
+//    (SnapshotWriter::write_array checks this).
+struct TaxonSnapshotRecord {
+    std::int64_t id;
+    std::uint32_t parent_index;
+    std::uint32_t flags;
+    std::uint32_t rank;
+    std::uint32_t unused = 0;
+    SnapshotStr name;
+    SnapshotStr uniqname;
+    SnapshotStr source_info;
+};
+
+struct SynonymSnapshotRecord {
+    std::uint64_t primary_index;
+    SnapshotStr name;
+    SnapshotStr source_string;
+};
+
+// target is the preorder index of the node (or the OTT Id if
+//    foreign IDs are not mapped to pointers).
+struct ForeignIdSnapshotRecord {
+    std::int64_t foreign_id;
+    std::int64_t target;
+};
+
+struct ForwardSnapshotRecord {
+    OttId old_id;
+    OttId new_id;
+};
+
+static TaxonomySnapshotStamp current_taxonomy_stamp(const string & dir,
+                                                    bitset<32> cf,
+                                                    OttId kr,
+                                                    bool read_syn_type_as_src) {
+    TaxonomySnapshotStamp stamp;
+    stamp.taxonomy_tsv = stamp_file(dir + "/taxonomy.tsv");
+    stamp.synonyms_tsv = stamp_file(dir + "/synonyms.tsv");
+    stamp.forwards_tsv = stamp_file(dir + "/forwards.tsv");
+    stamp.version_txt = stamp_file(dir + "/version.txt");
+    stamp.keep_root = kr;
+    stamp.cleaning_flags = static_cast<std::uint32_t>(cf.to_ulong());
+    stamp.read_synonym_type_as_src = read_syn_type_as_src ? 1 : 0;
+    return stamp;
+}
+
+vector<const RTRichTaxNode *> taxonomy_nodes_in_snapshot_order(const RichTaxTree & tree) {
+    vector<const RTRichTaxNode *> nodes;
+    for (auto nd : iter_pre_const(tree)) {
+        nodes.push_back(nd);
+    }
+    return nodes;
+}
+
+string taxonomy_snapshot_stale_reason(SnapshotReader & snapshot,
+                                      const string & dir,
+                                      bitset<32> cf,
+                                      OttId kr) {
+    auto stored = snapshot.read_value<TaxonomySnapshotStamp>();
+    auto stored_version = snapshot.read_string();
+    auto current = current_taxonomy_stamp(dir, cf, kr, false);
+    if (stored.version_txt != current.version_txt
+        or stored_version != strip_trailing_whitespace(read_str_content_of_utf8_file(dir + "/version.txt"))) {
+        return "the taxonomy version has changed";
+    }
+    if (stored.taxonomy_tsv != current.taxonomy_tsv
+        or stored.synonyms_tsv != current.synonyms_tsv
+        or stored.forwards_tsv != current.forwards_tsv) {
+        return "the taxonomy files have been modified";
+    }
+    if (stored.keep_root != current.keep_root or stored.cleaning_flags != current.cleaning_flags) {
+        return "it was written with a different root or cleaning flags";
+    }
+    if (stored.read_synonym_type_as_src != current.read_synonym_type_as_src) {
+        return "it was written with synonym types read as sources";
+    }
+    return string();
+}
+
+template<typename T>
+static void write_foreign_id_map(SnapshotWriter & snapshot,
+                                 const TaxonomyIndex<OttId, T> & id_map,
+                                 const unordered_map<const RTRichTaxNode *, std::uint32_t> & node_index) {
+    vector<ForeignIdSnapshotRecord> records;
+    records.reserve(id_map.size());
+    for (const auto & [foreign_id, target] : id_map) {
+#       if defined(MAP_FOREIGN_TO_POINTER)
+            records.push_back(ForeignIdSnapshotRecord{foreign_id, node_index.at(target)});
+#       else
+            records.push_back(ForeignIdSnapshotRecord{foreign_id, target});
+#       endif
+    }
+    snapshot.write_vector(records);
+}
+
+template<typename T>
+static void read_foreign_id_map(SnapshotReader & snapshot,
+                                TaxonomyIndex<OttId, T> & id_map,
+                                const vector<RTRichTaxNode *> & nodes) {
+    auto [records, num_records] = snapshot.read_array<ForeignIdSnapshotRecord>();
+    id_map.reserve(num_records);
+    for (std::size_t i = 0; i < num_records; ++i) {
+        const auto & rec = records[i];
+#       if defined(MAP_FOREIGN_TO_POINTER)
+            id_map[static_cast<OttId>(rec.foreign_id)] = nodes.at(rec.target);
+#       else
+            id_map[static_cast<OttId>(rec.foreign_id)] = static_cast<OttId>(rec.target);
+#       endif
+    }
+}
+
+void RichTaxonomy::write_snapshot(SnapshotWriter & snapshot) const {
+    snapshot.write_value(current_taxonomy_stamp(path, cleaning_flags, keep_root, read_synonym_type_as_src));
+    snapshot.write_string(version);
+    const auto nodes = taxonomy_nodes_in_snapshot_order(*tree);
+    if (nodes.size() >= NO_SNAPSHOT_PARENT) {
+        throw OTCError() << "Too many taxa (" << nodes.size() << ") to write a taxonomy snapshot.";
+    }
+    unordered_map<const RTRichTaxNode *, std::uint32_t> node_index;
+    node_index.reserve(nodes.size());
+    for (std::uint32_t i = 0; i < nodes.size(); ++i) {
+        node_index[nodes[i]] = i;
+    }
+    SnapshotStringPool pool;
+    vector<TaxonSnapshotRecord> taxa;
+    taxa.reserve(nodes.size());
+    for (auto nd : nodes) {
+        const auto & data = nd->get_data();
+        TaxonSnapshotRecord rec;
+        rec.id = nd->get_ott_id();
+        rec.parent_index = (nd->get_parent() == nullptr ? NO_SNAPSHOT_PARENT : node_index.at(nd->get_parent()));
+        rec.flags = static_cast<std::uint32_t>(data.flags.to_ulong());
+        rec.rank = static_cast<std::uint32_t>(data.rank);
+        rec.uniqname = pool.add(nd->get_name());
+        rec.name = pool.add(data.possibly_nonunique_name);
+        rec.source_info = pool.add(data.source_info);
+        taxa.push_back(rec);
+    }
+    vector<SynonymSnapshotRecord> syn_records;
+    syn_records.reserve(synonyms.size());
+    for (const auto & tjs : synonyms) {
+        syn_records.push_back(SynonymSnapshotRecord{node_index.at(tjs.primary),
+                                                    pool.add(tjs.name),
+                                                    pool.add(tjs.source_string)});
+    }
+    vector<SnapshotStr> filtered_lines;
+    filtered_lines.reserve(filtered_records.size());
+    for (const auto & tr : filtered_records) {
+        filtered_lines.push_back(pool.add(tr.line));
+    }
+    vector<ForwardSnapshotRecord> forward_records;
+    forward_records.reserve(forwards.size());
+    for (const auto & [old_id, new_id] : forwards) {
+        forward_records.push_back(ForwardSnapshotRecord{old_id, new_id});
+    }
+    const auto & tree_data = tree->get_data();
+    snapshot.write_string(pool.contents());
+    snapshot.write_vector(taxa);
+    write_foreign_id_map(snapshot, tree_data.ncbi_id_map, node_index);
+    write_foreign_id_map(snapshot, tree_data.gbif_id_map, node_index);
+    write_foreign_id_map(snapshot, tree_data.worms_id_map, node_index);
+    write_foreign_id_map(snapshot, tree_data.if_id_map, node_index);
+    write_foreign_id_map(snapshot, tree_data.irmng_id_map, node_index);
+    snapshot.write_vector(syn_records);
+    snapshot.write_vector(forward_records);
+    snapshot.write_vector(filtered_lines);
+}
+
+RichTaxonomy::RichTaxonomy(const std::string& dir,
+                           std::bitset<32> cf,
+                           OttId kr,
+                           SnapshotReader & snapshot)
+    :BaseTaxonomy(dir, cf, kr),
+    read_synonym_type_as_src(false) {
+    const string_view pool = snapshot.read_string();
+    auto [taxa, num_taxa] = snapshot.read_array<TaxonSnapshotRecord>();
+    if (num_taxa == 0) {
+        throw OTCError() << "No taxa in snapshot \"" << snapshot.get_path() << "\"";
+    }
+    tree = std::make_unique<RichTaxTree>();
+    vector<RTRichTaxNode *> nodes(num_taxa, nullptr);
+    for (std::size_t i = 0; i < num_taxa; ++i) {
+        const auto & rec = taxa[i];
+        RTRichTaxNode * nd = nullptr;
+        if (i == 0) {
+            nd = tree->create_root();
+        } else {
+            if (rec.parent_index >= i) {
+                throw OTCError() << "Taxa are not in preorder in snapshot \"" << snapshot.get_path() << "\"";
+            }
+            nd = tree->create_child(nodes[rec.parent_index]);
+        }
+        populate_rich_taxon_node(*nd,
+                                 *tree,
+                                 static_cast<OttId>(rec.id),
+                                 snapshot_str_to_view(pool, rec.name),
+                                 snapshot_str_to_view(pool, rec.uniqname),
+                                 static_cast<TaxonomicRank>(rec.rank),
+                                 bitset<32>(rec.flags));
+        nd->get_data().source_info = tree->get_data().source_info_pool.add(snapshot_str_to_view(pool, rec.source_info));
+        nodes[i] = nd;
+    }
+    auto & tree_data = tree->get_data();
+    read_foreign_id_map(snapshot, tree_data.ncbi_id_map, nodes);
+    read_foreign_id_map(snapshot, tree_data.gbif_id_map, nodes);
+    read_foreign_id_map(snapshot, tree_data.worms_id_map, nodes);
+    read_foreign_id_map(snapshot, tree_data.if_id_map, nodes);
+    read_foreign_id_map(snapshot, tree_data.irmng_id_map, nodes);
+
+    auto [syn_records, num_syn] = snapshot.read_array<SynonymSnapshotRecord>();
+    for (std::size_t i = 0; i < num_syn; ++i) {
+        const auto & rec = syn_records[i];
+        RTRichTaxNode * primary = nodes.at(rec.primary_index);
+        auto & tjs = _emplace_synonym(snapshot_str_to_view(pool, rec.name),
+                                      primary,
+                                      snapshot_str_to_view(pool, rec.source_string));
+        primary->get_data().junior_synonyms.push_back(&tjs);
+    }
+
+    auto [forward_records, num_forwards] = snapshot.read_array<ForwardSnapshotRecord>();
+    forwards.reserve(num_forwards);
+    for (std::size_t i = 0; i < num_forwards; ++i) {
+        forwards[forward_records[i].old_id] = forward_records[i].new_id;
+    }
+
+    auto [filtered_lines, num_filtered] = snapshot.read_array<SnapshotStr>();
+    filtered_records.reserve(num_filtered);
+    for (std::size_t i = 0; i < num_filtered; ++i) {
+        _add_filtered_record(snapshot_str_to_view(pool, filtered_lines[i]));
+    }
+    _register_filtered_records();
+    compute_depth(*tree);
+    compute_traversal_intervals(*tree);
+    _fill_ids_to_suppress_set();
+}
+
+} // namespace otc
@@ -0,0 +1,56 @@
+#include "otc/taxonomy/tsv_chunks.h"
+#include <algorithm>
+#include <string>
+
+using std::string_view;
+using std::vector;
+
+namespace otc {
+
+unsigned int num_tsv_parse_threads() {
+    return shared_work_pool().num_threads() + 1;
+}
+
+vector<string_view> split_at_line_boundaries(string_view text,
+                                             std::size_t max_chunks,
+                                             std::size_t min_chunk_size) {
+    vector<string_view> chunks;
+    if (text.empty()) {
+        return chunks;
+    }
+    max_chunks = std::max<std::size_t>(max_chunks, 1);
+    const std::size_t target = std::max(min_chunk_size, text.length() / max_chunks + 1);
+    while (not text.empty()) {
+        std::size_t len = text.length();
+        if (chunks.size() + 1 < max_chunks and len > target) {
+            auto nl = text.find('\n', target - 1);
+            len = (nl == string_view::npos ? text.length() : nl + 1);
+        }
+        chunks.push_back(text.substr(0, len));
+        text.remove_prefix(len);
+    }
+    return chunks;
+}
+
+std::size_t count_lines(string_view chunk) {
+    std::size_t n = std::count(chunk.begin(), chunk.end(), '\n');
+    if (not chunk.empty() and chunk.back() != '\n') {
+        ++n;
+    }
+    return n;
+}
+
+void split_tsv_fields(string_view line, string_view * fields, std::size_t n) {
+    constexpr string_view sep = "\t|\t";
+    const string_view whole_line = line;
+    for (std::size_t i = 0; i < n; ++i) {
+        auto loc = line.find(sep);
+        if (loc == string_view::npos) {
+            throw OTCError() << "Expected " << n << " fields separated by \"\\t|\\t\" in the line \"" << std::string(whole_line) << "\"";
+        }
+        fields[i] = line.substr(0, loc);
+        line.remove_prefix(loc + sep.length());
+    }
+}
+
+} // namespace otc
@@ -0,0 +1,59 @@
+#ifndef OTC_TAXONOMY_TSV_CHUNKS_H
+#define OTC_TAXONOMY_TSV_CHUNKS_H
+// Helpers for parsing the "\t|\t"-delimited OTT .tsv files in parallel.
+//
+// The text of a file (usually a MappedFile) is split into chunks at newline
+//  boundaries, and the chunks are parsed on the threads of shared_work_pool(),
+//  so --work-threads limits them too. Parsers get string_views into the text,
+//  so nothing is copied until a caller decides to keep it.
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "otc/error.h"
+#include "otc/work_stealing_pool.h"
+
+namespace otc {
+
+// Number of threads used to parse a file: the caller and the threads of shared_work_pool().
+unsigned int num_tsv_parse_threads();
+
+// Splits text into at most max_chunks consecutive pieces that each end just
+//  after a '\n' (or at the end of text). Chunks are at least min_chunk_size
+//  bytes, except for the last, so small files give a single chunk.
+std::vector<std::string_view> split_at_line_boundaries(std::string_view text,
+                                                       std::size_t max_chunks,
+                                                       std::size_t min_chunk_size = 1 << 20);
+
+// Number of lines in a chunk. A final line without a '\n' counts.
+std::size_t count_lines(std::string_view chunk);
+
+// Calls fn(line) for each line of chunk (without the '\n').
+template<typename F>
+inline void for_each_line(std::string_view chunk, F && fn) {
+    while (not chunk.empty()) {
+        auto nl = chunk.find('\n');
+        if (nl == std::string_view::npos) {
+            fn(chunk);
+            return;
+        }
+        fn(chunk.substr(0, nl));
+        chunk.remove_prefix(nl + 1);
+    }
+}
+
+// Calls fn(i, chunks[i]) for every chunk, spread over the calling thread and the
+//  threads of shared_work_pool(). Rethrows the first exception thrown by fn.
+template<typename F>
+inline void for_each_chunk_in_parallel(const std::vector<std::string_view> & chunks, F && fn) {
+    shared_work_pool().parallel_for(chunks.size(), [&](std::size_t i) {
+        fn(i, chunks[i]);
+    });
+}
+
+// Splits a line into n "\t|\t"-delimited fields. Throws OTCError if the line
+//  has fewer than n separators. Text after the n-th separator is ignored.
+void split_tsv_fields(std::string_view line, std::string_view * fields, std::size_t n);
+
+} // namespace otc
+#endif
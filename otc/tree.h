@@ -1,11 +1,14 @@
 #ifndef OTCETERA_TREE_H
 #define OTCETERA_TREE_H
 
+#include <algorithm>
 #include <climits>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <set>
 #include "otc/otc_base_includes.h"
@@ -318,18 +321,116 @@ inline const NodeType* find_root(const NodeType* nd) {
     return nd;
 }
     
+// Default node storage: every node is a separate heap allocation, so nodes
+//  can be freed with `delete` and moved freely between trees.
+template<typename N>
+class HeapNodeStorage {
+    public:
+        static constexpr bool releases_all_nodes = false;
+        N * create(N * parent) {
+            return new N(parent);
+        }
+        void destroy(const N * nd) {
+            delete nd;
+        }
+        void release_all() {
+        }
+};
+
+// Allocates nodes from contiguous slabs owned by the tree, so that the nodes
+//  of a tree are close together in memory and the whole tree is released by
+//  freeing its slabs (destructors are skipped for trivially destructible nodes).
+// Nodes freed individually with destroy() are reused by later create() calls.
+template<typename N>
+class ArenaNodeStorage {
+    public:
+        static constexpr bool releases_all_nodes = true;
+        static constexpr std::size_t MIN_SLAB_SIZE = 256;
+        static constexpr std::size_t MAX_SLAB_SIZE = 1 << 16;
+
+        ArenaNodeStorage() = default;
+        ~ArenaNodeStorage() {
+            release_all();
+        }
+        ArenaNodeStorage(const ArenaNodeStorage &) = delete;
+        ArenaNodeStorage & operator=(const ArenaNodeStorage &) = delete;
+
+        N * create(N * parent) {
+            if (not free_slots.empty()) {
+                N * nd = ::new (static_cast<void *>(free_slots.back())) N(parent);
+                free_slots.pop_back();
+                return nd;
+            }
+            if (slabs.empty() or slabs.back().used == slabs.back().capacity) {
+                add_slab();
+            }
+            Slab & slab = slabs.back();
+            N * nd = ::new (static_cast<void *>(slab.nodes + slab.used)) N(parent);
+            ++slab.used;
+            return nd;
+        }
+        void destroy(const N * nd) {
+            N * slot = const_cast<N *>(nd);
+            slot->~N();
+            free_slots.push_back(slot);
+        }
+        void release_all() {
+            if constexpr (not std::is_trivially_destructible_v<N>) {
+                // Refill the freed slots, so that every slot below `used` holds a node
+                //  and the slabs can be destroyed without looking up which were freed.
+                for (auto slot : free_slots) {
+                    ::new (static_cast<void *>(slot)) N(nullptr);
+                }
+                for (auto & slab : slabs) {
+                    std::destroy_n(slab.nodes, slab.used);
+                }
+            }
+            std::allocator<N> alloc;
+            for (auto & slab : slabs) {
+                alloc.deallocate(slab.nodes, slab.capacity);
+            }
+            slabs.clear();
+            free_slots.clear();
+        }
+    private:
+        struct Slab {
+            N * nodes;
+            std::size_t capacity;
+            std::size_t used;
+        };
+        void add_slab() {
+            std::size_t capacity = (slabs.empty() ? MIN_SLAB_SIZE : std::min(2 * slabs.back().capacity, MAX_SLAB_SIZE));
+            slabs.reserve(slabs.size() + 1);
+            slabs.push_back(Slab{std::allocator<N>().allocate(capacity), capacity, 0});
+        }
+        std::vector<Slab> slabs;
+        std::vector<N *> free_slots;
+};
+
+// Specialize as std::true_type for large trees that should use ArenaNodeStorage.
+//  The nodes of such a tree must be freed through the tree (delete_node or
+//  prune_and_delete) rather than with `delete`, and must not be moved into
+//  another tree, because they are released along with the tree's slabs.
+template<typename T, typename U>
+struct uses_node_arena : std::false_type {
+};
+
 template<typename T, typename U>
 class RootedTree {
     public:
         using node_data_type = T;
         using node_type = RootedTreeNode<T>;
         using data_type = U;
+        using node_storage_type = std::conditional_t<uses_node_arena<T, U>::value,
+                                                     ArenaNodeStorage<node_type>,
+                                                     HeapNodeStorage<node_type>>;
         
         RootedTree()
             :root(nullptr) {
         }
         explicit RootedTree(node_type* r)
             :root(r) {
+            static_assert(not uses_node_arena<T, U>::value, "nodes of an arena-backed tree must be created by the tree");
         }
         ~RootedTree() {
             clear();
@@ -395,13 +496,18 @@ class RootedTree {
             auto nodes = get_subtree_nodes(nd);
             prune_and_dangle(nd);
             for (auto ndi: nodes) {
-                delete ndi;
+                node_storage.destroy(ndi);
             }
         }
+        // Frees a node that has already been detached from its parent and children.
+        void delete_node(node_type * nd) {
+            node_storage.destroy(nd);
+        }
         bool is_detached(node_type * nd) {
             return contains(detached, nd);
         }
     protected:
+        node_storage_type node_storage;
         node_type * root;
         U data;
         std::string name;
@@ -415,12 +521,15 @@ class RootedTree {
             return name;
         }
         node_type * alloc_new_node(node_type *p) {
-            node_type * nd = new node_type(p);
-            return nd;
+            return node_storage.create(p);
         }
         void clear() {
-            for(auto nd: get_all_attached_nodes()) {
-                delete nd;
+            if constexpr (node_storage_type::releases_all_nodes) {
+                node_storage.release_all();
+            } else {
+                for(auto nd: get_all_attached_nodes()) {
+                    node_storage.destroy(nd);
+                }
             }
             root = NULL;
         }
@@ -484,6 +593,7 @@ class RTNodeIncludeBoolData{
 
 template<typename Tree>
 inline void add_subtree(typename Tree::node_type* par, Tree& T2) {
+    static_assert(not Tree::node_storage_type::releases_all_nodes, "cannot move nodes out of an arena-backed tree");
     auto c = T2.get_root();
     T2.prune_and_dangle(c);
     par->add_child(c);
@@ -491,6 +601,7 @@ inline void add_subtree(typename Tree::node_type* par, Tree& T2) {
 
 template<typename Tree>
 void replace_with_subtree(typename Tree::node_type* n, Tree& T2) {
+    static_assert(not Tree::node_storage_type::releases_all_nodes, "cannot move nodes out of an arena-backed tree");
     // Get the parent of the tip we are replacing
     auto p = n->get_parent();
     // Remove the data from T2 and attach it to this parent
@@ -28,7 +28,7 @@ class RTreeOttIDMapping {
 
 class RTSplits {
     public:
-    std::set<OttId> des_ids;
+    OttIdSet des_ids;
     int depth = 0;
 };
 
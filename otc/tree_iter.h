@@ -65,6 +65,11 @@ class preorder_iterator : std::forward_iterator_tag {
         bool moving_down;
         node_pointer const exit_node;
         void _advance() {
+            // A subtree that is a tip ends with it (climbing from it would never reach exit_node).
+            if (curr == exit_node and curr->is_tip()) {
+                curr = nullptr;
+                return;
+            }
             if (subtree_filter_fn == nullptr) {
                 _unfiltered_advance();
             } else {
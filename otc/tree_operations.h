@@ -12,6 +12,7 @@
 #include "otc/error.h"
 #include "otc/util.h"
 #include "otc/debug.h"
+#include "otc/leaf_bitset.h"
 namespace otc {
 template<typename T, typename CONTAINER>
 void show_children_in_set(std::ostream & out, T nd, const CONTAINER & ancestral);
@@ -22,7 +23,7 @@ bool is_monotypic_in_set(T nd, const CONTAINER & ancestral);
 template<typename T>
 void collapse_split_dont_del_node(T* nd);
 template<typename T>
-void collapse_split_and_del_node(T* nd);
+void collapse_split_and_del_node(typename T::node_type * nd, T & tree);
 template<typename T>
 std::size_t n_internal_with_ott_id(const T& tree);
 template<typename T>
@@ -155,14 +156,9 @@ void collapse_split_dont_del_node(T* nd) {
 }
 
 template<typename T>
-void collapse_split_and_del_node(T* nd) {
-    while (nd->get_first_child()) {
-        auto nd2 = nd->get_first_child();
-        nd2->detach_this_node();
-        nd->add_sib_on_left(nd2);
-    }
-    nd->detach_this_node();
-    delete nd;
+void collapse_split_and_del_node(typename T::node_type * nd, T & tree) {
+    collapse_split_dont_del_node(nd);
+    tree.delete_node(nd);
 }
 
 
@@ -265,10 +261,11 @@ void fill_des_ids(T & tree) {
                     des_ids.insert(node->get_ott_id());
             }
         } else {
-            for (auto child : iter_child(*node)) {
-                auto & cDesIds = child->get_data().des_ids;
-                des_ids.insert(cDesIds.begin(), cDesIds.end());
-            }
+            insert_union(des_ids, [node](auto add) {
+                for (auto child : iter_child(*node)) {
+                    add(child->get_data().des_ids);
+                }
+            });
         }
     }
 }
@@ -282,10 +279,11 @@ void clear_and_fill_des_ids(T & tree) {
         if (node->is_tip()) {
             des_ids.insert(node->get_ott_id());
         } else {
-            for (auto child : iter_child(*node)) {
-                auto & cDesIds = child->get_data().des_ids;
-                des_ids.insert(cDesIds.begin(), cDesIds.end());
-            }
+            insert_union(des_ids, [node](auto add) {
+                for (auto child : iter_child(*node)) {
+                    add(child->get_data().des_ids);
+                }
+            });
         }
     }
 }
@@ -302,10 +300,11 @@ void fill_des_ids_including_internals(T & tree) {
             if (node->has_ott_id()) {
                 des_ids.insert(node->get_ott_id());
             }
-            for (auto child : iter_child(*node)) {
-                auto & cDesIds = child->get_data().des_ids;
-                des_ids.insert(cDesIds.begin(), cDesIds.end());
-            }
+            insert_union(des_ids, [node](auto add) {
+                for (auto child : iter_child(*node)) {
+                    add(child->get_data().des_ids);
+                }
+            });
         }
     }
 }
@@ -321,6 +320,75 @@ void compute_depth(T& tree) {
     }
 }
 
+// fills in the trav_enter (preorder label) and trav_exit (largest label in the
+//  subtree) data members for each node.
+// The labels increase in preorder, but are spaced out, so that a node added (or a
+//  subtree moved) later can usually be given labels in the gap after its new parent's
+//  subtree by assign_traversal_intervals, without relabeling the whole tree.
+template <typename T>
+void compute_traversal_intervals(T& tree) {
+    std::uint64_t num_nodes = 0;
+    for (auto nd: iter_pre(tree)) {
+        num_nodes += 1;
+        (void) nd;
+    }
+    const std::uint32_t gap = std::clamp<std::uint64_t>(UINT32_MAX / (2 * num_nodes + 2), 1, 1024);
+    std::uint32_t n = 0;
+    for (auto nd: iter_pre(tree)) {
+        nd->get_data().trav_enter = n;
+        n += gap;
+    }
+    for (auto nd: iter_post(tree)) {
+        auto & d = nd->get_data();
+        auto lc = nd->get_last_child();
+        d.trav_exit = (lc == nullptr ? d.trav_enter : lc->get_data().trav_exit);
+    }
+}
+
+// Labels the subtree of nd, which has just been added or moved to be the last child of
+//  its parent, with the free labels after its parent's other descendants. The trav_exit
+//  of its ancestors is extended to cover them where needed. (A subtree that is moved away
+//  leaves the trav_exit of its old ancestors as it was; that only wastes labels.)
+// Returns false, and changes nothing, if the gap is too small; the caller should then
+//  call compute_traversal_intervals.
+// Takes O(size of the subtree + depth of nd).
+template <typename N>
+bool assign_traversal_intervals(N* nd) {
+    auto par = nd->get_parent();
+    assert(par != nullptr and par->get_last_child() == nd);
+    // The labels of the nodes after par's subtree in preorder start here.
+    std::uint64_t next_label = UINT32_MAX;
+    for (auto a = par; a != nullptr; a = a->get_parent()) {
+        if (auto s = a->get_next_sib()) {
+            next_label = s->get_data().trav_enter;
+            break;
+        }
+    }
+    const std::uint32_t old_exit = par->get_data().trav_exit;
+    std::uint64_t num_nodes = 0;
+    for (auto d: iter_pre_n(nd)) {
+        num_nodes += 1;
+        (void) d;
+    }
+    if (old_exit + num_nodes >= next_label) {
+        return false;
+    }
+    std::uint32_t n = old_exit + 1;
+    for (auto d: iter_pre_n(nd)) {
+        d->get_data().trav_enter = n++;
+    }
+    for (auto d: iter_post_n(*nd)) {
+        auto & dd = d->get_data();
+        auto lc = d->get_last_child();
+        dd.trav_exit = (lc == nullptr ? dd.trav_enter : lc->get_data().trav_exit);
+    }
+    const std::uint32_t new_exit = nd->get_data().trav_exit;
+    for (auto a = par; a != nullptr and a->get_data().trav_exit < new_exit; a = a->get_parent()) {
+        a->get_data().trav_exit = new_exit;
+    }
+    return true;
+}
+
 template <typename N>
 inline int depth(const N* node) {
     assert(node->get_data().depth > 0);
@@ -453,11 +521,10 @@ inline void fix_des_ids(RootedTreeNode<RTSplits> & nd, const OttIdSet & ls) {
     for (auto anc : iter_anc(nd)) {
         assert(anc != nullptr);
         assert(!anc->get_data().des_ids.empty());
-        for (auto tr : toRemove) {
-            assert(contains(anc->get_data().des_ids, tr));
-            anc->get_data().des_ids.erase(tr);
-        }
-        anc->get_data().des_ids.insert(begin(ls), end(ls));
+        auto & ad = anc->get_data().des_ids;
+        assert(is_subset(toRemove, ad));
+        ad = set_difference_as_set(ad, toRemove);
+        ad.insert(begin(ls), end(ls));
     }
 }
 
@@ -726,9 +793,7 @@ inline void cull_refs_to_node_from_data(RootedTree<RTSplits, RTreeOttIDMapping<R
     }
     for (auto a : iter_anc(*nd)) {
         auto & ad = a->get_data().des_ids;
-        for (auto el : d) {
-            ad.erase(el);
-        }
+        ad = set_difference_as_set(ad, d);
     }
 }
 
@@ -1125,7 +1190,7 @@ inline void del_monotypic_node(typename T::node_type* nd, T& tree) {
     } else {
         tree._set_root(child);
     }
-    delete nd;
+    tree.delete_node(nd);
  }
 
 template <typename T>
@@ -1332,28 +1397,133 @@ void induced_clade_sets(const T & tree1,
     }
 }
 
+// The tips of `tree` that have OTT ids, numbered in postorder.
+template<typename T>
+LeafIndex postorder_leaf_index(const T & tree) {
+    std::vector<OttId> ids;
+    for (auto nd : iter_post_const(tree)) {
+        if (nd->is_tip() and nd->has_ott_id()) {
+            ids.push_back(nd->get_ott_id());
+        }
+    }
+    return LeafIndex(std::move(ids));
+}
+
+// Maps the interval of leaf numbers below each node of `tree` to the lowest node with
+//  that interval. `leaves` must be postorder_leaf_index(tree).
+template<typename T>
+std::unordered_map<std::uint64_t, const typename T::node_type *>
+nodes_by_leaf_interval(const T & tree, const LeafIndex & leaves) {
+    std::unordered_map<std::uint64_t, const typename T::node_type *> by_interval;
+    std::unordered_map<const typename T::node_type *, LeafSpan> spans;
+    for (auto nd : iter_post_const(tree)) {
+        LeafSpan span;
+        if (nd->is_tip()) {
+            if (nd->has_ott_id()) {
+                span.add(static_cast<std::size_t>(leaves.index_of(nd->get_ott_id())));
+            }
+        } else {
+            for (auto c : iter_child_const(*nd)) {
+                auto it = spans.find(c);
+                span.add(it->second);
+                spans.erase(it);
+            }
+        }
+        if (span.count > 0) {
+            by_interval.emplace(span.interval_key(), nd);
+        }
+        spans[nd] = span;
+    }
+    return by_interval;
+}
+
+// The span of the numbers of `leaves` below each node of `tree` that has at least one
+//  of them below it (or has the OTT id of one), found by walking up from each leaf.
+//  Ids that are not in `tree` are left out. The walks stop below `stop`, if given.
+template<typename T>
+std::map<const typename T::node_type *, LeafSpan> induced_leaf_spans(const T & tree,
+                                                                     const LeafIndex & leaves,
+                                                                     const typename T::node_type * stop = nullptr) {
+    std::map<const typename T::node_type *, LeafSpan> spans;
+    for (std::size_t i = 0; i < leaves.size(); ++i) {
+        for (auto nd = tree.get_data().get_node_by_ott_id(leaves.ott_id_at(i));
+             nd != nullptr and nd != stop;
+             nd = nd->get_parent()) {
+            spans[nd].add(i);
+        }
+    }
+    return spans;
+}
+
+// The sizes of the sets of groupings that induced_clade_sets fills in, and of their
+//  intersection.
+struct InducedSplitCounts {
+    std::size_t num_induced = 0;   // groupings of > 1 of tree2's leaves induced by tree1
+    std::size_t num_in_second = 0; // groupings of > 2 leaves in tree2
+    std::size_t num_shared = 0;    // groupings in both
+};
+
+// Counts the groupings of induced_clade_sets without building them. The leaves of
+//  tree2 are numbered in postorder, so each of its groupings is an interval (see
+//  LeafSpan). The induced groupings of tree1 are nested or disjoint, so the lowest leaf
+//  and the size of one tell it apart from the others.
+template<typename T, typename U>
+InducedSplitCounts count_induced_splits(const T & tree1, const U & tree2) {
+    InducedSplitCounts counts;
+    const LeafIndex leaves = postorder_leaf_index(tree2);
+    // the intervals of tree2's groupings, and whether tree1 induces them
+    std::unordered_map<std::uint64_t, bool> tree2_intervals;
+    const auto t2r = tree2.get_root();
+    for (const auto & [interval, nd] : nodes_by_leaf_interval(tree2, leaves)) {
+        // As in induced_clade_sets, the root's leaf set is skipped; if the root has a unary
+        //  child, that child is the lowest node with the interval, so it is kept.
+        const auto num_leaves = (interval & 0xFFFFFFFFu) - (interval >> 32) + 1;
+        if (nd != t2r and num_leaves > 2) {
+            tree2_intervals.emplace(interval, false);
+        }
+    }
+    counts.num_in_second = tree2_intervals.size();
+
+    const auto inducingIds = get_ott_id_set_for_leaves(tree2);
+    auto mrca = find_mrca_using_des_ids(tree1, inducingIds);
+    if (mrca == nullptr) {
+        return counts;
+    }
+    std::set<std::pair<std::size_t, std::size_t> > induced; // (first, count)
+    for (const auto & [nd, span] : induced_leaf_spans(tree1, leaves, mrca)) {
+        if (span.count < 2 or not induced.emplace(span.first, span.count).second) {
+            continue;
+        }
+        if (span.is_interval()) {
+            auto it = tree2_intervals.find(span.interval_key());
+            if (it != tree2_intervals.end() and not it->second) {
+                it->second = true;
+                counts.num_shared += 1;
+            }
+        }
+    }
+    counts.num_induced = induced.size();
+    return counts;
+}
+
 template<typename T, typename U>
 unsigned long induced_rf_dist(const T & tree1, const U & tree2, bool firstIsSuperset) {
-    std::set<OttIdSet > inducedSplits;
-    std::set<OttIdSet > tree2Splits;
-    induced_clade_sets(tree1, tree2, inducedSplits, tree2Splits, firstIsSuperset);
-    return size_of_symmetric_difference(tree2Splits, inducedSplits);
+    if (!firstIsSuperset) {
+        throw OTCError("induced_rf_dist requires the first tree to be the superset");
+    }
+    const auto c = count_induced_splits(tree1, tree2);
+    return c.num_induced + c.num_in_second - 2 * c.num_shared;
 }
 
 template<typename T, typename U>
 std::size_t num_induced_splits_missing_in_second(const T & tree1,
                                               const U & tree2,
                                               bool firstIsSuperset) {
-    std::set<OttIdSet > inducedSplits;
-    std::set<OttIdSet > tree2Splits;
-    induced_clade_sets(tree1, tree2, inducedSplits, tree2Splits, firstIsSuperset);
-    std::size_t nm = 0;
-    for (auto ics : inducedSplits) {
-        if (!contains(tree2Splits, ics)) {
-            nm += 1;
-        }
+    if (!firstIsSuperset) {
+        throw OTCError("num_induced_splits_missing_in_second requires the first tree to be the superset");
     }
-    return nm;
+    const auto c = count_induced_splits(tree1, tree2);
+    return c.num_induced - c.num_shared;
 }
 
 template<typename U, typename T, typename V>
@@ -1492,9 +1662,10 @@ N* get_root(N* node) {
     return node;
 }
 
-template <typename node_t>
-void destroy_children(node_t* node) {
-    std::vector<node_t*> nodes;
+// Deletes the descendants of node, using `nodes` (which is cleared first) as the work list.
+template <typename Tree>
+void destroy_children(Tree& tree, typename Tree::node_type* node, std::vector<typename Tree::node_type*>& nodes) {
+    nodes.clear();
     while(auto n = node->get_first_child()) {
         n->detach_this_node();
         nodes.push_back(n);
@@ -1504,11 +1675,17 @@ void destroy_children(node_t* node) {
             n->detach_this_node();
             nodes.push_back(n);
         }
-        delete nodes[i];
+        tree.delete_node(nodes[i]);
     }
     assert(node->is_tip());
 }
 
+template <typename Tree>
+void destroy_children(Tree& tree, typename Tree::node_type* node) {
+    std::vector<typename Tree::node_type*> nodes;
+    destroy_children(tree, node, nodes);
+}
+
 // Walks the subtree rooted at `nd`. for each branch of the subtree, the rootward-most
 //    OTT ID is added to `ott_id_set`
 // This is useful for getting a complete list of taxa within a subtree without adding every
@@ -1570,7 +1747,7 @@ void delete_tip_and_monotypic_ancestors(T& tree, typename T::node_type* node) {
         } else {
             node->detach_this_node();
         }
-        delete node;
+        tree.delete_node(node);
         node = parent;
     }
 }
@@ -392,6 +392,61 @@ inline std::set<T> set_difference_as_set(const std::set<T> & fir, const std::set
     return d;
 }
 
+// The same for SortedVectorSet (the default OttIdSet): each is one linear merge.
+template<typename T>
+inline SortedVectorSet<T> set_intersection_as_set(const SortedVectorSet<T> & fir, const SortedVectorSet<T> & sec) {
+    std::vector<T> d;
+    d.reserve(std::min(fir.size(), sec.size()));
+    set_intersection(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return SortedVectorSet<T>::from_sorted(std::move(d));
+}
+template<typename T>
+inline SortedVectorSet<T> set_union_as_set(const SortedVectorSet<T> & fir, const SortedVectorSet<T> & sec) {
+    std::vector<T> d;
+    d.reserve(fir.size() + sec.size());
+    set_union(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return SortedVectorSet<T>::from_sorted(std::move(d));
+}
+template<typename T>
+inline SortedVectorSet<T> set_sym_difference_as_set(const SortedVectorSet<T> & fir, const SortedVectorSet<T> & sec) {
+    std::vector<T> d;
+    set_symmetric_difference(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return SortedVectorSet<T>::from_sorted(std::move(d));
+}
+template<typename T>
+inline SortedVectorSet<T> set_difference_as_set(const SortedVectorSet<T> & fir, const SortedVectorSet<T> & sec) {
+    std::vector<T> d;
+    set_difference(begin(fir), end(fir), begin(sec), end(sec), std::back_inserter(d));
+    return SortedVectorSet<T>::from_sorted(std::move(d));
+}
+
+// Inserts into s the elements of every set that for_each_set passes to its argument, as in
+//   insert_union(ids, [&](auto add) {for (auto c : iter_child(*nd)) add(c->get_data().des_ids);});
+template<typename S, typename ForEachSet>
+inline void insert_union(S & s, ForEachSet for_each_set) {
+    for_each_set([&](const auto & other) {
+        s.insert(begin(other), end(other));
+    });
+}
+// A SortedVectorSet gathers all of the elements and sorts them once: inserting the sets one at
+//  a time would merge all of s for each of them, which is quadratic at a wide polytomy.
+template<typename T, typename ForEachSet>
+inline void insert_union(SortedVectorSet<T> & s, ForEachSet for_each_set) {
+    std::size_t n = s.size();
+    for_each_set([&](const auto & other) {
+        n += other.size();
+    });
+    std::vector<T> d;
+    d.reserve(n);
+    d.insert(d.end(), begin(s), end(s));
+    for_each_set([&](const auto & other) {
+        d.insert(d.end(), begin(other), end(other));
+    });
+    std::sort(d.begin(), d.end());
+    d.erase(std::unique(d.begin(), d.end()), d.end());
+    s = SortedVectorSet<T>::from_sorted(std::move(d));
+}
+
 inline std::size_t find_first_graph_index(const std::string & s) {
     std::size_t pos = 0U;
     for (const auto & c : s) {
@@ -539,8 +594,8 @@ inline std::ostream& write_separated_collection(std::ostream& o, const std::vect
 }
 
 // returns the set of values for and key that is in `keys` and container 
-template<typename X, typename Y>
-inline std::set<Y> get_values_for_found_keys(const std::map<X, Y> & container, const std::set<X> & keys) {
+template<typename X, typename Y, typename Keys>
+inline std::set<Y> get_values_for_found_keys(const std::map<X, Y> & container, const Keys & keys) {
     std::set<Y> ret;
     for (auto i : keys) {
         auto x = container.find(i);
@@ -0,0 +1,220 @@
+#include "otc/work_stealing_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include "otc/error.h"
+
+namespace otc {
+
+// A range of items [begin, end) is packed into one 64-bit word so that the owner and
+//  the thieves can claim items from it with a single compare-and-swap.
+constexpr unsigned RANGE_SHIFT = 32;
+constexpr std::uint64_t RANGE_MASK = 0xFFFFFFFFu;
+
+inline std::uint64_t pack_range(std::size_t begin, std::size_t end) {
+    return (std::uint64_t(begin) << RANGE_SHIFT) | std::uint64_t(end);
+}
+
+inline std::size_t range_begin(std::uint64_t r) {
+    return std::size_t(r >> RANGE_SHIFT);
+}
+
+inline std::size_t range_end(std::uint64_t r) {
+    return std::size_t(r & RANGE_MASK);
+}
+
+struct WorkStealingPool::Job {
+    Job(std::size_t n, unsigned num_slots, void (*i)(void *, std::size_t), void * f)
+        :invoke(i),
+        fn(f),
+        ranges(num_slots),
+        remaining(n) {
+        for (unsigned s = 0; s < num_slots; ++s) {
+            ranges[s] = pack_range((n * s) / num_slots, (n * (s + 1)) / num_slots);
+        }
+    }
+    void (*invoke)(void *, std::size_t);
+    void * fn;
+    std::vector<std::atomic<std::uint64_t> > ranges; // slot 0 belongs to the caller
+    unsigned next_slot = 1; // guarded by the pool mutex
+    std::atomic<std::size_t> remaining;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex mutex; // guards error, and is held to notify done
+    std::condition_variable done;
+
+    std::optional<std::size_t> take_front(unsigned slot) {
+        auto & range = ranges[slot];
+        auto r = range.load();
+        while (range_begin(r) < range_end(r)) {
+            if (range.compare_exchange_weak(r, pack_range(range_begin(r) + 1, range_end(r)))) {
+                return range_begin(r);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Takes the back half of the largest range of another slot, keeps its first item
+    //  and puts the rest in the (empty) range of this slot.
+    std::optional<std::size_t> steal(unsigned slot) {
+        for (;;) {
+            unsigned victim = slot;
+            std::uint64_t victim_r = 0;
+            std::size_t largest = 0;
+            for (unsigned s = 0; s < ranges.size(); ++s) {
+                if (s == slot) {
+                    continue;
+                }
+                auto r = ranges[s].load();
+                auto b = range_begin(r), e = range_end(r);
+                if (b < e and e - b > largest) {
+                    victim = s;
+                    victim_r = r;
+                    largest = e - b;
+                }
+            }
+            if (largest == 0) {
+                return std::nullopt;
+            }
+            auto b = range_begin(victim_r), e = range_end(victim_r);
+            auto mid = b + (e - b) / 2;
+            if (ranges[victim].compare_exchange_strong(victim_r, pack_range(b, mid))) {
+                ranges[slot] = pack_range(mid + 1, e);
+                return mid;
+            }
+        }
+    }
+
+    void work(unsigned slot) {
+        for (;;) {
+            auto item = take_front(slot);
+            if (not item) {
+                item = steal(slot);
+                if (not item) {
+                    return;
+                }
+            }
+            if (not failed) {
+                try {
+                    invoke(fn, *item);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (not error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+            if (remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+};
+
+WorkStealingPool::WorkStealingPool(unsigned num_threads) {
+    threads.reserve(num_threads);
+    for (unsigned i = 0; i < num_threads; ++i) {
+        threads.emplace_back([this] { worker_loop(); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto & t : threads) {
+        t.join();
+    }
+}
+
+void WorkStealingPool::run(std::size_t n, void (*invoke)(void *, std::size_t), void * fn) {
+    if (n > RANGE_MASK) {
+        throw OTCError() << "WorkStealingPool::parallel_for called with too many items (" << n << ")";
+    }
+    const unsigned num_slots = unsigned(std::min<std::size_t>(n, threads.size() + 1));
+    auto job = std::make_shared<Job>(n, num_slots, invoke, fn);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+    }
+    if (num_slots == 2) {
+        wake.notify_one();
+    } else {
+        wake.notify_all();
+    }
+    job->work(0);
+    {
+        // Threads that have not joined yet would find nothing left to do.
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find(jobs.begin(), jobs.end(), job);
+        if (it != jobs.end()) {
+            jobs.erase(it);
+        }
+    }
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->done.wait(lock, [&] { return job->remaining == 0; });
+        // A pool thread may hold the last reference to job, so take the exception out of it.
+        std::swap(error, job->error);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkStealingPool::worker_loop() {
+    for (;;) {
+        std::shared_ptr<Job> job;
+        unsigned slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping or not jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = jobs.front();
+            slot = job->next_slot++;
+            if (job->next_slot >= job->ranges.size()) {
+                jobs.pop_front();
+            }
+        }
+        job->work(slot);
+    }
+}
+
+namespace {
+std::mutex shared_pool_mutex;
+std::optional<unsigned> shared_pool_size;
+std::unique_ptr<WorkStealingPool> shared_pool;
+}
+
+WorkStealingPool & shared_work_pool() {
+    std::lock_guard<std::mutex> lock(shared_pool_mutex);
+    if (not shared_pool) {
+        unsigned num_threads;
+        if (shared_pool_size) {
+            num_threads = *shared_pool_size;
+        } else {
+            num_threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        }
+        shared_pool = std::make_unique<WorkStealingPool>(num_threads);
+    }
+    return *shared_pool;
+}
+
+void set_shared_work_pool_size(unsigned num_threads) {
+    std::lock_guard<std::mutex> lock(shared_pool_mutex);
+    if (shared_pool) {
+        throw OTCError() << "The size of the shared work pool must be set before it is used.";
+    }
+    shared_pool_size = num_threads;
+}
+
+} // namespace otc
@@ -0,0 +1,73 @@
+#ifndef OTC_WORK_STEALING_POOL_H
+#define OTC_WORK_STEALING_POOL_H
+// A pool of threads that help split one caller's work into independent items.
+//
+// parallel_for(n, fn) calls fn(i) once for every i in [0, n), and returns when all
+//  calls have finished. The items are first cut into one contiguous range per
+//  participant: the calling thread and each pool thread that joins in. A participant
+//  takes items from the front of its own range; when that is empty, it steals the back
+//  half of the largest remaining range. So a few slow items (e.g. names that need fuzzy
+//  matching) do not leave the other threads idle.
+//
+// The calling thread always works on its own call, so a call finishes even when every
+//  pool thread is busy with other callers' items, and a pool with 0 threads just runs
+//  the items in order on the caller. If fn throws, the remaining items are skipped and
+//  the first exception is rethrown by parallel_for.
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace otc {
+
+class WorkStealingPool {
+    public:
+    explicit WorkStealingPool(unsigned num_threads);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool & operator=(const WorkStealingPool &) = delete;
+
+    unsigned num_threads() const {
+        return static_cast<unsigned>(threads.size());
+    }
+
+    template<typename F>
+    void parallel_for(std::size_t n, F && fn) {
+        if (threads.empty() or n < 2) {
+            for (std::size_t i = 0; i < n; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        auto fn_ptr = &fn;
+        using fn_ptr_t = decltype(fn_ptr);
+        run(n,
+            [](void * f, std::size_t i) { (*static_cast<fn_ptr_t>(f))(i); },
+            const_cast<void *>(static_cast<const void *>(fn_ptr)));
+    }
+
+    private:
+    struct Job;
+    void run(std::size_t n, void (*invoke)(void *, std::size_t), void * fn);
+    void worker_loop();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<Job> > jobs; // jobs that still have a range for another thread
+    bool stopping = false;
+};
+
+// The pool shared by everything in the process that splits up its work. It is created
+//  on first use with the size given to set_shared_work_pool_size, or with one thread
+//  less than the number of cores (the caller makes up the difference).
+WorkStealingPool & shared_work_pool();
+// Must be called before the first call of shared_work_pool().
+void set_shared_work_pool_size(unsigned num_threads);
+
+} // namespace otc
+#endif
@@ -528,8 +528,13 @@ json conflict_with_summary(const ConflictTree& query_tree,
     std::function<const cnode_type*(const cnode_type*,const cnode_type*)> query_mrca = [](const cnode_type* n1, const cnode_type* n2) {
         return mrca_from_depth(n1,n2);
     };
-    std::function<const snode_type*(const snode_type*,const snode_type*)> summary_mrca = [](const snode_type* n1, const snode_type* n2) {
-        return mrca_from_depth(n1,n2);
+    assert(summary.get_data().frozen);
+    const auto & frozen = *summary.get_data().frozen;
+    std::function<const snode_type*(const snode_type*,const snode_type*)> summary_mrca = [&frozen](const snode_type* n1, const snode_type* n2) {
+        if (not n1 or not n2) {
+            return n1 ? n1 : n2;
+        }
+        return frozen.mrca(n1,n2);
     };
     witness_namer_t witness_namer = [&](const string& w) {return synth_witness_namer(w,summary,Tax);};
     return conflict_with_tree_impl(query_tree, summary, query_mrca, summary_mrca, witness_namer);
@@ -20,12 +20,13 @@ std::unique_ptr<T> treeson_get_tree(const nlohmann::json& tree,
                                     const nlohmann::json& otus,
                                     bool extract_ingroup) {
     using std::string;
+    auto whole_tree = std::make_unique<T>();
     // 1. Create objects for nodes
     auto nodes = tree["nodeById"];
     std::map<string, typename T::node_type*> node_ptrs;
     typename T::node_type* root = nullptr;
     for(auto x = nodes.begin(); x != nodes.end(); x++) {
-        auto node = new typename T::node_type(nullptr);
+        auto node = whole_tree->create_node(nullptr);
         if (x.value().count("@root")) {
             root = node;
         }
@@ -66,11 +67,11 @@ std::unique_ptr<T> treeson_get_tree(const nlohmann::json& tree,
             root = root2;
         }
     }
-    // 4. Make tree from the root (ensure we don't leak non-ingroup nodes)
-    auto whole_tree = std::make_unique<T>(root);
+    // 4. Make tree from the root
+    whole_tree->_set_root(root);
     auto ingroup_node_id = lookup(tree, "^ot:inGroupClade");
 
-    // 5. Return ingroup if smaller than whole tree.
+    // 5. Return ingroup if smaller than whole tree (ensure we don't leak non-ingroup nodes)
     if (extract_ingroup and ingroup_node_id) {
         auto ingroup_node = node_ptrs[*ingroup_node_id];
         if (not ingroup_node) {
@@ -78,7 +79,10 @@ std::unique_ptr<T> treeson_get_tree(const nlohmann::json& tree,
         }
         if (ingroup_node and ingroup_node != root) {
             ingroup_node->detach_this_node();
-            return std::make_unique<T>(ingroup_node);
+            if (root) {
+                whole_tree->prune_and_delete(root);
+            }
+            whole_tree->_set_root(ingroup_node);
         }
     }
     return whole_tree;
@@ -21,25 +21,25 @@ class NodeNamerSupportedByStasher {
     NodeNameStyle nns;
     const RichTaxonomy & taxonomy;
     const TreesToServe & tts;
-    NodeNamerSupportedByStasher(NodeNameStyle in_nns, const RichTaxonomy &tax, const TreesToServe & tts_arg)
+    // needed only to name summary tree nodes.
+    const SourceEdgeMappingTable * mappings;
+    NodeNamerSupportedByStasher(NodeNameStyle in_nns,
+                                const RichTaxonomy &tax,
+                                const TreesToServe & tts_arg,
+                                const SourceEdgeMappingTable * mappings_arg = nullptr)
         :nns(in_nns),
         taxonomy(tax),
-        tts(tts_arg) {
+        tts(tts_arg),
+        mappings(mappings_arg) {
     }
 
     std::string operator()(const SumTreeNode_t *nd) const {
-        const SumTreeNodeData & d = nd->get_data();
-#           if defined(JOINT_MAPPING_VEC)
-            for (auto & el : d.source_edge_mappings) {
-                if (el.first == SourceEdgeMappingType::SUPPORTED_BY_MAPPING) {
-                    study_id_set.insert(tts.decode_study_node_id_index(el.second).first);
-                }
+        assert(mappings != nullptr);
+        for (auto & el : mappings->of(nd->get_data().frozen_index)) {
+            if (el.first == SourceEdgeMappingType::SUPPORTED_BY_MAPPING) {
+                study_id_set.insert(tts.decode_study_node_id_index(el.second).first);
             }
-#           else
-            for (auto & sni : d.supported_by) {
-                study_id_set.insert(tts.decode_study_node_id_index(sni).first);
-            }
-#           endif
+        }
         if (nns != NodeNameStyle::NNS_ID_ONLY && nd->has_ott_id()) {
             const auto * tr = taxonomy.included_taxon_from_id(nd->get_ott_id());
             if (tr == nullptr) {
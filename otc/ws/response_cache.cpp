@@ -0,0 +1,108 @@
+#include "otc/ws/response_cache.h"
+#include <algorithm>
+#include <functional>
+#include <string>
+
+namespace otc {
+
+// Rough per-entry cost of the list node, the index slot and the shared_ptr control block.
+constexpr std::size_t RESPONSE_CACHE_ENTRY_OVERHEAD = 128;
+
+std::string make_response_cache_key(const std::string & path,
+                                    const std::string & synth_id,
+                                    std::uint64_t taxonomy_generation,
+                                    const std::string & args) {
+    std::string key = path;
+    key += '\n';
+    key += synth_id;
+    key += '\n';
+    key += std::to_string(taxonomy_generation);
+    key += '\n';
+    key += args;
+    return key;
+}
+
+ResponseCache::ResponseCache(std::size_t budget, std::size_t num_shards)
+    :byte_budget(budget) {
+    num_shards = std::max<std::size_t>(1, num_shards);
+    shards.reserve(num_shards);
+    for (std::size_t i = 0; i < num_shards; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+void ResponseCache::set_byte_budget(std::size_t budget) {
+    byte_budget = budget;
+    clear();
+}
+
+ResponseCache::Shard & ResponseCache::shard_for(const std::string & key) {
+    return *shards[std::hash<std::string>{}(key) % shards.size()];
+}
+
+ResponseCache::Response ResponseCache::get(const std::string & key) {
+    if (not enabled()) {
+        return nullptr;
+    }
+    auto & shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        ++misses;
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    ++hits;
+    return it->second->response;
+}
+
+void ResponseCache::put(const std::string & key, Response response) {
+    const std::size_t budget = shard_byte_budget();
+    const std::size_t num_bytes = key.size() + response->size() + RESPONSE_CACHE_ENTRY_OVERHEAD;
+    if (num_bytes > budget) {
+        return;
+    }
+    auto & shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // Another thread computed the same response first.
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    while (not shard.lru.empty() and shard.num_bytes + num_bytes > budget) {
+        const auto & victim = shard.lru.back();
+        shard.num_bytes -= victim.num_bytes;
+        shard.index.erase(victim.key);
+        shard.lru.pop_back();
+        ++evictions;
+    }
+    shard.lru.push_front(Entry{key, std::move(response), num_bytes});
+    shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+    shard.num_bytes += num_bytes;
+}
+
+void ResponseCache::clear() {
+    for (auto & shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->index.clear();
+        shard->lru.clear();
+        shard->num_bytes = 0;
+    }
+}
+
+ResponseCacheStats ResponseCache::get_stats() const {
+    ResponseCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.byte_budget = byte_budget;
+    for (const auto & shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.num_entries += shard->lru.size();
+        stats.num_bytes += shard->num_bytes;
+    }
+    return stats;
+}
+
+} // namespace otc
@@ -0,0 +1,84 @@
+#ifndef OTC_WS_RESPONSE_CACHE_H
+#define OTC_WS_RESPONSE_CACHE_H
+// An in-process cache of web service response bodies.
+//
+// Keys are built with make_response_cache_key and must capture everything the
+//  response depends on. The cache is split into shards
+//  by the hash of the key, each with its own mutex and least-recently-used list, so
+//  that concurrent requests rarely contend. Each shard gets an equal part of the
+//  byte budget. A budget of 0 disables the cache.
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace otc {
+
+struct ResponseCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t num_entries = 0;
+    std::size_t num_bytes = 0;
+    std::size_t byte_budget = 0;
+};
+
+// The key of the response of the service at path to a request with the (canonical JSON)
+//  arguments args, computed from the synthetic tree synth_id and the taxonomy as of
+//  taxonomy_generation. So a response is never served for another tree, or from before
+//  an amendment.
+std::string make_response_cache_key(const std::string & path,
+                                    const std::string & synth_id,
+                                    std::uint64_t taxonomy_generation,
+                                    const std::string & args);
+
+class ResponseCache {
+    public:
+    using Response = std::shared_ptr<const std::string>;
+
+    explicit ResponseCache(std::size_t byte_budget = 0, std::size_t num_shards = 16);
+
+    bool enabled() const {
+        return byte_budget > 0;
+    }
+    // Changes the budget and empties the cache.
+    void set_byte_budget(std::size_t budget);
+    // Returns the cached response for key, or nullptr.
+    Response get(const std::string & key);
+    // Stores a response. Responses larger than the budget of a shard are not stored.
+    void put(const std::string & key, Response response);
+    void clear();
+    ResponseCacheStats get_stats() const;
+
+    private:
+    struct Entry {
+        std::string key;
+        Response response;
+        std::size_t num_bytes;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru; // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // keys point into lru
+        std::size_t num_bytes = 0;
+    };
+    Shard & shard_for(const std::string & key);
+    std::size_t shard_byte_budget() const {
+        return byte_budget / shards.size();
+    }
+
+    std::vector<std::unique_ptr<Shard> > shards;
+    std::atomic<std::size_t> byte_budget;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> evictions{0};
+};
+
+} // namespace otc
+#endif
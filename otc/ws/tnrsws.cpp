@@ -10,6 +10,7 @@
 #include <optional>
 #include <string_view>
 #include "otc/tnrs/context.h"
+#include "otc/work_stealing_pool.h"
 
 
 using std::vector;
@@ -100,7 +101,7 @@ vec_tax_str_pair_t exact_synonym_search_slow(const RichTaxonomy& /*taxonomy*/,
         }
         for(auto& tjs: taxon->get_data().junior_synonyms) {
             if (lcase_string_equals(query, tjs->get_name())) {
-                hits.push_back({taxon,tjs->get_name()});
+                hits.push_back({taxon, std::string(tjs->get_name())});
             }
         }
     }
@@ -308,7 +309,7 @@ vec_tax_str_pair_t prefix_synonym_search_slow(const Taxon* context_root,
         }
         for(auto& tjs: taxon->get_data().junior_synonyms) {
             if (lcase_match_prefix(tjs->get_name(), query)) {
-                hits.push_back({taxon,tjs->get_name()});
+                hits.push_back({taxon, std::string(tjs->get_name())});
             }
         }
     }
@@ -539,16 +540,22 @@ std::string tnrs_match_names_ws_method(const vector<string>& names,
     // 1. Determine context
     auto context = determine_context_for_names(names, context_name, taxonomy);
     ContextSearcher searcher(taxonomy, *context);
-    // 2. Iterate over names and fill arrays `results`, `unmatched_names`, `matched_names`, and `unambiguous_names`.
+    // 2. Search for the names on the shared work pool. Each name's result goes in its own
+    //    slot, so the response lists them in request order.
+    vector<pair<json,match_status>> name_results(names.size());
+    shared_work_pool().parallel_for(names.size(), [&](std::size_t i) {
+        name_results[i] = searcher.match_name(names[i], do_approximate_matching, include_suppressed);
+    });
+    // 3. Iterate over names and fill arrays `results`, `unmatched_names`, `matched_names`, and `unambiguous_names`.
     json results = json::array();
     json unambiguous_names = json::array();
     json unmatched_names = json::array();
     json matched_names = json::array();
-    for(auto& name: names) {
-        // Do the search
-        auto [result, status] = searcher.match_name(name, do_approximate_matching, include_suppressed);
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        auto& name = names[i];
+        auto& [result, status] = name_results[i];
         // Store the result
-        results.push_back(result);
+        results.push_back(std::move(result));
         // Classify name as unmatched / matched / unambiguous
         if (status == unmatched) {
             unmatched_names.push_back(name);
@@ -559,7 +566,7 @@ std::string tnrs_match_names_ws_method(const vector<string>& names,
             }
         }
     }
-    // 3. Construct JSON response.
+    // 4. Construct JSON response.
     json response;
     response["governing_code"] = context->code.name;
     response["context"] = context->name;
@@ -648,6 +655,10 @@ vector<const Taxon*> prefix_search_species_in_genus(const Taxon* genus,
 
 
 
+// autocomplete_name offers suggestions while the user types, so its fuzzy fallback only
+//  returns the best few matches.
+constexpr std::size_t MAX_AUTOCOMPLETE_FUZZY_MATCHES = 20;
+
 // curl -X POST https://api.opentreeoflife.org/v3/tnrs/autocomplete_name -H "content-type:application/json" -d '{"name":"Endoxyla","context_name":"All life"}'
 string tnrs_autocomplete_name_ws_method(const string& name,
                                         const string& context_name,
@@ -702,7 +713,7 @@ string tnrs_autocomplete_name_ws_method(const string& name,
             if (ctp == nullptr) {
                 throw OTCError() << "Fuzzy matching has not been enabled in the taxonomy, but was requested in match_name.";
             }
-            auto fuzzy_results = ctp->fuzzy_query_to_taxa(escaped_query, context_root, taxonomy, include_suppressed);
+            auto fuzzy_results = ctp->fuzzy_query_top_k(escaped_query, MAX_AUTOCOMPLETE_FUZZY_MATCHES, context_root, taxonomy, include_suppressed);
             add_hits(response, taxonomy, fuzzy_results);
         }
     } else { // does not contain a space at all
@@ -727,7 +738,7 @@ string tnrs_autocomplete_name_ws_method(const string& name,
             if (ctp == nullptr) {
                 throw OTCError() << "Fuzzy matching has not been enabled in the taxonomy, but was requested in match_name.";
             }
-            auto fuzzy_results = ctp->fuzzy_query_to_taxa(escaped_query, context_root, taxonomy, include_suppressed);
+            auto fuzzy_results = ctp->fuzzy_query_top_k(escaped_query, MAX_AUTOCOMPLETE_FUZZY_MATCHES, context_root, taxonomy, include_suppressed);
             add_hits(response, taxonomy, fuzzy_results);
         }
     }
@@ -85,14 +85,14 @@ vector<string> get_descendant_names(const RichTaxonomy& taxonomy, const SumTreeN
 }
 
 // Corresponds to getNodeBlob( ) and getNodeBlobArguson( ) in treemachine/src/main/java/opentree/GraphExplorer.java
-void add_basic_node_info(const RichTaxonomy & taxonomy, const SumTreeNode_t & nd, json & noderepr, bool is_arguson = false) {
+void add_basic_node_info(const RichTaxonomy & taxonomy, const FrozenSummaryTree & tree, const SumTreeNode_t & nd, json & noderepr, bool is_arguson = false) {
     noderepr["node_id"] = node_id_for_summary_tree_node(nd);
 
     // The number of descendant tips (.e.g not including this node).
     if (nd.is_tip())
         noderepr["num_tips"] = 0;
     else
-        noderepr["num_tips"] = nd.get_data().num_tips;
+        noderepr["num_tips"] = tree.get_num_tips(tree.index_of(&nd));
 
     if (is_arguson)
         noderepr["extinct"] = nd.get_data().is_extinct();
@@ -139,47 +139,8 @@ inline void add_str_to_str_or_vec_string(json & o, const string& first, const st
     }
 }
 
-#if !defined(JOINT_MAPPING_VEC)
-void add_support_info_vec(const TreesToServe & tts, 
-                          const char * tag,
-                          const vec_src_node_ids & v,
-                          json & noderepr,
-                          set<string> & usedSrcIds,
-                          const optional<string>& extra_src = {},
-                          const optional<string>& extra_node_id = {}) {
-    json o;
-    for (const auto & sni : v ) {
-        const auto study_node_pair = tts.decode_study_node_id_index(sni);
-        usedSrcIds.insert(*study_node_pair.first);
-        add_str_to_vec_string(o, study_node_pair.first, study_node_pair.second);
-    }
-    if (extra_src && extra_node_id) {
-        add_str_to_vec_string(o, *extra_src, *extra_node_id);
-    }
-    noderepr[tag] = o;
-}
-
-void add_support_info_single_element(const TreesToServe & tts,
-                                     const char * tag,
-                                     const vec_src_node_ids & v,
-                                     json & noderepr,
-                                     set<string> & usedSrcIds,
-                                     const optional<string>& extra_src = {},
-                                     const optional<string>& extra_node_id = {}) {
-    json o;
-    for (const auto & sni : v ) {
-        const auto study_node_pair = tts.decode_study_node_id_index(sni);
-        usedSrcIds.insert(*study_node_pair.first);
-        add_str_to_str(o, study_node_pair.first, study_node_pair.second);
-    }
-    if (extra_src && extra_node_id) {
-        add_str_to_str(o, *extra_src, *extra_node_id);
-    }
-    noderepr[tag] = o;
-}
-#endif
-
 void add_node_support_info(const TreesToServe & tts,
+                           const SourceEdgeMappingTable & mappings,
                            const SumTreeNode_t & nd,
                            json & noderepr,
                            set<string> & usedSrcIds) {
@@ -195,13 +156,12 @@ void add_node_support_info(const TreesToServe & tts,
         usedSrcIds.insert(*extra_src);
     }
 
-#if defined(JOINT_MAPPING_VEC)
     json supported_j; bool had_conflicts = false;
     json conflicts_j; bool had_supported = false;
     json partial_path_j; bool had_partial_path = false;
     json resolves_j; bool had_resolves = false;
     json terminal_j; bool had_terminal = false;
-    for (auto el : d.source_edge_mappings) {
+    for (auto el : mappings.of(d.frozen_index)) {
         const auto study_node_pair = tts.decode_study_node_id_index(el.second);
         usedSrcIds.insert(*study_node_pair.first);
         switch (el.first) {
@@ -253,23 +213,6 @@ void add_node_support_info(const TreesToServe & tts,
         noderepr["terminal"] = terminal_j;
     }
 
-#else
-    if (extra_src || !d.supported_by.empty()) {
-        add_support_info_single_element("supported_by", d.supported_by, noderepr, usedSrcIds, extra_src, extra_node_id);
-    }
-    if (!d.conflicts_with.empty()) {
-        add_support_info_vec("conflicts_with", d.conflicts_with, noderepr, usedSrcIds);
-    }
-    if (!d.resolves.empty()) {
-        add_support_info_single_element("resolves", d.resolves, noderepr, usedSrcIds);
-    }
-    if (!d.partial_path_of.empty()) {
-        add_support_info_single_element("partial_path_of", d.partial_path_of, noderepr, usedSrcIds);
-    }
-    if (!d.terminal.empty()) {
-        add_support_info_single_element("terminal", d.terminal, noderepr, usedSrcIds);
-    }
-#endif
     if (d.was_uncontested) {
         noderepr["was_uncontested"] = true;
         noderepr["was_constrained"] = true;
@@ -311,7 +254,7 @@ string about_ws_method(const TreesToServe &tts,
     {
         auto locked_taxonomy = tts.get_readable_taxonomy();
         const auto & taxonomy = locked_taxonomy.first;
-        add_basic_node_info(taxonomy, *root_node, root);
+        add_basic_node_info(taxonomy, tts.get_frozen_tree(tree_ptr), *root_node, root);
     }
     response["root"] = root;
     return response.dump(1);
@@ -338,22 +281,25 @@ string tax_about_ws_method(const RichTaxonomy & taxonomy) {
 
 inline void add_lineage(const TreesToServe & tts,
                         json & j,
+                        const FrozenSummaryTree & tree,
+                        const SourceEdgeMappingTable & mappings,
                         const SumTreeNode_t * focal,
                         const RichTaxonomy & taxonomy,
                         set<string> & usedSrcIds, bool is_arguson = false) {
     json lineage_arr;
-    const SumTreeNode_t * anc = focal->get_parent();
-    if (!anc) {
+    auto anc = tree.get_parent(tree.index_of(focal));
+    if (anc == NO_FROZEN_NODE) {
         vector<string> c;
         j["lineage"] = c;
         return;
     }
-    while (anc) {
+    while (anc != NO_FROZEN_NODE) {
         json ancj;
-        add_basic_node_info(taxonomy, *anc, ancj, is_arguson);
-        add_node_support_info(tts, *anc, ancj, usedSrcIds);
+        const auto & anc_nd = *tree.get_node(anc);
+        add_basic_node_info(taxonomy, tree, anc_nd, ancj, is_arguson);
+        add_node_support_info(tts, mappings, anc_nd, ancj, usedSrcIds);
         lineage_arr.push_back(ancj);
-        anc = anc->get_parent();
+        anc = tree.get_parent(anc);
     }
     j["lineage"] = lineage_arr;
 }
@@ -381,6 +327,7 @@ inline void add_source_id_map(json & j,
 }
 
 json node_info_json(const TreesToServe & tts,
+                    const SummaryTree_t * tree_ptr,
                     const SummaryTreeAnnotation * sta,
                     const SumTreeNode_t* focal,
                     bool include_lineage)
@@ -395,10 +342,11 @@ json node_info_json(const TreesToServe & tts,
     {
         auto locked_taxonomy = tts.get_readable_taxonomy();
         const auto & taxonomy = locked_taxonomy.first;
-        add_basic_node_info(taxonomy, *focal, response);
-        add_node_support_info(tts, *focal, response, usedSrcIds);
+        add_basic_node_info(taxonomy, tts.get_frozen_tree(tree_ptr), *focal, response);
+        const auto & mappings = tree_ptr->get_data().source_edge_mappings;
+        add_node_support_info(tts, mappings, *focal, response, usedSrcIds);
         if (include_lineage) {
-            add_lineage(tts, response, focal, taxonomy, usedSrcIds);
+            add_lineage(tts, response, tts.get_frozen_tree(tree_ptr), mappings, focal, taxonomy, usedSrcIds);
         }
         add_source_id_map(response, usedSrcIds, taxonomy, sta);
     }
@@ -419,7 +367,7 @@ string node_info_ws_method(const TreesToServe & tts,
     const auto & taxonomy = locked_taxonomy.first;
     auto result = find_required_node_by_id_str(*tree_ptr, taxonomy, node_id);
 
-    auto response = node_info_json(tts, sta, result.node(), include_lineage);
+    auto response = node_info_json(tts, tree_ptr, sta, result.node(), include_lineage);
     response["query"] = node_id;
     if (result.broken())
         response["broken"] = true;
@@ -447,7 +395,7 @@ string nodes_info_ws_method(const TreesToServe & tts,
 
         if (result.node())
         {
-            j = node_info_json(tts, sta, result.node(), include_lineage);
+            j = node_info_json(tts, tree_ptr, sta, result.node(), include_lineage);
             if (result.broken())
                 j["broken"] = true;
         }
@@ -483,37 +431,28 @@ void add_nearest_taxon(const RichTaxonomy& taxonomy, const SumTreeNode_t& node,
 }
 
 template <typename T>
-const SumTreeNode_t * mrca(const T & nodes) {
-    const SumTreeNode_t * focal = nullptr;
-    bool first = true;
+const SumTreeNode_t * mrca(const FrozenSummaryTree & tree, const T & nodes) {
+    std::uint32_t focal = NO_FROZEN_NODE;
     for (auto n : nodes) {
-        if (first) {
-            first = false;
-            focal = n;
-        } else {
-            focal = mrca_from_depth(focal, n);
-            if (focal == nullptr) {
-                break;
-            }
-        }
+        focal = tree.mrca(focal, tree.index_of(n));
     }
-    return focal;
+    return (focal == NO_FROZEN_NODE ? nullptr : tree.get_node(focal));
 }
 
 
 // Check if the excluded node is inside the include group, and update the MRCA of the exclude group if not.
-bool check_node_and_update_excluded_ancestor(const SumTreeNode_t* mrca_included, const SumTreeNode_t* excluded_node, const SumTreeNode_t* &closest_excluded_ancestor)
+bool check_node_and_update_excluded_ancestor(const FrozenSummaryTree & tree, const SumTreeNode_t* mrca_included, const SumTreeNode_t* excluded_node, const SumTreeNode_t* &closest_excluded_ancestor)
 {
-    auto mrca = mrca_from_depth(mrca_included, excluded_node);
+    auto mrca = tree.mrca(mrca_included, excluded_node);
 
     // Return false if the excluded node is actually inside the include group.
     if (mrca == mrca_included)
         return false;
 
-    assert(not closest_excluded_ancestor or is_ancestor_of_using_depth(closest_excluded_ancestor, mrca_included) or is_ancestor_of_using_depth(mrca_included, closest_excluded_ancestor));
+    assert(not closest_excluded_ancestor or tree.is_ancestor_of(closest_excluded_ancestor, mrca_included) or tree.is_ancestor_of(mrca_included, closest_excluded_ancestor));
 
     // If this is the first excluded taxon OR the mrca is closer, the update the closest excluded ancestor
-    if (not closest_excluded_ancestor or is_ancestor_of_using_depth(closest_excluded_ancestor, mrca))
+    if (not closest_excluded_ancestor or tree.is_ancestor_of(closest_excluded_ancestor, mrca))
         closest_excluded_ancestor = mrca;
 
     return true;
@@ -531,11 +470,12 @@ string mrca_ws_method(const TreesToServe & tts,
     assert(sta != nullptr);
 
     auto [taxonomy,_] = tts.get_readable_taxonomy();
+    const auto & tree = tts.get_frozen_tree(tree_ptr);
 
     // 1. Find MRCA of include group
     auto [tip_nodes, broken] = find_nodes_for_id_strings(taxonomy, tree_ptr, node_id_vec);
 
-    auto mrca_included = mrca(tip_nodes);
+    auto mrca_included = mrca(tree, tip_nodes);
 
     if (not mrca_included) throw OTCBadRequest("MRCA of taxa was not found.\n");
 
@@ -546,7 +486,7 @@ string mrca_ws_method(const TreesToServe & tts,
     json reversals;
     for(int i=0;i<excluded_nodes.size();i++)
     {
-        if (not check_node_and_update_excluded_ancestor(mrca_included, excluded_nodes[i], closest_excluded_ancestor))
+        if (not check_node_and_update_excluded_ancestor(tree, mrca_included, excluded_nodes[i], closest_excluded_ancestor))
             reversals.push_back(excluded_node_ids[i]);
     }
 
@@ -566,7 +506,7 @@ string mrca_ws_method(const TreesToServe & tts,
     // 4. Do the phylo-ref response here, if we had any excluded ids.
     if (not excluded_node_ids.empty())
     {
-        assert(is_ancestor_of_using_depth(closest_excluded_ancestor, mrca_included));
+        assert(tree.is_ancestor_of(closest_excluded_ancestor, mrca_included));
         json nodes;
         for(auto node = mrca_included; node != closest_excluded_ancestor; node = node->get_parent())
             nodes.push_back(node_id_for_summary_tree_node(*node));
@@ -577,8 +517,8 @@ string mrca_ws_method(const TreesToServe & tts,
     // 5. Do the standard mrca response.
     json mrcaj;
     set<string> usedSrcIds;
-    add_node_support_info(tts, *mrca_included, mrcaj, usedSrcIds);
-    add_basic_node_info(taxonomy, *mrca_included, mrcaj);
+    add_node_support_info(tts, tree_ptr->get_data().source_edge_mappings, *mrca_included, mrcaj, usedSrcIds);
+    add_basic_node_info(taxonomy, tree, *mrca_included, mrcaj);
     add_nearest_taxon(taxonomy, *mrca_included, response);
     add_source_id_map(response, usedSrcIds, taxonomy, sta);
     response["mrca"] = mrcaj;
@@ -603,6 +543,7 @@ auto lookup(const Map& m, const Key& k)
 
 
 const SumTreeNode_t * get_node_for_subtree(const SummaryTree_t * tree_ptr,
+                                           const FrozenSummaryTree & tree,
                                            const string & node_id,
                                            const RichTaxonomy& taxonomy,
                                            int height_limit,
@@ -630,49 +571,82 @@ const SumTreeNode_t * get_node_for_subtree(const SummaryTree_t * tree_ptr,
         j["broken"] = broken;
         throw OTCBadRequest("node_id was not found (broken taxon).\n")<<j;
     }
-    if (result.node()->get_data().num_tips > tip_limit && height_limit < 0) {
+    if (tree.get_num_tips(tree.index_of(result.node())) > tip_limit && height_limit < 0) {
         throw OTCBadRequest() << "The requested subtree is too large to be returned via the API. (Tip limit = " << tip_limit << ".) Download the entire tree.\n";
     }
     return result.node();
 }
 
 
-template<typename C, typename T, typename Y>
+// visited[i] is true for the preorder indices i of the nodes to write.
+template<typename Y>
 inline void write_visited_newick_no_semi(std::ostream & out,
-                                         const C & visited,
-                                         T nd,
+                                         const FrozenSummaryTree & tree,
+                                         const vector<char> & visited,
+                                         std::uint32_t nd,
                                          Y & nodeNamer) {
-    assert(nd != nullptr);
-    if (!(nd->is_tip())) {
+    assert(nd != NO_FROZEN_NODE);
+    if (!(tree.is_tip(nd))) {
         bool first = true;
-        for (auto c : iter_child_const(*nd)) {
-            if (visited.count(c)) {
+        for (auto c : iter_child(tree, nd)) {
+            if (visited[c]) {
                 if (first) {
                     out << '(';
                     first = false;
                 } else {
                     out << ',';
                 }
-                write_visited_newick_no_semi<C, T, Y>(out, visited, c, nodeNamer);
+                write_visited_newick_no_semi<Y>(out, tree, visited, c, nodeNamer);
             }
         }
         if (!first) {
             out << ')';
         }
     }
-    write_escaped_for_newick(out, nodeNamer(nd));
+    write_escaped_for_newick(out, nodeNamer(tree.get_node(nd)));
 }
 
-template<typename C, typename T, typename Y>
+template<typename Y>
 inline void write_visited_newick(std::ostream & out,
-                                 const C & visited,
-                                 T nd,
-
+                                 const FrozenSummaryTree & tree,
+                                 const vector<char> & visited,
+                                 std::uint32_t nd,
                                  Y & nodeNamer) {
-    write_visited_newick_no_semi<C,T,Y>(out, visited, nd, nodeNamer);
+    write_visited_newick_no_semi<Y>(out, tree, visited, nd, nodeNamer);
     out << ';';
 }
 
+// Same output as write_newick_generic, but walks the frozen tree.
+template<typename Y>
+inline void write_frozen_newick_no_semi(std::ostream & out,
+                                        const FrozenSummaryTree & tree,
+                                        std::uint32_t nd,
+                                        Y & nodeNamer,
+                                        bool include_all_node_labels,
+                                        long height_limit) {
+    assert(nd != NO_FROZEN_NODE);
+    if (!(tree.is_tip(nd)) && height_limit != 0) {
+        out << '(';
+        bool first = true;
+        const long nhl = height_limit - 1;
+        for (auto c : iter_child(tree, nd)) {
+            if (first) {
+                first = false;
+            } else {
+                out << ',';
+            }
+            write_frozen_newick_no_semi<Y>(out, tree, c, nodeNamer, include_all_node_labels, nhl);
+        }
+        out << ')';
+    }
+    // We need to call nodeNamer(nd) to mark nd as visited, even if we don't use the name.
+    const SumTreeNode_t * node = tree.get_node(nd);
+    auto name = nodeNamer(node);
+    if (include_all_node_labels or node->has_ott_id()) {
+        write_escaped_for_newick(out, name);
+    }
+}
+
 json get_supporting_studies(const set<const string*>& study_id_set) {
     json ss_arr = json::array();
     for (auto study_it_ptr : study_id_set) {
@@ -686,40 +660,52 @@ string induced_subtree_ws_method(const TreesToServe & tts,
                                  const vector<string> & node_id_vec,
                                  NodeNameStyle label_format) {
     assert(tree_ptr != nullptr);
-    const SumTreeNode_t * focal = nullptr;
+    const auto & tree = tts.get_frozen_tree(tree_ptr);
     auto locked_taxonomy = tts.get_readable_taxonomy();
     const auto & taxonomy = locked_taxonomy.first;
     // Check if any of the tip nodes are either (i) broken or (ii) not found.
     auto [tip_nodes, broken] = find_nodes_for_id_strings(taxonomy, tree_ptr, node_id_vec);
-    // Find the mrca
-    bool first = true;
+    vector<std::uint32_t> tip_inds;
+    tip_inds.reserve(tip_nodes.size());
     for (auto n: tip_nodes) {
-        if (first) {
-            first = false;
-            focal = n;
-        } else {
-            focal = mrca_from_depth(focal, n);
-            if (focal == nullptr) {
-                break;
-            }
-        }
+        tip_inds.push_back(tree.index_of(n));
+    }
+    // Find the mrca
+    std::uint32_t focal = NO_FROZEN_NODE;
+    for (auto n: tip_inds) {
+        focal = tree.mrca(focal, n);
     }
-    if (focal == nullptr) {
+    if (focal == NO_FROZEN_NODE) {
         throw OTCBadRequest() << "MRCA of taxa was not found.\n";
     }
-    // Visit some nodes beween tip_nodes and the mrca
-    set<const SumTreeNode_t *> visited;
-    visited.insert(focal);
-    for (auto tni : tip_nodes) {
-        auto cnd = tni;
-        while (visited.count(cnd) == 0) {
-            visited.insert(cnd);
-            cnd = cnd->get_parent(); 
-        } 
-    }
-    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy, tts);
+    // Visit some nodes beween tip_nodes and the mrca.
+    //    The marks are indexed by preorder number. They are kept between
+    //    requests, and only the entries set here are cleared afterwards.
+    thread_local vector<char> visited;
+    if (visited.size() < tree.size()) {
+        visited.resize(tree.size(), 0);
+    }
+    struct ClearMarks {
+        vector<char> & visited;
+        vector<std::uint32_t> marked;
+        ~ClearMarks() {
+            for (auto i : marked) {
+                visited[i] = 0;
+            }
+        }
+    } marks{visited, {}};
+    visited[focal] = 1;
+    marks.marked.push_back(focal);
+    for (auto cnd : tip_inds) {
+        while (not visited[cnd]) {
+            visited[cnd] = 1;
+            marks.marked.push_back(cnd);
+            cnd = tree.get_parent(cnd);
+        }
+    }
+    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy, tts, &tree_ptr->get_data().source_edge_mappings);
     ostringstream out;
-    write_visited_newick(out, visited, focal, nnsbs);
+    write_visited_newick(out, tree, visited, focal, nnsbs);
     json response;
     response["newick"] = out.str();
     response["supporting_studies"] = get_supporting_studies(nnsbs.study_id_set);
@@ -737,10 +723,12 @@ string newick_subtree_ws_method(const TreesToServe & tts,
     const uint32_t NEWICK_TIP_LIMIT = 100000;
     auto locked_taxonomy = tts.get_readable_taxonomy();
     const auto & taxonomy = locked_taxonomy.first;
-    auto focal = get_node_for_subtree(tree_ptr, node_id, taxonomy, height_limit, NEWICK_TIP_LIMIT);
-    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy, tts);
+    const auto & tree = tts.get_frozen_tree(tree_ptr);
+    auto focal = get_node_for_subtree(tree_ptr, tree, node_id, taxonomy, height_limit, NEWICK_TIP_LIMIT);
+    NodeNamerSupportedByStasher nnsbs(label_format, taxonomy, tts, &tree_ptr->get_data().source_edge_mappings);
     ostringstream out;
-    write_newick_generic<const SumTreeNode_t *, NodeNamerSupportedByStasher>(out, focal, nnsbs, include_all_node_labels, height_limit);
+    write_frozen_newick_no_semi(out, tree, tree.index_of(focal), nnsbs, include_all_node_labels, height_limit);
+    out << ';';
     json response;
     response["newick"] = out.str();
     response["supporting_studies"] = get_supporting_studies(nnsbs.study_id_set);
@@ -748,27 +736,28 @@ string newick_subtree_ws_method(const TreesToServe & tts,
 }
 
 
-template<typename T>
 inline void write_arguson(json & j,
                           const TreesToServe & tts,
                           const SummaryTreeAnnotation * sta,
                           const RichTaxonomy & taxonomy,
-                          T nd,
+                          const FrozenSummaryTree & tree,
+                          const SourceEdgeMappingTable & mappings,
+                          std::uint32_t nd,
                           long height_limit,
                           set<string> & usedSrcIds) {
-    assert(nd != nullptr);
-    if (!(nd->is_tip()) && height_limit != 0) {
+    assert(nd != NO_FROZEN_NODE);
+    if (!(tree.is_tip(nd)) && height_limit != 0) {
         json c_array;
         const long nhl = height_limit - 1;
-        for (auto c : iter_child_const(*nd)) {
+        for (auto c : iter_child(tree, nd)) {
             json cj;
-            write_arguson<T>(cj, tts, sta, taxonomy, c, nhl, usedSrcIds);
+            write_arguson(cj, tts, sta, taxonomy, tree, mappings, c, nhl, usedSrcIds);
             c_array.push_back(cj);
         }
         j["children"] = c_array;
     }
-    add_basic_node_info(taxonomy, *nd, j, true);
-    add_node_support_info(tts, *nd, j, usedSrcIds);
+    add_basic_node_info(taxonomy, tree, *tree.get_node(nd), j, true);
+    add_node_support_info(tts, mappings, *tree.get_node(nd), j, usedSrcIds);
 }
 
 string arguson_subtree_ws_method(const TreesToServe & tts,
@@ -779,7 +768,9 @@ string arguson_subtree_ws_method(const TreesToServe & tts,
     const uint32_t NEWICK_TIP_LIMIT = 25000;
     auto locked_taxonomy = tts.get_readable_taxonomy();
     const auto & taxonomy = locked_taxonomy.first;
-    auto focal = get_node_for_subtree(tree_ptr, node_id, taxonomy, height_limit, NEWICK_TIP_LIMIT);
+    const auto & tree = tts.get_frozen_tree(tree_ptr);
+    const auto & mappings = tree_ptr->get_data().source_edge_mappings;
+    auto focal = get_node_for_subtree(tree_ptr, tree, node_id, taxonomy, height_limit, NEWICK_TIP_LIMIT);
     json response;
     response["synth_id"] = sta->synth_id;
     set<string> usedSrcIds;
@@ -788,12 +779,12 @@ string arguson_subtree_ws_method(const TreesToServe & tts,
         auto locked_taxonomy = tts.get_readable_taxonomy();
         const auto & taxonomy = locked_taxonomy.first;
         try {
-            write_arguson(a, tts, sta, taxonomy, focal, height_limit, usedSrcIds);
+            write_arguson(a, tts, sta, taxonomy, tree, mappings, tree.index_of(focal), height_limit, usedSrcIds);
         } catch (...) {
             LOG(DEBUG) << "Exception in arguson_subtree_ws_method";
             throw;
         }
-        add_lineage(tts, a, focal, taxonomy, usedSrcIds, true);
+        add_lineage(tts, a, tree, mappings, focal, taxonomy, usedSrcIds, true);
         add_source_id_map(a, usedSrcIds, taxonomy, sta);
     }
     response["arguson"] = a;
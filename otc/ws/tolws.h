@@ -12,9 +12,11 @@
 #include <filesystem>
 #include <stdexcept>
 #include <memory>
+#include <span>
 #include "otc/newick_tokenizer.h"
 #include "otc/newick.h"
 #include "otc/tree.h"
+#include "otc/frozen_tree.h"
 #include "otc/error.h"
 #include "otc/taxonomy/taxonomy.h"
 #include "otc/taxonomy/patching.h"
@@ -36,38 +38,83 @@ typedef std::vector<src_node_id> vec_src_node_id_mapper;
 
 typedef RTRichTaxNode Taxon;
 
-#define JOINT_MAPPING_VEC
-
-#if defined(JOINT_MAPPING_VEC)
-    enum SourceEdgeMappingType {
-        CONFLICTS_WITH_MAPPING = 0,
-        PARTIAL_PATH_OF_MAPPING = 1,
-        RESOLVES_MAPPING = 2,
-        SUPPORTED_BY_MAPPING = 3,
-        TERMINAL_MAPPING = 4
-    };
-    typedef std::pair<SourceEdgeMappingType, std::uint32_t> semt_ind_t;
-    typedef std::vector<semt_ind_t> vec_src_node_ids;
-#else
-    typedef std::vector<std::uint32_t> vec_src_node_ids;
-#endif
+enum SourceEdgeMappingType {
+    CONFLICTS_WITH_MAPPING = 0,
+    PARTIAL_PATH_OF_MAPPING = 1,
+    RESOLVES_MAPPING = 2,
+    SUPPORTED_BY_MAPPING = 3,
+    TERMINAL_MAPPING = 4
+};
+typedef std::pair<SourceEdgeMappingType, std::uint32_t> semt_ind_t;
+typedef std::vector<semt_ind_t> vec_src_node_ids;
 
+// The support statements (supported_by, conflicts_with, ...) of every node of a summary
+//  tree, stored in one array and grouped by the preorder index of the node in its
+//  FrozenSummaryTree. Nodes therefore do not carry a vector each.
+class SourceEdgeMappingTable {
+    public:
+    std::span<const semt_ind_t> of(std::uint32_t frozen_index) const {
+        if (frozen_index + 1 >= first.size()) {
+            return {};
+        }
+        return {mappings.data() + first[frozen_index], mappings.data() + first[frozen_index + 1]};
+    }
+    std::span<semt_ind_t> all() {
+        return mappings;
+    }
+    std::size_t bytes_allocated() const {
+        return first.capacity() * sizeof(std::uint32_t) + mappings.capacity() * sizeof(semt_ind_t);
+    }
+    private:
+    std::vector<std::uint32_t> first; // mappings of node i are [first[i], first[i + 1])
+    std::vector<semt_ind_t> mappings;
+    friend class SourceEdgeMappingTableBuilder;
+};
+
+// Collects the mappings of nodes in any order (as annotations.json lists them).
+//  If a node is added twice, the last mappings added for it win.
+class SourceEdgeMappingTableBuilder {
+    public:
+    explicit SourceEdgeMappingTableBuilder(std::uint32_t num_nodes)
+        :last_block(num_nodes, UINT32_MAX) {
+    }
+    void add(std::uint32_t frozen_index, const vec_src_node_ids & node_mappings) {
+        last_block[frozen_index] = static_cast<std::uint32_t>(block_start.size());
+        block_start.push_back(static_cast<std::uint32_t>(pending.size()));
+        pending.insert(pending.end(), node_mappings.begin(), node_mappings.end());
+    }
+    void build(SourceEdgeMappingTable & table) const;
+    private:
+    std::vector<std::uint32_t> last_block;
+    std::vector<std::uint32_t> block_start;
+    vec_src_node_ids pending;
+};
+
+inline void SourceEdgeMappingTableBuilder::build(SourceEdgeMappingTable & table) const {
+    const std::uint32_t num_nodes = last_block.size();
+    table.first.assign(num_nodes + 1, 0);
+    table.mappings.clear();
+    table.mappings.reserve(pending.size());
+    for (std::uint32_t i = 0; i < num_nodes; ++i) {
+        table.first[i] = table.mappings.size();
+        const auto b = last_block[i];
+        if (b != UINT32_MAX) {
+            const std::size_t end = (b + 1 < block_start.size() ? block_start[b + 1] : pending.size());
+            table.mappings.insert(table.mappings.end(), pending.begin() + block_start[b], pending.begin() + end);
+        }
+    }
+    table.first[num_nodes] = table.mappings.size();
+    table.mappings.shrink_to_fit();
+}
+
+// Depths and tip counts are not stored here: they are columns of the FrozenSummaryTree.
+// The support statements of the node are in the SourceEdgeMappingTable of its tree.
 class SumTreeNodeData {
     public:
-    int depth = 0;
-#   if defined(JOINT_MAPPING_VEC)
-        vec_src_node_ids source_edge_mappings;
-#   else
-        vec_src_node_ids supported_by;
-        vec_src_node_ids conflicts_with;
-        vec_src_node_ids resolves;
-        vec_src_node_ids partial_path_of;
-        vec_src_node_ids terminal;
-#   endif
+    std::uint32_t frozen_index = 0; // set by FrozenTree
     bool was_uncontested = false;
     bool extinct_mark = false;  // extinctness means that the node has >= 1 descendant (including itself), and all descendants are extinct.
     bool is_extinct() const {return extinct_mark;}
-    uint32_t num_tips = 0;
 };
 
 #if defined(REPORT_MEMORY_USAGE)
@@ -78,28 +125,10 @@ inline std::size_t calc_memory_used(const src_node_id &,
 }
 
 template<>
-inline std::size_t calc_memory_used(const SumTreeNodeData &d, MemoryBookkeeper &mb) {
-    std::size_t total = 3 * sizeof(std::uint32_t); // traversals and num_tips
-    mb["tree node data trav + num_tips"] += total;
-    std::size_t x;
-#if defined(JOINT_MAPPING_VEC)
-    std::size_t v_el_size = sizeof(SourceEdgeMappingType) + sizeof(std::uint32_t); // 2 * sizeof(const std::string *);
-    x = calc_memory_used_by_vector_eqsize(d.source_edge_mappings, v_el_size, mb);
-    mb["tree node data source_edge_mappings"] += x; total += x;
-#else
-    std::size_t v_el_size = sizeof(std::uint32_t); // 2 * sizeof(const std::string *);
-    x = calc_memory_used_by_vector_eqsize(d.supported_by, v_el_size, mb);
-    mb["tree node data supported_by"] += x; total += x;
-    x = calc_memory_used_by_vector_eqsize(d.conflicts_with, v_el_size, mb);
-    mb["tree node data conflicts_with"] += x; total += x;
-    x = calc_memory_used_by_vector_eqsize(d.resolves, v_el_size, mb);
-    mb["tree node data resolves"] += x; total += x;
-    x = calc_memory_used_by_vector_eqsize(d.partial_path_of, v_el_size, mb);
-    mb["tree node data partial_path_of"] += x; total += x;
-    x = calc_memory_used_by_vector_eqsize(d.terminal, v_el_size, mb);
-    mb["tree node data terminal"] += x; total += x;
-#endif
-    total += sizeof(bool);
+inline std::size_t calc_memory_used(const SumTreeNodeData &, MemoryBookkeeper &mb) {
+    std::size_t total = sizeof(std::uint32_t); // frozen_index
+    mb["tree node data frozen_index"] += total;
+    total += 2 * sizeof(bool);
     return total;
 }
 
@@ -133,10 +162,23 @@ class SumTreeData {
 
     // string -> [(Tree,[(parent,[children])])]
     std::unordered_map<std::string, std::vector<contesting_tree_t>> contesting_trees_for_taxon;
+
+    // set by TreesToServe::read_new_tree once the topology is final.
+    const FrozenTree<RootedTree<SumTreeNodeData, SumTreeData> > * frozen = nullptr;
+
+    // filled from annotations.json, indexed by the preorder indices of `frozen`.
+    SourceEdgeMappingTable source_edge_mappings;
 };
 
 using SummaryTree_t = otc::RootedTree<SumTreeNodeData, SumTreeData>;
 
+template<>
+struct uses_node_arena<SumTreeNodeData, SumTreeData> : std::true_type {
+};
+
+// Served trees are frozen as soon as they have been read (see TreesToServe::read_new_tree).
+using FrozenSummaryTree = FrozenTree<SummaryTree_t>;
+
 
 #if defined(REPORT_MEMORY_USAGE)
 
@@ -164,7 +206,9 @@ inline std::size_t calc_memory_used(const SumTreeData &d, MemoryBookkeeper &mb)
     mb["SumTreeData broken_name_to_node"] += bn2nmem;
     mb["SumTreeData id_to_node"] += i2nmem;
     mb["SumTreeData broken_taxa"] += btmem;
-    return btmem + i2nmem + bn2nmem;
+    std::size_t semmem = d.source_edge_mappings.bytes_allocated();
+    mb["SumTreeData source_edge_mappings"] += semmem;
+    return btmem + i2nmem + bn2nmem + semmem;
 }
 #endif
 
@@ -342,7 +386,11 @@ std::string phylesystem_conflict_ws_method(const SummaryTree_t & summary,
                                            const std::string& tree1s,
                                            const std::string& tree2s);
 
-bool read_trees(const std::filesystem::path & dirname, TreesToServe & tts, const std::string& tax_version_check);
+// If snapshot_dir is not empty, synth trees are read from (and written to) binary snapshots there.
+bool read_trees(const std::filesystem::path & dirname,
+                TreesToServe & tts,
+                const std::string& tax_version_check,
+                const std::filesystem::path & snapshot_dir = std::filesystem::path());
 
 void from_json(const nlohmann::json &j, SourceTreeId & sti);
 void to_json(nlohmann::json &j, const SourceTreeId & sti);
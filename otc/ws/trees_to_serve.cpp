@@ -1,4 +1,5 @@
 #include "otc/ws/trees_to_serve.h"
+#include "otc/snapshot.h"
 #include <regex>
 
 namespace otc
@@ -15,17 +16,22 @@ TreesToServe::TreesToServe()
     :taxonomy_thread_safety("taxonomy")
 { }
 
-const src_node_id & TreesToServe::decode_study_node_id_index(std::uint32_t sni_ind) const {
-    return src_node_id_storer.at(sni_ind);
+const string * SourceNodeIdTable::get_stored_string(const string & k) {
+    const string * v = stored_strings[k];
+    if (v == nullptr) {
+        stored_strings_list.push_back(k);
+        v = &(stored_strings_list.back());
+        stored_strings[k] = v;
+    }
+    return v;
 }
 
-std::uint32_t TreesToServe::get_source_node_id_index(src_node_id sni) {
-    assert(!finalized); // should only be called while registering
-    auto it = lookup_for_node_ids_while_registering_trees.find(sni);
+std::uint32_t SourceNodeIdTable::get_source_node_id_index(src_node_id sni) {
+    auto it = lookup_for_node_ids.find(sni);
     std::uint32_t r;
-    if (it == lookup_for_node_ids_while_registering_trees.end()) {
+    if (it == lookup_for_node_ids.end()) {
         r = src_node_id_storer.size();
-        lookup_for_node_ids_while_registering_trees[sni] = r;
+        lookup_for_node_ids[sni] = r;
         src_node_id_storer.push_back(sni);
     } else {
         r = it->second;
@@ -33,14 +39,13 @@ std::uint32_t TreesToServe::get_source_node_id_index(src_node_id sni) {
     return r;
 }
 
-const string * TreesToServe::get_stored_string(const string & k) {
-    const string * v = stored_strings[k];
-    if (v == nullptr) {
-        stored_strings_list.push_back(k);
-        v = &(stored_strings_list.back());
-        stored_strings[k] = v;
-    }
-    return v;
+void SourceNodeIdTable::forget_lookup() {
+    map<src_node_id, std::uint32_t> tmpm;
+    std::swap(lookup_for_node_ids, tmpm);
+}
+
+const src_node_id & TreesToServe::decode_study_node_id_index(std::uint32_t sni_ind) const {
+    return source_node_ids.decode(sni_ind);
 }
 
 void TreesToServe::set_taxonomy(PatchableTaxonomy &taxonomy) {
@@ -64,7 +69,7 @@ TreesToServe::WritableTaxonomy TreesToServe::get_writable_taxonomy() {
 
 void TreesToServe::fill_ott_id_set(const std::bitset<32> & flags,
                                    OttIdSet & ott_id_set,
-                                   OttIdSet & suppressed_from_tree) {
+                                   OttIdSet & suppressed_from_tree) const {
     ott_id_set.clear();
     for (const auto nd : iter_node_const(*taxonomy_tree)) {
         const auto & tax_record_flags = nd->get_data().get_flags();
@@ -78,32 +83,168 @@ void TreesToServe::fill_ott_id_set(const std::bitset<32> & flags,
     }
 }
 
-TreesToServe::SumTreeInitPair TreesToServe::get_new_tree_and_annotations(const string & configfilename,
-                                                           const string & filename) {
-            
+// Bump whenever the layout of the summary tree snapshot sections changes.
+constexpr std::uint32_t SUMMARY_TREE_SNAPSHOT_FORMAT_VERSION = 1;
+
+struct SummaryTreeSnapshotStamp {
+    FileStamp tree_file;
+    std::uint32_t cleaning_flags = 0;
+    std::uint32_t unused = 0;
+};
+
+constexpr std::uint32_t NO_SNAPSHOT_PARENT = UINT32_MAX;
+
+// Nodes are stored in preorder. name is only stored for nodes without an OTT Id
+//    (index_by_name_or_id clears the others).
+struct SumTreeNodeSnapshotRecord {
+    std::uint32_t parent_index;
+    std::uint32_t has_ott_id;
+    std::int64_t ott_id;
+    SnapshotStr name;
+};
+
+static SummaryTreeSnapshotStamp current_summary_tree_stamp(const string & filename,
+                                                           const std::bitset<32> & cleaning_flags) {
+    SummaryTreeSnapshotStamp stamp;
+    stamp.tree_file = stamp_file(filename);
+    stamp.cleaning_flags = static_cast<std::uint32_t>(cleaning_flags.to_ulong());
+    return stamp;
+}
+
+static void write_summary_tree_snapshot(const SummaryTree_t & tree,
+                                        const string & snapshot_filename,
+                                        const string & filename,
+                                        const std::bitset<32> & cleaning_flags,
+                                        const string & taxonomy_version) {
+    // The path from the root to the last node written, with the index of each record.
+    //  In preorder, the parent of a node is the last node on this path once the
+    //  nodes that are not its ancestors have been popped.
+    vector<std::pair<const SumTreeNode_t *, std::uint32_t> > path;
+    SnapshotStringPool pool;
+    vector<SumTreeNodeSnapshotRecord> records;
+    for (auto nd : iter_pre_const(tree)) {
+        SumTreeNodeSnapshotRecord rec{NO_SNAPSHOT_PARENT, 0, 0, SnapshotStr()};
+        while (not path.empty() and path.back().first != nd->get_parent()) {
+            path.pop_back();
+        }
+        if (not path.empty()) {
+            rec.parent_index = path.back().second;
+        }
+        if (nd->has_ott_id()) {
+            rec.has_ott_id = 1;
+            rec.ott_id = nd->get_ott_id();
+        } else {
+            rec.name = pool.add(nd->get_name());
+        }
+        path.emplace_back(nd, records.size());
+        records.push_back(rec);
+    }
+    SnapshotWriter snapshot(snapshot_filename, SnapshotKind::SUMMARY_TREE, SUMMARY_TREE_SNAPSHOT_FORMAT_VERSION);
+    snapshot.write_value(current_summary_tree_stamp(filename, cleaning_flags));
+    snapshot.write_string(taxonomy_version);
+    snapshot.write_string(pool.contents());
+    snapshot.write_vector(records);
+    snapshot.commit();
+}
+
+// Returns nullptr if the snapshot does not match the newick file or taxonomy.
+static unique_ptr<SummaryTree_t> read_summary_tree_snapshot(const string & snapshot_filename,
+                                                            const string & filename,
+                                                            const std::bitset<32> & cleaning_flags,
+                                                            const string & taxonomy_version,
+                                                            const OttIdSet & ott_id_set) {
+    SnapshotReader snapshot(snapshot_filename, SnapshotKind::SUMMARY_TREE, SUMMARY_TREE_SNAPSHOT_FORMAT_VERSION);
+    auto stored = snapshot.read_value<SummaryTreeSnapshotStamp>();
+    auto current = current_summary_tree_stamp(filename, cleaning_flags);
+    if (not (stored.tree_file == current.tree_file) or stored.cleaning_flags != current.cleaning_flags) {
+        LOG(INFO) << "snapshot \"" << snapshot_filename << "\" is stale: \"" << filename << "\" or its cleaning flags have changed.";
+        return nullptr;
+    }
+    if (snapshot.read_string() != taxonomy_version) {
+        LOG(INFO) << "snapshot \"" << snapshot_filename << "\" is stale: it was written with a different taxonomy version.";
+        return nullptr;
+    }
+    const std::string_view pool = snapshot.read_string();
+    auto [records, num_records] = snapshot.read_array<SumTreeNodeSnapshotRecord>();
+    if (num_records == 0) {
+        throw OTCError() << "No nodes in snapshot \"" << snapshot_filename << "\"";
+    }
+    auto tree = std::make_unique<SummaryTree_t>();
+    vector<SumTreeNode_t *> nodes(num_records, nullptr);
+    for (std::size_t i = 0; i < num_records; ++i) {
+        const auto & rec = records[i];
+        SumTreeNode_t * nd = nullptr;
+        if (i == 0) {
+            nd = tree->create_root();
+        } else {
+            if (rec.parent_index >= i) {
+                throw OTCError() << "Nodes are not in preorder in snapshot \"" << snapshot_filename << "\"";
+            }
+            nd = tree->create_child(nodes[rec.parent_index]);
+        }
+        if (rec.has_ott_id) {
+            OttId ott_id = check_ott_id_size(rec.ott_id);
+            if (not contains(ott_id_set, ott_id)) {
+                throw OTCError() << "Unrecognized OTT Id " << ott_id << " in snapshot \"" << snapshot_filename << "\"";
+            }
+            nd->set_ott_id(ott_id);
+        } else {
+            nd->set_name(string(snapshot_str_to_view(pool, rec.name)));
+        }
+        nodes[i] = nd;
+    }
+    LOG(INFO) << "read \"" << filename << "\" from snapshot \"" << snapshot_filename << "\"";
+    return tree;
+}
+
+unique_ptr<LoadedSummaryTree> TreesToServe::read_new_tree(const string & configfilename,
+                                                          const string & filename,
+                                                          const string & snapshot_filename) const {
+
     OttIdSet ott_id_set, suppressed_id_set;
     auto cleaning_flags = cleaning_flags_from_config_file(configfilename);
     fill_ott_id_set(cleaning_flags, ott_id_set, suppressed_id_set);
 
     assert(taxonomy_ptr != nullptr);
+    const string & taxonomy_version = taxonomy_ptr->get_version();
 
-    // Load tree from file
-    ParsingRules parsingRules;
-    parsingRules.ott_id_validator = &ott_id_set;
-    parsingRules.include_internal_nodes_in_des_id_sets = true;
-    parsingRules.set_ott_idForInternals = true;
-    parsingRules.require_ott_ids = true;
-    parsingRules.set_ott_ids = true;
-    unique_ptr<SummaryTree_t> nt = first_newick_tree_from_file<SummaryTree_t>(filename, parsingRules);
-
-    index_by_name_or_id(*nt);
-    compute_depth(*nt);
-    set_num_tips(*nt);
-    tree_list.push_back(move(nt));
-    annotation_list.emplace(annotation_list.end());
-    auto & sta = annotation_list.back();
-    sta.suppressed_from_tree = suppressed_id_set;
-    return {*(tree_list.back()), sta};
+    unique_ptr<SummaryTree_t> nt;
+    if (not snapshot_filename.empty() and std::filesystem::exists(snapshot_filename)) {
+        try {
+            nt = read_summary_tree_snapshot(snapshot_filename, filename, cleaning_flags, taxonomy_version, ott_id_set);
+        } catch (const std::exception & x) {
+            LOG(WARNING) << "Could not read snapshot \"" << snapshot_filename << "\": " << x.what();
+            nt = nullptr;
+        }
+    }
+    if (nt) {
+        index_by_name_or_id(*nt);
+    } else {
+        // Load tree from file
+        ParsingRules parsingRules;
+        parsingRules.ott_id_validator = &ott_id_set;
+        parsingRules.include_internal_nodes_in_des_id_sets = true;
+        parsingRules.set_ott_idForInternals = true;
+        parsingRules.require_ott_ids = true;
+        parsingRules.set_ott_ids = true;
+        nt = first_newick_tree_from_file<SummaryTree_t>(filename, parsingRules);
+        index_by_name_or_id(*nt);
+        if (not snapshot_filename.empty()) {
+            try {
+                write_summary_tree_snapshot(*nt, snapshot_filename, filename, cleaning_flags, taxonomy_version);
+                LOG(INFO) << "wrote snapshot \"" << snapshot_filename << "\"";
+            } catch (const std::exception & x) {
+                LOG(WARNING) << "Could not write snapshot \"" << snapshot_filename << "\": " << x.what();
+            }
+        }
+    }
+    auto loaded = std::make_unique<LoadedSummaryTree>();
+    loaded->frozen = std::make_unique<FrozenSummaryTree>(*nt);
+    nt->get_data().frozen = loaded->frozen.get();
+    loaded->tree = move(nt);
+    loaded->annotations = std::make_unique<SummaryTreeAnnotation>();
+    loaded->annotations->suppressed_from_tree = std::move(suppressed_id_set);
+    return loaded;
 }
 
 vector<int> synth_id_to_version(const string& id) {
@@ -141,22 +282,34 @@ int compare_synth_ids(const string& id1, const string& id2) {
     return compare_versions(v1,v2);
 }
 
-void TreesToServe::register_last_tree_and_annotations() {
-    const SummaryTreeAnnotation & sta = annotation_list.back();
+void TreesToServe::register_tree_and_annotations(LoadedSummaryTree && loaded) {
+    assert(!finalized); // should only be called while registering
+    const SummaryTreeAnnotation & sta = *loaded.annotations;
+    // Compare versions first: it throws for a synth_id without one.
+    const bool is_newest = default_synth_id.empty() or compare_synth_ids(default_synth_id, sta.synth_id) < 0;
+
+    const auto & tree_ids = loaded.source_node_ids;
+    vector<std::uint32_t> new_index(tree_ids.size());
+    for (std::uint32_t i = 0; i < new_index.size(); ++i) {
+        const auto & sni = tree_ids.decode(i);
+        new_index[i] = source_node_ids.get_source_node_id_index(src_node_id(source_node_ids.get_stored_string(*sni.first),
+                                                                            source_node_ids.get_stored_string(*sni.second)));
+    }
+    for (auto & mapping : loaded.tree->get_data().source_edge_mappings.all()) {
+        mapping.second = new_index[mapping.second];
+    }
+
+    frozen_trees[loaded.tree.get()] = std::move(loaded.frozen);
+    tree_list.push_back(std::move(loaded.tree));
+    annotation_list.push_back(std::move(loaded.annotations));
     const SummaryTree_t & tree = *(tree_list.back());
     id_to_tree[sta.synth_id] = &tree;
     id_to_annotations[sta.synth_id] = &sta;
-    if (default_synth_id.empty() or compare_synth_ids(default_synth_id,sta.synth_id) < 0) {
+    if (is_newest) {
         default_synth_id = sta.synth_id;
     }
 }
 
-void TreesToServe::free_last_tree_and_annotations() {
-    tree_list.back()->clear();
-    tree_list.pop_back();
-    annotation_list.pop_back();
-}
-
 string TreesToServe::get_default_tree() const
 {
     return default_synth_id;
@@ -187,6 +340,14 @@ const SummaryTree_t * TreesToServe::get_summary_tree(string synth_id) const {
     return mit == id_to_tree.end() ? nullptr : mit->second;
 }
 
+const FrozenSummaryTree & TreesToServe::get_frozen_tree(const SummaryTree_t * tree) const {
+    auto fit = frozen_trees.find(tree);
+    if (fit == frozen_trees.end()) {
+        throw OTCError() << "Summary tree has not been frozen.";
+    }
+    return *(fit->second);
+}
+
 std::size_t TreesToServe::get_num_trees() const {
     return id_to_tree.size();
 }
@@ -194,7 +355,7 @@ std::size_t TreesToServe::get_num_trees() const {
 void TreesToServe::final_tree_added() {
     finalized = true;
     if (get_num_trees() == 1) {
-        const auto & annot = annotation_list.back();
+        const auto & annot = *annotation_list.back();
         const auto & sft = annot.suppressed_from_tree;
         assert(taxonomy_ptr != nullptr);
         // TODO: make taxonomy_ptr non-const or make the relevant field mutable. Probably the former.
@@ -202,8 +363,7 @@ void TreesToServe::final_tree_added() {
         nct->set_ids_suppressed_from_summary_tree_alias(&sft);
     }
 
-    map<src_node_id, std::uint32_t> tmpm;
-    std::swap(lookup_for_node_ids_while_registering_trees, tmpm);
+    source_node_ids.forget_lookup();
 }
 
 
@@ -1,6 +1,7 @@
 #ifndef TREES_TO_SERVE_H
 #define TREES_TO_SERVE_H
 
+#include <atomic>
 #include <set>
 #include <thread>
 #include "otc/ws/tolws.h"
@@ -12,31 +13,61 @@ using ReadableTaxonomy = std::pair<const RichTaxonomy &,
                                    std::unique_ptr<ReadMutexWrapper> >;
 using WritableTaxonomy = std::pair<RichTaxonomy &,
                                    std::unique_ptr<WriteMutexWrapper> >;
-                                   
+
+// Source node ids (study tree id, node id), numbered in the order they were first seen.
+//  Each string is stored once, however many ids refer to it.
+class SourceNodeIdTable {
+    std::map<std::string, const std::string *> stored_strings;
+    std::list<std::string> stored_strings_list;
+    vec_src_node_id_mapper src_node_id_storer;
+    std::map<src_node_id, std::uint32_t> lookup_for_node_ids;
+
+public:
+    const std::string * get_stored_string(const std::string & k);
+
+    std::uint32_t get_source_node_id_index(src_node_id sni);
+
+    const src_node_id & decode(std::uint32_t sni_ind) const {
+        return src_node_id_storer.at(sni_ind);
+    }
+
+    std::size_t size() const {
+        return src_node_id_storer.size();
+    }
+
+    // Frees the lookup of indices; get_source_node_id_index( ) may not be called afterwards.
+    void forget_lookup();
+};
+
+// A summary tree and its annotations that have been read but are not served yet.
+//  The source_edge_mappings of the tree are indices into its own source_node_ids,
+//  so that several trees can be read at once without sharing a table.
+struct LoadedSummaryTree {
+    std::unique_ptr<SummaryTree_t> tree;
+    std::unique_ptr<FrozenSummaryTree> frozen;
+    std::unique_ptr<SummaryTreeAnnotation> annotations;
+    SourceNodeIdTable source_node_ids;
+};
+
 class TreesToServe {
-    std::list< SummaryTreeAnnotation> annotation_list;
+    std::list<std::unique_ptr<SummaryTreeAnnotation> > annotation_list;
     std::list<std::unique_ptr<SummaryTree_t> > tree_list;
+    std::map<const SummaryTree_t *, std::unique_ptr<FrozenSummaryTree> > frozen_trees;
     std::map<std::string, const SummaryTree_t *> id_to_tree;
     std::map<std::string, const SummaryTreeAnnotation *> id_to_annotations;
     std::string default_synth_id;
     PatchableTaxonomy * taxonomy_ptr = nullptr;
-    std::map<std::string, const std::string *> stored_strings;
-    std::list<std::string> stored_strings_list;
     const RichTaxTree * taxonomy_tree = nullptr;
-    vec_src_node_id_mapper src_node_id_storer;
-    std::map<src_node_id, std::uint32_t> lookup_for_node_ids_while_registering_trees;
+    SourceNodeIdTable source_node_ids;
     bool finalized = false;
     mutable ParallelReadSerialWrite taxonomy_thread_safety;
+    std::atomic<std::uint64_t> taxonomy_generation{0};
 
 public:
     explicit TreesToServe();
 
     const src_node_id & decode_study_node_id_index(std::uint32_t sni_ind) const;
 
-    std::uint32_t get_source_node_id_index(src_node_id sni);
-
-    const std::string * get_stored_string(const std::string & k);
-
     void set_taxonomy(PatchableTaxonomy &taxonomy);
 
     using ReadableTaxonomy = std::pair<const PatchableTaxonomy &, std::unique_ptr<ReadMutexWrapper> >;
@@ -45,17 +76,31 @@ public:
 
     WritableTaxonomy get_writable_taxonomy();
 
+    // Incremented whenever the taxonomy is patched, so that cached responses
+    //    computed from an older taxonomy can be recognized.
+    std::uint64_t get_taxonomy_generation() const {
+        return taxonomy_generation;
+    }
+    void bump_taxonomy_generation() {
+        ++taxonomy_generation;
+    }
+
     void fill_ott_id_set(const std::bitset<32> & flags,
                          OttIdSet & ott_id_set,
-                         OttIdSet & suppressed_from_tree);
-
-    typedef std::pair<SummaryTree_t &, SummaryTreeAnnotation &> SumTreeInitPair;
-    SumTreeInitPair get_new_tree_and_annotations(const std::string & configfilename,
-                                                 const std::string & filename);
+                         OttIdSet & suppressed_from_tree) const;
 
-    void register_last_tree_and_annotations();
+    // Reads a tree, with empty annotations, without adding it to the trees served.
+    //   Only reads the taxonomy, so several trees can be read at once.
+    // If snapshot_filename is not empty, the tree is read from that snapshot when it
+    //   is up to date, and the snapshot is (re)written after parsing the newick otherwise.
+    std::unique_ptr<LoadedSummaryTree> read_new_tree(const std::string & configfilename,
+                                                     const std::string & filename,
+                                                     const std::string & snapshot_filename = std::string()) const;
 
-    void free_last_tree_and_annotations();
+    // Adds a tree read by read_new_tree( ) (and annotated) to the trees served, renumbering
+    //   its source node ids into the shared table. Trees must be registered one at a time.
+    // Throws, without adding the tree, if its synth_id has no version number.
+    void register_tree_and_annotations(LoadedSummaryTree && loaded);
 
     std::string get_default_tree() const;
 
@@ -65,6 +110,9 @@ public:
 
     const SummaryTree_t * get_summary_tree(std::string synth_id) const;
 
+    // Only valid after final_tree_added()
+    const FrozenSummaryTree & get_frozen_tree(const SummaryTree_t * tree) const;
+
     std::size_t get_num_trees() const;
 
     void final_tree_added();
@@ -0,0 +1,84 @@
+#include "otc/test_harness.h"
+#include "otc/ws/parallelreadserialwrite.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+using namespace otc;
+
+// Writers keep a == b, but change them one at a time; readers must never see them differ.
+char test_readers_never_see_a_write_in_progress(const TestHarness &) {
+    ParallelReadSerialWrite prsw("test");
+    long a = 0;
+    long b = 0;
+    std::atomic<bool> stop{false};
+    std::atomic<long> num_reads{0};
+    std::atomic<long> num_torn{0};
+    std::vector<std::thread> threads;
+    for (int r = 0; r < 4; ++r) {
+        threads.emplace_back([&] {
+            while (not stop) {
+                ReadMutexWrapper lock(prsw);
+                if (a != b) {
+                    ++num_torn;
+                }
+                ++num_reads;
+            }
+        });
+    }
+    for (int w = 0; w < 2; ++w) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 500; ++i) {
+                WriteMutexWrapper lock(prsw);
+                a += 1;
+                std::this_thread::yield();
+                b += 1;
+            }
+        });
+    }
+    threads[4].join();
+    threads[5].join();
+    stop = true;
+    for (int r = 0; r < 4; ++r) {
+        threads[r].join();
+    }
+    if (num_torn != 0 or a != 1000 or b != 1000) {
+        std::cerr << num_torn << " of " << num_reads << " reads saw a write in progress; a = " << a << ", b = " << b << '\n';
+        return 'F';
+    }
+    return '.';
+}
+
+// A writer waits for the reader that got in first, and readers can share.
+char test_writer_waits_for_reader(const TestHarness &) {
+    ParallelReadSerialWrite prsw("test");
+    std::atomic<bool> reader_done{false};
+    std::atomic<bool> writer_saw_reader_done{false};
+    std::thread writer;
+    {
+        ReadMutexWrapper lock(prsw);
+        std::thread other_reader([&] {
+            ReadMutexWrapper lock2(prsw);
+        });
+        other_reader.join();
+        writer = std::thread([&] {
+            WriteMutexWrapper wlock(prsw);
+            writer_saw_reader_done = reader_done.load();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        reader_done = true;
+    }
+    writer.join();
+    if (not writer_saw_reader_done) {
+        std::cerr << "The writer got in while a reader was at work\n";
+        return 'F';
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests{TestFn{"readers never see a write in progress", test_readers_never_see_a_write_in_progress},
+                   TestFn{"writer waits for reader", test_writer_waits_for_reader}};
+    return th.run_tests(tests);
+}
@@ -0,0 +1,98 @@
+#include "otc/test_harness.h"
+#include "otc/ws/response_cache.h"
+#include <memory>
+#include <string>
+using namespace otc;
+
+using Response = ResponseCache::Response;
+
+Response body(char c) {
+    return std::make_shared<const std::string>(100, c);
+}
+
+// With one shard of room for 3 entries, a 4th evicts the least recently used one,
+//  and a get() makes an entry the most recently used.
+char test_lru_eviction_order(const TestHarness &) {
+    const std::size_t entry_size = 1 + 100 + 128; // key, body, and the overhead of an entry
+    ResponseCache cache(3 * entry_size, 1);
+    cache.put("a", body('a'));
+    cache.put("b", body('b'));
+    cache.put("c", body('c'));
+    if (not cache.get("a")) {
+        std::cerr << "\"a\" was not cached\n";
+        return 'F';
+    }
+    cache.put("d", body('d'));
+    if (cache.get("b")) {
+        std::cerr << "\"b\" should have been evicted\n";
+        return 'F';
+    }
+    for (auto key : {"a", "c", "d"}) {
+        auto hit = cache.get(key);
+        if (not hit or (*hit)[0] != key[0]) {
+            std::cerr << "\"" << key << "\" should still be cached\n";
+            return 'F';
+        }
+    }
+    cache.put("e", body('e'));
+    if (cache.get("a")) {
+        std::cerr << "\"a\" should have been evicted after \"c\" and \"d\" were used\n";
+        return 'F';
+    }
+    const auto stats = cache.get_stats();
+    if (stats.evictions != 2 or stats.num_entries != 3 or stats.num_bytes != 3 * entry_size) {
+        std::cerr << "evictions = " << stats.evictions << ", entries = " << stats.num_entries << ", bytes = " << stats.num_bytes << '\n';
+        return 'F';
+    }
+    return '.';
+}
+
+// Responses for another synthetic tree, or from before a taxonomy amendment, are never hit.
+//  A hit returns the stored body itself, not a copy.
+char test_keys_by_synth_id_and_taxonomy_generation(const TestHarness &) {
+    ResponseCache cache(1 << 20);
+    const std::string args = "{\"node_id\":\"ott1\"}";
+    const auto key = make_response_cache_key("/v3/tree_of_life/node_info", "opentree13.4", 0, args);
+    const auto stored = body('x');
+    cache.put(key, stored);
+    if (cache.get(key) != stored) {
+        std::cerr << "the stored body was not returned\n";
+        return 'F';
+    }
+    for (const auto & other : {make_response_cache_key("/v3/tree_of_life/node_info", "opentree14.9", 0, args),
+                               make_response_cache_key("/v3/tree_of_life/node_info", "opentree13.4", 1, args),
+                               make_response_cache_key("/v3/tree_of_life/mrca", "opentree13.4", 0, args)}) {
+        if (other == key or cache.get(other)) {
+            std::cerr << "hit for key \"" << other << "\"\n";
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+char test_clear(const TestHarness &) {
+    ResponseCache cache(1 << 20);
+    for (char c = 'a'; c <= 'z'; ++c) {
+        cache.put(std::string(1, c), body(c));
+    }
+    cache.clear();
+    auto stats = cache.get_stats();
+    if (stats.num_entries != 0 or stats.num_bytes != 0 or cache.get("a")) {
+        std::cerr << "entries = " << stats.num_entries << ", bytes = " << stats.num_bytes << " after clear()\n";
+        return 'F';
+    }
+    cache.put("a", body('a'));
+    if (not cache.enabled() or not cache.get("a")) {
+        std::cerr << "the cache does not work after clear()\n";
+        return 'F';
+    }
+    return '.';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests{TestFn{"lru eviction order", test_lru_eviction_order},
+                   TestFn{"keys by synth_id and taxonomy generation", test_keys_by_synth_id_and_taxonomy_generation},
+                   TestFn{"clear", test_clear}};
+    return th.run_tests(tests);
+}
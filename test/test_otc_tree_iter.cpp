@@ -1,6 +1,8 @@
 #include "otc/newick.h"
 #include "otc/util.h"
 #include "otc/test_harness.h"
+#include "otc/frozen_tree.h"
+#include <random>
 #include <sstream>
 using namespace otc;
 
@@ -13,6 +15,212 @@ inline std::string getNewick(const T *nd) {
 }
 
 typedef RootedTree<RTNodeNoData, RTreeNoData> Tree_t;
+
+class RTArenaTreeData{};
+namespace otc {
+template<>
+struct uses_node_arena<RTNodeNoData, RTArenaTreeData> : std::true_type {
+};
+}
+typedef RootedTree<RTNodeNoData, RTArenaTreeData> ArenaTree_t;
+
+class RTFrozenNodeData {
+    public:
+    std::uint32_t frozen_index = 0;
+};
+typedef RootedTree<RTFrozenNodeData, RTreeNoData> FrozenSrcTree_t;
+typedef FrozenSrcTree_t::node_type FrozenSrcNode_t;
+
+// The MRCA by marking the ancestors of nd1.
+inline const FrozenSrcNode_t * naive_mrca(const FrozenSrcNode_t * nd1, const FrozenSrcNode_t * nd2) {
+    std::set<const FrozenSrcNode_t *> anc;
+    for (auto nd = nd1; nd != nullptr; nd = nd->get_parent()) {
+        anc.insert(nd);
+    }
+    for (auto nd = nd2; nd != nullptr; nd = nd->get_parent()) {
+        if (anc.count(nd)) {
+            return nd;
+        }
+    }
+    return nullptr;
+}
+
+// Checks the FrozenTree traversals, ancestor tests, and MRCA against the pointer tree.
+char check_frozen_tree(FrozenSrcTree_t & tree, std::size_t num_random_pairs) {
+    FrozenTree<FrozenSrcTree_t> ft(tree);
+    std::vector<const FrozenSrcNode_t *> pre;
+    for (auto nd : iter_pre_const(tree)) {
+        pre.push_back(nd);
+    }
+    if (pre.size() != ft.size()) {
+        std::cerr << "FrozenTree size " << ft.size() << " != " << pre.size() << '\n';
+        return 'F';
+    }
+    auto index_or_none = [&](const FrozenSrcNode_t * nd) {
+        return nd == nullptr ? NO_FROZEN_NODE : ft.index_of(nd);
+    };
+    for (std::uint32_t i = 0; i < pre.size(); ++i) {
+        if (ft.get_first_child(i) != index_or_none(pre[i]->get_first_child())
+            or ft.get_next_sib(i) != index_or_none(pre[i]->get_next_sib())) {
+            std::cerr << "FrozenTree children of " << i << " are wrong\n";
+            return 'F';
+        }
+    }
+    std::vector<std::uint32_t> fpost;
+    for (auto fi : iter_post(ft, ft.get_root())) {
+        fpost.push_back(fi);
+    }
+    if (fpost.size() != pre.size()) {
+        std::cerr << "FrozenTree postorder has " << fpost.size() << " nodes\n";
+        return 'F';
+    }
+    std::size_t i = 0;
+    for (auto nd : iter_post_const(tree)) {
+        if (ft.get_node(fpost[i++]) != nd) {
+            std::cerr << "FrozenTree postorder differs at " << i << '\n';
+            return 'F';
+        }
+    }
+    auto check_pair = [&](std::uint32_t a, std::uint32_t b) {
+        auto expected = naive_mrca(pre[a], pre[b]);
+        if (ft.mrca(pre[a], pre[b]) != expected) {
+            std::cerr << "FrozenTree mrca(" << a << ", " << b << ") is wrong\n";
+            return false;
+        }
+        if (ft.is_ancestor_of(a, b) != (expected == pre[a])) {
+            std::cerr << "FrozenTree is_ancestor_of(" << a << ", " << b << ") is wrong\n";
+            return false;
+        }
+        return true;
+    };
+    const std::uint32_t n = ft.size();
+    if (num_random_pairs == 0) {
+        for (std::uint32_t a = 0; a < n; ++a) {
+            for (std::uint32_t b = 0; b < n; ++b) {
+                if (!check_pair(a, b)) {
+                    return 'F';
+                }
+            }
+        }
+    } else {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<std::uint32_t> dist(0, n - 1);
+        for (std::size_t k = 0; k < num_random_pairs; ++k) {
+            if (!check_pair(dist(rng), dist(rng))) {
+                return 'F';
+            }
+        }
+    }
+    return '.';
+}
+
+class TestFrozenTreeStruct {
+        const std::string filename;
+    public:
+        TestFrozenTreeStruct(const std::string & fn)
+            :filename(fn) {
+        }
+        char runTest(const TestHarness &h) const {
+            auto fp = h.get_filepath(filename);
+            std::ifstream inp;
+            if (!open_utf8_file(fp, inp)) {
+                return 'U';
+            }
+            ConstStrPtr filenamePtr = ConstStrPtr(new std::string(filename));
+            FilePosStruct pos(filenamePtr);
+            ParsingRules pr;
+            auto nt = read_next_newick<FrozenSrcTree_t>(inp, pos, pr);
+            return check_frozen_tree(*nt, 0);
+        }
+};
+
+// A random tree that is deep enough for MRCA queries to span many blocks of the depth index.
+char test_frozen_random_tree(const TestHarness &) {
+    std::mt19937 rng(11);
+    FrozenSrcTree_t tree;
+    std::vector<FrozenSrcNode_t *> nodes{tree.create_root()};
+    for (std::size_t i = 1; i < 5000; ++i) {
+        // bias toward recent nodes to get long paths.
+        std::uniform_int_distribution<std::size_t> dist(nodes.size() > 40 ? nodes.size() - 40 : 0, nodes.size() - 1);
+        auto par = nodes[(i % 10 == 0) ? rng() % nodes.size() : dist(rng)];
+        nodes.push_back(tree.create_child(par));
+    }
+    return check_frozen_tree(tree, 20000);
+}
+
+class RTIntervalNodeData {
+    public:
+    std::uint32_t trav_enter = 0;
+    std::uint32_t trav_exit = 0;
+};
+typedef RootedTree<RTIntervalNodeData, RTreeNoData> IntervalTree_t;
+typedef IntervalTree_t::node_type IntervalNode_t;
+
+// Adds leaves and moves subtrees at random, labeling them with assign_traversal_intervals
+//  (or relabeling the tree when it runs out of room), and checks the intervals against
+//  walks up the tree.
+char test_traversal_intervals(const TestHarness &) {
+    std::mt19937 rng(5);
+    IntervalTree_t tree;
+    std::vector<IntervalNode_t *> nodes{tree.create_root()};
+    for (std::size_t i = 1; i < 1000; ++i) {
+        nodes.push_back(tree.create_child(nodes[rng() % nodes.size()]));
+    }
+    compute_traversal_intervals(tree);
+    auto is_anc = [](const IntervalNode_t * a, const IntervalNode_t * b) {
+        for (; b != nullptr; b = b->get_parent()) {
+            if (a == b) {
+                return true;
+            }
+        }
+        return false;
+    };
+    for (int op = 0; op < 5000; ++op) {
+        IntervalNode_t * nd = nullptr;
+        if (rng() % 2) {
+            nd = tree.create_child(nodes[rng() % nodes.size()]);
+            nodes.push_back(nd);
+        } else {
+            nd = nodes[1 + rng() % (nodes.size() - 1)];
+            auto par = nodes[rng() % nodes.size()];
+            if (is_anc(nd, par) or nd->get_parent() == par) {
+                continue;
+            }
+            nd->get_parent()->remove_child(nd);
+            par->add_child(nd);
+        }
+        if (not assign_traversal_intervals(nd)) {
+            compute_traversal_intervals(tree);
+        }
+        for (int k = 0; k < 200; ++k) {
+            auto a = nodes[rng() % nodes.size()];
+            auto b = nodes[rng() % nodes.size()];
+            const auto e = b->get_data().trav_enter;
+            const bool in_interval = a->get_data().trav_enter <= e and e <= a->get_data().trav_exit;
+            if (in_interval != is_anc(a, b)) {
+                std::cerr << "interval containment disagrees with ancestry after operation " << op << '\n';
+                return 'F';
+            }
+        }
+    }
+    // A preorder walk of a tip's subtree is just the tip.
+    for (auto tip : nodes) {
+        if (tip->is_tip()) {
+            std::size_t n = 0;
+            for (auto nd : iter_pre_n(tip)) {
+                n += 1;
+                (void) nd;
+            }
+            if (n != 1) {
+                std::cerr << "iter_pre_n of a tip visited " << n << " nodes\n";
+                return 'F';
+            }
+        }
+    }
+    return '.';
+}
+
+template<typename Tree_t>
 class TestValidTreeStruct {
         const std::string filename;
     public:
@@ -90,13 +298,31 @@ int main(int argc, char *argv[]) {
     TestsVec tests;
     for (auto fn : validfilenames) {
         //const TestValidTreeStruct tvts(fn);
-        const TestValidTreeStruct tvts{fn};
+        const TestValidTreeStruct<Tree_t> tvts{fn};
         TestCallBack tcb = [tvts](const TestHarness &h) {
             return tvts.runTest(h);
         };
         const TestFn tf{fn, tcb};
         tests.push_back(tf);
     }
+    for (auto fn : validfilenames) {
+        const TestValidTreeStruct<ArenaTree_t> tvts{fn};
+        TestCallBack tcb = [tvts](const TestHarness &h) {
+            return tvts.runTest(h);
+        };
+        const TestFn tf{fn + " (arena)", tcb};
+        tests.push_back(tf);
+    }
+    for (auto fn : validfilenames) {
+        const TestFrozenTreeStruct tfts{fn};
+        TestCallBack tcb = [tfts](const TestHarness &h) {
+            return tfts.runTest(h);
+        };
+        const TestFn tf{fn + " (frozen)", tcb};
+        tests.push_back(tf);
+    }
+    tests.push_back(TestFn{"frozen random tree", test_frozen_random_tree});
+    tests.push_back(TestFn{"traversal intervals", test_traversal_intervals});
     return th.run_tests(tests);
 }
 
@@ -0,0 +1,92 @@
+#include "otc/test_harness.h"
+#include "otc/work_stealing_pool.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+using namespace otc;
+
+// Every item is visited exactly once, for sizes around the number of participants.
+char test_each_item_once(const TestHarness &) {
+    WorkStealingPool pool(3);
+    for (std::size_t n : {0, 1, 2, 3, 4, 5, 17, 1000, 100000}) {
+        std::vector<std::atomic<int> > visits(n);
+        pool.parallel_for(n, [&](std::size_t i) {
+            ++visits[i];
+        });
+        for (std::size_t i = 0; i < n; ++i) {
+            if (visits[i] != 1) {
+                std::cerr << "n = " << n << ": item " << i << " was visited " << visits[i] << " times\n";
+                return 'F';
+            }
+        }
+    }
+    return '.';
+}
+
+// The slow items are all at the front, so the other threads only finish early by stealing.
+char test_uneven_items(const TestHarness &) {
+    WorkStealingPool pool(3);
+    const std::size_t n = 400;
+    std::vector<std::atomic<int> > visits(n);
+    pool.parallel_for(n, [&](std::size_t i) {
+        if (i < n / 4) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        ++visits[i];
+    });
+    for (std::size_t i = 0; i < n; ++i) {
+        if (visits[i] != 1) {
+            std::cerr << "item " << i << " was visited " << visits[i] << " times\n";
+            return 'F';
+        }
+    }
+    return '.';
+}
+
+// Calls from several threads at once, and calls made from inside an item, all finish.
+char test_concurrent_and_nested_calls(const TestHarness &) {
+    WorkStealingPool pool(2);
+    std::atomic<std::size_t> total{0};
+    std::vector<std::thread> callers;
+    for (int c = 0; c < 4; ++c) {
+        callers.emplace_back([&] {
+            pool.parallel_for(10, [&](std::size_t) {
+                pool.parallel_for(100, [&](std::size_t i) {
+                    total += i;
+                });
+            });
+        });
+    }
+    for (auto & t : callers) {
+        t.join();
+    }
+    if (total != 4 * 10 * 4950) {
+        std::cerr << "total = " << total << '\n';
+        return 'F';
+    }
+    return '.';
+}
+
+char test_exception(const TestHarness &) {
+    WorkStealingPool pool(3);
+    try {
+        pool.parallel_for(1000, [&](std::size_t i) {
+            if (i == 500) {
+                throw std::runtime_error("item 500");
+            }
+        });
+    } catch (const std::runtime_error & e) {
+        return std::string(e.what()) == "item 500" ? '.' : 'F';
+    }
+    std::cerr << "The exception was not rethrown\n";
+    return 'F';
+}
+
+int main(int argc, char *argv[]) {
+    TestHarness th(argc, argv);
+    TestsVec tests{TestFn{"each item once", test_each_item_once},
+                   TestFn{"uneven items", test_uneven_items},
+                   TestFn{"concurrent and nested calls", test_concurrent_and_nested_calls},
+                   TestFn{"exception", test_exception}};
+    return th.run_tests(tests);
+}
@@ -1,5 +1,6 @@
 // See https://github.com/OpenTreeOfLife/opentree/wiki/Open-Tree-of-Life-APIs-v3#synthetic-tree
 #include <iostream>
+#include <thread>
 #include <tuple>
 #include <sstream>
 #include <cstring>
@@ -44,8 +45,12 @@ variables_map parse_cmd_line(int argc,char* argv[])  {
     reporting.add_options()
         ("ignore-monotypic,I",value<string>(),"Ignore monotypic nodes in summary")
         ;
+    options_description other("Other options");
+    other.add_options()
+        ("threads,j", value<int>(), "The number of input trees to map at once (default: the number of cores).")
+        ;
     options_description visible;
-    visible.add(otc::standard_options());
+    visible.add(other).add(otc::standard_options());
     // positional options
     positional_options_description p;
     p.add("synth", 1);
@@ -141,9 +146,7 @@ void set_support_blob_as_single_element(json& j, const map<string,Map<string,str
 }
 
 void add_element(map<string, Map<string, string>>& m, map<string, set<pair<string,string>>>& s,
-                 const Tree_t::node_type* synth_node, const Tree_t::node_type* input_node, const string& source) {
-    string synth = synth_node->get_name();
-    string node = get_source_node_name_if_available(input_node->get_name());
+                 const string& synth, const string& node, const string& source) {
     pair<string,string> x{source, node};
     if (not s[synth].count(x)) {
         s[synth].insert(x);
@@ -187,28 +190,25 @@ map<string, set<pair<string, string>>> terminal_set;
 int numErrors = 0;
 bool headerEmitted = false;
 
-void set_terminal(const Tree_t::node_type* synth_node, const Tree_t::node_type* input_node, const string& source) {
-    add_element(terminal, terminal_set, synth_node, input_node, source);
-}
-
-void set_supported_by(const Tree_t::node_type* synth_node, const Tree_t::node_type* input_node, const string& source) {
-    add_element(supported_by, supported_by_set, synth_node, input_node, source);
-}
-
-void set_partial_path_of(const Tree_t::node_type* synth_node, const Tree_t::node_type* input_node, const string& source) {
-    add_element(partial_path_of, partial_path_of_set, synth_node, input_node, source);
-}
-
-void set_conflicts_with(const Tree_t::node_type* synth_node, const Tree_t::node_type* input_node, const string& source) {
-    add_element(conflicts_with, conflicts_with_set, synth_node, input_node, source);
-}
+// A relation between a synth node and a node of an input tree, found by mapNextTree( ),
+//  to be added to the tables above (m and s).
+struct Element {
+    map<string, Map<string,string>>* m;
+    map<string, set<pair<string, string>>>* s;
+    string synth;
+    string node;
+};
 
-void set_resolved_by(const Tree_t::node_type* synth_node, const Tree_t::node_type* input_node, const string& source) {
-    add_element(resolved_by, resolved_by_set, synth_node, input_node, source);
-}
+// The relations found for one input tree, in the order in which they were found.
+struct MappedTree {
+    string source_name;
+    vector<Element> elements;
+};
 
-void set_resolves(const Tree_t::node_type* synth_node, const Tree_t::node_type* input_node, const string& source) {
-    add_element(resolves, resolves_set, synth_node, input_node, source);
+void add_elements(const MappedTree& mapped) {
+    for(auto& e: mapped.elements) {
+        add_element(*e.m, *e.s, e.synth, e.node, mapped.source_name);
+    }
 }
 
 json gen_json(const Tree_t& summaryTree, const map<string,string>& monotypic_nodes, bool ignore_monotypic) {
@@ -241,19 +241,25 @@ json gen_json(const Tree_t& summaryTree, const map<string,string>& monotypic_nod
     return document;
 }
 
+// Only reads summaryTree, so that input trees can be mapped onto it at the same time.
 void mapNextTree(const Tree_t& summaryTree,
                  const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
                  const Tree_t & tree,
-                 const string& source_name) {
+                 vector<Element>& elements) {
     typedef Tree_t::node_type node_type;
     std::function<const node_type*(const node_type*,const node_type*)> mrca_of_pair = [](const node_type* n1, const node_type* n2) {return mrca_from_depth(n1,n2);};
     auto ottid_to_node = get_ottid_to_const_node_map(tree);
+    auto logger = [&](map<string, Map<string,string>>& m, map<string, set<pair<string, string>>>& s) {
+        return [&elements, pm = &m, ps = &s](const node_t* synth_node, const node_t* input_node) {
+            elements.push_back({pm, ps, synth_node->get_name(), get_source_node_name_if_available(input_node->get_name())});
+        };
+    };
     {
-        auto log_supported_by    = [&](const node_t* node2, const node_t* node1) {set_supported_by(node2,node1,source_name);};
-        auto log_partial_path_of = [&](const node_t* node2, const node_t* node1) {set_partial_path_of(node2,node1,source_name);};
-        auto log_conflicts_with  = [&](const node_t* node2, const node_t* node1) {set_conflicts_with(node2,node1,source_name);};
-        auto log_resolved_by     = [&](const node_t* node2, const node_t* node1) {set_resolved_by(node2,node1,source_name);};
-        auto log_terminal        = [&](const node_t* node2, const node_t* node1) {set_terminal(node2,node1,source_name);};
+        auto log_supported_by    = logger(supported_by, supported_by_set);
+        auto log_partial_path_of = logger(partial_path_of, partial_path_of_set);
+        auto log_conflicts_with  = logger(conflicts_with, conflicts_with_set);
+        auto log_resolved_by     = logger(resolved_by, resolved_by_set);
+        auto log_terminal        = logger(terminal, terminal_set);
 
         perform_conflict_analysis(tree, ottid_to_node, mrca_of_pair,
                                   summaryTree, constSummaryOttIdToNode, mrca_of_pair,
@@ -264,10 +270,11 @@ void mapNextTree(const Tree_t& summaryTree,
                                   log_terminal);
     }
     {
+        auto log_resolves        = logger(resolves, resolves_set);
         auto log_supported_by    = [&](const node_t*, const node_t*) {};
         auto log_partial_path_of = [&](const node_t*, const node_t*) {};
         auto log_conflicts_with  = [&](const node_t*, const node_t*) {};
-        auto log_resolved_by     = [&](const node_t* node2, const node_t* node1) {set_resolves(node1,node2,source_name);};
+        auto log_resolved_by     = [&](const node_t* node2, const node_t* node1) {log_resolves(node1,node2);};
         auto log_terminal        = [&](const node_t*, const node_t*) {};
 
         perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, mrca_of_pair,
@@ -294,15 +301,26 @@ int main(int argc, char *argv[]) {
         auto monotypic_nodes = suppress_and_record_monotypic(*summaryTree);
         compute_depth(*summaryTree);
         // 2. Load and process input trees.
+        //    They are mapped in parallel, and their relations added to the tables in input order.
+        unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+        if (args.count("threads")) {
+            num_threads = unsigned(std::max(1, args["threads"].as<int>()));
+        }
+        WorkStealingPool pool(num_threads - 1);
         json sources;
-        for(const auto& filename: inputs) {
-            auto tree = get_tree<Tree_t>(filename);
+        auto map_input = [&](std::size_t i) {
+            auto tree = get_tree<Tree_t>(inputs[i]);
             compute_depth(*tree);
             compute_summary_leaves(*tree, summaryOttIdToNode);
-            string source_name = source_from_tree_name(tree->get_name());
-            mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, source_name);
-            sources.push_back(source_name);
-        }
+            MappedTree mapped;
+            mapped.source_name = source_from_tree_name(tree->get_name());
+            mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, mapped.elements);
+            return mapped;
+        };
+        analyze_in_parallel(pool, inputs.size(), map_input, [&](std::size_t, MappedTree&& mapped) {
+            add_elements(mapped);
+            sources.push_back(mapped.source_name);
+        });
         // 3. Generate json document and print it.
         auto document = gen_json(*summaryTree, monotypic_nodes, ignore_monotypic);
         document["sources"] = sources;
@@ -439,25 +439,34 @@ struct FindUnsupportedState : public TaxonomyDependentTreeProcessor<TreeMappedWi
                              const TreeMappedWithSplits & tree,
                              const std::set<const NodeWithSplits *> & expandedTips) {
         assert(toCheck != nullptr);
-        std::map<const NodeWithSplits *, OttIdSet > restrictedDesIds;
         if (inTheProcessOfAnalyzingTax) {
             identifySupportedNodesTaxo(tree);
         } else {
-            for (auto nd : iter_leaf_const(tree)) {
-                auto ottId = nd->get_ott_id();
-                mark_path_to_root(*toCheck, ottId, restrictedDesIds);
+            // With the leaves numbered in postorder, each clade of `tree` is an interval of
+            //  leaf numbers, so a node of toCheck pruned to these leaves is found by its span.
+            const LeafIndex leaves = postorder_leaf_index(tree);
+            for (std::size_t i = 0; i < leaves.size(); ++i) {
+                const auto ottId = leaves.ott_id_at(i);
+                if (toCheck->get_data().get_node_by_ott_id(ottId) == nullptr) {
+                    std::string m = "OTT id not found ";
+                    m += std::to_string(ottId);
+                    throw OTCError(m);
+                }
             }
-            identifySupportedNodes(otCLI, tree, restrictedDesIds, expandedTips);
+            const auto restrictedSpans = induced_leaf_spans(*toCheck, leaves);
+            identifySupportedNodes(otCLI, tree, leaves, restrictedSpans, expandedTips);
         }
         return true;
     }
 
     void identifySupportedNodes(OTCLI & otCLI,
                                 const TreeMappedWithSplits & tree,
-                                const std::map<const NodeWithSplits *, OttIdSet > & inducedNdToEffDesId,
+                                const LeafIndex & leaves,
+                                const std::map<const NodeWithSplits *, LeafSpan> & inducedNdToSpan,
                                 const std::set<const NodeWithSplits *> & expandedTips) {
-        for (auto pd : inducedNdToEffDesId) {
-            checkNodeForSupport(otCLI, pd.first, pd.second, tree, inducedNdToEffDesId, expandedTips);
+        const auto srcNodeByInterval = nodes_by_leaf_interval(tree, leaves);
+        for (const auto & pd : inducedNdToSpan) {
+            checkNodeForSupport(otCLI, pd.first, pd.second, tree, leaves, inducedNdToSpan, srcNodeByInterval, expandedTips);
         }
     }
     void identifySupportedNodesTaxo(const TreeMappedWithSplits & tree) {
@@ -499,9 +508,11 @@ struct FindUnsupportedState : public TaxonomyDependentTreeProcessor<TreeMappedWi
 
     void checkNodeForSupport(OTCLI & otCLI,
                              const NodeWithSplits *nd,
-                             const OttIdSet & nm,
+                             const LeafSpan & nm,
                              const TreeMappedWithSplits & tree,
-                             const std::map<const NodeWithSplits *, OttIdSet > & inducedNdToEffDesId,
+                             const LeafIndex & leaves,
+                             const std::map<const NodeWithSplits *, LeafSpan> & inducedNdToSpan,
+                             const std::unordered_map<std::uint64_t, const NodeWithSplits *> & srcNodeByInterval,
                              const std::set<const NodeWithSplits *> & expandedTips) {
         auto par = nd->get_parent();
         if (par == nullptr) {
@@ -511,30 +522,40 @@ struct FindUnsupportedState : public TaxonomyDependentTreeProcessor<TreeMappedWi
         if (firstBranchingAnc == nullptr) {
             return;
         }
-        auto ancIt = inducedNdToEffDesId.find(firstBranchingAnc);
-        assert(ancIt != inducedNdToEffDesId.end());
-        const auto & anm = ancIt->second;
+        auto ancIt = inducedNdToSpan.find(firstBranchingAnc);
+        assert(ancIt != inducedNdToSpan.end());
         const NodeWithSplits * firstNdPtr; // just used to match call
-        if (!multiple_children_in_map(*nd, inducedNdToEffDesId, &firstNdPtr)) {
+        if (!multiple_children_in_map(*nd, inducedNdToSpan, &firstNdPtr)) {
             return;
         }
-        if (anm == nm) {
+        // The ancestor's leaves include nd's, so they are the same set iff there are as many.
+        if (ancIt->second.count == nm.count) {
             return;
         }
-        auto srcNode = find_node_with_matching_des_ids(tree, nm);
-        if (srcNode != nullptr) {
-            if (aPrioriProblemNodes.find(nd) != aPrioriProblemNodes.end()) {
-                auto apIt = aPrioriProblemNodes.find(nd);
-                otCLI.out << "ERROR!: a priori unsupported node found. Designators were ";
-                write_ott_id_set(otCLI.out, "", apIt->second, " ");
-                otCLI.out << ". A node was found, which (when pruned to the leaf set of an input tree) contained:\n";
-                write_ott_id_set(otCLI.out, "    ", nm, " ");
-                otCLI.out << "\nThe subtree from the source was: ";
-                write_pruned_subtree_newick_for_marked_nodes(otCLI.out, *srcNode, inducedNdToEffDesId);
-                numErrors += 1;
-            }
-            recordInputTreeSupportForNode(nd, srcNode, tree, expandedTips);
+        if (!nm.is_interval()) {
+            return;
+        }
+        auto srcIt = srcNodeByInterval.find(nm.interval_key());
+        if (srcIt == srcNodeByInterval.end()) {
+            return;
         }
+        auto srcNode = srcIt->second;
+        if (aPrioriProblemNodes.find(nd) != aPrioriProblemNodes.end()) {
+            // The leaf sets themselves are only needed for the report.
+            std::map<const NodeWithSplits *, OttIdSet > inducedNdToEffDesId;
+            for (std::size_t i = 0; i < leaves.size(); ++i) {
+                mark_path_to_root(*toCheck, leaves.ott_id_at(i), inducedNdToEffDesId);
+            }
+            auto apIt = aPrioriProblemNodes.find(nd);
+            otCLI.out << "ERROR!: a priori unsupported node found. Designators were ";
+            write_ott_id_set(otCLI.out, "", apIt->second, " ");
+            otCLI.out << ". A node was found, which (when pruned to the leaf set of an input tree) contained:\n";
+            write_ott_id_set(otCLI.out, "    ", inducedNdToEffDesId.at(nd), " ");
+            otCLI.out << "\nThe subtree from the source was: ";
+            write_pruned_subtree_newick_for_marked_nodes(otCLI.out, *srcNode, inducedNdToEffDesId);
+            numErrors += 1;
+        }
+        recordInputTreeSupportForNode(nd, srcNode, tree, expandedTips);
     }
 
     bool treeHasClade(const TreeMappedWithSplits & tree, const OttIdSet & oids) {
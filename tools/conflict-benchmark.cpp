@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "otc/conflict.h"
+#include "otc/otcli.h"
+#include "otc/tree_operations.h"
+
+using namespace otc;
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+
+namespace po = boost::program_options;
+using po::variables_map;
+
+// Counts the calls to operator new, so that we can report how many allocations
+//  perform_conflict_analysis( ) makes.
+static std::atomic<std::size_t> num_allocations{0};
+
+void * operator new(std::size_t n) {
+    ++num_allocations;
+    if (void * p = std::malloc(n ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept {
+    std::free(p);
+}
+
+using Tree_t = ConflictTree;
+using node_t = Tree_t::node_type;
+
+variables_map parse_cmd_line(int argc,char* argv[]) {
+    using namespace po;
+    // named options
+    options_description invisible("Invisible options");
+    invisible.add_options()
+        ("reference", value<string>(),"Filename for the reference tree")
+        ("input", value<vector<string>>()->composing(),"Filename for input trees")
+        ;
+
+    options_description benchmark("Benchmark options");
+    benchmark.add_options()
+        ("tips,n",value<int>()->default_value(50000),"Number of tips in the synthetic pair of trees (0 to skip it)")
+        ("swaps",value<int>()->default_value(200),"Number of pairs of tips whose labels are swapped in the synthetic input tree")
+        ("collapse",value<double>()->default_value(0.2),"Fraction of the internal nodes of the synthetic input tree that are collapsed")
+        ("repeats,r",value<int>()->default_value(3),"Number of times to analyze each pair (the fastest is reported)")
+        ("seed",value<unsigned>()->default_value(1),"Seed for the synthetic pair of trees")
+        ;
+
+    options_description visible;
+    visible.add(benchmark).add(otc::standard_options());
+
+    // positional options
+    positional_options_description p;
+    p.add("reference", 1);
+    p.add("input", -1);
+
+    variables_map vm = otc::parse_cmd_line_standard(argc, argv,
+                                                    "Usage: otc-conflict-benchmark [<reference tree> <input tree1> <input tree2> ...] [OPTIONS]\n"
+                                                    "Time perform_conflict_analysis( ) on each input tree against the reference tree, in both\n"
+                                                    "directions as otc-annotate-synth and otc-conflict-stats do, and on a synthetic pair of large trees.",
+                                                    visible, invisible, p);
+
+    return vm;
+}
+
+// A random tree on the given tips, made by joining random pairs of subtrees until one is left.
+// The shape only depends on the number of tips and the seed, so that two trees made from the
+//  same seed only differ where their tips are labeled differently.
+unique_ptr<Tree_t> random_tree(const vector<OttId> & tip_ids, unsigned seed) {
+    std::mt19937 rng(seed);
+    unique_ptr<Tree_t> tree(new Tree_t());
+    vector<node_t *> subtrees;
+    for (auto id : tip_ids) {
+        auto nd = tree->create_node(nullptr);
+        nd->set_ott_id(id);
+        nd->set_name("ott" + std::to_string(id));
+        subtrees.push_back(nd);
+    }
+    while (subtrees.size() > 1) {
+        std::size_t i = std::uniform_int_distribution<std::size_t>(0, subtrees.size() - 1)(rng);
+        std::swap(subtrees[i], subtrees.back());
+        auto first = subtrees.back();
+        subtrees.pop_back();
+        std::size_t j = std::uniform_int_distribution<std::size_t>(0, subtrees.size() - 1)(rng);
+        auto p = tree->create_node(nullptr);
+        p->add_child(first);
+        p->add_child(subtrees[j]);
+        subtrees[j] = p;
+    }
+    tree->_set_root(subtrees.front());
+    return tree;
+}
+
+// The reference tree, and an input tree with the same shape but some tips swapped (which
+//  makes conflicting nodes) and some internal nodes collapsed (which makes resolved ones).
+std::pair<unique_ptr<Tree_t>, unique_ptr<Tree_t>> synthetic_pair(int num_tips, int num_swaps, double collapse, unsigned seed) {
+    vector<OttId> ids(num_tips);
+    for (int i = 0; i < num_tips; i++) {
+        ids[i] = i + 1;
+    }
+    auto reference = random_tree(ids, seed);
+    std::mt19937 rng(seed + 1);
+    std::uniform_int_distribution<int> pick(0, num_tips - 1);
+    for (int k = 0; k < num_swaps; k++) {
+        std::swap(ids[pick(rng)], ids[pick(rng)]);
+    }
+    auto input = random_tree(ids, seed);
+    std::bernoulli_distribution collapse_this(collapse);
+    vector<node_t *> internal;
+    for (auto nd : iter_post(*input)) {
+        if (nd->has_children() and nd != input->get_root() and collapse_this(rng)) {
+            internal.push_back(nd);
+        }
+    }
+    for (auto nd : internal) {
+        collapse_internal_into_par(nd, *input);
+    }
+    reference->set_name("synthetic-reference");
+    input->set_name("synthetic-input");
+    return {std::move(reference), std::move(input)};
+}
+
+struct Counts {
+    std::size_t supported_by = 0;
+    std::size_t partial_path_of = 0;
+    std::size_t conflicts_with = 0;
+    std::size_t resolved_by = 0;
+    std::size_t terminal = 0;
+};
+
+struct Timing {
+    double ms = 0;
+    std::size_t allocations = 0;
+};
+
+// Analyzes tree1 against tree2, timing only perform_conflict_analysis( ) on the induced trees.
+Timing time_analysis(Tree_t & tree1, Tree_t & tree2, Counts & counts) {
+    std::function<node_t*(node_t*,node_t*)> mrca_of_pair = [](node_t* n1, node_t* n2) {return mrca_from_depth(n1,n2);};
+    auto ottid_to_node1 = get_ottid_to_node_map(tree1);
+    auto ottid_to_node2 = get_ottid_to_node_map(tree2);
+    auto induced_tree1 = get_induced_tree<Tree_t>(tree1, ottid_to_node1, mrca_of_pair, tree2, ottid_to_node2);
+    auto induced_tree2 = get_induced_tree<Tree_t>(tree2, ottid_to_node2, mrca_of_pair, tree1, ottid_to_node1);
+    if (count_leaves(*induced_tree1) < 2) {
+        return {};
+    }
+    counts = Counts();
+    auto log_supported_by    = [&counts](const node_t*, const node_t*) {counts.supported_by++;};
+    auto log_partial_path_of = [&counts](const node_t*, const node_t*) {counts.partial_path_of++;};
+    auto log_conflicts_with  = [&counts](const node_t*, const node_t*) {counts.conflicts_with++;};
+    auto log_resolved_by     = [&counts](const node_t*, const node_t*) {counts.resolved_by++;};
+    auto log_terminal        = [&counts](const node_t*, const node_t*) {counts.terminal++;};
+
+    const auto allocations_before = num_allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    perform_conflict_analysis(*induced_tree1, *induced_tree2,
+                              log_supported_by,
+                              log_partial_path_of,
+                              log_conflicts_with,
+                              log_resolved_by,
+                              log_terminal);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return {elapsed.count(), num_allocations.load() - allocations_before};
+}
+
+static bool header_written = false;
+
+void benchmark_pair(Tree_t & tree1, Tree_t & tree2, int repeats) {
+    compute_depth(tree1);
+    compute_depth(tree2);
+    Counts counts;
+    Timing best;
+    for (int r = 0; r < repeats; r++) {
+        auto t = time_analysis(tree1, tree2, counts);
+        if (r == 0 or t.ms < best.ms) {
+            best = t;
+        }
+    }
+    if (not header_written) {
+        std::cout << "tips1\ttips2\tms\tallocations\tsupported_by\tpartial_path_of\tconflicts_with\tresolved_by\tterminal\ttree1\ttree2\n";
+        header_written = true;
+    }
+    std::cout << count_leaves(tree1) << '\t' << count_leaves(tree2) << '\t'
+              << best.ms << '\t' << best.allocations << '\t'
+              << counts.supported_by << '\t' << counts.partial_path_of << '\t' << counts.conflicts_with << '\t'
+              << counts.resolved_by << '\t' << counts.terminal << '\t'
+              << tree1.get_name() << '\t' << tree2.get_name() << '\n';
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        variables_map args = parse_cmd_line(argc,argv);
+        const int repeats = std::max(1, args["repeats"].as<int>());
+        if (args.count("reference")) {
+            auto reference = get_tree<Tree_t>(args["reference"].as<string>());
+            vector<string> inputs;
+            if (args.count("input")) {
+                inputs = args["input"].as<vector<string>>();
+            }
+            for (const auto & filename : inputs) {
+                auto input = get_tree<Tree_t>(filename);
+                benchmark_pair(*input, *reference, repeats);
+                benchmark_pair(*reference, *input, repeats);
+            }
+        }
+        const int num_tips = args["tips"].as<int>();
+        if (num_tips > 1) {
+            auto [reference, input] = synthetic_pair(num_tips,
+                                                     args["swaps"].as<int>(),
+                                                     args["collapse"].as<double>(),
+                                                     args["seed"].as<unsigned>());
+            benchmark_pair(*input, *reference, repeats);
+            benchmark_pair(*reference, *input, repeats);
+        }
+    } catch (std::exception& e) {
+        std::cerr << "otc-conflict-benchmark: Error! " << e.what() << std::endl;
+        exit(1);
+    }
+}
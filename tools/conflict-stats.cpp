@@ -1,5 +1,6 @@
 // See https://github.com/OpenTreeOfLife/opentree/wiki/Open-Tree-of-Life-APIs-v3#synthetic-tree
 #include <iostream>
+#include <thread>
 #include <tuple>
 #include <sstream>
 #include <cstring>
@@ -48,8 +49,13 @@ variables_map parse_cmd_line(int argc,char* argv[])
         ("names,N","Write out node names instead of counts.")
         ;
 
+    options_description other("Other options");
+    other.add_options()
+        ("threads,j", value<int>(), "The number of input trees to map at once (default: the number of cores).")
+        ;
+
     options_description visible;
-    visible.add(reporting).add(otc::standard_options());
+    visible.add(reporting).add(other).add(otc::standard_options());
 
     // positional options
     positional_options_description p;
@@ -134,10 +140,20 @@ struct stats
     set<pair<string,string>> resolved_by;
 };
 
+// One of the relations counted in stats.
+using Relation = set<pair<string,string>> stats::*;
+
+// An input node (or a synth node, with --switch) found to be in a relation by mapNextTree( ).
+struct Element {
+    Relation relation;
+    pair<string,string> x;
+};
+
 int numErrors = 0;
 bool headerEmitted = false;
 
-void add_element(set<pair<string, string>>& s,
+void add_element(vector<Element>& elements,
+                 Relation relation,
                  const Tree_t::node_type*,
                  const Tree_t::node_type* input_node,
                  const string& source) {
@@ -146,23 +162,29 @@ void add_element(set<pair<string, string>>& s,
         return;
     }
     string node = get_source_node_name_if_available(input_node);
-    s.insert({source, node});
+    elements.push_back({relation, {source, node}});
+}
+
+void add_elements(stats& s, const vector<Element>& elements) {
+    for(auto& e: elements) {
+        (s.*e.relation).insert(e.x);
+    }
 }
 
 void mapNextTree1(const Tree_t& summaryTree,
                   const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
                   const Tree_t & tree,
-                  stats& s) {
+                  vector<Element>& e) {
     typedef Tree_t::node_type node_type;
     std::function<const node_type*(const node_type*,const node_type*)> mrca_of_pair = [](const node_type* n1, const node_type* n2) {return mrca_from_depth(n1,n2);};
     string source_name = source_from_tree_name(tree.get_name());
     auto ottid_to_node = get_ottid_to_const_node_map(tree);
     {
-        auto log_supported_by    = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.supported_by,node2,node1,source_name);};
-        auto log_partial_path_of = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.partial_path_of,node2,node1,source_name);};
-        auto log_conflicts_with  = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.conflicts_with,node2,node1,source_name);};
-        auto log_resolved_by     = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.resolved_by,node2,node1,source_name);};
-        auto log_terminal        = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.terminal,node2,node1,source_name);};
+        auto log_supported_by    = [&source_name,&e](const node_t* node2, const node_t* node1) {add_element(e,&stats::supported_by,node2,node1,source_name);};
+        auto log_partial_path_of = [&source_name,&e](const node_t* node2, const node_t* node1) {add_element(e,&stats::partial_path_of,node2,node1,source_name);};
+        auto log_conflicts_with  = [&source_name,&e](const node_t* node2, const node_t* node1) {add_element(e,&stats::conflicts_with,node2,node1,source_name);};
+        auto log_resolved_by     = [&source_name,&e](const node_t* node2, const node_t* node1) {add_element(e,&stats::resolved_by,node2,node1,source_name);};
+        auto log_terminal        = [&source_name,&e](const node_t* node2, const node_t* node1) {add_element(e,&stats::terminal,node2,node1,source_name);};
 
         perform_conflict_analysis(tree, ottid_to_node, mrca_of_pair,
                                   summaryTree, constSummaryOttIdToNode, mrca_of_pair,
@@ -174,7 +196,7 @@ void mapNextTree1(const Tree_t& summaryTree,
     }
     {
         auto nothing    = [](const node_t*, const node_t*) {};
-        auto log_resolved_by     = [&source_name,&s](const node_t* node2, const node_t* node1) {add_element(s.resolves,node1,node2,source_name);};
+        auto log_resolved_by     = [&source_name,&e](const node_t* node2, const node_t* node1) {add_element(e,&stats::resolves,node1,node2,source_name);};
 
         perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, mrca_of_pair,
                                   tree, ottid_to_node, mrca_of_pair,
@@ -189,17 +211,17 @@ void mapNextTree1(const Tree_t& summaryTree,
 void mapNextTree2(const Tree_t& summaryTree,
                   const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
                   const Tree_t & tree,
-                  stats& s) {
+                  vector<Element>& e) {
     typedef Tree_t::node_type node_type;
     std::function<const node_type*(const node_type*,const node_type*)> mrca_of_pair = [](const node_type* n1, const node_type* n2) {return mrca_from_depth(n1,n2);};
     string source_name = source_from_tree_name(summaryTree.get_name());
     auto ottid_to_node = get_ottid_to_const_node_map(tree);
     {
-        auto log_supported_by    = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.supported_by,node2,node1,source_name);};
-        auto log_partial_path_of = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.partial_path_of,node2,node1,source_name);};
-        auto log_conflicts_with  = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.conflicts_with,node2,node1,source_name);};
-        auto log_resolved_by     = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.resolved_by,node2,node1,source_name);};
-        auto log_terminal        = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.terminal,node2,node1,source_name);};
+        auto log_supported_by    = [&source_name,&e](const node_t* node1, const node_t* node2) {add_element(e,&stats::supported_by,node2,node1,source_name);};
+        auto log_partial_path_of = [&source_name,&e](const node_t* node1, const node_t* node2) {add_element(e,&stats::partial_path_of,node2,node1,source_name);};
+        auto log_conflicts_with  = [&source_name,&e](const node_t* node1, const node_t* node2) {add_element(e,&stats::conflicts_with,node2,node1,source_name);};
+        auto log_resolved_by     = [&source_name,&e](const node_t* node1, const node_t* node2) {add_element(e,&stats::resolved_by,node2,node1,source_name);};
+        auto log_terminal        = [&source_name,&e](const node_t* node1, const node_t* node2) {add_element(e,&stats::terminal,node2,node1,source_name);};
 
         perform_conflict_analysis(tree, ottid_to_node, mrca_of_pair,
                                   summaryTree, constSummaryOttIdToNode, mrca_of_pair,
@@ -211,7 +233,7 @@ void mapNextTree2(const Tree_t& summaryTree,
     }
     {
         auto nothing    = [](const node_t*, const node_t*) {};
-        auto log_resolved_by     = [&source_name,&s](const node_t* node1, const node_t* node2) {add_element(s.resolves,node1,node2,source_name);};
+        auto log_resolved_by     = [&source_name,&e](const node_t* node1, const node_t* node2) {add_element(e,&stats::resolves,node1,node2,source_name);};
         perform_conflict_analysis(summaryTree, constSummaryOttIdToNode, mrca_of_pair,
                                   tree, ottid_to_node, mrca_of_pair,
                                   nothing,
@@ -222,15 +244,16 @@ void mapNextTree2(const Tree_t& summaryTree,
     }
 }
 
+// Only reads summaryTree, so that input trees can be mapped onto it at the same time.
 void mapNextTree(const Tree_t& summaryTree,
                  const map<OttId, const Tree_t::node_type*>& constSummaryOttIdToNode,
                  const Tree_t & tree,
-                 stats& s, //isTaxoComp is third param
+                 vector<Element>& e, //isTaxoComp is third param
                  bool sw) {
     if (not sw) {
-        mapNextTree1(summaryTree, constSummaryOttIdToNode, tree, s);
+        mapNextTree1(summaryTree, constSummaryOttIdToNode, tree, e);
     } else {
-        mapNextTree2(summaryTree, constSummaryOttIdToNode, tree, s);
+        mapNextTree2(summaryTree, constSummaryOttIdToNode, tree, e);
     }
 }
 
@@ -283,24 +306,42 @@ int main(int argc, char *argv[]) {
         if (not names) {
             show_header(std::cout);
         }
-        for(const auto& filename: inputs) {
-            auto tree = get_tree<Tree_t>(filename);
+        //    They are mapped in parallel, and their results merged in input order.
+        unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+        if (args.count("threads")) {
+            num_threads = unsigned(std::max(1, args["threads"].as<int>()));
+        }
+        WorkStealingPool pool(num_threads - 1);
+        struct MappedTree {
+            vector<Element> elements;
+            string each_output;
+        };
+        auto map_input = [&](std::size_t i) {
+            auto tree = get_tree<Tree_t>(inputs[i]);
             compute_depth(*tree);
             compute_summary_leaves(*tree, summaryOttIdToNode);
             string source_name = source_from_tree_name(tree->get_name());
-            if (all) {
-                mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, global, sw);
-            }
+            MappedTree mapped;
+            mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, mapped.elements, sw);
             if (each) {
                 stats local;
-                mapNextTree(*summaryTree, constSummaryOttIdToNode, *tree, local, sw);
+                add_elements(local, mapped.elements);
+                std::ostringstream out;
                 if (names) {
-                    show_names(std::cout, local, source_name);
+                    show_names(out, local, source_name);
                 } else {
-                    show_stats(std::cout, local, source_name);
+                    show_stats(out, local, source_name);
                 }
+                mapped.each_output = out.str();
             }
-        }
+            return mapped;
+        };
+        analyze_in_parallel(pool, inputs.size(), map_input, [&](std::size_t, MappedTree&& mapped) {
+            if (all) {
+                add_elements(global, mapped.elements);
+            }
+            std::cout << mapped.each_output;
+        });
         // 3. Write out the stats
         if (all and names) {
             show_names(std::cout, global, "ALL");
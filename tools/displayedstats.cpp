@@ -4,6 +4,7 @@
 #include <sstream>
 #include <cstring>
 #include <unordered_map>
+#include <optional>
 
 using namespace otc;
 
@@ -54,11 +55,28 @@ inline NDSE operator|(NDSE f, NDSB s) {
     return static_cast<NDSE>(static_cast<int>(f) | static_cast<int>(s));
 }
 
+// The leaf sets of an input tree's nodes and of the summary tree's nodes, restricted to
+//  the input tree's leaves. The leaves are numbered in the summary tree's postorder, so
+//  that the leaves of each summary node are an interval (see LeafSpan). Not used for
+//  comparisons with the taxonomy.
+struct InducedLeafSets {
+    const LeafIndex & leaves;
+    const LeafBitset & of_input_node;
+    const LeafSpan & input_node_span;
+    const std::map<const NodeWithSplits *, LeafSpan> & of_summary_node;
+
+    LeafSpan summary_span(const NodeWithSplits * nd) const {
+        auto it = of_summary_node.find(nd);
+        return (it == of_summary_node.end() ? LeafSpan{} : it->second);
+    }
+};
+
 std::pair<NDSE, const NodeWithSplits *>
 classifyInpNode(const TreeMappedWithSplits & summaryTree,
                      const NodeWithSplits * nd,
                      const OttIdSet & leaf_set,
                      const NodeWithSplits * startSummaryNd,
+                     const InducedLeafSets * induced,
                      bool isTaxoComp=false);
 
 std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
@@ -73,6 +91,7 @@ classifyInpNode(const TreeMappedWithSplits & summaryTree,
                      const NodeWithSplits * nd,
                      const OttIdSet & leaf_set,
                      const NodeWithSplits * startSummaryNd,
+                     const InducedLeafSets * induced,
                      bool isTaxoComp) {
     using CN = std::pair<NDSE, const NodeWithSplits *>;
     const auto & ndi = nd->get_data().des_ids;
@@ -149,18 +168,21 @@ classifyInpNode(const TreeMappedWithSplits & summaryTree,
             }
         }
     } else {
+        // Only the input tree's leaves matter, and the summary node's are an interval.
+        assert(induced != nullptr);
+        const LeafBitset & ndBits = induced->of_input_node;
+        const LeafSpan & ndSpan = induced->input_node_span;
         for (;;) {
-            const auto & sumdi = rn->get_data().des_ids;
-            const auto extra = set_difference_as_set(sumdi, ndi);
-            if (is_subset(ndi, sumdi)) {
-                if (are_disjoint(extra, leaf_set)) {
+            const LeafSpan sumSpan = induced->summary_span(rn);
+            const bool noExtra = (sumSpan.count == 0 || ndBits.all_in_range(sumSpan.first, sumSpan.last));
+            if (sumSpan.count > 0 && sumSpan.first <= ndSpan.first && ndSpan.last <= sumSpan.last) {
+                if (noExtra) {
                     if (nd->is_outdegree_one_node()) {
                         return CN{NDSE::REDUNDANT_DISPLAYED, rn};
                     }
                     return CN{NDSE::FORKING_DISPLAYED, rn};
                 }
-                const auto exc = set_difference_as_set(leaf_set, ndi);
-                if (can_be_resolved_to_display_inc_exc_group(rn, ndi, exc)) {
+                if (can_be_resolved_to_display_inc_exc_group(rn, ndBits, induced->of_summary_node)) {
                     if (nd->is_outdegree_one_node()) {
                         return CN{NDSE::REDUNDANT_COULD_RESOLVE, rn};
                     }
@@ -168,12 +190,18 @@ classifyInpNode(const TreeMappedWithSplits & summaryTree,
                 }
                 break; // incompatible
             }
-            if (!are_disjoint(extra, leaf_set)) {
+            if (!noExtra) {
                 break; // incompatible
             }
             rn = rn->get_parent();
             if (rn == nullptr) {
-                const auto z = set_difference_as_set(ndi, sumdi);
+                OttIdSet z;
+                for (auto id : ndBits.to_ott_id_set(induced->leaves)) {
+                    const auto i = static_cast<std::size_t>(induced->leaves.index_of(id));
+                    if (sumSpan.count == 0 || i < sumSpan.first || i > sumSpan.last) {
+                        z.insert(id);
+                    }
+                }
                 auto x = *z.begin();
                 std::string m = "OTT id not found ";
                 m += std::to_string(x);
@@ -199,6 +227,7 @@ std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
                                        std::map<const NodeWithSplits *, NDSE> * node2Classification,
                                        std::unordered_multimap<string,string> * support,
                                        std::unordered_multimap<string,string> * conflict,
+                                       const std::unordered_map<OttId, std::size_t> & summaryPostorder,
                                        bool isTaxoComp);
 
 std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
@@ -206,6 +235,7 @@ std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
                                        std::map<const NodeWithSplits *, NDSE> * node2Classification,
                                        std::unordered_multimap<string,string> * support,
                                        std::unordered_multimap<string,string> * conflict,
+                                       const std::unordered_map<OttId, std::size_t> & summaryPostorder,
                                        bool isTaxoComp) {
     std::map<NDSE, std::size_t> r;
     if (inpTree.get_root() == nullptr) {
@@ -215,8 +245,38 @@ std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
     std::map<const NodeWithSplits *, NDSE> & nd2t{node2Classification == nullptr ? localNd2C : *node2Classification};
     std::map<const NodeWithSplits *, const NodeWithSplits *> nd2summaryTree;
     const auto & treeLeafSet = inpTree.get_root()->get_data().des_ids;
+    // The restricted leaf sets (the taxonomy is compared by des_ids).
+    std::optional<LeafIndex> inpLeaves;
+    std::map<const NodeWithSplits *, LeafSpan> summarySpans;
+    std::map<const NodeWithSplits *, std::pair<LeafBitset, LeafSpan> > inpSets; // only until the parent is visited
+    if (!isTaxoComp) {
+        std::vector<OttId> ids(treeLeafSet.begin(), treeLeafSet.end());
+        auto rank = [&](OttId id) {
+            auto it = summaryPostorder.find(id);
+            return (it == summaryPostorder.end() ? summaryPostorder.size() : it->second);
+        };
+        std::stable_sort(ids.begin(), ids.end(), [&](OttId a, OttId b) { return rank(a) < rank(b); });
+        inpLeaves.emplace(std::move(ids));
+        summarySpans = induced_leaf_spans(summaryTree, *inpLeaves);
+    }
     for (auto nd : iter_post_const(inpTree)) {
         NDSE t = NDSE::END_VALUE;
+        LeafBitset ndBits;
+        LeafSpan ndSpan;
+        if (inpLeaves) {
+            ndBits = LeafBitset(*inpLeaves);
+            if (nd->is_tip()) {
+                const auto i = static_cast<std::size_t>(inpLeaves->index_of(nd->get_ott_id()));
+                ndBits.set(i);
+                ndSpan.add(i);
+            }
+            for (auto c : iter_child_const(*nd)) {
+                auto cIt = inpSets.find(c);
+                ndBits |= cIt->second.first;
+                ndSpan.add(cIt->second.second);
+                inpSets.erase(cIt);
+            }
+        }
         if (nd->is_tip()) {
             if (nd->get_parent() != nullptr) {
                 t = NDSE::LEAF_NODE;
@@ -253,7 +313,13 @@ std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
                     break;
                 }
             }
-            auto p = classifyInpNode(summaryTree, nd, treeLeafSet, startSummaryNd, isTaxoComp);
+            std::pair<NDSE, const NodeWithSplits *> p;
+            if (isTaxoComp) {
+                p = classifyInpNode(summaryTree, nd, treeLeafSet, startSummaryNd, nullptr, true);
+            } else {
+                const InducedLeafSets induced{*inpLeaves, ndBits, ndSpan, summarySpans};
+                p = classifyInpNode(summaryTree, nd, treeLeafSet, startSummaryNd, &induced, false);
+            }
             t = p.first;
             if (p.second != nullptr) {
                 nd2summaryTree[nd] = p.second;
@@ -285,6 +351,9 @@ std::map<NDSE, std::size_t> doStatCalc(const TreeMappedWithSplits & summaryTree,
         assert(t != END_VALUE);
         r[t] += 1;
         nd2t[nd] = t;
+        if (inpLeaves) {
+            inpSets.emplace(nd, std::make_pair(std::move(ndBits), ndSpan));
+        }
     }
     return r;
 }
@@ -350,6 +419,7 @@ void writeRow(std::ostream &out,
 
 struct DisplayedStatsState : public TaxonomyDependentTreeProcessor<TreeMappedWithSplits> {
     std::unique_ptr<TreeMappedWithSplits> summaryTree;
+    std::unordered_map<OttId, std::size_t> summaryPostorder; // the postorder rank of each OTT id in summaryTree
     std::map<NDSE, std::size_t> totals;
     std::unordered_multimap<string,string> support;
     std::unordered_multimap<string,string> conflict;
@@ -435,7 +505,7 @@ struct DisplayedStatsState : public TaxonomyDependentTreeProcessor<TreeMappedWit
     }
 
     void statsForNextTree(OTCLI & otCLI, const TreeMappedWithSplits & tree, bool isTaxoComp) {
-        auto c = doStatCalc(*summaryTree, tree, nullptr, showJSON?(&support):nullptr, showJSON?(&conflict):nullptr, isTaxoComp);
+        auto c = doStatCalc(*summaryTree, tree, nullptr, showJSON?(&support):nullptr, showJSON?(&conflict):nullptr, summaryPostorder, isTaxoComp);
         if (not showJSON) writeNextRow(otCLI.out, c, tree.get_name());
         for (const auto & p : c) {
             totals[p.first] += p.second;
@@ -458,6 +528,11 @@ struct DisplayedStatsState : public TaxonomyDependentTreeProcessor<TreeMappedWit
         assert(taxonomy != nullptr);
         if (summaryTree == nullptr) {
             summaryTree = std::move(tree);
+            for (auto nd : iter_post_const(*summaryTree)) {
+                if (nd->has_ott_id()) {
+                    summaryPostorder.emplace(nd->get_ott_id(), summaryPostorder.size());
+                }
+            }
             return true;
         }
         require_tips_to_be_mapped_to_terminal_taxa(*tree, *taxonomy);
@@ -44,26 +44,19 @@ struct DistanceState : public TaxonomyDependentTreeProcessor<TreeMappedWithSplit
         }
         assert(tree != nullptr);
         assert(taxonomy != nullptr);
-        std::set<OttIdSet > inducedSplits;
-        std::set<OttIdSet > tree2Splits;
-        induced_clade_sets(*taxonomy, *tree, inducedSplits, tree2Splits, true);
+        const auto counts = count_induced_splits(*taxonomy, *tree);
         unsigned long rf = 0;
         unsigned long numNotDisplayed = 0;
-        const unsigned long numInternals = tree2Splits.size();
+        const unsigned long numInternals = counts.num_in_second;
         unsigned long numDisplayed = 0;
         totalNumInternals += numInternals;
         if (showRF) {
-            rf = size_of_symmetric_difference(tree2Splits, inducedSplits);
+            rf = counts.num_induced + counts.num_in_second - 2 * counts.num_shared;
             totalRF += rf;
         }
         if (showNumDisplayed || showNumNotDisplayed) {
-            for (auto ics : tree2Splits) {
-                if (contains(inducedSplits, ics)) {
-                    numDisplayed += 1;
-                } else {
-                    numNotDisplayed += 1;
-                }
-            }
+            numDisplayed = counts.num_shared;
+            numNotDisplayed = counts.num_in_second - counts.num_shared;
             totalNumNotDisplayed += numNotDisplayed;
             totalNumDisplayed += numDisplayed;
 
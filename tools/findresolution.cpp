@@ -225,7 +225,8 @@ struct FindResolutionState : public TaxonomyDependentTreeProcessor<TreeMappedWit
         const auto  tp = &tree;
         const auto tpI = tree2LeafSet.find(tp);
         if (tpI == tree2LeafSet.end()) {
-            tree2LeafSet[tp] = keys(tree.get_data().ott_id_to_node);
+            const auto leafIds = keys(tree.get_data().ott_id_to_node);
+            tree2LeafSet[tp] = OttIdSet(leafIds.begin(), leafIds.end());
             return &(tree2LeafSet[tp]);
         }
         return &(tpI->second);
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "otc/error.h"
+#include "otc/otcli.h"
+#include "otc/taxonomy/taxonomy.h"
+#include "otc/ctrie/context_ctrie_db.h"
+#include "otc/ctrie/str_utils.h"
+#include "otc/tnrs/context.h"
+
+using namespace otc;
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace po = boost::program_options;
+using po::variables_map;
+
+variables_map parse_cmd_line(int argc,char* argv[]) {
+    using namespace po;
+    // named options
+    options_description invisible("Invisible options");
+    invisible.add_options()
+        ("taxonomy", value<string>(),"Filename for the taxonomy")
+        ;
+
+    options_description taxonomy("Taxonomy options");
+    taxonomy.add_options()
+        ("config,c",value<string>(),"Config file containing flags to filter")
+        ("clean",value<string>(),"Comma-separated string of flags to filter")
+        ("root,r", value<OttId>(), "OTT id of root node of subtree to keep")
+        ;
+
+    options_description benchmark("Benchmark options");
+    benchmark.add_options()
+        ("names",value<string>(),"File with one query name per line. By default, names are drawn from the taxonomy and misspelled.")
+        ("context",value<string>(),"Name of the TNRS context to search in (default: All life). Drawn names are taken from the context.")
+        ("queries,n",value<int>()->default_value(1000),"Number of names to draw from the taxonomy if --names is not given")
+        ("typos",value<int>()->default_value(2),"Maximum number of random letter substitutions, insertions or deletions per drawn name")
+        ("seed",value<int>()->default_value(1),"Seed for drawing and misspelling names")
+        ("repeat",value<int>()->default_value(3),"Number of passes over the names. The fastest pass is reported.")
+        ("top-k",value<int>(),"Only ask for the best k matches of each name (as autocomplete_name does).")
+        ;
+
+    options_description visible;
+    visible.add(taxonomy).add(benchmark).add(otc::standard_options());
+
+    // positional options
+    positional_options_description p;
+    p.add("taxonomy", -1);
+
+    variables_map vm = otc::parse_cmd_line_standard(argc, argv,
+                                                    "Usage: otc-fuzzy-match-benchmark <taxonomy-dir> [OPTIONS]\n"
+                                                    "Time the approximate name matching behind the match_names web service (do_approximate_matching=true).",
+                                                    visible, invisible, p);
+
+    return vm;
+}
+
+vector<string> read_names(const string & filename) {
+    std::ifstream inp(filename);
+    if (not inp.good()) {
+        throw OTCError() << "Could not open \"" << filename << "\"";
+    }
+    vector<string> names;
+    string line;
+    while (std::getline(inp, line)) {
+        if (not line.empty()) {
+            names.push_back(line);
+        }
+    }
+    return names;
+}
+
+// Taxon names with up to max_typos random edits each, like the misspellings that
+//    match_names is asked to correct.
+vector<string> misspelled_taxonomy_names(const RTRichTaxNode * context_root, int num_names, int max_typos, int seed) {
+    vector<string> all_names;
+    for (auto nd : iter_pre_n_const(context_root)) {
+        all_names.push_back(string(nd->get_data().get_nonuniqname()));
+    }
+    const std::u32string alphabet = U"abcdefghijklmnopqrstuvwxyz";
+    std::mt19937 rng(seed);
+    vector<string> names;
+    for (int i = 0; i < num_names and not all_names.empty(); ++i) {
+        // Edit letters, not bytes, so that names with non-ASCII letters stay valid UTF-8.
+        auto name = to_u32string(all_names[rng() % all_names.size()]);
+        const int num_typos = max_typos > 0 ? rng() % (max_typos + 1) : 0;
+        for (int j = 0; j < num_typos and name.length() > 1; ++j) {
+            const std::size_t pos = 1 + rng() % (name.length() - 1);
+            const char32_t letter = alphabet[rng() % alphabet.length()];
+            switch (rng() % 3) {
+                case 0: name[pos] = letter; break;
+                case 1: name.erase(pos, 1); break;
+                default: name.insert(pos, 1, letter);
+            }
+        }
+        names.push_back(to_char_str(name));
+    }
+    return names;
+}
+
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+    try {
+        auto args = parse_cmd_line(argc, argv);
+        auto taxonomy = load_rich_taxonomy(args);
+        Context::cull_contexts_to_taxonomy(taxonomy);
+        const Context * context = determine_context({});
+        ContextAwareCTrieBasedDB match_db{*context, taxonomy};
+        const RTRichTaxNode * context_root = taxonomy.get_tax_tree().get_root();
+        if (args.count("context")) {
+            context_root = taxonomy.included_taxon_from_id(get_context_by_name(args["context"].as<string>())->ott_id);
+            if (context_root == nullptr) {
+                throw OTCError() << "The root of context \"" << args["context"].as<string>() << "\" is not in the taxonomy";
+            }
+        }
+
+        vector<string> names;
+        if (args.count("names")) {
+            names = read_names(args["names"].as<string>());
+        } else {
+            names = misspelled_taxonomy_names(context_root, args["queries"].as<int>(), args["typos"].as<int>(), args["seed"].as<int>());
+        }
+        if (names.empty()) {
+            throw OTCError() << "No names to match";
+        }
+
+        const int repeat = std::max(1, args["repeat"].as<int>());
+        const std::size_t top_k = args.count("top-k") ? std::size_t(std::max(1, args["top-k"].as<int>())) : 0;
+        vector<double> times_ms;
+        std::size_t num_results = 0;
+        std::size_t num_matched = 0;
+        double total_ms = -1;
+        for (int i = 0; i < repeat; ++i) {
+            vector<double> pass_times_ms;
+            pass_times_ms.reserve(names.size());
+            num_results = 0;
+            num_matched = 0;
+            for (const auto & name : names) {
+                auto start = std::chrono::steady_clock::now();
+                auto results = (top_k > 0
+                                ? match_db.fuzzy_query_top_k(normalize_query(name), top_k, context_root, taxonomy, false)
+                                : match_db.fuzzy_query_to_taxa(normalize_query(name), context_root, taxonomy, false));
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                pass_times_ms.push_back(elapsed.count());
+                num_results += results.size();
+                num_matched += results.empty() ? 0 : 1;
+            }
+            double pass_ms = 0;
+            for (auto t : pass_times_ms) {
+                pass_ms += t;
+            }
+            if (total_ms < 0 or pass_ms < total_ms) {
+                total_ms = pass_ms;
+                times_ms = std::move(pass_times_ms);
+            }
+        }
+        std::sort(times_ms.begin(), times_ms.end());
+        auto percentile = [&](double p) {
+            return times_ms[std::min(times_ms.size() - 1, std::size_t(p * times_ms.size()))];
+        };
+        cout << "names: " << names.size() << " (" << num_matched << " with a match, " << num_results << " matches)\n";
+        cout << "total (fastest of " << repeat << " passes): " << total_ms << " ms (" << (total_ms > 0 ? 1000.0 * names.size() / total_ms : 0) << " names per second)\n";
+        cout << "per name: mean " << total_ms / names.size() << " ms, median " << percentile(0.5)
+             << " ms, 99th percentile " << percentile(0.99) << " ms, max " << times_ms.back() << " ms" << endl;
+    } catch (std::exception& e) {
+        cerr << "otc-fuzzy-match-benchmark: Error! " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <numeric>
+#include <random>
+#include "otc/otcli.h"
+#include "otc/tree_operations.h"
+using namespace otc;
+typedef RootedTree<RTNodeNoData, RTreeNoData> Tree_t;
+
+// Counts the bytes that a std::set asks for, i.e. its nodes.
+static std::size_t numBytesAllocated = 0;
+
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+    CountingAllocator() = default;
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U> &) {
+    }
+    T * allocate(std::size_t n) {
+        numBytesAllocated += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T * p, std::size_t n) {
+        numBytesAllocated -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+    template<typename U>
+    bool operator==(const CountingAllocator<U> &) const {
+        return true;
+    }
+};
+
+using CountedStdSet = std::set<OttId, std::less<OttId>, CountingAllocator<OttId> >;
+
+// The des_ids of every node of tree, filled in postorder as clear_and_fill_des_ids does.
+//  Returns the bytes used by the sets (bytesOf gives the heap bytes of a set that does
+//  not use CountingAllocator) and the time taken in milliseconds.
+template<typename S, typename BytesFn>
+std::pair<std::size_t, double> fillDesIds(const Tree_t & tree, BytesFn bytesOf) {
+    const auto bytesBefore = numBytesAllocated;
+    const auto start = std::chrono::steady_clock::now();
+    std::map<const Tree_t::node_type *, S> desIds;
+    for (auto nd : iter_post_const(tree)) {
+        auto & d = desIds[nd];
+        if (nd->has_ott_id()) {
+            d.insert(nd->get_ott_id());
+        }
+        insert_union(d, [&](auto add) {
+            for (auto c : iter_child_const(*nd)) {
+                add(desIds.at(c));
+            }
+        });
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::size_t numBytes = numBytesAllocated - bytesBefore;
+    for (const auto & nds : desIds) {
+        numBytes += sizeof(S) + bytesOf(nds.second);
+    }
+    return {numBytes, elapsed.count()};
+}
+
+static bool headerWritten = false;
+
+bool writeIdSetSizes(OTCLI & otCLI, std::unique_ptr<Tree_t> tree) {
+    std::size_t numNodes = 0;
+    for (auto nd : iter_post_const(*tree)) {
+        numNodes += 1;
+        (void) nd;
+    }
+    const auto stdSet = fillDesIds<CountedStdSet>(*tree, [](const CountedStdSet &) { return std::size_t(0); });
+    const auto flat = fillDesIds<SortedVectorSet<OttId> >(*tree, [](const SortedVectorSet<OttId> & s) {
+        return s.capacity() * sizeof(OttId);
+    });
+    if (!headerWritten) {
+        otCLI.out << "nodes\tstd::set bytes\tstd::set ms\tSortedVectorSet bytes\tSortedVectorSet ms\ttree\n";
+        headerWritten = true;
+    }
+    otCLI.out << numNodes << '\t'
+              << stdSet.first << '\t' << stdSet.second << '\t'
+              << flat.first << '\t' << flat.second << '\t'
+              << tree->get_name() << '\n';
+    return true;
+}
+
+static long numPolytomyTips = 0;
+
+bool handlePolytomy(OTCLI &, const std::string & arg) {
+    numPolytomyTips = std::stol(arg);
+    return numPolytomyTips > 0;
+}
+
+// With -p, also reports a tree that is one polytomy of that many tips (in shuffled id
+//  order), where the des_ids of the root are the union of that many children.
+int writePolytomySizes(OTCLI & otCLI) {
+    if (numPolytomyTips > 0) {
+        std::unique_ptr<Tree_t> tree(new Tree_t());
+        auto root = tree->create_root();
+        std::vector<OttId> ids(numPolytomyTips);
+        std::iota(ids.begin(), ids.end(), OttId(1));
+        std::shuffle(ids.begin(), ids.end(), std::mt19937(1));
+        for (auto id : ids) {
+            tree->create_child(root)->set_ott_id(id);
+        }
+        tree->set_name("polytomy of " + std::to_string(numPolytomyTips) + " tips");
+        writeIdSetSizes(otCLI, std::move(tree));
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    OTCLI otCLI("otc-ott-id-set-benchmark",
+                "takes filepaths to newick files and reports the memory and time used to build the des_ids of every node of each tree as a std::set and as a SortedVectorSet (the default OttIdSet)",
+                "some.tre -p200000");
+    otCLI.add_flag('p',
+                   "Also report a tree that is a single polytomy with this many tips",
+                   handlePolytomy,
+                   true);
+    std::function<bool (OTCLI &, std::unique_ptr<Tree_t>)> wis = writeIdSetSizes;
+    return tree_processing_main<Tree_t>(otCLI, argc, argv, wis, writePolytomySizes, nullptr, 0);
+}
@@ -1,8 +1,11 @@
 #include <algorithm>
+#include <atomic>
 #include <set>
 #include <list>
 #include <iterator>
 #include <numeric>
+#include <mutex>
+#include <thread>
 
 #include "solver/tree.h"
 #include "solver/rsplit.h"
@@ -22,6 +25,7 @@
 #include <optional>
 
 #include "otc/node_naming.h"
+#include "otc/work_stealing_pool.h"
 
 using namespace otc;
 namespace fs = std::filesystem;
@@ -110,8 +114,15 @@ variables_map parse_cmd_line(int argc,char* argv[]) {
         ("time,m", "Report time taken to standard error.")
          ;
 
+    options_description each("Options for solving many subproblems");
+    each.add_options()
+        ("solve-each", value<string>(), "Solve each subproblem in this directory (*.tre files), or listed in this file (one per line), on its own.")
+        ("output-dir,o", value<string>(), "With --solve-each: write the solution of each subproblem to a file of the same name in this directory.")
+        ("threads,j", value<int>(), "With --solve-each: the number of subproblems to solve at once (default: the number of cores).")
+        ;
+
     options_description visible;
-    visible.add(output).add(strategies).add(other).add(otc::standard_options());
+    visible.add(output).add(strategies).add(other).add(each).add(otc::standard_options());
 
     // positional options
     positional_options_description p;
@@ -119,9 +130,11 @@ variables_map parse_cmd_line(int argc,char* argv[]) {
 
     variables_map vm = otc::parse_cmd_line_standard(argc, argv,
                                                     "Usage: otc-solve-subproblem <trees-file1> [<trees-file2> ... ] [OPTIONS]\n"
+                                                    "       otc-solve-subproblem --solve-each <dir-or-list> --output-dir <dir> [OPTIONS]\n"
                                                     "Takes a series of tree files.\n"
                                                     "Files are concatenated and the combined list treated as a single subproblem.\n"
-                                                    "Trees should occur in order of priority, with the taxonomy last.",
+                                                    "Trees should occur in order of priority, with the taxonomy last.\n"
+                                                    "With --solve-each, each file is a separate subproblem.",
                                                     visible, invisible, p);
 
     string order = vm.at("branch-order").as<string>();
@@ -216,45 +229,6 @@ std::vector<T> concat(const std::vector<T>& v1, const std::vector<T>& v2)
     return v3;
 }
 
-void simplify(RSplitObj& s1, RSplitObj& s2)
-{
-    std::set<OttId> include1;
-    std::set<OttId> exclude1;
-    for(auto& i: s1.in)
-        include1.insert(i);
-    for(auto& o: s1.out)
-        exclude1.insert(o);
-    std::set<OttId> taxa1 = set_union_as_set(include1, exclude1);
-
-    std::set<OttId> include2;
-    std::set<OttId> exclude2;
-    for(auto& i: s2.in)
-        include2.insert(i);
-    for(auto& o: s2.out)
-        exclude2.insert(o);
-    std::set<OttId> taxa2 = set_union_as_set(include2, exclude2);
-
-    auto common_taxa = set_intersection_as_set(taxa1, taxa2);
-
-    include1 = set_intersection_as_set(include1, common_taxa);
-    exclude1 = set_intersection_as_set(exclude1, common_taxa);
-    s1.in.clear();
-    for(auto& i: include1)
-        s1.in.push_back(i);
-    s1.out.clear();
-    for(auto& e: exclude1)
-        s1.out.push_back(e);
-
-    include2 = set_intersection_as_set(include2, common_taxa);
-    exclude2 = set_intersection_as_set(exclude2, common_taxa);
-    s2.in.clear();
-    for(auto& i: include2)
-        s2.in.push_back(i);
-    s2.out.clear();
-    for(auto& e: exclude2)
-        s2.out.push_back(e);
-}
-
 // This is for debugging.
 std::vector<ConstRSplit> find_minimal_conflict_set(const vector<int>& all_leaves_indices, const vector<ConstRSplit>& splits1, const vector<ConstRSplit>& splits2)
 {
@@ -364,6 +338,215 @@ void standardize(Tree_t& t)
     sort_by_smallest_child_map(t, smallest_child);
 }
 
+// Solves the subproblem in `filenames` (the taxonomy last) and writes the summary tree to `out`.
+void solve_subproblem(const vector<string>& filenames, variables_map& args, const OttIdSet& incertae_sedis, std::ostream& out)
+{
+    ParsingRules rules;
+    rules.set_ott_ids = not (bool)args.count("allow-no-ids");
+    rules.prune_unrecognized_input_tips = (bool)args.count("prune-unrecognized");
+    rules.require_ott_ids = false;
+    bool synthesize_taxonomy = (bool)args.count("synthesize-taxonomy");
+    bool cladeTips = not (bool)args.count("no-higher-tips");
+    bool writeStandardized = (bool)args.count("standardize");
+    if (writeStandardized) {
+        rules.set_ott_ids = false;
+    }
+    bool setRootName = (bool)args.count("root-name");
+
+    // 2. Load trees from subproblem file(s)
+    if (filenames.empty()) {
+        throw OTCError("No subproblem provided!\n\nSee --help for usage information.");
+    }
+    vector<unique_ptr<Tree_t>> trees = get_trees<Tree_t>(filenames, rules);
+    if (trees.empty()) {
+        throw OTCError("No trees loaded!");
+    }
+    if (args.count("input-deg-dist")) {
+        auto filename = args["input-deg-dist"].as<string>();
+        std::ofstream file(filename); 
+        if (not file) {
+            throw OTCError() << "Cannot open input-deg-dist file '" << fs::absolute(filename) << "'";
+        }
+        for(const auto & tree: trees) {
+            writeDegDist(file, nullptr, *tree);
+        }
+    }
+    // 3. Make a fake taxonomy if asked
+    if (synthesize_taxonomy) {
+        trees.push_back(make_unresolved_tree(trees, rules.set_ott_ids));
+        LOG(DEBUG) << "taxonomy = " << newick(*trees.back()) << "\n";
+    }
+    // 4. Add fake Ott Ids to tips and compute des_ids (if asked)
+    if (not rules.set_ott_ids) {
+        auto name_to_id = create_ids_from_names(*trees.back());
+        for(auto& tree: trees) {
+            set_ids_from_names_and_refresh(*tree, name_to_id);
+        }
+    }
+    // 5. Write out subproblem with newly minted ottids (if asked)
+    if (writeStandardized) {
+        for(const auto& tree: trees) {
+            relabel_nodes_with_ott_id(*tree);
+            out << newick(*tree) << "\n";
+        }
+        return;
+    }
+    // 6. Check if trees are mapping to non-terminal taxa, and either fix the situation or die.
+    for (int i = 0; i < trees.size() - 1; i++) {
+        if (cladeTips) {
+            expand_ott_internals_which_are_leaves(*trees[i], *trees.back());
+        } else {
+            require_tips_to_be_mapped_to_terminal_taxa(*trees[i], *trees.back());
+        }
+    }
+    // 6.5 Make a copy of the taxonomy so that "combine" doesn't modify it.
+    auto taxonomy = copy_tree<Tree_t>(*trees.back());
+    compute_depth(*taxonomy);
+
+    // 7. Perform the synthesis
+    auto tree = combine(trees, incertae_sedis, args);
+    // 8. Set the root name (if asked)
+    // FIXME: This could be avoided if the taxonomy tree in the subproblem always had a name for the root node.
+    if (setRootName) {
+        tree->get_root()->set_name(args["root-name"].as<string>());
+    }
+    // 9. Write out the summary tree.
+    standardize(*tree);
+    write_tree_as_newick(out, *tree);
+    out << "\n";
+
+    if (args.count("output-deg-dist")) {
+        auto filename = args["output-deg-dist"].as<string>();
+        std::ofstream file(filename); 
+        if (not file) {
+            throw OTCError() << "Cannot open output-deg-dist file '" << fs::absolute(filename) << "'";
+        }
+        writeDegDist(file, nullptr, *tree);
+    }
+
+    // 10. Find placements
+    auto placements = check_placement(*tree, *taxonomy);
+    for(auto& [placed, parent]: placements)
+    {
+        auto mrca = mrca_from_depth(placed, parent);
+        vector<const node_t*> placement_path = vec_ptr_to_anc(parent, mrca);
+        vector<const node_t*> is_path = vec_ptr_to_anc(placed, mrca);
+        std::ostringstream msg;
+        for(int i=0;i<is_path.size();i++) {
+            msg <<node_name_is(is_path[i], incertae_sedis);
+            if (i != is_path.size()-1) {
+                msg << " <- ";
+            }
+        }
+        msg << " placed under ";
+        for(int i=0;i<placement_path.size();i++) {
+            msg << node_name_is(placement_path[i], incertae_sedis);
+            if (i != placement_path.size()-1) {
+                msg << " <- ";
+            }
+        }
+        LOG(INFO) << msg.str();
+    }
+}
+
+// The subproblem files of --solve-each: the *.tre files in a directory, or the files listed in a file.
+vector<fs::path> subproblem_files(const string& dir_or_list)
+{
+    vector<fs::path> paths;
+    if (fs::is_directory(dir_or_list)) {
+        for(const auto& entry: fs::directory_iterator(dir_or_list)) {
+            if (entry.is_regular_file() and entry.path().extension() == ".tre") {
+                paths.push_back(entry.path());
+            }
+        }
+    } else {
+        std::ifstream file(dir_or_list);
+        if (not file) {
+            throw OTCError() << "Cannot open subproblem list '" << fs::absolute(dir_or_list) << "'";
+        }
+        string line;
+        while (std::getline(file, line)) {
+            auto path = strip_surrounding_whitespace(line);
+            if (not path.empty()) {
+                paths.push_back(path);
+            }
+        }
+    }
+    // Start the largest subproblems first, so that one does not finish long after the rest.
+    // Missing files sort last, and fail when they are solved.
+    auto size_of = [](const fs::path& path) {
+        std::error_code ec;
+        auto size = fs::file_size(path, ec);
+        return ec ? std::uintmax_t(0) : size;
+    };
+    std::sort(paths.begin(), paths.end(), [&](const fs::path& p1, const fs::path& p2) {
+        auto size1 = size_of(p1), size2 = size_of(p2);
+        return (size1 != size2) ? size1 > size2 : p1 < p2;
+    });
+    return paths;
+}
+
+// Solves each subproblem of --solve-each on its own, several at once, and writes the solution
+// of each to the output directory as soon as it is done.  Returns the number that failed.
+int solve_each(variables_map& args, const OttIdSet& incertae_sedis)
+{
+    for(auto option: {"standardize", "input-deg-dist", "output-deg-dist"}) {
+        if (args.count(option)) {
+            throw OTCError() << "Option '" << option << "' cannot be used with --solve-each.";
+        }
+    }
+    if (not args.count("output-dir")) {
+        throw OTCError("--solve-each requires --output-dir.");
+    }
+    const fs::path output_dir = args["output-dir"].as<string>();
+    fs::create_directories(output_dir);
+    const auto subproblems = subproblem_files(args["solve-each"].as<string>());
+
+    unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (args.count("threads")) {
+        num_threads = unsigned(std::max(1, args["threads"].as<int>()));
+    }
+    // The calling thread solves subproblems too.
+    WorkStealingPool pool(num_threads - 1);
+
+    std::mutex progress_mutex;
+    std::size_t num_done = 0;
+    int num_failed = 0;
+    auto solve_one = [&](std::size_t i) {
+        const auto& subproblem = subproblems[i];
+        const auto output_path = output_dir / subproblem.filename();
+        string error;
+        try {
+            std::ostringstream solution;
+            solve_subproblem({subproblem.string()}, args, incertae_sedis, solution);
+            std::ofstream out(output_path);
+            if (not (out << solution.str())) {
+                throw OTCError() << "Cannot write solution to '" << fs::absolute(output_path) << "'";
+            }
+        } catch (std::exception& e) {
+            error = e.what();
+        }
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        num_done++;
+        if (error.empty()) {
+            LOG(INFO) << "solved " << subproblem.string() << " (" << num_done << "/" << subproblems.size() << ")";
+        } else {
+            num_failed++;
+            std::cerr << "otc-solve-subproblem: Error! " << subproblem.string() << ": " << error << std::endl;
+        }
+    };
+    // parallel_for hands out contiguous ranges, which would put the largest subproblems
+    // one after another on the same thread.  Instead each participant takes the next
+    // subproblem in size order whenever it is free (longest processing time first).
+    std::atomic<std::size_t> next_subproblem{0};
+    pool.parallel_for(num_threads, [&](std::size_t) {
+        for (auto i = next_subproblem++; i < subproblems.size(); i = next_subproblem++) {
+            solve_one(i);
+        }
+    });
+    return num_failed;
+}
+
 int main(int argc, char *argv[])
 {
     std::cout<<std::boolalpha;
@@ -371,42 +554,12 @@ int main(int argc, char *argv[])
     try {
         // 1. Parse command line arguments
         variables_map args = parse_cmd_line(argc,argv);
-        ParsingRules rules;
-        rules.set_ott_ids = not (bool)args.count("allow-no-ids");
-        rules.prune_unrecognized_input_tips = (bool)args.count("prune-unrecognized");
-        rules.require_ott_ids = false;
-        bool synthesize_taxonomy = (bool)args.count("synthesize-taxonomy");
-        bool cladeTips = not (bool)args.count("no-higher-tips");
-        bool verbose = (bool)args.count("verbose");
-        bool writeStandardized = (bool)args.count("standardize");
-        if (writeStandardized) {
-            rules.set_ott_ids = false;
-        }
-        bool setRootName = (bool)args.count("root-name");
+        bool each = (bool)args.count("solve-each");
 
-        if (not args.count("subproblem"))
+        if (not each and not args.count("subproblem"))
             throw OTCError("No subproblem provided!\n\nSee --help for usage information.");
 
-        vector<string> filenames = args["subproblem"].as<vector<string>>();
-        // 2. Load trees from subproblem file(s)
-        if (filenames.empty()) {
-            throw OTCError("No subproblem provided!\n\nSee --help for usage information.");
-        }
-        vector<unique_ptr<Tree_t>> trees = get_trees<Tree_t>(filenames, rules);
-        if (trees.empty()) {
-            throw OTCError("No trees loaded!");
-        }
-        if (args.count("input-deg-dist")) {
-            auto filename = args["input-deg-dist"].as<string>();
-            std::ofstream file(filename); 
-            if (not file) {
-                throw OTCError() << "Cannot open input-deg-dist file '" << fs::absolute(filename) << "'";
-            }
-            for(const auto & tree: trees) {
-                writeDegDist(file, nullptr, *tree);
-            }
-        }
-        //2.5 Load Incertae Sedis info
+        // Load Incertae Sedis info.  With --solve-each, it is shared by all of the subproblems.
         OttIdSet incertae_sedis;
         if (args.count("incertae-sedis")) {
             auto filename = args["incertae-sedis"].as<string>();
@@ -420,82 +573,10 @@ int main(int argc, char *argv[])
                 incertae_sedis.insert(i);
             }
         }
-        // 3. Make a fake taxonomy if asked
-        if (synthesize_taxonomy) {
-            trees.push_back(make_unresolved_tree(trees, rules.set_ott_ids));
-            LOG(DEBUG) << "taxonomy = " << newick(*trees.back()) << "\n";
-        }
-        // 4. Add fake Ott Ids to tips and compute des_ids (if asked)
-        if (not rules.set_ott_ids) {
-            auto name_to_id = create_ids_from_names(*trees.back());
-            for(auto& tree: trees) {
-                set_ids_from_names_and_refresh(*tree, name_to_id);
-            }
-        }
-        // 5. Write out subproblem with newly minted ottids (if asked)
-        if (writeStandardized) {
-            for(const auto& tree: trees) {
-                relabel_nodes_with_ott_id(*tree);
-                std::cout << newick(*tree) << "\n";
-            }
-            return 0;
-        }
-        // 6. Check if trees are mapping to non-terminal taxa, and either fix the situation or die.
-        for (int i = 0; i < trees.size() - 1; i++) {
-            if (cladeTips) {
-                expand_ott_internals_which_are_leaves(*trees[i], *trees.back());
-            } else {
-                require_tips_to_be_mapped_to_terminal_taxa(*trees[i], *trees.back());
-            }
-        }
-        // 6.5 Make a copy of the taxonomy so that "combine" doesn't modify it.
-        auto taxonomy = copy_tree<Tree_t>(*trees.back());
-        compute_depth(*taxonomy);
-
-        // 7. Perform the synthesis
-        auto tree = combine(trees, incertae_sedis, args);
-        // 8. Set the root name (if asked)
-        // FIXME: This could be avoided if the taxonomy tree in the subproblem always had a name for the root node.
-        if (setRootName) {
-            tree->get_root()->set_name(args["root-name"].as<string>());
-        }
-        // 9. Write out the summary tree.
-        standardize(*tree);
-        write_tree_as_newick(std::cout, *tree);
-        std::cout << "\n";
-
-        if (args.count("output-deg-dist")) {
-            auto filename = args["output-deg-dist"].as<string>();
-            std::ofstream file(filename); 
-            if (not file) {
-                throw OTCError() << "Cannot open output-deg-dist file '" << fs::absolute(filename) << "'";
-            }
-            writeDegDist(file, nullptr, *tree);
-        }
-
-        // 10. Find placements
-        auto placements = check_placement(*tree, *taxonomy);
-        for(auto& [placed, parent]: placements)
-        {
-            auto mrca = mrca_from_depth(placed, parent);
-            vector<const node_t*> placement_path = vec_ptr_to_anc(parent, mrca);
-            vector<const node_t*> is_path = vec_ptr_to_anc(placed, mrca);
-            std::ostringstream msg;
-            for(int i=0;i<is_path.size();i++) {
-                msg <<node_name_is(is_path[i], incertae_sedis);
-                if (i != is_path.size()-1) {
-                    msg << " <- ";
-                }
-            }
-            msg << " placed under ";
-            for(int i=0;i<placement_path.size();i++) {
-                msg << node_name_is(placement_path[i], incertae_sedis);
-                if (i != placement_path.size()-1) {
-                    msg << " <- ";
-                }
-            }
-            LOG(INFO) << msg.str();
+        if (each) {
+            return solve_each(args, incertae_sedis) ? 1 : 0;
         }
+        solve_subproblem(args["subproblem"].as<vector<string>>(), args, incertae_sedis, std::cout);
         return 0;
     } catch (std::exception& e) {
         std::cerr << "otc-solve-subproblem: Error! " << e.what() << std::endl;
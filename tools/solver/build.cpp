@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "build.h"
 #include "rollback.h"
 
@@ -6,7 +7,9 @@ using std::list;
 using std::optional;
 using std::shared_ptr;
 
-vector<int> indices;
+BuildContext::BuildContext(int n_taxa)
+    :indices(n_taxa, -1)
+{}
 
 template <typename T>
 bool sort_cmp(const vector<T>& v1,  const vector<T>& v2)
@@ -19,43 +22,36 @@ bool sort_cmp(const vector<T>& v1,  const vector<T>& v2)
     return (w1 == w2);
 }
 
-void Solution::initialize_taxon_index_map() const
+void Solution::initialize_taxon_index_map(BuildContext& context) const
 {
+    auto& indices = context.indices;
     for(int k=0;k<indices.size();k++)
         assert(indices[k] == -1);
     for (int i=0;i<taxa.size();i++)
         indices[taxa[i]] = i;
 }
 
-void Solution::clear_taxon_index_map() const
+void Solution::clear_taxon_index_map(BuildContext& context) const
 {
+    auto& indices = context.indices;
     for(int id: taxa)
         indices[id] = -1;
 }
 
 
-bool exclude_group_intersects_component(const ConstRSplit& split, const component_t* component, const vector<component_ref>& component_for_index)
+bool exclude_group_intersects_component(const vector<int>& indices, const ConstRSplit& split, const component_t* component, const Solution& solution)
 {
-    for(int taxon: split->out)
-    {
-        int index = indices[taxon];
-
-        if (index == -1) continue;
+    return split->any_out([&](int taxon)
+        {
+            int index = indices[taxon];
 
-        if (component_for_index[index] == component) return true;
-    }
-    return false;
+            return index != -1 and solution.component_for_index(index) == component;
+        });
 }
 
-bool exclude_group_intersects_taxon_set(const ConstRSplit& split)
+bool exclude_group_intersects_taxon_set(const vector<int>& indices, const ConstRSplit& split)
 {
-    for(int taxon: split->out)
-    {
-        int index = indices[taxon];
-
-        if (index != -1) return true;
-    }
-    return false;
+    return split->any_out([&](int taxon) {return indices[taxon] != -1;});
 }
 
 
@@ -66,13 +62,14 @@ void append(vector<T>& v1, const vector<T>& v2)
 }
 
 /// Merge components c1 and c2 and return the component name that survived
-component_ref merge_components(component_ref c1, component_ref c2, vector<component_ref>& component_for_index, vector<MergeRollbackInfo>& merge_rollback_info, bool record_component_mergers)
+component_ref merge_components(Solution& solution, component_ref c1, component_ref c2, vector<MergeRollbackInfo>& merge_rollback_info, bool record_component_mergers)
 {
-    if (c2->elements.size() > c1->elements.size())
+    // The larger component survives.
+    auto join = solution.component_forest.join(c1->root, c2->root);
+    if (join.root != c1->root)
         std::swap(c1, c2);
-
-    for(int i: c2->elements)
-        component_for_index[i] = c1;
+    solution.component_for_root[c2->root] = nullptr;
+    c2->root = -1;
 
     if (c1->solution)
     {
@@ -85,22 +82,27 @@ component_ref merge_components(component_ref c1, component_ref c2, vector<compon
         c1->old_solutions.push_back(c2->solution);
 
     if (record_component_mergers)
-        merge_rollback_info.push_back({c1, c2, c2->elements.begin(), c1->solution});
+        merge_rollback_info.push_back({c1, c2, join, c1->solution});
 
     // One of these components could be new -- that is, composed only of previously-trivial components.
     append(c1->old_solutions, c2->old_solutions);
 
     c1->solution = {};
 
-    c1->elements.splice(c1->elements.end(), c2->elements);
-
     return c1;
 }
 
 /// Merge components c1 and c2 and return the component name that survived
-void merge_component_with_trivial(component_ref c1, int index2, vector<component_ref>& component_for_index, vector<MergeRollbackInfo>& merge_rollback_info, bool record_component_mergers)
+void merge_component_with_trivial(Solution& solution, component_ref c1, int index2, vector<MergeRollbackInfo>& merge_rollback_info, bool record_component_mergers)
 {
-    component_for_index[index2] = c1;
+    RollbackUnionFind::Join join{index2, -1, -1};
+    if (c1->root == -1)
+    {
+        c1->root = index2;
+        solution.component_for_root[index2] = c1;
+    }
+    else
+        join = solution.component_forest.join(c1->root, index2);
 
     if (c1->solution)
     {
@@ -110,11 +112,9 @@ void merge_component_with_trivial(component_ref c1, int index2, vector<component
     }
 
     if (record_component_mergers)
-        merge_rollback_info.push_back({c1, nullptr, {}, c1->solution});
+        merge_rollback_info.push_back({c1, nullptr, join, c1->solution});
 
     c1->solution = {};
-
-    c1->elements.push_back(index2);
 }
 
 void MaybeReuseSolution(shared_ptr<Solution>& solution, vector<shared_ptr<Solution>>& sub_solutions)
@@ -143,12 +143,12 @@ void MaybeReuseSolution(shared_ptr<Solution>& solution, vector<shared_ptr<Soluti
 
 // TODO: If BUILD fails, can we rebuild the solution that we have modified in-place?
 //       * we need to avoid modifying the old solutions (for a merged component) in-place.
-//       * we need to restore the component->elements list.
+//       * we need to restore the component_forest.
 
 /// Construct a tree with all the splits mentioned, and return false if this is not possible
 ///   You can get the resulting tree from it with solution.get_tree().
 ///   New splits are in both `new_splits` and `sub_solution`.
-void RemoveImpliedSplits(const shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions)
+void RemoveImpliedSplits(BuildContext& context, const shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions)
 {
 #pragma clang diagnostic ignored  "-Wsign-conversion"
 #pragma clang diagnostic ignored  "-Wsign-compare"
@@ -159,13 +159,13 @@ void RemoveImpliedSplits(const shared_ptr<Solution>& solution, vector<ConstRSpli
     if (new_splits.empty() and sub_solutions.empty()) return;
 
     // 2. Initialize the mapping from taxa to indices.
-    solution->initialize_taxon_index_map();
+    solution->initialize_taxon_index_map(context);
 
     // 3. Determine the new splits that go into each component (both satisfied AND unsatisfied)
     for(int k = new_splits.size()-1; k >= 0; k--)
     {
         auto& split = new_splits[k];
-        bool implied = not exclude_group_intersects_taxon_set(split);
+        bool implied = not exclude_group_intersects_taxon_set(context.indices, split);
         if (implied)
         {
             // Copy the split to the implied_splits set.
@@ -192,7 +192,7 @@ void RemoveImpliedSplits(const shared_ptr<Solution>& solution, vector<ConstRSpli
         {
             auto& split = sub_solution->implied_splits[i];
 
-            bool implied = not exclude_group_intersects_taxon_set(split);
+            bool implied = not exclude_group_intersects_taxon_set(context.indices, split);
 
             // If we just realized that this sub_solution is punctured, then copy the previously seen splits to new_splits
             if (implied and not punctured)
@@ -230,48 +230,47 @@ void RemoveImpliedSplits(const shared_ptr<Solution>& solution, vector<ConstRSpli
     }
 
     // 5. Determine the new splits that go into each component (both satisfied AND unsatisfied)
-    solution->clear_taxon_index_map();
+    solution->clear_taxon_index_map(context);
 }
 
 
-void Merge(shared_ptr<Solution>& solution, const vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions, SolutionRollbackInfo& rollback_info)
+void Merge(BuildContext& context, shared_ptr<Solution>& solution, const vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions, SolutionRollbackInfo& rollback_info)
 {
-    auto& component_for_index = solution->component_for_index;
     auto& components = solution->components;
 
     rollback_info.n_orig_components = solution->components.size();
 
     bool record_rollback = solution->rollback and not solution->components.empty();
 
-    auto merge = [&](auto& group)
+    auto merge = [&](const auto& group)
         {
             assert(group.size() >= 2);
             component_ref split_comp = nullptr;
             for(int taxon: group)
             {
-                int index = indices[taxon];
+                int index = context.indices[taxon];
                 assert(index != -1);
-                auto taxon_comp = component_for_index[index];
+                auto taxon_comp = solution->component_for_index(index);
                 if (not split_comp)
                 {
                     if (not taxon_comp)
                     {
                         components.push_back(std::make_unique<component_t>());
                         taxon_comp = components.back().get();
-                        merge_component_with_trivial(taxon_comp, index, component_for_index, rollback_info.merge_rollback_info, record_rollback);
+                        merge_component_with_trivial(*solution, taxon_comp, index, rollback_info.merge_rollback_info, record_rollback);
                     }
                     split_comp = taxon_comp;
                 }
                 else if (not taxon_comp)
-                    merge_component_with_trivial(split_comp, index, component_for_index, rollback_info.merge_rollback_info, record_rollback);
+                    merge_component_with_trivial(*solution, split_comp, index, rollback_info.merge_rollback_info, record_rollback);
                 else if (split_comp != taxon_comp)
-                    split_comp = merge_components(split_comp,taxon_comp,component_for_index, rollback_info.merge_rollback_info, record_rollback);
+                    split_comp = merge_components(*solution, split_comp, taxon_comp, rollback_info.merge_rollback_info, record_rollback);
             }
         };
 
     // 3a. For each new split, all the leaves in the include group must be in the same component
     for(const auto& split: new_splits)
-        merge(split->in);
+        merge(split->in());
     // 3b. For each sub_solution, all the leaves in the taxon set must be in the same component
     for(const auto& sub_solution: sub_solutions)
     {
@@ -284,13 +283,13 @@ void Merge(shared_ptr<Solution>& solution, const vector<ConstRSplit>& new_splits
     auto& packed_components = *rollback_info.old_components;
     assert(packed_components.empty());
     for(auto& component: components)
-        if (not component->elements.empty())
+        if (component->root != -1)
             packed_components.push_back( component );
     std::swap(components, packed_components);
 
 }
 
-bool MaybeFail(shared_ptr<Solution>& solution)
+bool MaybeFail(BuildContext& context, shared_ptr<Solution>& solution)
 {
     auto& components = solution->components;
 
@@ -302,24 +301,22 @@ bool MaybeFail(shared_ptr<Solution>& solution)
     else
     {
         assert(components.size() == 1);
-        solution->clear_taxon_index_map();
+        solution->clear_taxon_index_map(context);
 
         // we failed!
         return true;
     }
 }
 
-void Assign(shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions)
+void Assign(BuildContext& context, shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions)
 {
-    auto& component_for_index = solution->component_for_index;
-
     // 1. Determine the new splits that go into each component.
     //    We will check if they are implied or unimplied when we call RemoveImpliedSplits( ) on the component.
     for(auto& split: new_splits)
     {
-        int first = indices[*split->in.begin()];
+        int first = context.indices[split->in()[0]];
         assert(first >= 0);
-        auto component = component_for_index[first];
+        auto component = solution->component_for_index(first);
 
         component->new_splits.push_back(split);
     }
@@ -332,27 +329,26 @@ void Assign(shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vec
     for(auto& sub_solution: sub_solutions)
     {
         int first_taxon = sub_solution->taxa[0];
-        int first_index = indices[first_taxon];
-        auto component = component_for_index[first_index];
+        int first_index = context.indices[first_taxon];
+        auto component = solution->component_for_index(first_index);
         component->old_solutions.push_back(sub_solution);
     }
 }
 
 
 
-bool BuildIncA(shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions,
+bool BuildIncA(BuildContext& context, shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions,
                vector<SolutionRollbackInfo>& all_rollback_info, bool top = false);
 
-bool SolveSubproblems(shared_ptr<Solution>& solution, vector<SolutionRollbackInfo>& all_rollback_info)
+bool SolveSubproblems(BuildContext& context, shared_ptr<Solution>& solution, vector<SolutionRollbackInfo>& all_rollback_info)
 {
-    auto& taxa = solution->taxa;
     auto& components = solution->components;
 
     optional<int> failing_component;
     for(int i=0;i<components.size();i++)
     {
         auto& component = components[i];
-        assert(component->elements.size() >= 2);
+        assert(solution->component_size(*component) >= 2);
 
         vector<ConstRSplit> comp_new_splits;
         std::swap(component->new_splits, comp_new_splits);
@@ -366,9 +362,9 @@ bool SolveSubproblems(shared_ptr<Solution>& solution, vector<SolutionRollbackInf
         // If we've invalidated the solution for this component because the component's taxon set increased,
         // then create an empty solution to use here.
         if (not component->solution)
-            component->solution = std::make_shared<Solution>(*component, taxa, solution->rollback);
+            component->solution = std::make_shared<Solution>(solution->taxa_of(*component), solution->rollback);
 
-        if (not BuildIncA(component->solution, comp_new_splits, comp_sub_solutions, all_rollback_info))
+        if (not BuildIncA(context, component->solution, comp_new_splits, comp_sub_solutions, all_rollback_info))
             failing_component = i;
 
         assert(component->old_solutions.empty());
@@ -378,7 +374,7 @@ bool SolveSubproblems(shared_ptr<Solution>& solution, vector<SolutionRollbackInf
     return (not failing_component);
 }
 
-bool BuildIncA(shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions,
+bool BuildIncA(BuildContext& context, shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits, vector<shared_ptr<Solution>>& sub_solutions,
                vector<SolutionRollbackInfo>& all_rollback_info, bool top)
 {
     // 1. MaybeReuseSolution
@@ -393,7 +389,7 @@ bool BuildIncA(shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits,
 
     // 3. Remove implied splits
     if (not top)
-        RemoveImpliedSplits(solution, new_splits, sub_solutions);
+        RemoveImpliedSplits(context, solution, new_splits, sub_solutions);
 
     // A. If there are no splits to add, then we are consistent.
     if (new_splits.empty() and sub_solutions.empty())
@@ -405,39 +401,39 @@ bool BuildIncA(shared_ptr<Solution>& solution, vector<ConstRSplit>& new_splits,
     }
 
     // B. Initialize the mapping from taxa to indices.
-    solution->initialize_taxon_index_map();
+    solution->initialize_taxon_index_map(context);
 
     // 4. Merge components
-    Merge(solution, new_splits, sub_solutions, sol_rollback_info);
+    Merge(context, solution, new_splits, sub_solutions, sol_rollback_info);
 
     if (record_rollback_info)
         all_rollback_info.push_back(sol_rollback_info);
 
     // 5. Fail if there is only one component
-    bool fail = MaybeFail(solution);
+    bool fail = MaybeFail(context, solution);
     if (fail)
         return false;
 
     // 6. Assign splits and sub_solutions to components
-    Assign(solution, new_splits, sub_solutions);
+    Assign(context, solution, new_splits, sub_solutions);
 
     // C. Clear the taxon index map
-    solution->clear_taxon_index_map();
+    solution->clear_taxon_index_map(context);
 
     // 7. Recurse into sub-problems
-    bool success = SolveSubproblems(solution, all_rollback_info);
+    bool success = SolveSubproblems(context, solution, all_rollback_info);
 
     return success;
 }
 
 
-bool BUILDINC(shared_ptr<Solution>& solution, const vector<ConstRSplit>& new_splits)
+bool BUILDINC(BuildContext& context, shared_ptr<Solution>& solution, const vector<ConstRSplit>& new_splits)
 {
     auto new_splits2 = new_splits;
     vector<shared_ptr<Solution>> sub_solutions;
 
     vector<SolutionRollbackInfo> all_rollback_info;
-    bool ok =  BuildIncA(solution, new_splits2, sub_solutions, all_rollback_info, true);
+    bool ok =  BuildIncA(context, solution, new_splits2, sub_solutions, all_rollback_info, true);
 
     assert(solution->rollback or all_rollback_info.empty());
 
@@ -450,16 +446,23 @@ bool BUILDINC(shared_ptr<Solution>& solution, const vector<ConstRSplit>& new_spl
     return ok;
 }
 
+int max_taxon(const vector<int>& taxa)
+{
+    return taxa.empty() ? -1 : *std::max_element(taxa.begin(), taxa.end());
+}
+
 bool BUILD_check(const std::vector<int> all_leaves_indices, const std::vector<ConstRSplit>& splits)
 {
+    BuildContext context(max_taxon(all_leaves_indices) + 1);
     auto solution = std::make_shared<Solution>(all_leaves_indices, false);
-    return BUILDINC(solution, splits);
+    return BUILDINC(context, solution, splits);
 }
 
 std::unique_ptr<Tree_t> BUILD(const std::vector<int> all_leaves_indices, const std::vector<ConstRSplit>& splits)
 {
+    BuildContext context(max_taxon(all_leaves_indices) + 1);
     auto solution = std::make_shared<Solution>(all_leaves_indices, false);
-    bool compatible = BUILDINC(solution, splits);
+    bool compatible = BUILDINC(context, solution, splits);
     if (compatible)
         return solution->get_tree();
     else
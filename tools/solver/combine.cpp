@@ -4,8 +4,10 @@
 #include "oracle.h"
 #include "names.h"
 
+#include <algorithm>
 #include <chrono>
 #include <map>
+#include <ranges>
 #include <utility>
 #include <iomanip>
 
@@ -37,9 +39,9 @@ vector<typename Tree_t::node_type const*> get_siblings(typename Tree_t::node_typ
 }
 
 template<typename Tree_T>
-map<typename Tree_t::node_type const*, set<OttId>> construct_include_sets(const Tree_t& tree, const set<OttId>& incertae_sedis)
+map<typename Tree_t::node_type const*, OttIdSet> construct_include_sets(const Tree_t& tree, const OttIdSet& incertae_sedis)
 {
-    map<typename Tree_t::node_type const*, set<OttId>> include;
+    map<typename Tree_t::node_type const*, OttIdSet> include;
     for(auto nd: iter_post(tree)) {
         // 1. Initialize set for this node.
         auto & inc = include[nd];
@@ -61,8 +63,8 @@ map<typename Tree_t::node_type const*, set<OttId>> construct_include_sets(const
 }
 
 template<typename Tree_t>
-map<typename Tree_t::node_type const*, set<OttId>> construct_exclude_sets(const Tree_t& tree, const set<OttId>& incertae_sedis) {
-    map<typename Tree_t::node_type const*, set<OttId>> exclude;
+map<typename Tree_t::node_type const*, OttIdSet> construct_exclude_sets(const Tree_t& tree, const OttIdSet& incertae_sedis) {
+    map<typename Tree_t::node_type const*, OttIdSet> exclude;
     // 1. Set exclude set for root node to the empty set.
     exclude[tree.get_root()];
     for(auto nd: iter_pre(tree)) {
@@ -71,7 +73,7 @@ map<typename Tree_t::node_type const*, set<OttId>> construct_exclude_sets(const
             continue;
         }
         // 3. Start with the exclude set for the parent.  This should already exist.
-        set<OttId> ex = exclude.at(nd->get_parent());
+        OttIdSet ex = exclude.at(nd->get_parent());
         // 4. The exclude set should ALSO include ALL (not just some) descendants of siblings.
         for(auto nd2: get_siblings<Tree_t>(nd)) {
             if (not incertae_sedis.count(nd2->get_ott_id())) {
@@ -85,21 +87,47 @@ map<typename Tree_t::node_type const*, set<OttId>> construct_exclude_sets(const
     return exclude;
 }
 
-vector<pair<node_type<Tree_t>*,RSplit>>
-splits_for_tree(bool preorder, Tree_t& tree, const std::function< set<int>(const set<OttId>&) >& remap)
+/// Numbers the leaves of a subproblem 0..n-1 in the order of their OTT ids, so that the
+///   numbers of a sorted set of ids come out sorted, and can go straight into a split.
+class LeafNumbering
 {
-    vector<pair<node_type<Tree_t>*,RSplit>> splits;
+    vector<OttId> ids;
+
+public:
+    explicit LeafNumbering(const OttIdSet& leaves)
+        :ids(leaves.begin(), leaves.end())
+    { }
+
+    OttId id(int index) const {return ids[index];}
+
+    int index(OttId id) const
+    {
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        assert(it != ids.end() and *it == id);
+        return it - ids.begin();
+    }
+
+    auto indices(const OttIdSet& s) const
+    {
+        return s | std::views::transform([this](OttId id) {return index(id);});
+    }
+};
+
+vector<pair<node_type<Tree_t>*,ConstRSplit>>
+splits_for_tree(bool preorder, Tree_t& tree, const LeafNumbering& numbering, SplitArena& arena)
+{
+    vector<pair<node_type<Tree_t>*,ConstRSplit>> splits;
     auto root = tree.get_root();
-    const auto leafTaxa = root->get_data().des_ids;
-    const auto leafTaxaIndices = set_to_vector( remap(leafTaxa) );
+    const auto& leafTaxa = root->get_data().des_ids;
+    const auto leafTaxaIndices = arena.add_taxa(numbering.indices(leafTaxa));
     auto maybe_add_split = [&](const auto& nd)
     {
         if (nd->get_out_degree() >= 2 and nd != root)
         {
-            auto descendants = remap(nd->get_data().des_ids);
+            const auto& descendants = nd->get_data().des_ids;
             if (descendants.size() > 1)
-                splits.push_back({nd, RSplit(new RSplitObj{descendants, leafTaxaIndices})}) ;
-            assert(splits.back().second->in.size() > 1);
+                splits.push_back({nd, arena.split_from_include(numbering.indices(descendants), leafTaxaIndices)});
+            assert(splits.back().second->in().size() > 1);
         }
     };
 
@@ -117,13 +145,13 @@ splits_for_tree(bool preorder, Tree_t& tree, const std::function< set<int>(const
     return splits;
 }
 
-vector<pair<node_type<Tree_t>*,RSplit>>
-splits_for_taxonomy_tree(bool preorder, Tree_t& tree, const std::function< set<int>(const set<OttId>&) >& remap, const set<OttId>& incertae_sedis)
+vector<pair<node_type<Tree_t>*,ConstRSplit>>
+splits_for_taxonomy_tree(bool preorder, Tree_t& tree, const LeafNumbering& numbering, SplitArena& arena, const OttIdSet& incertae_sedis)
 {
     if (incertae_sedis.empty())
-        return splits_for_tree(preorder, tree, remap);
+        return splits_for_tree(preorder, tree, numbering, arena);
 
-    vector<pair<node_type<Tree_t>*,RSplit>> splits;
+    vector<pair<node_type<Tree_t>*,ConstRSplit>> splits;
     auto root = tree.get_root();
 
     auto exclude = construct_exclude_sets(tree, incertae_sedis);
@@ -132,13 +160,14 @@ splits_for_taxonomy_tree(bool preorder, Tree_t& tree, const std::function< set<i
     {
         if (nd->get_out_degree() >= 2 and nd != root) {
             // construct split
-            const auto descendants = remap(nd->get_data().des_ids);
-            const auto nondescendants = remap(exclude[nd]);
+            const auto& descendants = nd->get_data().des_ids;
+            const auto& nondescendants = exclude[nd];
             // FIXME: Should we allow splits with nondescendants.size() == 0 ??
             //        Probably not, but doing so breaks test is-naming1,
             //        Since we have (A,B,C) with B and C both incertae-sedis.
             if (descendants.size() > 1)
-                splits.push_back({nd, split_from_include_exclude(descendants, nondescendants)});
+                splits.push_back({nd, arena.split_from_include_exclude(numbering.indices(descendants),
+                                                                       numbering.indices(nondescendants))});
         }
     };
 
@@ -156,37 +185,9 @@ splits_for_taxonomy_tree(bool preorder, Tree_t& tree, const std::function< set<i
     return splits;
 }
 
-set<int> remap_ids(const set<OttId>& s1, const map<OttId,int>& id_map) {
-    set<int> s2;
-    for(auto x: s1) {
-        auto it = id_map.find(x);
-        assert(it != id_map.end());
-        s2.insert(it->second);
-    }
-    return s2;
-}
-
-template <typename T>
-pair<vector<T>,map<T,int>> make_index_map(const set<T>& s)
-{
-    pair<vector<T>,map<T,int>> x;
-    // ids:    index -> id
-    // id_map: id    -> index
-    auto& [ids,id_map] = x;
-    for(auto& id: s)
-    {
-        int i = ids.size();
-        id_map[id] = i;
-        ids.push_back(id);
-        assert(id_map[ids[i]] == i);
-        assert(ids[id_map[id]] == id);
-    }
-    return x;
-}
-
 
 /// Get the list of splits, and add them one at a time if they are consistent with previous splits
-unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>& incertae_sedis, variables_map& args)
+unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const OttIdSet& incertae_sedis, variables_map& args)
 {
     bool verbose = (bool)args.count("verbose");
     bool batching = args["batching"].as<bool>();
@@ -202,20 +203,16 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
     const auto& taxonomy = trees.back();
     auto all_leaves = taxonomy->get_root()->get_data().des_ids;
 
-    // ids:    index -> id
-    // id_map: id    -> index
-    auto [ids, id_map_] = make_index_map(all_leaves);
-    auto& id_map = id_map_;
+    const LeafNumbering numbering(all_leaves);
+
+    // The splits of every tree are made in this arena, and live until we return.
+    SplitArena arena;
 
-    std::function< set<int>(const set<OttId>&) > remap = [&id_map](const set<OttId>& argIds) {return remap_ids(argIds, id_map);};
     vector<int> all_leaves_indices;
     for(int i=0;i<all_leaves.size();i++) {
         all_leaves_indices.push_back(i);
     }
-    indices.resize(all_leaves.size());
-    for(auto& i: indices) {
-        i=-1;
-    }
+    BuildContext context(all_leaves.size());
 
     /// Incrementally add splits from @splits_to_try to @consistent if they are consistent with it.
     vector<ConstRSplit> consistent;
@@ -225,7 +222,7 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
     // A non-null solution means that consistent splits are already part of the solution.
 
     int total_build_calls = 0;
-    auto add_splits_if_consistent = [&](vector<pair<node_type<Tree_t>*,RSplit>>& splits, int start, int n)
+    auto add_splits_if_consistent = [&](vector<pair<node_type<Tree_t>*,ConstRSplit>>& splits, int start, int n)
         {
             bool result;
             if (incremental)
@@ -236,7 +233,7 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
                 for(int i=0;i<n;i++)
                     new_splits.push_back(splits[start+i].second);
 
-                result = BUILDINC(solution, new_splits);
+                result = BUILDINC(context, solution, new_splits);
                 LOG(TRACE)<<"consistent = "<< consistent.size()<<" -> "<<consistent.size()+n<<": "<<(result?"ok":"FAIL");
                 if (result)
                 {
@@ -250,7 +247,7 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
                     if (not rollback)
                     {
                         solution = std::make_shared<Solution>(all_leaves_indices, rollback);
-                        bool old_result = BUILDINC(solution, consistent);
+                        bool old_result = BUILDINC(context, solution, consistent);
                         assert(old_result);
                         total_build_calls ++;
                     }
@@ -264,7 +261,7 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
 
                 solution = std::make_shared<Solution>(all_leaves_indices, rollback);
 
-                result = BUILDINC(solution, consistent);
+                result = BUILDINC(context, solution, consistent);
                 LOG(TRACE)<<"consistent = "<< consistent.size()-n<<" -> "<<consistent.size()<<": "<<(result?"ok":"FAIL");
                 if (not result)
                 {
@@ -280,8 +277,8 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
             return result;
         };
 
-    std::function<int(vector<pair<node_type<Tree_t>*,RSplit>>&,int,int)> add_splits_if_consistent_batch;
-    add_splits_if_consistent_batch = [&](vector<pair<node_type<Tree_t>*,RSplit>>& splits, int start, int n) -> int
+    std::function<int(vector<pair<node_type<Tree_t>*,ConstRSplit>>&,int,int)> add_splits_if_consistent_batch;
+    add_splits_if_consistent_batch = [&](vector<pair<node_type<Tree_t>*,ConstRSplit>>& splits, int start, int n) -> int
         {
             assert(n >= 1);
             assert(start+n <= splits.size());
@@ -301,7 +298,7 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
         };
 
     // 1. Find splits in order of input trees
-    vector<pair<node_type<Tree_t>*,RSplit>> splits;
+    vector<pair<node_type<Tree_t>*,ConstRSplit>> splits;
     int total_splits_considered = 0;
     int total_splits_compatible = 0;
     for(int i=0;i<trees.size();i++)
@@ -315,8 +312,8 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
 
         // 2. Get remaining splits
         auto splits2 = (i<trees.size()-1)
-            ?splits_for_tree(preorder, *tree, remap)
-            :splits_for_taxonomy_tree(preorder, *tree, remap, incertae_sedis);
+            ?splits_for_tree(preorder, *tree, numbering, arena)
+            :splits_for_taxonomy_tree(preorder, *tree, numbering, arena, incertae_sedis);
 
         if (splits2.empty()) continue;
 
@@ -358,7 +355,7 @@ unique_ptr<Tree_t> combine(vector<unique_ptr<Tree_t>>& trees, const set<OttId>&
         if (nd->is_tip())
         {
             int index = nd->get_ott_id();
-            nd->set_ott_id(ids[index]);
+            nd->set_ott_id(numbering.id(index));
         }
     }
 
@@ -8,6 +8,6 @@
 #include "otc/otc_base_includes.h" // for OttId
 #include "otc/otcli.h"
 
-std::unique_ptr<Tree_t> combine(std::vector<std::unique_ptr<Tree_t>>& trees, const std::set<otc::OttId>& incertae_sedis, boost::program_options::variables_map& args);
+std::unique_ptr<Tree_t> combine(std::vector<std::unique_ptr<Tree_t>>& trees, const otc::OttIdSet& incertae_sedis, boost::program_options::variables_map& args);
 
 #endif
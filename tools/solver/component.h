@@ -1,7 +1,6 @@
 #ifndef COMPONENT_H
 #define COMPONENT_H
 
-#include <list>
 #include <vector>
 #include <memory>  // for shared_ptr
 
@@ -11,21 +10,14 @@ struct Solution;
 // A non-trivial component
 struct component_t
 {
-    std::list<int> elements;
+    // The root of the component's taxon indices in the component_forest of its Solution,
+    // or -1 if it has none (yet, or any more, after being merged into another component).
+    int root = -1;
 
     std::shared_ptr<Solution> solution;
 
     std::vector<ConstRSplit> new_splits;
     std::vector<std::shared_ptr<Solution>> old_solutions;
-
-    std::vector<int> get_taxa(const std::vector<int>& other_taxa) const
-    {
-        std::vector<int> taxa;
-        taxa.reserve(elements.size());
-        for(auto index: elements)
-            taxa.push_back(other_taxa[index]);
-        return taxa;
-    }
 };
 
 typedef component_t* component_ref;
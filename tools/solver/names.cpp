@@ -18,7 +18,7 @@ using std::string;
 
 using namespace otc;
 
-Tree_t::node_type* find_mrca_of_desids(const set<OttId>& ids, const std::unordered_map<OttId, Tree_t::node_type*>& summaryOttIdToNode) {
+Tree_t::node_type* find_mrca_of_desids(const OttIdSet& ids, const std::unordered_map<OttId, Tree_t::node_type*>& summaryOttIdToNode) {
     int first = *ids.begin();
     auto node = summaryOttIdToNode.at(first);
     while( not is_subset(ids, node->get_data().des_ids) )
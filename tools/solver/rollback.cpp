@@ -1,7 +1,6 @@
 #include "rollback.h"
 
 using std::vector;
-using std::list;
 using std::shared_ptr;
 using std::optional;
 
@@ -10,16 +9,19 @@ void MergeRollbackInfo::unmerge(Solution& S)
     // Undo merging two components.
     if (c2)
     {
-        c2->elements.splice(c2->elements.end(), c1->elements, it, c1->elements.end());
-        for(auto& x: c2->elements)
-            S.component_for_index[x] = c2;
+        S.component_forest.undo(join);
+        c2->root = join.child;
+        S.component_for_root[c2->root] = c2;
     }
-    // Undo merge with trivial
-    else
+    // Undo creating c1 for a trivial component
+    else if (join.child == -1)
     {
-        S.component_for_index[c1->elements.back()] = nullptr;
-        c1->elements.pop_back();
+        S.component_for_root[join.root] = nullptr;
+        c1->root = -1;
     }
+    // Undo merge with trivial
+    else
+        S.component_forest.undo(join);
 
     if (old_solution)
         c1->solution = old_solution;
@@ -39,7 +41,8 @@ void SolutionRollbackInfo::rollback()
         S->components.clear();
 
         // If we are just going to _delete_ S later on, then this is a waste of time.
-        for(auto& c: S->component_for_index)
+        S->component_forest.reset();
+        for(auto& c: S->component_for_root)
             c = nullptr;
 
         return;
@@ -74,13 +77,13 @@ void SolutionRollbackInfo::rollback()
             assert(S->components[i]);
 
         for(int i=*n_orig_components;i<S->components.size();i++)
-            assert(S->components[i]->elements.empty());
+            assert(S->components[i]->root == -1);
 
         assert(*n_orig_components <= S->components.size());
         S->components.resize(*n_orig_components);
 
         for(int i=0;i<S->components.size();i++)
-            assert(not S->components[i]->elements.empty());
+            assert(S->components[i]->root != -1);
     }
 }
 
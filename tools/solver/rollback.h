@@ -2,7 +2,6 @@
 #define ROLLBACK_H
 
 #include <vector>
-#include <list>
 #include <memory> // for shared_ptr
 #include <optional>
 
@@ -13,7 +12,9 @@ struct MergeRollbackInfo
 {
     component_ref c1;
     component_ref c2;
-    std::list<int>::const_iterator it;
+    // If c2 is null, then join.child is the taxon index that was added to c1,
+    //   or -1 if c1 was created for taxon index join.root.
+    RollbackUnionFind::Join join;
 
     std::shared_ptr<Solution> old_solution;
 
@@ -1,65 +1,52 @@
 #include "tools/solver/rsplit.h"
-#include "otc/util.h"
+#include <ostream>
 
-using std::set;
-using std::vector;
+// Blocks start small, since most subproblems are, and double up to 16MB.
+constexpr std::size_t min_block_size = 1<<12;
+constexpr std::size_t max_block_size = 1<<22;
 
-RSplitObj::RSplitObj()
+int* SplitArena::allocate(std::size_t n)
 {
-    id = num++;
-}
-
-RSplitObj::RSplitObj(const set<int>& i, const set<int>& a)
-{
-    id = num++;
-    in  = set_to_vector(i);
-    set_difference(begin(a), end(a), begin(in), end(in), std::inserter(out, out.end()));
-}
-
-RSplitObj::RSplitObj(const set<int>& i, const vector<int>& a)
-{
-    id = num++;
-    in  = set_to_vector(i);
-    set_difference(begin(a), end(a), begin(in), end(in), std::inserter(out, out.end()));
+    if (blocks.empty() or block_used + n > block_size)
+    {
+        block_size = std::max(n, std::clamp(2*block_size, min_block_size, max_block_size));
+        blocks.push_back(std::make_unique_for_overwrite<int[]>(block_size));
+        block_used = 0;
+    }
+    int* ids = blocks.back().get() + block_used;
+    block_used += n;
+    return ids;
 }
 
-std::size_t RSplitObj::num = 0;
-
 std::ostream& operator<<(std::ostream& o, const RSplitObj& s)
 {
-    o<<"["<<s.in.size() + s.out.size()<<" tips] ";
-    for(auto& is: s.in)
+    o<<"["<<s.in().size() + s.out_size()<<" tips] ";
+    for(auto& is: s.in())
         o<<"ott"<<is<<" ";
     o<<"| ";
-    for(auto& os: s.out)
-        o<<"ott"<<os<<" ";
+    s.any_out([&](int os) {o<<"ott"<<os<<" "; return false;});
     return o;
 }
 
-RSplit split_from_include_exclude(const set<int>& i, const set<int>& e)
-{
-    RSplit s(new RSplitObj);
-    s->in = set_to_vector(i);
-    s->out = set_to_vector(e);
-    return s;
-}
-
 std::ostream& operator<<(std::ostream& o, const ConstRSplit& s)
 {
-    otc::write_separated_collection(o, s->in, " ") <<" | ";
-    if (s->out.size() < 100)
-        otc::write_separated_collection(o, s->out, " ");
-    else
+    const char* sep = "";
+    for(int i: s->in())
     {
-        auto it = s->out.begin();
-        for(int i=0;i<100;i++)
-            o << *it++ <<" ";
-        o << "...";
+        o<<sep<<i;
+        sep = " ";
     }
+    o<<" | ";
+    sep = "";
+    int n = 0;
+    bool more = s->any_out([&](int i)
+        {
+            if (n++ == 100) return true;
+            o<<sep<<i;
+            sep = " ";
+            return false;
+        });
+    if (more)
+        o << " ...";
     return o;
 }
-
-std::ostream& operator<<(std::ostream& o, const RSplit& s)
-{
-    return o<<(ConstRSplit(s));
-}
@@ -1,70 +1,117 @@
 #ifndef RSPLIT_H
 #define RSPLIT_H
 
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <ranges>
+#include <span>
 #include <vector>
-#include <optional>
-#include <set>
-#include <boost/smart_ptr/intrusive_ptr.hpp>
 
-struct RSplitObj
+/// A split of the taxa of a subproblem, which are numbered 0..n-1.
+/// The include group `in` is sorted.  The exclude group is either stored (sorted) as well,
+///   or is the taxa of the split's tree that are not in `in`.  Splits from the same tree
+///   share its taxa, so a split takes space for its include group only.
+class RSplitObj
 {
-    static std::size_t num;
+    std::span<const int> in_;
+    std::span<const int> out_or_all;
+    bool out_is_rest;
 
-    mutable int _refs = 0;
+public:
+    RSplitObj(std::span<const int> i, std::span<const int> o, bool rest)
+        :in_(i), out_or_all(o), out_is_rest(rest)
+    { }
 
-    friend inline void intrusive_ptr_release(RSplitObj* pThis)
-    {
-        if (--pThis->_refs == 0 ) {
-            delete pThis;
-        }
-    }
+    std::span<const int> in() const {return in_;}
 
-    friend inline void intrusive_ptr_add_ref(RSplitObj* pThis)
-    {
-        pThis->_refs++;
-    }
+    std::size_t out_size() const {return out_is_rest ? out_or_all.size() - in_.size() : out_or_all.size();}
 
-    friend inline void intrusive_ptr_release(const RSplitObj* pThis)
+    /// Calls f on each taxon in the exclude group, in order, until it returns true.
+    /// Returns true if it did.
+    template <typename F>
+    bool any_out(F f) const
     {
-        if(--const_cast<RSplitObj*>(pThis)->_refs == 0 ) {
-            delete const_cast<RSplitObj*>(pThis);
+        if (not out_is_rest)
+            return std::ranges::any_of(out_or_all, f);
+
+        // Scan the runs of taxa between the members of `in`, which are usually few.
+        auto from = out_or_all.begin();
+        for(int taxon: in_)
+        {
+            auto to = (*from == taxon) ? from : std::lower_bound(from, out_or_all.end(), taxon);
+            if (std::any_of(from, to, f))
+                return true;
+            from = to + 1;
         }
+        return std::any_of(from, out_or_all.end(), f);
     }
+};
 
-    friend inline void intrusive_ptr_add_ref(const RSplitObj* pThis)
+/// Splits are owned by their SplitArena, and live as long as it does.
+using ConstRSplit = const RSplitObj*;
+
+/// The splits of one subproblem.
+///
+/// Splits are made for every internal node of every input tree.  Allocating two vectors
+///   per split -- and a set per node to build them from -- dominated the time spent outside
+///   of BUILD, and storing every exclude group in full took O(#nodes * #taxa) space.
+///   The arena instead copies taxa into slices of a few large blocks of ints, and keeps
+///   the RSplitObjs in a deque.  Nothing is freed until the arena is.
+class SplitArena
+{
+    std::vector<std::unique_ptr<int[]>> blocks;
+    std::size_t block_size = 0;
+    std::size_t block_used = 0;
+    std::deque<RSplitObj> splits;
+
+    int* allocate(std::size_t n);
+
+public:
+    SplitArena() = default;
+    SplitArena(const SplitArena&) = delete;
+    SplitArena& operator=(const SplitArena&) = delete;
+
+    /// Copies a range of taxa (e.g. all the taxa of a tree) into the arena.
+    template <typename Range>
+    std::span<const int> add_taxa(const Range& taxa);
+
+    /// The split with include group `in` and exclude group `all` - `in`.
+    /// Both must be sorted, `in` must be a subset of `all`, and `all` must live as long
+    ///   as the arena, e.g. by coming from add_taxa( ).
+    template <typename Range>
+    ConstRSplit split_from_include(const Range& in, std::span<const int> all)
     {
-        const_cast<RSplitObj*>(pThis)->_refs++;
+        auto in_taxa = add_taxa(in);
+        assert(std::ranges::includes(all, in_taxa));
+        return &splits.emplace_back(in_taxa, all, true);
     }
 
-    std::vector<int> in;
-    std::vector<int> out;
-    std::optional<std::size_t> id;
+    /// The split with include group `in` and exclude group `out`, which must both be sorted.
+    template <typename Range1, typename Range2>
+    ConstRSplit split_from_include_exclude(const Range1& in, const Range2& out)
+    {
+        auto in_taxa = add_taxa(in);
+        return &splits.emplace_back(in_taxa, add_taxa(out), false);
+    }
 
-    RSplitObj();
-    RSplitObj(const std::set<int>& i, const std::set<int>& a);
-    RSplitObj(const std::set<int>& i, const std::vector<int>& a);
+    std::size_t size() const {return splits.size();}
 };
 
-// Reference-counted objects, with reference stored inside the object
-using RSplit = boost::intrusive_ptr<RSplitObj>;
-using ConstRSplit = boost::intrusive_ptr<const RSplitObj>;
+template <typename Range>
+std::span<const int> SplitArena::add_taxa(const Range& taxa)
+{
+    const std::size_t n = std::ranges::size(taxa);
+    int* ids = allocate(n);
+    std::ranges::copy(taxa, ids);
+    assert(std::is_sorted(ids, ids + n));
+    return {ids, n};
+}
 
 std::ostream& operator<<(std::ostream& o, const RSplitObj& s);
 
 std::ostream& operator<<(std::ostream& o, const ConstRSplit& s);
 
-std::ostream& operator<<(std::ostream& o, const RSplit& s);
-
-RSplit split_from_include_exclude(const std::set<int>& i, const std::set<int>& e);
-
-/// Create a SORTED vector from a set
-/// Better: myset | ranges::to<vector>
-template <typename T>
-std::vector<T> set_to_vector(const std::set<T>& s) {
-    std::vector<T> v;
-    v.reserve(s.size());
-    std::copy(s.begin(), s.end(), std::back_inserter(v));
-    return v;
-}
-
 #endif /* RSPLIT_H */
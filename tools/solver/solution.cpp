@@ -5,7 +5,16 @@ using std::unique_ptr;
 
 bool Solution::all_taxa_in_one_component() const
 {
-    return component_for_index[0] and component_for_index[0]->elements.size() == taxa.size();
+    auto component = component_for_index(0);
+    return component and component_size(*component) == taxa.size();
+}
+
+vector<int> Solution::taxa_of(const component_t& c) const
+{
+    vector<int> c_taxa;
+    c_taxa.reserve(component_size(c));
+    component_forest.for_each_member(c.root, [&](int index) {c_taxa.push_back(taxa[index]);});
+    return c_taxa;
 }
 
 bool Solution::valid() const
@@ -63,7 +72,7 @@ unique_ptr<Tree_t> Solution::get_tree() const
     // 3. Add children for trivial components
     for(int index=0;index<taxa.size();index++)
     {
-        if (not component_for_index[index])
+        if (not component_for_index(index))
         {
             auto taxon = taxa[index];
             auto node = tree->create_child(tree->get_root());
@@ -75,9 +84,5 @@ unique_ptr<Tree_t> Solution::get_tree() const
 }
 
 Solution::Solution(const vector<int>& t, bool r)
-    :taxa(t), component_for_index(taxa.size()), rollback(r)
-{}
-
-Solution::Solution(const component_t& c, const vector<int> other_taxa, bool r)
-    :Solution(c.get_taxa(other_taxa),r)
+    :taxa(t), component_forest(taxa.size()), component_for_root(taxa.size()), rollback(r)
 {}
@@ -7,6 +7,17 @@
 #include "rsplit.h"
 #include "component.h"
 #include "tree.h"
+#include "union_find.h"
+
+// The scratch state of one solve with BUILD/BUILDINC: indices[taxon] is the index of
+// taxon in the taxa of the Solution being worked on, or -1.  All the Solutions of one
+// solve share a context, so separate solves can run on separate threads.
+struct BuildContext
+{
+    std::vector<int> indices;
+
+    explicit BuildContext(int n_taxa);
+};
 
 struct Solution
 {
@@ -14,17 +25,24 @@ struct Solution
 
     std::vector<ConstRSplit> implied_splits;
 
-    std::vector< component_ref > component_for_index;
+    // The taxon indices of each non-trivial component form a set in component_forest, and
+    // component_for_root maps the root of each set to its component (or to nullptr for trivial ones).
+    RollbackUnionFind component_forest;
+    std::vector< component_ref > component_for_root;
     std::vector< std::shared_ptr<component_t> > components;
 
     // Counter for determining if this is a new Solution or a pre-existing one.
     int visited = 0;
     bool rollback = true;
 
+    component_ref component_for_index(int index) const {return component_for_root[component_forest.find(index)];}
+    int component_size(const component_t& c) const {return component_forest.set_size(c.root);}
+    std::vector<int> taxa_of(const component_t& c) const;
+
     bool all_taxa_in_one_component() const;
 
-    void initialize_taxon_index_map() const;
-    void clear_taxon_index_map() const;
+    void initialize_taxon_index_map(BuildContext& context) const;
+    void clear_taxon_index_map(BuildContext& context) const;
 
     std::vector<ConstRSplit> non_implied_splits_from_components() const;
     std::vector<ConstRSplit> splits_from_components() const;
@@ -42,7 +60,6 @@ struct Solution
     Solution(Solution&&) = default;
 
     Solution(const std::vector<int>& t, bool rollback);
-    Solution(const component_t& c, const std::vector<int> other_taxa, bool rollback);
 };
 
 #endif
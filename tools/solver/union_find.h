@@ -0,0 +1,93 @@
+#ifndef UNION_FIND_H
+#define UNION_FIND_H
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+/// A union-find forest over 0..n-1 whose joins can be undone, most recent first.
+///
+/// Sets are joined by size, and find( ) does not compress paths (that could not be undone),
+///   so find( ) takes O(log n) time, and join( ) and undo( ) take O(1).
+/// The members of each set are kept in the order in which they were joined, as a cycle
+///   through `next`, so that a set can be listed without a per-set container.
+class RollbackUnionFind
+{
+    std::vector<int> parent;    // parent[i] == i for roots
+    std::vector<int> size_;     // the size of a set, at its root
+    std::vector<int> last;      // the last member of a set, at its root
+    std::vector<int> next;      // the member after i, wrapping around
+
+public:
+    /// What undo( ) needs to know about a join( ).
+    struct Join
+    {
+        int root;
+        int child;
+        int old_last;
+    };
+
+    explicit RollbackUnionFind(int n)
+        :parent(n), size_(n, 1), last(n), next(n)
+    {
+        reset();
+    }
+
+    /// Makes every element a set of its own again.
+    void reset()
+    {
+        for(int i=0;i<parent.size();i++)
+            parent[i] = last[i] = next[i] = i;
+        std::fill(size_.begin(), size_.end(), 1);
+    }
+
+    int find(int i) const
+    {
+        while (parent[i] != i)
+            i = parent[i];
+        return i;
+    }
+
+    int set_size(int i) const {return size_[find(i)];}
+
+    /// Joins the sets whose roots are r1 and r2.
+    /// The members of the smaller set go after those of the larger one, and r1 wins ties.
+    Join join(int r1, int r2)
+    {
+        assert(r1 != r2 and parent[r1] == r1 and parent[r2] == r2);
+        if (size_[r2] > size_[r1])
+            std::swap(r1, r2);
+        Join j{r1, r2, last[r1]};
+        parent[r2] = r1;
+        size_[r1] += size_[r2];
+        std::swap(next[last[r1]], next[last[r2]]);
+        last[r1] = last[r2];
+        return j;
+    }
+
+    /// Undoes j, which must be the most recent join( ) that has not been undone.
+    void undo(const Join& j)
+    {
+        assert(parent[j.child] == j.root and parent[j.root] == j.root);
+        parent[j.child] = j.child;
+        size_[j.root] -= size_[j.child];
+        last[j.root] = j.old_last;
+        std::swap(next[j.old_last], next[last[j.child]]);
+    }
+
+    /// Calls f on each member of the set whose root is r, in the order they were joined.
+    template <typename F>
+    void for_each_member(int r, F f) const
+    {
+        assert(parent[r] == r);
+        int first = next[last[r]];
+        int i = first;
+        do {
+            f(i);
+            i = next[i];
+        } while (i != first);
+    }
+};
+
+#endif
@@ -297,6 +297,7 @@ void parse_source_edits_json(std::istream & inp,
 }
 
 std::list<TaxonomicJuniorSynonym> new_synonyms;
+StringArena new_synonym_strings; // backing store for the names and sources of new_synonyms
 std::set<const RTRichTaxNode *> deleted_nodes;
 std::set<const RTRichTaxNode *> detached_nodes;
 std::set<const RTRichTaxNode *> attached_nodes;
@@ -341,7 +342,9 @@ inline bool handle_alpha(const AlphaEdit & aed, RichTaxTree & tree,
             }
         }
     } else if (aed.operation == AlphaEditOp::ADDED_SYN) {
-        new_synonyms.emplace_back(aed.first_str, nd, aed.second_str);
+        new_synonyms.emplace_back(new_synonym_strings.add(aed.first_str),
+                                  nd,
+                                  new_synonym_strings.add(aed.second_str));
         TaxonomicJuniorSynonym & js = *new_synonyms.rbegin();
         nd_data->junior_synonyms.push_back(&js);
         if (tax_id == 1000949) {
@@ -27,7 +27,7 @@ void suppress_monotypic_fast(Tree_t& tree) {
         child->detach_this_node();
         nd->add_sib_on_right(child);
         nd->detach_this_node();
-        delete nd;
+        tree.delete_node(nd);
     }
 }
 
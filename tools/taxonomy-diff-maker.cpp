@@ -571,11 +571,11 @@ void TaxonomyDiffer::record_syn_diffs(const RTRichTaxNode *old_nd, const RTRichT
     map<string, set<string> > newpairs;
     const RTRichTaxNodeData & old_nd_data = old_nd->get_data();
     for (const auto js : old_nd_data.junior_synonyms) {
-        oldpairs[js->name].insert(js->source_string);
+        oldpairs[string(js->name)].insert(string(js->source_string));
     }
     const RTRichTaxNodeData & new_nd_data = new_nd->get_data();
     for (const auto js : new_nd_data.junior_synonyms) {
-        newpairs[js->name].insert(js->source_string);
+        newpairs[string(js->name)].insert(string(js->source_string));
     }
     for (auto op : oldpairs) {
         auto nIt = newpairs.find(op.first);
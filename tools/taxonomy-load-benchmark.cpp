@@ -0,0 +1,98 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+
+#include "otc/error.h"
+#include "otc/otcli.h"
+#include "otc/taxonomy/taxonomy.h"
+#include "otc/taxonomy/tsv_chunks.h"
+
+using namespace otc;
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace po = boost::program_options;
+using po::variables_map;
+
+variables_map parse_cmd_line(int argc,char* argv[]) {
+    using namespace po;
+    // named options
+    options_description invisible("Invisible options");
+    invisible.add_options()
+        ("taxonomy", value<string>(),"Filename for the taxonomy")
+        ;
+
+    options_description taxonomy("Taxonomy options");
+    taxonomy.add_options()
+        ("config,c",value<string>(),"Config file containing flags to filter")
+        ("clean",value<string>(),"Comma-separated string of flags to filter")
+        ("root,r", value<OttId>(), "OTT id of root node of subtree to keep")
+        ;
+
+    options_description benchmark("Benchmark options");
+    benchmark.add_options()
+        ("repeat,n",value<int>()->default_value(3),"Number of times to load the taxonomy with each loader")
+        ("rich","Load a RichTaxonomy (tree and synonyms.tsv) instead of the flat Taxonomy records")
+        ;
+
+    options_description visible;
+    visible.add(taxonomy).add(benchmark).add(otc::standard_options());
+
+    // positional options
+    positional_options_description p;
+    p.add("taxonomy", -1);
+
+    variables_map vm = otc::parse_cmd_line_standard(argc, argv,
+                                                    "Usage: otc-taxonomy-load-benchmark <taxonomy-dir> [OPTIONS]\n"
+                                                    "Time the sequential and parallel taxonomy.tsv/synonyms.tsv loaders.",
+                                                    visible, invisible, p);
+
+    return vm;
+}
+
+// Returns the fastest of `repeat` loads, in milliseconds, and the number of taxa loaded.
+std::pair<double, std::size_t> time_loads(const variables_map & args, bool parallel, int repeat) {
+    double best_ms = -1.0;
+    std::size_t num_taxa = 0;
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (args.count("rich")) {
+            auto taxonomy = load_rich_taxonomy(args, parallel);
+            num_taxa = taxonomy.get_tax_tree().get_data().id_to_node.size();
+        } else {
+            auto taxonomy = load_taxonomy(args, parallel);
+            num_taxa = taxonomy.size();
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (best_ms < 0 or elapsed.count() < best_ms) {
+            best_ms = elapsed.count();
+        }
+    }
+    return {best_ms, num_taxa};
+}
+
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+    try {
+        auto args = parse_cmd_line(argc, argv);
+        const int repeat = std::max(1, args["repeat"].as<int>());
+        auto [seq_ms, seq_taxa] = time_loads(args, false, repeat);
+        auto [par_ms, par_taxa] = time_loads(args, true, repeat);
+        if (seq_taxa != par_taxa) {
+            throw OTCError() << "The sequential loader read " << seq_taxa << " taxa, but the parallel loader read " << par_taxa;
+        }
+        cout << "taxa loaded: " << par_taxa << '\n';
+        cout << "sequential (std::getline) loader: " << seq_ms << " ms (best of " << repeat << ")\n";
+        cout << "parallel (mmap, " << num_tsv_parse_threads() << " threads) loader: " << par_ms << " ms (best of " << repeat << ")\n";
+        if (par_ms > 0) {
+            cout << "speedup: " << seq_ms / par_ms << "x" << endl;
+        }
+    } catch (std::exception& e) {
+        cerr << "otc-taxonomy-load-benchmark: Error! " << e.what() << std::endl;
+        return 1;
+    }
+}
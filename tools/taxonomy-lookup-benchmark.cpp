@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "otc/error.h"
+#include "otc/otcli.h"
+#include "otc/taxonomy/taxonomy.h"
+#include "otc/ctrie/context_ctrie_db.h"
+#include "otc/tnrs/context.h"
+
+using namespace otc;
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace po = boost::program_options;
+using po::variables_map;
+
+variables_map parse_cmd_line(int argc,char* argv[]) {
+    using namespace po;
+    // named options
+    options_description invisible("Invisible options");
+    invisible.add_options()
+        ("taxonomy", value<string>(),"Filename for the taxonomy")
+        ;
+
+    options_description taxonomy("Taxonomy options");
+    taxonomy.add_options()
+        ("config,c",value<string>(),"Config file containing flags to filter")
+        ("clean",value<string>(),"Comma-separated string of flags to filter")
+        ("root,r", value<OttId>(), "OTT id of root node of subtree to keep")
+        ;
+
+    options_description benchmark("Benchmark options");
+    benchmark.add_options()
+        ("queries,n",value<int>()->default_value(1000000),"Number of lookups of each kind")
+        ;
+
+    options_description visible;
+    visible.add(taxonomy).add(benchmark).add(otc::standard_options());
+
+    // positional options
+    positional_options_description p;
+    p.add("taxonomy", -1);
+
+    variables_map vm = otc::parse_cmd_line_standard(argc, argv,
+                                                    "Usage: otc-taxonomy-lookup-benchmark <taxonomy-dir> [OPTIONS]\n"
+                                                    "Time the id and name lookups behind the taxon_info and match_names web services.",
+                                                    visible, invisible, p);
+
+    return vm;
+}
+
+// Calls fn(queries[i % queries.size()]) num_queries times, and prints the throughput.
+//    fn returns the number of hits, which is summed so that the lookups are not optimized away.
+template<typename T, typename F>
+void time_lookups(const string & label, const vector<T> & queries, int num_queries, F && fn) {
+    std::size_t num_hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_queries; ++i) {
+        num_hits += fn(queries[i % queries.size()]);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    cout << label << ": " << num_queries << " lookups in " << elapsed.count() * 1000 << " ms ("
+         << (elapsed.count() > 0 ? num_queries / elapsed.count() : 0) << " per second, "
+         << num_hits << " hits)\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+    try {
+        auto args = parse_cmd_line(argc, argv);
+        const int num_queries = std::max(1, args["queries"].as<int>());
+        auto taxonomy = load_rich_taxonomy(args);
+        Context::cull_contexts_to_taxonomy(taxonomy);
+        const Context * context = determine_context({});
+        ContextAwareCTrieBasedDB match_db{*context, taxonomy};
+
+        const auto & tree = taxonomy.get_tax_tree();
+        vector<OttId> ids;
+        vector<string> names;
+        for (auto nd : iter_pre_const(tree)) {
+            ids.push_back(nd->get_ott_id());
+            names.push_back(string(nd->get_data().get_nonuniqname()));
+        }
+        for (const auto & tjs : taxonomy.get_synonyms_list()) {
+            names.push_back(string(tjs.name));
+        }
+        // Shuffle, so that the lookups do not follow the order in which the indexes were filled.
+        std::mt19937 rng(1);
+        std::shuffle(ids.begin(), ids.end(), rng);
+        std::shuffle(names.begin(), names.end(), rng);
+        cout << "taxa: " << ids.size() << ", names: " << names.size() << '\n';
+
+        const auto & tree_data = tree.get_data();
+        const RTRichTaxNode * context_root = taxonomy.included_taxon_from_id(context->ott_id);
+        time_lookups("taxon_info (included_taxon_from_id)", ids, num_queries, [&](OttId id) {
+            return taxonomy.included_taxon_from_id(id) != nullptr ? 1 : 0;
+        });
+        time_lookups("name_to_node", names, num_queries, [&](const string & name) {
+            return tree_data.name_to_node.count(name) + tree_data.homonym_to_nodes.count(name);
+        });
+        time_lookups("match_names exact (exact_query + to_taxa)", names, num_queries, [&](const string & name) {
+            return match_db.to_taxa(match_db.exact_query(name), context_root, taxonomy, true).size();
+        });
+    } catch (std::exception& e) {
+        cerr << "otc-taxonomy-lookup-benchmark: Error! " << e.what() << std::endl;
+        return 1;
+    }
+}
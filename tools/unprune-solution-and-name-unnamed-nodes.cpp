@@ -98,15 +98,35 @@ using std::vector;
 
 
 
-// adds ott_id to the des_ids field of every node from first_node down to
+// Ids waiting to be added to the des_ids fields of nodes.
+// Ids arrive in slice order, not id order, and inserting one id into an OttIdSet
+//    is O(size of the set) unless it lands at the end. So the ids of each node are
+//    gathered here and added with one insert_union per node.
+class PendingDesIds {
+    public:
+    void add(Node_t * nd, OttId ott_id) {
+        pending[nd].push_back(ott_id);
+    }
+    void add_to_des_ids() {
+        for (auto & [nd, ids] : pending) {
+            insert_union(nd->get_data().des_ids, [&ids](auto add) {add(ids);});
+        }
+        pending.clear();
+    }
+    private:
+    map<Node_t *, vector<OttId> > pending;
+};
+
+// queues ott_id for the des_ids field of every node from first_node down to
 // its ancestor anc_and_last_node (inclusive).
 void add_to_des_ids_for_anc(OttId ott_id,
                             Node_t *first_node,
                             Node_t *anc_and_last_node,
-                            const map<OttId, childParPair> & ott_to_tax) {
+                            const map<OttId, childParPair> & ott_to_tax,
+                            PendingDesIds & pending_des_ids) {
     assert(first_node);
     while (true) {
-        first_node->get_data().des_ids.insert(ott_id);
+        pending_des_ids.add(first_node, ott_id);
         if (first_node == anc_and_last_node) {
             return;
         }
@@ -436,16 +456,17 @@ void register_covering_of_incertae_sedis(OttId effective_tip_id,
                                           const map<OttId, Node_t *> & ott_to_supertree, 
                                           const UnpruneStats & unprune_stats,
                                           std::map<Node_t *, std::set<TaxSolnNdPair> > & curr_slice_inc_sed_map,
-                                          const map<OttId, childParPair> & ott_to_tax) {
+                                          const map<OttId, childParPair> & ott_to_tax,
+                                          PendingDesIds & pending_des_ids) {
     const auto & inc_sed_internals = unprune_stats.inc_sed_internals;
     auto anc = ott_to_tax.at(effective_tip_id).second;
-    effective_tip_taxon_node->get_data().des_ids.insert(effective_tip_id);
+    pending_des_ids.add(effective_tip_taxon_node, effective_tip_id);
     auto effTipSolnNd = ott_to_supertree.at(effective_tip_id);
     if (inc_sed_internals.find(effective_tip_taxon_node) != inc_sed_internals.end()) {
         curr_slice_inc_sed_map[effective_tip_taxon_node].insert(TaxSolnNdPair(effective_tip_taxon_node, effTipSolnNd));
     }
     while (anc &&  inc_sed_internals.find(anc) != inc_sed_internals.end()) {
-        anc->get_data().des_ids.insert(effective_tip_id);
+        pending_des_ids.add(anc, effective_tip_id);
         curr_slice_inc_sed_map[anc].insert(TaxSolnNdPair(effective_tip_taxon_node, effTipSolnNd));
         anc = ott_to_tax.at(anc->get_ott_id()).second;
     }
@@ -488,6 +509,7 @@ leaf_inc_sed_tuple_t detect_leaves_for_slice(Node_t * root_taxon,
     const OttIdSet * root_non_exclude = root_taxon->get_data().nonexcluded_ids;
     assert(root_non_exclude != nullptr);
     list<CarriedIDRealId > queued_for_flagging;
+    PendingDesIds pending_des_ids;
     const auto & inc_sed_map = unprune_stats.inc_sed_taxon_to_sampled_tips;
     for (auto effective_tip_id : supertree_des_ids) {
         auto effective_tip_taxon_node = ott_to_tax.at(effective_tip_id).first;
@@ -518,7 +540,8 @@ leaf_inc_sed_tuple_t detect_leaves_for_slice(Node_t * root_taxon,
                                                     ott_to_supertree, 
                                                     unprune_stats,
                                                     curr_slice_inc_sed_map,
-                                                    ott_to_tax);
+                                                    ott_to_tax,
+                                                    pending_des_ids);
                 if (effective_tip_taxon_node->is_tip()) {
                     taxa_leaves.insert(effective_tip_taxon_node);
                 }
@@ -542,6 +565,7 @@ leaf_inc_sed_tuple_t detect_leaves_for_slice(Node_t * root_taxon,
             }
         }    
     }
+    pending_des_ids.add_to_des_ids();
     bool root_taxon_is_inc_sed = inc_sed_map.find(root_taxon) != inc_sed_map.end();
     if (root_taxon_is_inc_sed) {
         inc_sed_that_are_proper_children.insert(root_taxon);
@@ -557,10 +581,11 @@ leaf_inc_sed_tuple_t detect_leaves_for_slice(Node_t * root_taxon,
     }
     for (auto [carriedTipId, threadedThroughOttId] : queued_for_flagging) {
         Node_t * effective_tip_taxon_node = ott_to_tax.at(carriedTipId).first;
-        add_to_des_ids_for_anc(carriedTipId, effective_tip_taxon_node, root_taxon, ott_to_tax);
+        add_to_des_ids_for_anc(carriedTipId, effective_tip_taxon_node, root_taxon, ott_to_tax, pending_des_ids);
         supertree_leaves.insert(ott_to_supertree.at(threadedThroughOttId));
         taxa_leaves.insert(effective_tip_taxon_node);
     }
+    pending_des_ids.add_to_des_ids();
     return make_tuple(taxa_leaves,
                       supertree_leaves,
                       curr_slice_inc_sed_map,
@@ -790,6 +815,7 @@ void unprune_slice(N *root_supertree_node,
         }
     }
     // all of the ones with MRCA deeper need to have the root_supertree_node registered as the "sampled tip" (even though it really isn't a tip)
+    vector<OttId> spike_ids;
     for (auto is_taxon_ptr : inc_sed_mapping_deeper) {
         auto & samp_tip_set = unprune_stats.inc_sed_taxon_to_sampled_tips.at(is_taxon_ptr);
         auto & stsp = curr_slice_inc_sed_map.at(is_taxon_ptr);
@@ -797,7 +823,7 @@ void unprune_slice(N *root_supertree_node,
             // for the deeper parts of the tree the tips in this slice need to be annotated
             //    to reflect the fact that they have already been included in a taxonomic node
             Node_t * spike_nd = tsp.first;
-            root_supertree_node->get_data().des_ids.insert(spike_nd->get_ott_id());
+            spike_ids.push_back(spike_nd->get_ott_id());
             //flagIncSedAs
             while (spike_nd != nullptr) {
                 if (inc_sed_mapping_deeper.count(spike_nd) > 0) {
@@ -810,6 +836,7 @@ void unprune_slice(N *root_supertree_node,
         }
         samp_tip_set.insert(root_supertree_node);
     }
+    insert_union(root_supertree_node->get_data().des_ids, [&spike_ids](auto add) {add(spike_ids);});
     unprune_stats.num_internals_merged_to_backbone += numMerged;
     unprune_stats.num_supertree_leaves_expanded += numExpanded;
 }
@@ -113,7 +113,7 @@ void combine2(vector<unique_ptr<Tree_t>>& trees, bool verbose) {
                              <<"  ancestral children = " << count_children_in_set(nodes.back(),ancestral);
                 }
                 // MTH this is where we should make note of which higher taxa do not make it into the solution.
-                collapse_split_and_del_node(nodes.back());
+                collapse_split_and_del_node(nodes.back(), taxonomy);
                 ancestral.erase(nodes.back());
                 nodes.pop_back();
             }
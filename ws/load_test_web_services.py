@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+"""Load test for otc-tol-ws persistent connections.
+
+Launches the server on the loopback interface twice: once with --keep-alive-timeout=0
+(every response closes its connection, so every request pays for a new TCP connection)
+and once with persistent connections. Each time, a number of client threads send the
+same requests for a fixed number of seconds, and the requests/sec are reported.
+"""
+import http.client
+import json
+import os
+import subprocess
+import sys
+import time
+from threading import Thread, Lock
+
+PIDFILE_NAME = "pidfile.txt"
+SERVER_OUT_ERR_FN = "load-test-server-stdouterr.txt"
+API_HEADERS = {'content-type' : 'application/json',
+               'accept' : 'application/json',
+              }
+# (url, body) pairs that every client thread cycles through.
+DEFAULT_REQUESTS = [("/v3/tree_of_life/about", {}),
+                    ("/v3/taxonomy/about", {}),
+                    ("/v3/tnrs/contexts", {}),
+                   ]
+
+def launch_server(exe_dir, taxonomy_dir, synth_par, port, server_threads, extra_args):
+    exe_path = os.path.join(exe_dir, 'otc-tol-ws')
+    pidfile_path = os.path.join(exe_dir, PIDFILE_NAME)
+    invocation = [exe_path,
+                  taxonomy_dir,
+                  "-D" + synth_par,
+                  "-p{}".format(pidfile_path),
+                  "-P{}".format(port),
+                  "--num-threads={}".format(server_threads),
+                  "--response-cache-mb=0"] + extra_args
+    sys.stderr.write('Launching with: "{}"\n'.format('" "'.join(invocation)))
+    with open(os.path.join(exe_dir, SERVER_OUT_ERR_FN), 'w') as sstdoe:
+        server = subprocess.Popen(invocation, stdout=sstdoe, stderr=subprocess.STDOUT)
+    wc = 0
+    while (server.poll() is None) and (not os.path.exists(pidfile_path)):
+        time.sleep(0.1)
+        if wc > 300:
+            server.kill()
+            raise RuntimeError("Assuming that the server has hung after waiting for pidfile")
+        wc += 1
+    if server.poll() is not None:
+        raise RuntimeError("The server exited with status {}".format(server.returncode))
+    return server
+
+def kill_server(server, exe_dir):
+    server.terminate()
+    try:
+        server.wait(timeout=10)
+    except subprocess.TimeoutExpired:
+        server.kill()
+        server.wait()
+    pidfile_path = os.path.join(exe_dir, PIDFILE_NAME)
+    if os.path.exists(pidfile_path):
+        os.remove(pidfile_path)
+
+class LoadStats(object):
+    def __init__(self):
+        self.lock = Lock()
+        self.num_requests = 0
+        self.num_errors = 0
+        self.num_connections = 0
+
+def client_loop(port, requests_to_send, stop_time, stats):
+    """Sends requests until stop_time. http.client reopens the connection whenever the
+    server has closed it, so the number of connections shows whether they were reused."""
+    conn = http.client.HTTPConnection("127.0.0.1", port, timeout=30)
+    num_requests, num_errors, num_connections = 0, 0, 0
+    i = 0
+    while time.time() < stop_time:
+        url, body = requests_to_send[i % len(requests_to_send)]
+        i += 1
+        try:
+            if conn.sock is None:
+                num_connections += 1
+            conn.request("POST", url, body=json.dumps(body), headers=API_HEADERS)
+            response = conn.getresponse()
+            response.read()
+            if response.status != 200:
+                num_errors += 1
+            if response.getheader("Connection", "").lower() == "close":
+                conn.close()
+        except (http.client.HTTPException, OSError):
+            num_errors += 1
+            conn.close()
+        num_requests += 1
+    conn.close()
+    with stats.lock:
+        stats.num_requests += num_requests
+        stats.num_errors += num_errors
+        stats.num_connections += num_connections
+
+def run_load(port, requests_to_send, client_threads, seconds):
+    stats = LoadStats()
+    stop_time = time.time() + seconds
+    threads = [Thread(target=client_loop, args=(port, requests_to_send, stop_time, stats))
+               for i in range(client_threads)]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - start
+    return stats, elapsed
+
+def report(label, stats, elapsed):
+    rate = stats.num_requests / elapsed if elapsed > 0 else 0.0
+    print("{}: {} requests in {:.2f} s = {:.1f} requests/sec over {} connections ({} errors)".format(
+        label, stats.num_requests, elapsed, rate, stats.num_connections, stats.num_errors))
+    return rate
+
+if __name__ == '__main__':
+    import argparse
+    parser = argparse.ArgumentParser(description="Measures the requests/sec of otc-tol-ws with and without persistent connections")
+    parser.add_argument('--taxonomy-dir', required=True, help='Directory that is the parent of the taxonomy files')
+    parser.add_argument('--synthesis-parent', required=True, help='Directory that is the parent of synthesis directories')
+    parser.add_argument('--exe-dir', required=True, help='Directory that holds the otc-tol-ws executable and which will be the working directory of the server.')
+    parser.add_argument('--server-port', default=1991, type=int, required=False, help='Port number for the server')
+    parser.add_argument('--server-threads', default=4, type=int, required=False, help='Number of threads for the server')
+    parser.add_argument('--client-threads', default=8, type=int, required=False, help='Number of client threads sending requests')
+    parser.add_argument('--seconds', default=10.0, type=float, required=False, help='Duration of each run')
+    parser.add_argument('--keep-alive-timeout', default=5, type=int, required=False, help='--keep-alive-timeout for the persistent connection run')
+    parser.add_argument('--keep-alive-max-requests', default=100, type=int, required=False, help='--keep-alive-max-requests for the persistent connection run')
+    parser.add_argument('--requests', default=None, required=False, help='JSON file with a list of [url, arguments] pairs to send instead of the default requests')
+    args = parser.parse_args()
+    if args.server_threads < 1 or args.client_threads < 1 or args.keep_alive_timeout < 1:
+        sys.exit("The number of threads and the keep-alive timeout must be positive.")
+    for d in [args.taxonomy_dir, args.synthesis_parent, args.exe_dir]:
+        if not os.path.isdir(d):
+            sys.exit('Directory "{}" does not exist.\n'.format(d))
+    if os.path.exists(os.path.join(args.exe_dir, PIDFILE_NAME)):
+        sys.exit("{} is in the way!\n".format(os.path.join(args.exe_dir, PIDFILE_NAME)))
+    requests_to_send = DEFAULT_REQUESTS
+    if args.requests is not None:
+        with open(args.requests) as inp:
+            requests_to_send = [tuple(r) for r in json.load(inp)]
+
+    runs = [("Connection: close", ["--keep-alive-timeout=0"]),
+            ("keep-alive", ["--keep-alive-timeout={}".format(args.keep_alive_timeout),
+                            "--keep-alive-max-requests={}".format(args.keep_alive_max_requests)]),
+           ]
+    rates = []
+    num_errors = 0
+    for label, extra_args in runs:
+        server = launch_server(args.exe_dir, args.taxonomy_dir, args.synthesis_parent,
+                               args.server_port, args.server_threads, extra_args)
+        try:
+            # warm up, so that both runs are timed against a server that has answered requests.
+            run_load(args.server_port, requests_to_send, 1, 0.5)
+            stats, elapsed = run_load(args.server_port, requests_to_send, args.client_threads, args.seconds)
+        finally:
+            kill_server(server, args.exe_dir)
+        rates.append(report(label, stats, elapsed))
+        num_errors += stats.num_errors
+    if rates[0] > 0:
+        print("keep-alive speedup: {:.2f}x".format(rates[1] / rates[0]))
+    sys.exit(1 if num_errors else 0)
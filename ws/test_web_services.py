@@ -1,14 +1,18 @@
 #!/usr/bin/env python
+import atexit
 import subprocess
 import requests
 import json
 import time
 import logging
+import shutil
 import sys
+import tempfile
 try:
     from Queue import Queue
 except:
     from queue import Queue
+import threading
 from threading import Thread, RLock
 _LOG = logging.getLogger(__name__)
 _LOG.setLevel(logging.DEBUG)
@@ -131,13 +135,17 @@ def start_worker(num_workers):
         t.start()
 
 #########################################################################################
-_verb_name_to_req_method = {"GET": requests.get,
-                            "PUT": requests.put,
-                            "POST": requests.post,
-                            "DELETE": requests.delete,
-                            "HEAD": requests.head,
-                            "OPTIONS": requests.options,
-                            }
+_VERB_NAMES = frozenset(["GET", "PUT", "POST", "DELETE", "HEAD", "OPTIONS"])
+# Each worker thread sends its requests through its own requests.Session, which reuses
+#   connections. So the tests exercise the server's persistent connections (including
+#   closing them after --keep-alive-max-requests), not just one connection per request.
+_THREAD_LOCAL = threading.local()
+def _http_session():
+    s = getattr(_THREAD_LOCAL, 'session', None)
+    if s is None:
+        s = requests.Session()
+        _THREAD_LOCAL.session = s
+    return s
 API_HEADERS = {'content-type' : 'application/json',
                'accept' : 'application/json',
               }
@@ -146,7 +154,9 @@ class WebServiceTestJob(object):
         self.url_fragment = test_description["url_fragment"]
         self.arguments = test_description["arguments"]
         v = test_description.get("verb", "GET").upper()
-        self.requests_method = _verb_name_to_req_method[v]
+        if v not in _VERB_NAMES:
+            raise KeyError(v)
+        self.verb = v
         self.service_prefix = service_prefix
         self.url = service_prefix + self.url_fragment
         self.expected = test_description.get('expected_response_payload')
@@ -185,9 +195,9 @@ class WebServiceTestJob(object):
             # 1. Make the call
             if self.arguments:
                 _LOG.debug("{} arguments = {}".format(self.name, repr(self.arguments)))
-                response = self.requests_method(self.url, headers=API_HEADERS, data=json.dumps(self.arguments))
+                response = _http_session().request(self.verb, self.url, headers=API_HEADERS, data=json.dumps(self.arguments))
             else:
-                response = self.requests_method(self.url)
+                response = _http_session().request(self.verb, self.url)
 
             # 2.A Raise exception if we expected status 200 and didn't get it.
             if self.expected_status == 200:
@@ -257,7 +267,7 @@ RUNNING_SERVER = None
 SERVER_PORT = 1985 # global, set by CLI. Needed by server launch and threads
 SERVER_OUT_ERR_FN = "test-server-stdouterr.txt"
 
-def launch_server(exe_dir, taxonomy_dir, synth_par, server_threads=4):
+def launch_server(exe_dir, taxonomy_dir, synth_par, server_threads=4, snapshot_dir=None):
     global RUNNING_SERVER
     exe_path = os.path.join(exe_dir, 'otc-tol-ws')
     pidfile_path = os.path.join(exe_dir, PIDFILE_NAME)
@@ -269,6 +279,8 @@ def launch_server(exe_dir, taxonomy_dir, synth_par, server_threads=4):
                   "-P{}".format(SERVER_PORT), 
                   "--num-threads={}".format(server_threads),
                   "-v"]
+    if snapshot_dir is not None:
+        invocation.append("--snapshot-dir={}".format(snapshot_dir))
     _LOG.debug('Launching with: "{}"'.format('" "'.join(invocation)))
     with open(server_std_out, 'w') as sstdoe:
         RUNNING_SERVER = subprocess.Popen(invocation,
@@ -389,6 +401,7 @@ if __name__ == '__main__':
     parser.add_argument('--server-threads', default=4, type=int, required=False, help='Number of threads for the server')
     parser.add_argument('--test-threads', default=8, type=int, required=False, help='Number of threads launched for running tests.')
     parser.add_argument('--secs-to-recheck-pid-file', default=0, type=int, required=False, help='If the pid file exists, the process will enter a loop sleeping and rechecking for this number of seconds.')
+    parser.add_argument('--test-snapshots', default=False, action="store_true", help='If true, the server is launched once to write binary snapshots to a new temporary directory, and the tests are run against a second launch that boots from those snapshots. The directory is removed afterwards.')
     parser.add_argument('--interactive', default=False, action="store_true", help='If true, run 1 thread and prompt for each next test')
     
     args = parser.parse_args()
@@ -441,12 +454,30 @@ if __name__ == '__main__':
         if os.path.exists(pidfile_path):
             sys.exit("{} is in the way!\n".format(pidfile_path))
 
+    # if testing snapshots, boot once from the text files to write them.
+    snapshot_dir = None
+    if args.test_snapshots:
+        snapshot_dir = tempfile.mkdtemp(prefix='otc-tol-ws-snapshots-')
+        atexit.register(shutil.rmtree, snapshot_dir, True)
+        for i in range(2):
+            if launch_server(exe_dir=exe_dir,
+                             taxonomy_dir=taxonomy_dir,
+                             synth_par=synth_par_path,
+                             server_threads=args.server_threads,
+                             snapshot_dir=snapshot_dir):
+                kill_server(exe_dir)
+                break
+            time.sleep(1)
+        if not os.path.exists(os.path.join(snapshot_dir, "taxonomy.otcsnap")):
+            sys.exit('The server did not write a taxonomy snapshot to "{}".\n'.format(snapshot_dir))
+
     # try launching otc-tol-ws and running the tests against it.
     for i in range(2):
         if launch_server(exe_dir=exe_dir,
                         taxonomy_dir=taxonomy_dir,
                         synth_par=synth_par_path,
-                        server_threads=args.server_threads):
+                        server_threads=args.server_threads,
+                        snapshot_dir=snapshot_dir):
             try:
                 num_passed, nf, ne = run_tests(test_par, to_run, args.test_threads)
             finally:
@@ -6,17 +6,26 @@
     #include <unistd.h>
 #endif
 #include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
 #include <restbed>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
 #include "otc/ws/tolwsadaptors.h"
 #include "otc/ws/find_node.h"
+#include "otc/ws/response_cache.h"
 #include "otc/otcli.h"
 #include "otc/ctrie/context_ctrie_db.h"
 #include "otc/tnrs/context.h"
 #include "otc/supertree_util.h"
 #include "otc/taxonomy/patching.h"
+#include "otc/snapshot.h"
+#include "otc/work_stealing_pool.h"
 #include "config.h"
 #ifdef HAVE_SYS_RESOURCE_H
 #include <sys/resource.h>
@@ -51,6 +60,7 @@ using std::pair;
 namespace otc {
 // global
 TreesToServe tts;
+ResponseCache response_cache;
 
 
 }// namespace otc
@@ -351,7 +361,11 @@ string taxon_addition_method_handler( const json& parsedargs )
     int num_new_ottids = extract_required_argument<int>(parsedargs, "new_ottids_required");
     if (taxa.size() > num_new_ottids)
         throw OTCBadRequest() << "Amendment mentions "<<taxa.size()<<" taxa, but "<<num_new_ottids<<" new OTT IDs.";
-    
+
+    // Bumped before patching (even if the patch fails part way), while the write lock
+    //    keeps readers out. Responses cached for the old generation are never served again.
+    tts.bump_taxonomy_generation();
+    response_cache.clear();
     return taxon_addition_ws_method(tts, locked_taxonomy, taxa);
 }
 
@@ -359,8 +373,11 @@ string taxon_addition_method_handler( const json& parsedargs )
 
 // 10,000 queries at .0016 second per query = 16 seconds
 const int MAX_NONFUZZY_QUERY_STRINGS = 10000;
-// 250 queries at .3 second per query = 75 seconds
-const int MAX_FUZZY_QUERY_STRINGS = 250;
+// 2,500 queries at .0014 second per query = 3.5 seconds
+//   otc-fuzzy-match-benchmark (1000 misspelled names against 418,000 names) measured
+//   .00222 second per query with the old banded DP and .0014 with the bit-parallel kernel.
+//   Only this limit is checked; the nonfuzzy one above has never been enforced.
+const int MAX_FUZZY_QUERY_STRINGS = 2500;
 
 static string LIFE_NODE_NAME = "life";
 static string LIFE_CONTEXT_NAME = "All life";
@@ -379,6 +396,10 @@ string tnrs_match_names_handler( const json& parsedargs ) {
         throw OTCBadRequest() << "The number of names and ids does not match. If you provide ids, then you "
                               << "must provide exactly as many ids as names.";
     }
+    if (do_approximate_matching and names.size() > MAX_FUZZY_QUERY_STRINGS) {
+        throw OTCBadRequest() << "Too many names: " << names.size() << " were submitted, but at most "
+                              << MAX_FUZZY_QUERY_STRINGS << " can be matched in one call with approximate matching.";
+    }
     auto locked_taxonomy = tts.get_readable_taxonomy();
     const auto & taxonomy = locked_taxonomy.first;
     return tnrs_match_names_ws_method(names, context_name, do_approximate_matching, ids, include_suppressed, taxonomy);
@@ -404,6 +425,20 @@ string tnrs_infer_context_handler( const json& parsedargs ) {
     return tnrs_infer_context_ws_method(names, taxonomy);
 }
 
+string cache_stats_method_handler( const json& ) {
+    auto stats = response_cache.get_stats();
+    json response;
+    response["enabled"] = response_cache.enabled();
+    response["hits"] = stats.hits;
+    response["misses"] = stats.misses;
+    response["evictions"] = stats.evictions;
+    response["num_entries"] = stats.num_entries;
+    response["num_bytes"] = stats.num_bytes;
+    response["byte_budget"] = stats.byte_budget;
+    response["taxonomy_generation"] = tts.get_taxonomy_generation();
+    return response.dump(1);
+}
+
 string conflict_status_method_handler( const json& parsed_args ) {
     auto tree1newick = extract_argument<string>(parsed_args, "tree1newick");
     auto tree1 = extract_argument<string>(parsed_args, "tree1");
@@ -450,35 +485,6 @@ bool_fp_set get_subdirs(const fs::path & dirname) {
 
 
 /// formerly tolwsadaptors.h
-inline otc::vec_src_node_ids extract_node_id_vec(otc::TreesToServe & tts,
-                                                 const nlohmann::json & sbv
-#                                                if defined(JOINT_MAPPING_VEC)
-                                                   , otc::SourceEdgeMappingType semt
-#                                                endif
-                                                 ) {
-#   if defined(JOINT_MAPPING_VEC)
-       using lel_t = otc::semt_ind_t;
-#   else
-       using lel_t = std::uint32_t;
-#   endif
-    std::list<lel_t> lsni;
-    for (nlohmann::json::const_iterator jit = sbv.begin(); jit != sbv.end(); ++jit) {
-        const std::string * kp = tts.get_stored_string(jit.key());
-        const auto & v = jit.value();
-        for (nlohmann::json::const_iterator vit = v.begin(); vit != v.end(); ++vit) {
-            const std::string * vp = tts.get_stored_string(*vit);
-            const auto sni_ind = tts.get_source_node_id_index(otc::src_node_id(kp, vp));
-#           if defined(JOINT_MAPPING_VEC)
-                lsni.push_back(lel_t(semt, sni_ind));
-#           else
-                lsni.push_back(sni_ind);
-#           endif
-        } 
-    }
-    return otc::vec_src_node_ids(lsni.begin(), lsni.end());
-}
-
-
 inline const nlohmann::json & extract_obj(const nlohmann::json &j, const char * field) {
     auto dc_el = j.find(field);
     if (dc_el == j.end()) {
@@ -569,8 +575,7 @@ multimap<string,string> request_headers(const string& rbody) {
     headers.insert({ "Access-Control-Allow-Origin", "*" });
     headers.insert({ "Access-Control-Max-Age","86400" });
     headers.insert({ "Cache-Control", "no-store, no-cache, must-revalidate, post-check=0, pre-check=0"});
-// Connection:Keep-Alive  -- I 
-//  We're calling 'close' so this doesn't make sense, I think...
+//  Connection and Keep-Alive are added by respond( ), which knows whether the connection stays open.
     headers.insert({ "Content-Length", ::to_string(rbody.length())});
 
 //  All of our replies should be JSON, so that users can unconditionally parse the response a JSON.
@@ -608,6 +613,98 @@ multimap<string,string> options_headers() {
     return headers;
 }
 
+// Persistent connections. A keep_alive_timeout of 0 closes the connection after every
+//    response, which is what otc-tol-ws always did before.
+chrono::seconds keep_alive_timeout{0};
+unsigned keep_alive_max_requests = 100;
+
+// Counts the requests answered on each open connection. restbed reuses the Session for
+//    every request on a connection, so the Session is the key. Entries of sessions that
+//    are closed by the client or by the idle timeout are pruned lazily; the weak_ptr tells
+//    us when a Session address has been reused by a new connection.
+class SessionRequestCounts {
+    std::mutex mutex;
+    std::unordered_map<const Session*, pair<std::weak_ptr<Session>, unsigned>> counts;
+    std::size_t prune_at = 1024;
+  public:
+    unsigned increment(const shared_ptr<Session>& session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& [weak_session, count] = counts[session.get()];
+        if (weak_session.lock() != session) {
+            weak_session = session;
+            count = 0;
+        }
+        const unsigned n = ++count;
+        if (counts.size() >= prune_at) {
+            for (auto it = counts.begin(); it != counts.end(); ) {
+                it = it->second.first.expired() ? counts.erase(it) : std::next(it);
+            }
+            prune_at = std::max<std::size_t>(1024, 2*counts.size());
+        }
+        return n;
+    }
+    void erase(const shared_ptr<Session>& session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        counts.erase(session.get());
+    }
+} session_request_counts;
+
+bool header_value_is(const string& value, const string& expected) {
+    return boost::iequals(boost::trim_copy(value), expected);
+}
+
+// HTTP/1.1 connections are persistent unless the client sends "Connection: close";
+//    HTTP/1.0 clients have to ask for "Connection: keep-alive".
+bool client_wants_keep_alive(const Request& request) {
+    const string connection = request.get_header("Connection", string());
+    if (request.get_version() < 1.1) {
+        return header_value_is(connection, "keep-alive");
+    }
+    return not header_value_is(connection, "close");
+}
+
+// Sends the response, and either waits for the next request on the same connection or
+//    closes it.
+void respond(const shared_ptr< Session >& session, int status, const string& rbody, multimap<string,string> headers) {
+    if (keep_alive_timeout.count() == 0) {
+        session->close( status, rbody, headers );
+        return;
+    }
+    unsigned n = 0;
+    if (client_wants_keep_alive(*session->get_request())) {
+        n = session_request_counts.increment(session);
+    }
+    if (n == 0 or n >= keep_alive_max_requests) {
+        session_request_counts.erase(session);
+        headers.insert({ "Connection", "close"});
+        session->close( status, rbody, headers );
+        return;
+    }
+    headers.insert({ "Connection", "keep-alive"});
+    headers.insert({ "Keep-Alive", "timeout=" + to_string(keep_alive_timeout.count()) + ", max=" + to_string(keep_alive_max_requests - n)});
+    session->yield( status, rbody, headers );
+}
+
+void respond(const shared_ptr< Session >& session, int status, const string& rbody) {
+    respond(session, status, rbody, request_headers(rbody));
+}
+
+// Set by --server-timing.
+bool send_server_timing = false;
+
+// With --server-timing, adds a Server-Timing header with the milliseconds since start, so
+//  that clients can tell the time spent computing a response from the time spent sending it.
+void respond(const shared_ptr< Session >& session, int status, const string& rbody, chrono::steady_clock::time_point start) {
+    auto headers = request_headers(rbody);
+    if (send_server_timing) {
+        chrono::duration<double, std::milli> elapsed = chrono::steady_clock::now() - start;
+        ostringstream timing;
+        timing << "app;dur=" << std::fixed << std::setprecision(3) << elapsed.count();
+        headers.insert({ "Server-Timing", timing.str()});
+    }
+    respond(session, status, rbody, headers);
+}
+
 // OK, so I want to make something like OTCWebError, but add the ability to pass back
 // some JSON along with the error.
 
@@ -628,27 +725,32 @@ std::string error_response(const string& path, const OTCWebError& e1) {
     return e2.json().dump(4)+"\n";
 }
 
+// Computes a response body. The body is shared rather than copied, so that a body held by
+//    response_cache can be sent as it is.
+using shared_body_fn = std::function<ResponseCache::Response(const json&)>;
+
 std::function<void(const shared_ptr< Session > session)>
-create_method_handler(const string& path, const std::function<std::string(const json&)> process_request) {
+create_method_handler(const string& path, const shared_body_fn process_request) {
     return [=](const shared_ptr< Session > session ) {
         const auto request = session->get_request( );
         size_t content_length = request->get_header( "Content-Length", 0 );
         session->fetch( content_length, [ path, process_request, request ]( const shared_ptr< Session > session, const Bytes & body ) {
+                const auto start = chrono::steady_clock::now();
                 try {
                     LOG(DEBUG)<<"request: "<<path;
                     json parsedargs = parse_body_or_throw(body);
                     LOG(DEBUG)<<"   argument "<<parsedargs.dump(1);
                     auto rbody = process_request(parsedargs);
                     LOG(DEBUG)<<"request: DONE";
-                    session->close( OK, rbody, request_headers(rbody) );
+                    respond( session, OK, *rbody, start );
                 } catch (OTCWebError& e) {
                     LOG(DEBUG) << "OTCWebError: " << e.what();
                     string rbody = error_response(path,e);
-                    session->close( e.status_code(), rbody, request_headers(rbody) );
+                    respond( session, e.status_code(), rbody, start );
                 } catch (OTCError& e) {
                     LOG(DEBUG) << "OTCError: " << e.what();
                     string rbody = error_response(path,e);
-                    session->close( 500, rbody, request_headers(rbody) );
+                    respond( session, 500, rbody, start );
                 } catch (std::exception& e) {
                     LOG(DEBUG) << "std::exception: " << e.what();
                     throw;
@@ -669,6 +771,7 @@ json request_to_json(const Request& request) {
 std::function<void(const shared_ptr< Session > session)>
 create_GET_method_handler(const string& path, const std::function<std::string(const json&)> process_request) {
     return [=](const shared_ptr< Session > session ) {
+        const auto start = chrono::steady_clock::now();
         try {
             LOG(DEBUG)<<"request: "<<path;
             const auto& request = session->get_request( );
@@ -676,22 +779,22 @@ create_GET_method_handler(const string& path, const std::function<std::string(co
             LOG(DEBUG)<<"   argument "<<parsedargs.dump(1);
             auto rbody = process_request(parsedargs);
             LOG(DEBUG)<<"request: DONE";
-            session->close( OK, rbody, request_headers(rbody) );
+            respond( session, OK, rbody, start );
         } catch (OTCWebError& e) {
             string rbody = error_response(path, e);
-            session->close( e.status_code(), rbody, request_headers(rbody) );
+            respond( session, e.status_code(), rbody, start );
         } catch (OTCError& e) {
             string rbody = error_response(path, e);
-            session->close( 500, rbody, request_headers(rbody) );
+            respond( session, 500, rbody, start );
         }
     };
 }
 
 void options_method_handler( const shared_ptr< Session > session ) {
-    session->close( OK, "", options_headers() );
+    respond( session, OK, "", options_headers() );
 }
 
-shared_ptr< Resource > path_handler(const string& path, std::function<std::string(const json &)> process_request) {
+shared_ptr< Resource > shared_body_path_handler(const string& path, shared_body_fn process_request) {
     auto r_subtree = make_shared< Resource >( );
     r_subtree->set_path( path );
     r_subtree->set_method_handler( "POST", create_method_handler(path,process_request));
@@ -699,8 +802,92 @@ shared_ptr< Resource > path_handler(const string& path, std::function<std::strin
     return r_subtree;
 }
 
+shared_ptr< Resource > path_handler(const string& path, std::function<std::string(const json &)> process_request) {
+    return shared_body_path_handler(path, [process_request](const json& parsedargs) {
+        return make_shared<const string>(process_request(parsedargs));
+    });
+}
+
+// The key of a response in response_cache. json objects are ordered by key, so
+//    dump() gives the same string for equivalent arguments.
+string response_cache_key(const string& path, const json& parsedargs) {
+    string synth_id = tts.get_default_tree();
+    if (auto sit = parsedargs.find("synth_id"); sit != parsedargs.end() and sit->is_string()) {
+        synth_id = sit->get<string>();
+    }
+    return make_response_cache_key(path, synth_id, tts.get_taxonomy_generation(), parsedargs.dump());
+}
+
+// Like path_handler, but responses are stored in response_cache. Only for services whose
+//    response depends on nothing but the arguments, the synthetic tree and the taxonomy.
+//    Errors are not cached.
+shared_ptr< Resource > cached_path_handler(const string& path, std::function<std::string(const json &)> process_request) {
+    auto cached_process_request = [path, process_request](const json& parsedargs) -> ResponseCache::Response {
+        if (not response_cache.enabled()) {
+            return make_shared<const string>(process_request(parsedargs));
+        }
+        const string key = response_cache_key(path, parsedargs);
+        if (auto hit = response_cache.get(key)) {
+            return hit;
+        }
+        auto rbody = make_shared<const string>(process_request(parsedargs));
+        response_cache.put(key, rbody);
+        return rbody;
+    };
+    return shared_body_path_handler(path, cached_process_request);
+}
+
 
 
+// Opens the taxonomy snapshot in snapshot_dir if it exists and is up to date.
+//  Returns nullptr (after logging why) if the snapshot cannot be used.
+unique_ptr<SnapshotReader> open_taxonomy_snapshot(const po::variables_map & args,
+                                                  const fs::path & snapshot_path) {
+    if (not fs::is_regular_file(snapshot_path)) {
+        LOG(INFO) << "no taxonomy snapshot at " << snapshot_path;
+        return nullptr;
+    }
+    try {
+        auto snapshot = std::make_unique<SnapshotReader>(snapshot_path.native(), SnapshotKind::TAXONOMY, TAXONOMY_SNAPSHOT_FORMAT_VERSION);
+        auto reason = taxonomy_snapshot_stale_reason(*snapshot, get_taxonomy_dir(args));
+        if (not reason.empty()) {
+            LOG(INFO) << "ignoring taxonomy snapshot " << snapshot_path << " because " << reason;
+            return nullptr;
+        }
+        return snapshot;
+    } catch (const std::exception & x) {
+        LOG(WARNING) << "Could not use taxonomy snapshot " << snapshot_path << ": " << x.what();
+    }
+    return nullptr;
+}
+
+PatchableTaxonomy load_taxonomy_for_server(const po::variables_map & args,
+                                           unique_ptr<SnapshotReader> & snapshot) {
+    if (snapshot) {
+        try {
+            return load_patchable_taxonomy(args, *snapshot);
+        } catch (const std::exception & x) {
+            LOG(WARNING) << "Could not read taxonomy snapshot \"" << snapshot->get_path() << "\": " << x.what();
+            snapshot.reset();
+        }
+    }
+    return load_patchable_taxonomy(args);
+}
+
+void write_taxonomy_snapshot(const fs::path & snapshot_path,
+                             const PatchableTaxonomy & taxonomy,
+                             const ContextAwareCTrieBasedDB & ct) {
+    try {
+        SnapshotWriter snapshot(snapshot_path.native(), SnapshotKind::TAXONOMY, TAXONOMY_SNAPSHOT_FORMAT_VERSION);
+        taxonomy.write_snapshot(snapshot);
+        ct.write_snapshot(snapshot, taxonomy);
+        snapshot.commit();
+        LOG(INFO) << "wrote taxonomy snapshot " << snapshot_path;
+    } catch (const std::exception & x) {
+        LOG(WARNING) << "Could not write taxonomy snapshot " << snapshot_path << ": " << x.what();
+    }
+}
+
 int run_server(const po::variables_map & args) {
     time_t start_time;
     time(&start_time);
@@ -721,6 +908,13 @@ int run_server(const po::variables_map & args) {
     if (args.count("ignore-broken-syn")) {
         Taxonomy::tolerate_synonyms_to_unknown_id = true;
     }
+    response_cache.set_byte_budget(std::size_t(std::max(0, args["response-cache-mb"].as<int>())) << 20);
+    keep_alive_timeout = chrono::seconds(std::max(0, args["keep-alive-timeout"].as<int>()));
+    keep_alive_max_requests = std::max(1, args["keep-alive-max-requests"].as<int>());
+    send_server_timing = args.count("server-timing") > 0;
+    if (args.count("work-threads")) {
+        set_shared_work_pool_size(unsigned(std::max(0, args["work-threads"].as<int>())));
+    }
 
 
     if (!args.count("tree-dir")) {
@@ -729,9 +923,17 @@ int run_server(const po::variables_map & args) {
     }
     const fs::path topdir{args["tree-dir"].as<string>()};
 
+    fs::path snapshot_dir;
+    unique_ptr<SnapshotReader> tax_snapshot;
+    if (args.count("snapshot-dir")) {
+        snapshot_dir = args["snapshot-dir"].as<string>();
+        fs::create_directories(snapshot_dir);
+        tax_snapshot = open_taxonomy_snapshot(args, snapshot_dir / "taxonomy.otcsnap");
+    }
+
     // Must load taxonomy before trees
     LOG(INFO) << "reading taxonomy...";
-    PatchableTaxonomy taxonomy = load_patchable_taxonomy(args);
+    PatchableTaxonomy taxonomy = load_taxonomy_for_server(args, tax_snapshot);
     
     auto nc = Context::cull_contexts_to_taxonomy(taxonomy);
     LOG(INFO) << nc << " taxonomy contexts retained...";
@@ -740,8 +942,23 @@ int run_server(const po::variables_map & args) {
     if (c == nullptr) {
         throw OTCError() << "no context found for entire taxonomy";
     }
-    ContextAwareCTrieBasedDB ct{*c, taxonomy};
-    taxonomy.set_fuzzy_matcher(&ct);
+    optional<ContextAwareCTrieBasedDB> ct;
+    if (tax_snapshot) {
+        try {
+            ct.emplace(*c, taxonomy, *tax_snapshot);
+        } catch (const std::exception & x) {
+            LOG(WARNING) << "Could not read the name matcher from \"" << tax_snapshot->get_path() << "\": " << x.what();
+            ct.reset();
+        }
+    }
+    if (not ct) {
+        ct.emplace(*c, taxonomy);
+        if (not snapshot_dir.empty()) {
+            write_taxonomy_snapshot(snapshot_dir / "taxonomy.otcsnap", taxonomy, *ct);
+        }
+    }
+    tax_snapshot.reset();
+    taxonomy.set_fuzzy_matcher(&(*ct));
 
     time_t post_tax_time;
     time(&post_tax_time);
@@ -749,7 +966,7 @@ int run_server(const po::variables_map & args) {
 
     // Now load trees
     auto tax_version_check = args.at("tax-version-check").as<string>();
-    if (!read_trees(topdir, tts, tax_version_check)) {
+    if (!read_trees(topdir, tts, tax_version_check, snapshot_dir)) {
         return 2;
     }
     time_t post_trees_time;
@@ -761,18 +978,18 @@ int run_server(const po::variables_map & args) {
 
     ////// v3 ROUTES
     // tree web services
-    auto v3_r_about            = path_handler(v3_prefix + "/tree_of_life/about", about_method_handler);
-    auto v3_r_node_info        = path_handler(v3_prefix + "/tree_of_life/node_info", node_info_method_handler );
-    auto v3_r_mrca             = path_handler(v3_prefix + "/tree_of_life/mrca", mrca_method_handler );
-    auto v3_r_subtree          = path_handler(v3_prefix + "/tree_of_life/subtree", process_subtree);
-    auto v3_r_induced_subtree  = path_handler(v3_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler );
+    auto v3_r_about            = cached_path_handler(v3_prefix + "/tree_of_life/about", about_method_handler);
+    auto v3_r_node_info        = cached_path_handler(v3_prefix + "/tree_of_life/node_info", node_info_method_handler );
+    auto v3_r_mrca             = cached_path_handler(v3_prefix + "/tree_of_life/mrca", mrca_method_handler );
+    auto v3_r_subtree          = cached_path_handler(v3_prefix + "/tree_of_life/subtree", process_subtree);
+    auto v3_r_induced_subtree  = cached_path_handler(v3_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler );
 
     // taxonomy web services
-    auto v3_r_tax_about        = path_handler(v3_prefix + "/taxonomy/about", tax_about_method_handler );
-    auto v3_r_taxon_info       = path_handler(v3_prefix + "/taxonomy/taxon_info", taxon_info_method_handler );
-    auto v3_r_taxon_flags      = path_handler(v3_prefix + "/taxonomy/flags", taxon_flags_method_handler );
-    auto v3_r_taxon_mrca       = path_handler(v3_prefix + "/taxonomy/mrca", taxon_mrca_method_handler );
-    auto v3_r_taxon_subtree    = path_handler(v3_prefix + "/taxonomy/subtree", taxon_subtree_method_handler );
+    auto v3_r_tax_about        = cached_path_handler(v3_prefix + "/taxonomy/about", tax_about_method_handler );
+    auto v3_r_taxon_info       = cached_path_handler(v3_prefix + "/taxonomy/taxon_info", taxon_info_method_handler );
+    auto v3_r_taxon_flags      = cached_path_handler(v3_prefix + "/taxonomy/flags", taxon_flags_method_handler );
+    auto v3_r_taxon_mrca       = cached_path_handler(v3_prefix + "/taxonomy/mrca", taxon_mrca_method_handler );
+    auto v3_r_taxon_subtree    = cached_path_handler(v3_prefix + "/taxonomy/subtree", taxon_subtree_method_handler );
 
     auto v3_r_taxon_addition   = path_handler(v3_prefix + "/taxonomy/process_additions", taxon_addition_method_handler );
 
@@ -798,18 +1015,18 @@ int run_server(const po::variables_map & args) {
 
     // tree web services
     auto v4_r_available_trees  = path_handler(v4_prefix + "/tree_of_life/available_trees", available_trees_method_handler);
-    auto v4_r_about            = path_handler(v4_prefix + "/tree_of_life/about", about_method_handler);
-    auto v4_r_node_info        = path_handler(v4_prefix + "/tree_of_life/node_info", node_info_method_handler );
-    auto v4_r_mrca             = path_handler(v4_prefix + "/tree_of_life/mrca", mrca_method_handler );
-    auto v4_r_subtree          = path_handler(v4_prefix + "/tree_of_life/subtree", process_subtree);
-    auto v4_r_induced_subtree  = path_handler(v4_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler );
+    auto v4_r_about            = cached_path_handler(v4_prefix + "/tree_of_life/about", about_method_handler);
+    auto v4_r_node_info        = cached_path_handler(v4_prefix + "/tree_of_life/node_info", node_info_method_handler );
+    auto v4_r_mrca             = cached_path_handler(v4_prefix + "/tree_of_life/mrca", mrca_method_handler );
+    auto v4_r_subtree          = cached_path_handler(v4_prefix + "/tree_of_life/subtree", process_subtree);
+    auto v4_r_induced_subtree  = cached_path_handler(v4_prefix + "/tree_of_life/induced_subtree", induced_subtree_method_handler );
 
     // taxonomy web services
-    auto v4_r_tax_about        = path_handler(v4_prefix + "/taxonomy/about", tax_about_method_handler );
-    auto v4_r_taxon_info       = path_handler(v4_prefix + "/taxonomy/taxon_info", taxon_info_method_handler );
-    auto v4_r_taxon_flags      = path_handler(v4_prefix + "/taxonomy/flags", taxon_flags_method_handler );
-    auto v4_r_taxon_mrca       = path_handler(v4_prefix + "/taxonomy/mrca", taxon_mrca_method_handler );
-    auto v4_r_taxon_subtree    = path_handler(v4_prefix + "/taxonomy/subtree", taxon_subtree_method_handler );
+    auto v4_r_tax_about        = cached_path_handler(v4_prefix + "/taxonomy/about", tax_about_method_handler );
+    auto v4_r_taxon_info       = cached_path_handler(v4_prefix + "/taxonomy/taxon_info", taxon_info_method_handler );
+    auto v4_r_taxon_flags      = cached_path_handler(v4_prefix + "/taxonomy/flags", taxon_flags_method_handler );
+    auto v4_r_taxon_mrca       = cached_path_handler(v4_prefix + "/taxonomy/mrca", taxon_mrca_method_handler );
+    auto v4_r_taxon_subtree    = cached_path_handler(v4_prefix + "/taxonomy/subtree", taxon_subtree_method_handler );
 
     auto v4_r_taxon_addition   = path_handler(v4_prefix + "/taxonomy/process_additions", taxon_addition_method_handler );
 
@@ -822,11 +1039,19 @@ int run_server(const po::variables_map & args) {
     // conflict
     auto v4_r_conflict_status  = path_handler(v4_prefix + "/conflict/conflict-status", conflict_status_method_handler );
 
+    // response cache
+    auto v4_r_cache_stats      = path_handler(v4_prefix + "/cache/stats", cache_stats_method_handler );
+
     /////  SETTINGS
     auto settings = make_shared< Settings >( );
     settings->set_port( port_number );
     settings->set_worker_limit( num_threads );
-    settings->set_default_header( "Connection", "close" );
+    if (keep_alive_timeout.count() > 0) {
+        // restbed drops connections that are idle for longer than the connection timeout.
+        settings->set_connection_timeout( keep_alive_timeout );
+    } else {
+        settings->set_default_header( "Connection", "close" );
+    }
     
     Service service;
     global_service_ptr = &service;
@@ -866,10 +1091,11 @@ int run_server(const po::variables_map & args) {
     service.publish( v4_r_tnrs_contexts );
     service.publish( v4_r_tnrs_infer_context );
     service.publish( v4_r_conflict_status );
+    service.publish( v4_r_cache_stats );
 
     service.set_signal_handler( SIGINT, sigterm_handler );
     service.set_signal_handler( SIGTERM, sigterm_handler );
-    LOG(INFO) << "starting service with " << num_threads << " threads on port " << port_number << "...";
+    LOG(INFO) << "starting service with " << num_threads << " threads on port " << port_number << " (" << shared_work_pool().num_threads() << " shared work threads)...";
     time_t service_prep_time;
     time(&service_prep_time);
     LOG(INFO) << "Taxonomy reading took " << difftime(post_tax_time, start_time) << " seconds.";
@@ -903,8 +1129,14 @@ po::variables_map parse_cmd_line(int argc, char* argv[]) {
         ("crash,C","Intentionally SEGFAULT.")
         ("pidfile,p",value<string>(),"filepath for PID")
         ("num-threads,n",value<int>(),"number of threads")
+        ("work-threads",value<int>(),"Number of threads, besides the request's own, that split up the names of a match_names request. They are shared by all requests, and also parse the taxonomy at startup. Default: one less than the number of cores. 0 matches names on the request's thread only.")
         ("ignore-broken-syn","If passed in, the presence of a synonym mapping to a non-existent ID will just be ignored.")
 	("tax-version-check",value<string>()->default_value("exact"),"Should we load synth trees built with an older taxonomy: 'exact' or 'no-check'.")
+        ("response-cache-mb",value<int>()->default_value(256),"Memory budget (in MB) for caching responses of the tree_of_life and taxonomy services. 0 disables the cache.")
+        ("keep-alive-timeout",value<int>()->default_value(5),"Seconds an idle persistent connection is kept open. 0 closes the connection after every response.")
+        ("keep-alive-max-requests",value<int>()->default_value(100),"Maximum number of requests answered on one persistent connection.")
+        ("server-timing","Add a Server-Timing header with the time spent computing each response.")
+        ("snapshot-dir",value<string>(),"Directory for binary snapshots of the taxonomy and synthetic trees. Up-to-date snapshots are read instead of the text files; missing or stale ones are (re)written.")
         ;
 
     options_description visible;
@@ -924,32 +1156,33 @@ po::variables_map parse_cmd_line(int argc, char* argv[]) {
 
 /// end formerly tolwsadaptors.cpp
 namespace otc {
-bool read_tree_and_annotations(const fs::path & configpath,
-                               const fs::path & treepath,
-                               const fs::path & annotationspath,
-                               const fs::path & brokentaxapath,
-                               const fs::path & contestingtrees_path,
-                               TreesToServe & tts,
-			       const string& tax_version_check);
+unique_ptr<LoadedSummaryTree> read_tree_and_annotations(const fs::path & configpath,
+                                                        const fs::path & treepath,
+                                                        const fs::path & annotationspath,
+                                                        const fs::path & brokentaxapath,
+                                                        const fs::path & contestingtrees_path,
+                                                        const TreesToServe & tts,
+                                                        const string& tax_version_check,
+                                                        const fs::path & snapshot_path);
 
 // Globals. TODO: lock if we read twice
 fp_set checked_dirs;
 fp_set known_tree_dirs;
 
-bool read_trees(const fs::path & dirname, TreesToServe & tts, const string& tax_version_check) {
+// The directories are read in parallel, each into a LoadedSummaryTree of its own, and
+//  then registered one at a time in the order of their paths.
+bool read_trees(const fs::path & dirname, TreesToServe & tts, const string& tax_version_check, const fs::path & snapshot_dir) {
     auto [is_dir, subdir_set] = get_subdirs(dirname);
     if (not is_dir) {
         return false;
     }
+    vector<fs::path> tree_dirs;
     for (auto p : subdir_set) {
         if (!contains(checked_dirs, p)) {
             checked_dirs.insert(p);
             fs::path configpath = p / "config";
-
             fs::path treepath = p / "labelled_supertree" / "labelled_supertree.tre";
-            fs::path brokentaxapath = p / "labelled_supertree" / "broken_taxa.json";
             fs::path annotationspath = p / "annotated_supertree" / "annotations.json";
-            fs::path contestingtrees_path = p / "subproblems" / "contesting-trees.json";
 
 	    bool missing_files = false;
 	    for(auto& path: {treepath, annotationspath, configpath})
@@ -963,17 +1196,43 @@ bool read_trees(const fs::path & dirname, TreesToServe & tts, const string& tax_
 		    LOG(DEBUG) <<"In "<<p<<", found "<<path<<".";
 	    }
 	    if (missing_files) continue;
+            tree_dirs.push_back(p);
+        }
+    }
 
-            try
-	    {
-                if (read_tree_and_annotations(configpath, treepath, annotationspath, brokentaxapath, contestingtrees_path, tts, tax_version_check))
-		    known_tree_dirs.insert(p);
-            }
-	    catch (const std::exception & x)
-	    {
-                LOG(WARNING) << "Exception while reading summary tree directory:\n   "<<x.what();
-            }
+    vector<unique_ptr<LoadedSummaryTree>> loaded(tree_dirs.size());
+    shared_work_pool().parallel_for(tree_dirs.size(), [&](std::size_t i) {
+        const fs::path & p = tree_dirs[i];
+        fs::path configpath = p / "config";
+        fs::path treepath = p / "labelled_supertree" / "labelled_supertree.tre";
+        fs::path brokentaxapath = p / "labelled_supertree" / "broken_taxa.json";
+        fs::path annotationspath = p / "annotated_supertree" / "annotations.json";
+        fs::path contestingtrees_path = p / "subproblems" / "contesting-trees.json";
+        fs::path snapshot_path;
+        if (not snapshot_dir.empty()) {
+            snapshot_path = snapshot_dir / ("tree-" + p.filename().string() + ".otcsnap");
+        }
+        const auto start = chrono::steady_clock::now();
+        try {
+            loaded[i] = read_tree_and_annotations(configpath, treepath, annotationspath, brokentaxapath, contestingtrees_path, tts, tax_version_check, snapshot_path);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            LOG(INFO) << "Reading summary tree directory " << p << " took " << elapsed.count() << " seconds.";
+        } catch (const std::exception & x) {
+            LOG(WARNING) << "Exception while reading summary tree directory:\n   "<<x.what();
         }
+    });
+
+    for (std::size_t i = 0; i < tree_dirs.size(); ++i) {
+        if (not loaded[i]) {
+            continue;
+        }
+        try {
+            tts.register_tree_and_annotations(std::move(*loaded[i]));
+            known_tree_dirs.insert(tree_dirs[i]);
+        } catch (const std::exception & x) {
+            LOG(WARNING) << "Exception while registering summary tree directory " << tree_dirs[i] << ":\n   "<<x.what();
+        }
+        loaded[i].reset();
     }
     tts.final_tree_added();
     return true;
@@ -1008,7 +1267,9 @@ inline std::size_t calc_memory_used(const RTRichTaxTreeData &d, MemoryBookkeeper
     mb["taxonomy data name_to_node"] += nn_sz;
     mb["taxonomy data non_unique_taxon_names"] += nutn_sz;
     mb["taxonomy data homonym_to_nodes"] += htn_sz;
-    return nm_sz + gm_sz + wm_sz + fm_sz + im_sz + f2j_sz + in_sz + nn_sz + nutn_sz + htn_sz;
+    std::size_t pool_sz = d.name_pool.bytes_allocated() + d.source_info_pool.bytes_allocated();
+    mb["taxonomy data string pools"] += pool_sz;
+    return nm_sz + gm_sz + wm_sz + fm_sz + im_sz + f2j_sz + in_sz + nn_sz + nutn_sz + htn_sz + pool_sz;
 }
 
 template<>
@@ -1035,7 +1296,7 @@ inline std::size_t calc_memory_used(const RTRichTaxNodeData &rtn, MemoryBookkeep
     mb["taxonomy node data rank"] += x; total += x;
     x = sizeof(int32_t) + sizeof(std::bitset<32>);
     mb["taxonomy node data flags"] += x; total += x;
-    x = calc_memory_used(rtn.source_info, mb);
+    x = sizeof(std::string_view);
     mb["taxonomy node data source_info"] += x; total += x;
     x = sizeof(std::string_view);
     mb["taxonomy node data nonunique name"] += x; total += x;
@@ -1095,30 +1356,325 @@ void mark_summary_tree_nodes_extinct(SummaryTree_t& tree, const RichTaxonomy& ta
     }
 }
 
-bool read_tree_and_annotations(const fs::path & config_path,
-                               const fs::path & tree_path,
-                               const fs::path & annotations_path,
-                               const fs::path & brokentaxa_path,
-                               const fs::path & contestingtrees_path,
-                               TreesToServe & tts,
-			       const string& tax_version_check)
+// Builds the json value of a run of SAX events, for the (small) fields of annotations.json.
+class JsonDomBuilder {
+    json value;
+    vector<json *> open_containers;
+    string key;
+    json * add(json && v) {
+        if (open_containers.empty()) {
+            value = std::move(v);
+            return &value;
+        }
+        json & parent = *open_containers.back();
+        if (parent.is_object()) {
+            return &(parent[key] = std::move(v));
+        }
+        parent.push_back(std::move(v));
+        return &parent.back();
+    }
+    public:
+    bool done() const {
+        return open_containers.empty();
+    }
+    json take() {
+        return std::move(value);
+    }
+    void scalar(json && v) {
+        add(std::move(v));
+    }
+    void start_container(json && v) {
+        open_containers.push_back(add(std::move(v)));
+    }
+    void end_container() {
+        open_containers.pop_back();
+    }
+    void set_key(const string & k) {
+        key = k;
+    }
+};
+
+// Reads annotations.json with nlohmann's SAX interface.
+//
+// Parsing it into a DOM took several times the memory of the server once booted, almost
+//  all of it in the "nodes" object (one small object per node of the tree). Here the
+//  support statements of each node are collected for the SourceEdgeMappingTable of the
+//  tree, and only the other top-level fields are kept as json, in `header`.
+// Ids of nodes that are not in the tree are not an error until the caller has checked
+//  the taxonomy version (from `header`), so the first one is kept in `missing_node`.
+class AnnotationsSaxReader {
+    public:
+    json header = json::object();
+    bool saw_nodes = false;
+    std::string missing_node;
+    std::string error_message;
+
+    AnnotationsSaxReader(SourceNodeIdTable & ids_arg,
+                         const SummaryTree_t & tree_arg,
+                         const RichTaxonomy & taxonomy_arg)
+        :ids(ids_arg),
+         tree(tree_arg),
+         taxonomy(taxonomy_arg),
+         mapping_builder(tree_arg.get_data().frozen->size()) {
+    }
+    // Stores the support statements read into `table`.
+    void build_mapping_table(SourceEdgeMappingTable & table) const {
+        mapping_builder.build(table);
+    }
+
+    bool null() {
+        return scalar(nullptr);
+    }
+    bool boolean(bool val) {
+        if (reading_node() and depth == 3 and field == Field::was_uncontested) {
+            node_data->was_uncontested = val;
+            return true;
+        }
+        return scalar(val);
+    }
+    bool number_integer(json::number_integer_t val) {
+        return scalar(val);
+    }
+    bool number_unsigned(json::number_unsigned_t val) {
+        return scalar(val);
+    }
+    bool number_float(json::number_float_t val, const std::string &) {
+        return scalar(val);
+    }
+    bool string(std::string & val) {
+        // {"tree": "node"} is read as {"tree": ["node"]}, as it was from the DOM.
+        if (reading_node() and field == Field::mapping and (depth == 4 or depth == 5)) {
+            const auto * vp = ids.get_stored_string(val);
+            const auto sni_ind = ids.get_source_node_id_index(src_node_id(source_key, vp));
+            node_mappings.emplace_back(field_semt, sni_ind);
+            field_source_keys.push_back(source_key);
+            return true;
+        }
+        return scalar(val);
+    }
+    bool binary(json::binary_t &) {
+        throw OTCError() << "Unexpected binary value.";
+    }
+    bool start_object(std::size_t) {
+        return start_container(json::object());
+    }
+    bool end_object() {
+        return end_container();
+    }
+    bool start_array(std::size_t) {
+        return start_container(json::array());
+    }
+    bool end_array() {
+        return end_container();
+    }
+    bool key(std::string & val) {
+        if (in_header) {
+            header_value.set_key(val);
+        } else if (depth == 1) {
+            in_nodes = (val == "nodes");
+            if (in_nodes) {
+                saw_nodes = true;
+            } else {
+                in_header = true;
+                header_key = val;
+            }
+        } else if (in_nodes and depth == 2) {
+            start_node(val);
+        } else if (reading_node() and depth == 3) {
+            start_field(val);
+        } else if (reading_node() and depth == 4) {
+            source_key = ids.get_stored_string(val);
+        }
+        return true;
+    }
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception & ex) {
+        error_message = ex.what();
+        return false;
+    }
+
+    private:
+    enum class Field {
+        mapping,
+        was_uncontested,
+        ignored
+    };
+
+    SourceNodeIdTable & ids;
+    const SummaryTree_t & tree;
+    const RichTaxonomy & taxonomy;
+
+    int depth = 0;
+    bool in_nodes = false;
+    bool in_header = false;
+    std::string header_key;
+    JsonDomBuilder header_value;
+
+    SumTreeNodeData * node_data = nullptr;
+    Field field = Field::ignored;
+    std::string field_name;
+    const std::string * source_key = nullptr;
+    SourceEdgeMappingType field_semt = SUPPORTED_BY_MAPPING;
+    vec_src_node_ids node_mappings;
+    SourceEdgeMappingTableBuilder mapping_builder;
+    std::vector<const std::string *> field_source_keys;
+    std::vector<std::size_t> field_order;
+
+    bool reading_node() const {
+        return in_nodes and node_data != nullptr;
+    }
+    bool scalar(json && v) {
+        if (in_header) {
+            header_value.scalar(std::move(v));
+            finish_header_value();
+        } else if (in_nodes and depth == 1) {
+            throw OTCError() << "Expected \"nodes\" field to be an object.\n";
+        } else if (reading_node() and depth >= 3) {
+            if (field == Field::was_uncontested) {
+                throw OTCError() << "Expected was_uncontested to be a boolean.";
+            }
+            if (field == Field::mapping) {
+                throw OTCError() << "Expected " << field_name << " to map tree ids to lists of node ids.";
+            }
+        }
+        return true;
+    }
+    bool start_container(json && v) {
+        depth += 1;
+        if (in_header) {
+            header_value.start_container(std::move(v));
+        } else if (in_nodes and depth == 2 and not v.is_object()) {
+            throw OTCError() << "Expected \"nodes\" field to be an object.\n";
+        } else if (reading_node() and depth >= 4) {
+            if (field == Field::was_uncontested) {
+                throw OTCError() << "Expected was_uncontested to be a boolean.";
+            }
+            if (field == Field::mapping and (depth > 5 or (depth == 4 and not v.is_object()))) {
+                throw OTCError() << "Expected " << field_name << " to map tree ids to lists of node ids.";
+            }
+        }
+        return true;
+    }
+    bool end_container() {
+        depth -= 1;
+        if (in_header) {
+            header_value.end_container();
+            finish_header_value();
+        } else if (reading_node() and depth == 3 and field == Field::mapping) {
+            finish_field();
+        } else if (reading_node() and depth == 2) {
+            // The DOM was walked in key order, and the mapping types are numbered in
+            //  the order of their keys.
+            std::stable_sort(node_mappings.begin(), node_mappings.end(),
+                             [](const auto & a, const auto & b) {return a.first < b.first;});
+            mapping_builder.add(node_data->frozen_index, node_mappings);
+            node_data = nullptr;
+        } else if (in_nodes and depth == 1) {
+            in_nodes = false;
+        }
+        return true;
+    }
+    // Puts the mappings of the field just read in the order of their tree ids, as
+    //  walking the field's json object did. The order of the node ids is kept.
+    void finish_field() {
+        auto & mappings = node_mappings;
+        const auto n = field_source_keys.size();
+        const auto first = mappings.size() - n;
+        auto key_less = [&](std::size_t a, std::size_t b) {
+            return *field_source_keys[a] < *field_source_keys[b];
+        };
+        field_order.resize(n);
+        std::iota(field_order.begin(), field_order.end(), std::size_t(0));
+        if (not std::is_sorted(field_order.begin(), field_order.end(), key_less)) {
+            std::stable_sort(field_order.begin(), field_order.end(), key_less);
+            const vec_src_node_ids unsorted(mappings.begin() + first, mappings.end());
+            for (std::size_t i = 0; i < n; ++i) {
+                mappings[first + i] = unsorted[field_order[i]];
+            }
+        }
+        field_source_keys.clear();
+    }
+    void finish_header_value() {
+        if (header_value.done()) {
+            header[header_key] = header_value.take();
+            in_header = false;
+        }
+    }
+    void start_node(const std::string & node_id) {
+        auto result = find_node_by_id_str(tree, taxonomy, node_id);
+        if (result.node() == nullptr) {
+            if (missing_node.empty()) {
+                missing_node = node_id;
+            }
+            node_data = nullptr;
+            return;
+        }
+        node_data = &(const_cast<SumTreeNode_t *>(result.node())->get_data());
+        node_mappings.clear();
+    }
+    void start_field(const std::string & k) {
+        field_name = k;
+        field_source_keys.clear();
+        if (k == "was_uncontested") {
+            field = Field::was_uncontested;
+            return;
+        }
+        if (k == "was_constrained") {
+            field = Field::ignored;
+            return;
+        }
+        field = Field::mapping;
+        if (k == "supported_by") {
+            field_semt = SUPPORTED_BY_MAPPING;
+        } else if (k == "terminal") {
+            field_semt = TERMINAL_MAPPING;
+        } else if (k == "conflicts_with") {
+            field_semt = CONFLICTS_WITH_MAPPING;
+        } else if (k == "partial_path_of") {
+            field_semt = PARTIAL_PATH_OF_MAPPING;
+        } else if (k == "resolves") {
+            field_semt = RESOLVES_MAPPING;
+        } else {
+            throw OTCError() << "Unrecognized annotations key " << k;
+        }
+    }
+};
+
+unique_ptr<LoadedSummaryTree> read_tree_and_annotations(const fs::path & config_path,
+                                                        const fs::path & tree_path,
+                                                        const fs::path & annotations_path,
+                                                        const fs::path & brokentaxa_path,
+                                                        const fs::path & contestingtrees_path,
+                                                        const TreesToServe & tts,
+                                                        const string& tax_version_check,
+                                                        const fs::path & snapshot_path)
 {
     auto locked_taxonomy = tts.get_readable_taxonomy();
     const auto & taxonomy = locked_taxonomy.first;
 
-    std::string annot_str = annotations_path.native();
-    std::ifstream annotations_stream(annot_str.c_str());
-    json annotations_obj;
-    try {
-        annotations_stream >> annotations_obj;
-    } catch (...) {
-        LOG(WARNING) << "Could not read \"" << annotations_path << "\" as JSON.\n";
-        throw;
+#   if defined(REPORT_MEMORY_USAGE)
+        MemoryBookkeeper tax_mem_b;
+        std::size_t tree_mem = 0;
+        auto tax_mem = calc_memory_used(taxonomy, tax_mem_b);
+        write_memory_bookkeeping(INTERNAL_LOG_MESSAGE(INFO).stream(), tax_mem_b, "taxonomy", tax_mem);
+#   endif
+    // The node annotations are read straight into the tree, so it has to be loaded first.
+    auto loaded = tts.read_new_tree(config_path.native(), tree_path.native(), snapshot_path.native());
+    auto & tree = *loaded->tree;
+    auto & sta = *loaded->annotations;
+    AnnotationsSaxReader annotations_reader(loaded->source_node_ids, tree, taxonomy);
+    {
+        std::ifstream annotations_stream(annotations_path.native());
+        if (not json::sax_parse(annotations_stream, &annotations_reader)) {
+            LOG(WARNING) << "Could not read \"" << annotations_path << "\" as JSON.\n";
+            throw OTCError() << annotations_reader.error_message;
+        }
     }
+    annotations_reader.build_mapping_table(tree.get_data().source_edge_mappings);
+    const json & annotations_obj = annotations_reader.header;
 
     // Check that the tree was built against the correct taxonomy.
-    string tree_tax_version = annotations_obj["taxonomy_version"];
-    string synth_id = annotations_obj["synth_id"];
+    string tree_tax_version = extract_string(annotations_obj, "taxonomy_version");
+    string synth_id = extract_string(annotations_obj, "synth_id");
     if (tree_tax_version != taxonomy.get_version()) {
         // propinquity now tags ott versions with "modified: root id" in custom synth
         //  but the tree still reflects the unmodified OTT version string. 
@@ -1126,12 +1682,18 @@ bool read_tree_and_annotations(const fs::path & config_path,
         auto taxv = taxonomy.get_version();
         auto ttaxvm = tree_tax_version + "modified";
 
-	// FIXME! We should really have an "or-newer" option, but that requires parsing and comparing versions.
-	if (!lcase_match_prefix(taxv, ttaxvm) and tax_version_check == "exact") {
+        // FIXME! We should really have an "or-newer" option, but that requires parsing and comparing versions.
+        if (!lcase_match_prefix(taxv, ttaxvm) and tax_version_check == "exact") {
             LOG(WARNING) << "Read \"" << annotations_path << "\" as JSON.\n";
             throw OTCError()<<"Tree with <synth_id='"<<synth_id<<"',taxonomy_version='"<<tree_tax_version<<"'> does not match taxonomy version '"<<taxonomy.get_version()<<"' (= or modified)";
         }
     }
+    if (not annotations_reader.saw_nodes) {
+        throw OTCError() << "Missing \"nodes\" field.\n";
+    }
+    if (not annotations_reader.missing_node.empty()) {
+        throw OTCError() << "Node " << annotations_reader.missing_node << " from annotations not found in tree.";
+    }
 
     std::ifstream contestingtrees_stream(contestingtrees_path.native().c_str());
     json contestingtrees_obj;
@@ -1151,171 +1713,86 @@ bool read_tree_and_annotations(const fs::path & config_path,
         LOG(WARNING) << "Could not read \"" << brokentaxa_path << "\" as JSON.\n";
         throw;
     }
-#   if defined(REPORT_MEMORY_USAGE)
-        MemoryBookkeeper tax_mem_b;
-        std::size_t tree_mem = 0;
-        auto tax_mem = calc_memory_used(taxonomy, tax_mem_b);
-        write_memory_bookkeeping(INTERNAL_LOG_MESSAGE(INFO).stream(), tax_mem_b, "taxonomy", tax_mem);
-#   endif
-    auto [tree,sta] = tts.get_new_tree_and_annotations(config_path.native(), tree_path.native());
-    try {
 
-        mark_summary_tree_nodes_extinct(tree, taxonomy);
-
-        sta = annotations_obj;
-        json tref;
-        tref["taxonomy"] = taxonomy.get_version();
-        sta.full_source_id_map_json[taxonomy.get_version()] = tref;
-
-        // read the node annotations and add them to the tree.
-        auto node_obj = extract_obj(annotations_obj, "nodes");
-        auto & sum_tree_data = tree.get_data();
-        //const auto & n2n = sum_tree_data.name_to_node;
-        for (json::const_iterator nit = node_obj.begin(); nit != node_obj.end(); ++nit) {
-            string k = nit.key();
-            auto result = find_node_by_id_str(tree, taxonomy, k);
-            //auto stnit = n2n.find(k);
-            if (result.node() == nullptr) {
-                throw OTCError() << "Node " << k << " from annotations not found in tree.";
-            }
-            //const SumTreeNode_t * stn = stnit->second;
-            SumTreeNode_t * mstn = const_cast<SumTreeNode_t *>(result.node());
-            SumTreeNodeData & mstnd = mstn->get_data();
-            const auto & supportj = nit.value();
-#           if defined(JOINT_MAPPING_VEC)
-                vec_src_node_ids tmpv;
-#           endif
-            for (json::const_iterator sbit = supportj.begin(); sbit != supportj.end(); ++sbit) {
-                const auto & sbk = sbit.key();
-                const auto & sbv = sbit.value();
-                if (sbk == "supported_by") {            
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::SUPPORTED_BY_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.supported_by = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "terminal") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::TERMINAL_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.terminal = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "conflicts_with") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::CONFLICTS_WITH_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.conflicts_with = extract_node_id_vec(tts, sbv)
-#                   endif
-                } else if (sbk == "partial_path_of") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::PARTIAL_PATH_OF_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.partial_path_of = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "resolves") {
-#                   if defined(JOINT_MAPPING_VEC)
-                        auto x = extract_node_id_vec(tts, sbv, SourceEdgeMappingType::RESOLVES_MAPPING);
-                        tmpv.insert(end(tmpv), x.begin(), x.end());
-#                   else
-                        mstnd.resolves = extract_node_id_vec(tts, sbv);
-#                   endif
-                } else if (sbk == "was_uncontested") {
-                    if (sbv.is_boolean()) {
-                        mstnd.was_uncontested =  sbv.get<bool>();
-                    } else {
-                        throw OTCError() << "Expected was_uncontested to be a boolean.";
-                    }
-                } else {
-                    if (sbk != "was_constrained") {
-                        throw OTCError() << "Unrecognized annotations key " << sbit.key();
-                    }
-                }
-            }
-#           if defined(JOINT_MAPPING_VEC)
-                mstnd.source_edge_mappings.clear();
-                std::swap(mstnd.source_edge_mappings, tmpv);
-                //LOG(INFO) << "mstnd.source_edge_mappings size = " << mstnd.source_edge_mappings.size() << " for k = " << k;
-#           endif
+    mark_summary_tree_nodes_extinct(tree, taxonomy);
 
-        }
+    sta = annotations_obj;
+    json tref;
+    tref["taxonomy"] = taxonomy.get_version();
+    sta.full_source_id_map_json[taxonomy.get_version()] = tref;
+    auto & sum_tree_data = tree.get_data();
 
-        // Read in the 'contesting-trees.json' file.  We aren't using all the info yet.
-        auto& contesting_trees_for_taxon = sum_tree_data.contesting_trees_for_taxon;
-        for(auto& [taxon,trees]: contestingtrees_obj.items())
+    // Read in the 'contesting-trees.json' file.  We aren't using all the info yet.
+    auto& contesting_trees_for_taxon = sum_tree_data.contesting_trees_for_taxon;
+    for(auto& [taxon,trees]: contestingtrees_obj.items())
+    {
+        vector<contesting_tree_t> contesting_trees;
+        for(auto& [tree,attachment_points_json]: trees.items())
         {
-            vector<contesting_tree_t> contesting_trees;
-            for(auto& [tree,attachment_points_json]: trees.items())
+            contesting_tree_t contesting_tree;
+            // Remove extension ".tre"
+            assert(tree.substr(tree.size()-4) == ".tre");
+            contesting_tree.tree = tree.substr(0,tree.size()-4);
+            for(auto& attachment_point_json: attachment_points_json)
             {
-                contesting_tree_t contesting_tree;
-                // Remove extension ".tre"
-                assert(tree.substr(tree.size()-4) == ".tre");
-                contesting_tree.tree = tree.substr(0,tree.size()-4);
-                for(auto& attachment_point_json: attachment_points_json)
+                attachment_point_t A;
+                assert(attachment_point_json.count("parent"));
+                assert(attachment_point_json.count("children_from_taxon")>0);
+
+                A.parent = attachment_point_json["parent"].get<string>();
+                A.parent = strip_surrounding_whitespace(A.parent);
+                A.parent = get_source_node_name_if_available(A.parent);
+
+                for(auto& child_json: attachment_point_json["children_from_taxon"])
                 {
-                    attachment_point_t A;
-                    assert(attachment_point_json.count("parent"));
-                    assert(attachment_point_json.count("children_from_taxon")>0);
-
-                    A.parent = attachment_point_json["parent"].get<string>();
-                    A.parent = strip_surrounding_whitespace(A.parent);
-                    A.parent = get_source_node_name_if_available(A.parent);
-
-                    for(auto& child_json: attachment_point_json["children_from_taxon"])
-                    {
-                        string child = child_json.get<string>();
-                        child = strip_surrounding_whitespace(child);
-                        child = get_source_node_name_if_available(child);
-                        A.children_from_taxon.push_back(child);
-                    }
-                    contesting_tree.attachment_points.push_back(A);
+                    string child = child_json.get<string>();
+                    child = strip_surrounding_whitespace(child);
+                    child = get_source_node_name_if_available(child);
+                    A.children_from_taxon.push_back(child);
                 }
-                contesting_trees.push_back(contesting_tree);
+                contesting_tree.attachment_points.push_back(A);
             }
-            contesting_trees_for_taxon.insert({taxon, contesting_trees});
+            contesting_trees.push_back(contesting_tree);
         }
+        contesting_trees_for_taxon.insert({taxon, contesting_trees});
+    }
 
-        auto & tree_broken_taxa = sum_tree_data.broken_taxa;
-        // read the info from the broken taxa file
-        if (brokentaxa_obj.count("non_monophyletic_taxa")
-            && (!brokentaxa_obj["non_monophyletic_taxa"].is_null())) {
-            auto & nmt_obj = extract_obj(brokentaxa_obj, "non_monophyletic_taxa");
-            for (json::const_iterator btit = nmt_obj.begin(); btit != nmt_obj.end(); ++btit) {
-                string broken_ott = btit.key();
-                auto & dest_obj = btit.value();
-                string mrca_id = extract_string(dest_obj, "mrca");
-                auto & attach_obj = extract_obj(dest_obj, "attachment_points");
-                list<string> attach_id_list;
-                for (json::const_iterator ai_it = attach_obj.begin(); ai_it != attach_obj.end(); ++ai_it) {
-                    attach_id_list.push_back(ai_it.key());
-                }
-                auto mrca_result = find_node_by_id_str(tree, taxonomy, mrca_id);
-                vector<const SumTreeNode_t *> avec;
-                avec.reserve(attach_id_list.size());
-                for (auto attach_id : attach_id_list) {
-                    auto anptr = find_node_by_id_str(tree, taxonomy, attach_id).node();
-                    assert(anptr != nullptr);
-                    avec.push_back(anptr);
-                }
-                tree_broken_taxa[broken_ott] = BrokenMRCAAttachVec(mrca_result.node(), avec);
+    auto & tree_broken_taxa = sum_tree_data.broken_taxa;
+    // read the info from the broken taxa file
+    if (brokentaxa_obj.count("non_monophyletic_taxa")
+        && (!brokentaxa_obj["non_monophyletic_taxa"].is_null())) {
+        auto & nmt_obj = extract_obj(brokentaxa_obj, "non_monophyletic_taxa");
+        for (json::const_iterator btit = nmt_obj.begin(); btit != nmt_obj.end(); ++btit) {
+            string broken_ott = btit.key();
+            auto & dest_obj = btit.value();
+            string mrca_id = extract_string(dest_obj, "mrca");
+            auto & attach_obj = extract_obj(dest_obj, "attachment_points");
+            list<string> attach_id_list;
+            for (json::const_iterator ai_it = attach_obj.begin(); ai_it != attach_obj.end(); ++ai_it) {
+                attach_id_list.push_back(ai_it.key());
+            }
+            auto mrca_result = find_node_by_id_str(tree, taxonomy, mrca_id);
+            vector<const SumTreeNode_t *> avec;
+            avec.reserve(attach_id_list.size());
+            for (auto attach_id : attach_id_list) {
+                auto anptr = find_node_by_id_str(tree, taxonomy, attach_id).node();
+                assert(anptr != nullptr);
+                avec.push_back(anptr);
             }
+            tree_broken_taxa[broken_ott] = BrokenMRCAAttachVec(mrca_result.node(), avec);
         }
-        sta.initialized = true;
-        tts.register_last_tree_and_annotations();
-#       if defined(REPORT_MEMORY_USAGE)
-            MemoryBookkeeper tree_mem_b;
-            tree_mem += calc_memory_used_by_tree(tree, tree_mem_b);
-            write_memory_bookkeeping(INTERNAL_LOG_MESSAGE(INFO).stream(), tree_mem_b, "tree", tree_mem);
-            LOG(INFO) << "tax + tree memory = " << tax_mem << " + " << tree_mem << " = " << tax_mem + tree_mem;
-#       endif
-    } catch (...) {
-        tts.free_last_tree_and_annotations();
-        throw;
     }
-    return true;
+    sta.initialized = true;
+#   if defined(REPORT_MEMORY_USAGE)
+        MemoryBookkeeper tree_mem_b;
+        tree_mem += calc_memory_used_by_tree(tree, tree_mem_b);
+        const std::size_t frozen_mem = loaded->frozen->bytes_allocated();
+        tree_mem_b["frozen tree"] += frozen_mem;
+        tree_mem += frozen_mem;
+        write_memory_bookkeeping(INTERNAL_LOG_MESSAGE(INFO).stream(), tree_mem_b, "tree", tree_mem);
+        LOG(INFO) << "tax + tree memory = " << tax_mem << " + " << tree_mem << " = " << tax_mem + tree_mem;
+#   endif
+    return loaded;
 }
 
 }// namespace otc